@@ -23,6 +23,11 @@ public:
 	virtual bool LoadAsset(Asset *asset) = 0;
 	virtual void DestroyAsset(Asset *asset) = 0;
 
+	// io stage of an AssetStreamer load, runs on an io thread before
+	//  LoadAsset (which then should not block on the device).
+	//  must not touch the asset beyond reading its name.
+	virtual void PrefetchAsset(Asset *asset) {}
+
 	virtual std::set<file::Path> EnumerateExisting() = 0;
 };
 
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <ork/asset/Asset.h>
+#include <ork/asset/AssetStreamer.h>
 #include <ork/kernel/mutex.h>
 #include <ork/file/path.h>
 
@@ -26,6 +27,13 @@ public:
 	static AssetType* Load(const PieceString &asset_name);
 	static AssetType* LoadUnManaged(const PieceString &asset_name);
 	static bool AutoLoad(int depth = -1);
+
+	// streamed loads (see AssetStreamer), never block the caller
+	static AssetLoadHandle LoadAsync(const PieceString &asset_name, EAssetLoadPriority priority = EASSETPRI_NORMAL);
+	static int AutoLoadAsync(EAssetLoadPriority priority = EASSETPRI_NORMAL, int depth = -1);
+	// appends a handle per request, decodes on decodeq instead of the manager's
+	static int AutoLoadAsync(orkvector<AssetLoadHandle>& handles, Opq* decodeq, EAssetLoadPriority priority = EASSETPRI_NORMAL, int depth = -1);
+	static void SetDecodeOpQ(Opq* decodeq) { gDecodeOpQ = decodeq; } // nullptr : ConcurrentOpQ
 #if defined(ORKCONFIG_ASSET_UNLOAD)
 	static bool AutoUnLoad(int depth = -1);
 #endif
@@ -37,6 +45,7 @@ private:
 
 	static ork::recursive_mutex gLock;
 	static bool gbAUTOLOAD;
+	static Opq* gDecodeOpQ;
 };
 
 
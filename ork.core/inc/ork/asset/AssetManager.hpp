@@ -7,6 +7,7 @@
 #include <ork/pch.h>
 
 #include <ork/asset/AssetLoader.h>
+#include <ork/asset/AssetSetEntry.h>
 #include <ork/util/RingLink.hpp>
 
 namespace ork { namespace asset {
@@ -15,6 +16,8 @@ template<typename AssetType> ork::recursive_mutex AssetManager<AssetType>::gLock
 
 template<typename AssetType> bool AssetManager<AssetType>::gbAUTOLOAD = true;
 
+template<typename AssetType> Opq* AssetManager<AssetType>::gDecodeOpQ = nullptr;
+
 
 template<typename AssetType>
 inline
@@ -48,6 +51,17 @@ AssetType *AssetManager<AssetType>::Load(const PieceString& asset_name)
 	{
 		if( false == asset->IsLoaded() )
 		{
+			AssetSetEntry* entry = GetAssetSetEntry(asset);
+
+			if( AssetLoadRequest* request = entry->GetStreamRequest() )
+			{
+				// already streaming, wait for it instead of loading it twice
+				AssetLoadHandle handle(asset,request);
+				gLock.UnLock();
+				handle.Wait();
+				return asset;
+			}
+
 			asset->Load();
 		}
 		gLock.UnLock();
@@ -83,6 +97,59 @@ bool AssetManager<AssetType>::AutoLoad(int depth)
 	}
 }
 
+template<typename AssetType>
+inline
+AssetLoadHandle AssetManager<AssetType>::LoadAsync(const PieceString& asset_name, EAssetLoadPriority priority)
+{
+	AssetLoadHandle handle;
+
+	gLock.Lock();
+	if(AssetType *asset = Create(asset_name))
+	{
+		AssetSetEntry* entry = GetAssetSetEntry(asset);
+		handle = AssetStreamer::GetRef().Request(entry, gLock, priority, gDecodeOpQ);
+	}
+	gLock.UnLock();
+
+	return handle;
+}
+
+template<typename AssetType>
+inline
+int AssetManager<AssetType>::AutoLoadAsync(EAssetLoadPriority priority, int depth)
+{
+	if( false == gbAUTOLOAD )
+		return 0;
+
+	orkvector<AssetSetEntry*> entries;
+
+	gLock.Lock();
+	AssetType::GetClassStatic()->GetAssetSet().EnumerateUnloaded(entries,depth);
+	for( AssetSetEntry* entry : entries )
+		AssetStreamer::GetRef().Request(entry, gLock, priority, gDecodeOpQ);
+	gLock.UnLock();
+
+	return int(entries.size());
+}
+
+template<typename AssetType>
+inline
+int AssetManager<AssetType>::AutoLoadAsync(orkvector<AssetLoadHandle>& handles, Opq* decodeq, EAssetLoadPriority priority, int depth)
+{
+	if( false == gbAUTOLOAD )
+		return 0;
+
+	orkvector<AssetSetEntry*> entries;
+
+	gLock.Lock();
+	AssetType::GetClassStatic()->GetAssetSet().EnumerateUnloaded(entries,depth);
+	for( AssetSetEntry* entry : entries )
+		handles.push_back( AssetStreamer::GetRef().Request(entry, gLock, priority, decodeq) );
+	gLock.UnLock();
+
+	return int(entries.size());
+}
+
 #if defined(ORKCONFIG_ASSET_UNLOAD)
 template<typename AssetType>
 inline
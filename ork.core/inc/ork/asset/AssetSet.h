@@ -30,6 +30,7 @@ public:
 	AssetLoader *FindLoader(PoolString name);
 
 	bool Load(int depth = -1);
+	void EnumerateUnloaded(orkvector<AssetSetEntry *> &entries, int depth = -1);
 #if defined(ORKCONFIG_ASSET_UNLOAD)
 	bool UnLoad(int depth = -1);
 #endif
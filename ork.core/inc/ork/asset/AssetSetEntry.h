@@ -14,6 +14,7 @@ class Asset;
 class AssetLoader;
 class AssetDependent;
 class AssetSetLevel;
+struct AssetLoadRequest;
 
 class AssetSetEntry
 {
@@ -30,14 +31,21 @@ public:
 	Asset *GetAsset() const;
 	AssetLoader *GetLoader() const;
 	bool IsLoaded();
+	void MarkLoaded(AssetSetLevel *level);
 	util::dependency::Provider *GetLoadProvider();
 
+	// the in flight AssetStreamer request (guarded by the AssetManager lock),
+	//  Load() does not load a streaming asset a second time
+	AssetLoadRequest *GetStreamRequest() const { return mStreamRequest; }
+	void SetStreamRequest(AssetLoadRequest *request) { mStreamRequest = request; }
+
 private:
 	Asset *mAsset;
 	AssetLoader *mLoader;
 	util::dependency::Provider mLoadProvider;
 	AssetSetLevel *mDeclareLevel;
 	AssetSetLevel *mLoadLevel;
+	AssetLoadRequest *mStreamRequest;
 };
 
 AssetSetEntry *GetAssetSetEntry(const Asset *asset);
@@ -0,0 +1,158 @@
+///////////////////////////////////////////////////////////////////////////////
+// Orkid
+// Copyright 1996-2010, Michael T. Mayers
+///////////////////////////////////////////////////////////////////////////////
+// AssetStreamer
+//
+//  asynchronous asset loading, in two stages :
+//   io     : AssetLoader::PrefetchAsset on one of a few io threads,
+//             highest priority request first
+//   decode : AssetLoader::LoadAsset as an op on the request's decode Opq
+//             (ConcurrentOpQ by default)
+//
+//  requests are made through AssetManager<T>::LoadAsync / AutoLoadAsync,
+//   a second request for an asset which is already streaming returns the
+//   same request (raising its priority if needed).
+//
+//  AssetLoadHandle h = AssetManager<TextureAsset>::LoadAsync("data://tex",EASSETPRI_HIGH);
+//  ...
+//  if( h.IsDone() ) ... or h.Wait();
+//
+//  Wait does whatever is left of the request on the calling thread when it
+//   can (reading a still queued request, decoding when the request decodes
+//   on the waiter's Opq or on ConcurrentOpQ), so a LoadAsset which waits on
+//   another asset does not wait on a decode op queued behind itself.
+//
+//  loaders whose LoadAsset must run on a specific thread (gpu context, ..)
+//   should have their AssetManager decode on that thread's Opq
+//   (AssetManager<T>::SetDecodeOpQ).
+//  asset levels must not be popped while their assets stream.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <ork/kernel/atomic.h>
+#include <ork/kernel/mutex.h>
+#include <ork/kernel/thread.h>
+#include <ork/kernel/future.hpp>
+#include <ork/rtti/downcast.h>
+#include <ork/orkstl.h>
+#include <deque>
+
+namespace ork { struct Opq; }
+
+namespace ork { namespace asset {
+
+class Asset;
+class AssetLoader;
+class AssetSetEntry;
+
+///////////////////////////////////////////////////////////////////////////////
+
+enum EAssetLoadPriority
+{
+	EASSETPRI_LOW = 0,		// prefetch for later
+	EASSETPRI_NORMAL,
+	EASSETPRI_HIGH,
+	EASSETPRI_CRITICAL,		// someone is waiting on it
+	EASSETPRI_COUNT,
+};
+
+enum EAssetLoadState
+{
+	EASSETREQ_QUEUED = 0,
+	EASSETREQ_READING,
+	EASSETREQ_READ,			// decode op queued, not yet claimed
+	EASSETREQ_DECODING,
+	EASSETREQ_DONE,
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct AssetLoadRequest
+{
+	AssetLoadRequest(AssetSetEntry* entry, ork::recursive_mutex* lock, Opq* decodeq);
+
+	void AddRef();
+	void Release();	// deletes the request with the last reference
+
+	AssetSetEntry*			mEntry;
+	Asset*					mAsset;
+	AssetLoader*			mLoader;
+	ork::recursive_mutex*	mpLock;		// lock of the AssetManager which owns the asset
+	Opq*					mDecodeOpQ;
+	ork::atomic<int>		mPriority;
+	ork::atomic<int>		mState;		// EAssetLoadState
+	ork::atomic<int>		mRefCount;
+	bool					mbLoaded;
+	Future					mFuture;	// signaled (with mbLoaded) when done
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+class AssetLoadHandle
+{
+public:
+	AssetLoadHandle();
+	AssetLoadHandle(Asset* asset, AssetLoadRequest* request=nullptr);
+	AssetLoadHandle(const AssetLoadHandle& oth);
+	AssetLoadHandle& operator=(const AssetLoadHandle& oth);
+	~AssetLoadHandle();
+
+	bool IsValid() const { return mAsset!=nullptr; }
+	bool IsDone() const;
+	bool Wait() const; // raises the request to EASSETPRI_CRITICAL, true if the asset loaded
+	void Raise(EAssetLoadPriority priority) const;
+
+	Asset* GetAsset() const { return mAsset; }
+	template <typename T> T* GetAsset() const { return rtti::safe_downcast<T*>(mAsset); }
+
+private:
+	Asset*				mAsset;
+	AssetLoadRequest*	mRequest; // nullptr if the asset was loaded when requested
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+class AssetStreamer
+{
+public:
+	static const int kdefaultiothreads = 2;
+	static const int kmaxiothreads = 8;
+
+	static AssetStreamer& GetRef();
+
+	// caller holds lock (the AssetManager lock which guards entry)
+	AssetLoadHandle Request(AssetSetEntry* entry, ork::recursive_mutex& lock, EAssetLoadPriority priority, Opq* decodeq);
+	void Raise(AssetLoadRequest* request, EAssetLoadPriority priority);
+	bool Wait(AssetLoadRequest* request); // see AssetLoadHandle::Wait
+
+	void SetNumIoThreads(int inumthreads); // before the first request
+	int GetNumIoThreads() const { return miNumIoThreads; }
+	int GetNumPending() const { return miNumPending.load(); }
+	void WaitAll();
+
+private:
+
+	AssetStreamer();
+	~AssetStreamer();
+
+	void StartIoThreads();
+	void IoThreadLoop();
+	void Read(AssetLoadRequest* request); // caller moved it to EASSETREQ_READING
+	void QueueDecode(AssetLoadRequest* request);
+	bool TryDecode(AssetLoadRequest* request); // false if someone else claimed it
+	void Decode(AssetLoadRequest* request);
+	void Enqueue(AssetLoadRequest* request, int ipriority); // mMutex held
+
+	std::mutex					mMutex;
+	std::condition_variable		mIoCV;
+	std::condition_variable		mDoneCV;
+	std::deque<AssetLoadRequest*> mIoQueues[EASSETPRI_COUNT];
+	std::vector<ork::Thread*>	mIoThreads;
+	int							miNumIoThreads;
+	ork::atomic<int>			miNumPending;
+	bool						mbGoingDown;
+};
+
+} }
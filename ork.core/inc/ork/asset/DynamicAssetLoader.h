@@ -18,14 +18,17 @@ struct DynamicAssetLoader : public AssetLoader
 	bool CheckAsset(const PieceString &) override;
 	bool LoadAsset(Asset *asset) override;
 	void DestroyAsset(Asset *asset) override;
+	void PrefetchAsset(Asset *asset) override;
 	std::set<file::Path> EnumerateExisting() override;
 
 	typedef std::function<bool(const PieceString &name)> check_fn_t;
 	typedef std::function<bool(Asset* passet)> load_fn_t;
+	typedef std::function<void(Asset* passet)> prefetch_fn_t;
 	typedef std::function<std::set<file::Path>()> enum_fn_t;
 
 	check_fn_t mCheckFn;
 	load_fn_t mLoadFn;
+	prefetch_fn_t mPrefetchFn;
 	enum_fn_t mEnumFn;
 };
 
@@ -35,6 +35,7 @@ struct FileAssetLoader : public AssetLoader
 	bool FindAsset(const PieceString &, MutableString result, int first_extension = 0);
 	bool CheckAsset(const PieceString &) override;
 	bool LoadAsset(Asset *asset) override;
+	void PrefetchAsset(Asset *asset) override;
 	void AddLocation( file_pathbase_t b, file_ext_t e );
 
 protected:
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <ork/file/file.h>
+#include <ork/file/mappedfile.h>
 #include <ork/util/endian.h>
 #include <ork/stream/IOutputStream.h>
 #include <ork/kernel/string/StringBlock.h>
@@ -25,6 +26,24 @@ namespace ork {
 	
 namespace chunkfile {
 
+///////////////////////////////////////////////////////////////////////////////
+// file layout :
+//  magic ("chka", or "chkf" for packed legacy files)
+//  string table length, string table, file type (string index)
+//  chunk count, chunk table (name string index, offset, length)
+//  chunk data, offsets are relative to the first chunk.
+//  in "chka" files the first chunk starts at a kchunkalign boundary of the
+//  file and every chunk offset is a multiple of kchunkalign.
+///////////////////////////////////////////////////////////////////////////////
+
+static const int kchunkalign = 64;
+
+enum EReadMode
+{
+	EREADMODE_ALLOCATE = 0,	// chunks are read into Allocator memory
+	EREADMODE_MAPPED,		// streams point into the (copy on write) mapped file
+};
+
 class OutputStream : public ork::stream::IOutputStream
 {
 public:
@@ -95,6 +114,12 @@ struct InputStream
 
 ///////////////////////////////////////////////////////////////////////////////
 
+///////////////////////////////////////////////////////////////////////////////
+// EREADMODE_MAPPED : the Allocator is not used, stream data lives (and pages
+//  in lazily) until the Reader is destroyed, writes to it stay private.
+//  falls back to EREADMODE_ALLOCATE if the file can not be mapped.
+///////////////////////////////////////////////////////////////////////////////
+
 template <typename Allocator> class Reader
 {
 	static const int kmaxstreams = 16;
@@ -105,21 +130,36 @@ template <typename Allocator> class Reader
 
 public:
 	
-	Reader( const file::Path& inpath, const char* ptype );
+	Reader( const file::Path& inpath, const char* ptype, EReadMode emode=EREADMODE_ALLOCATE );
 	~Reader();
 
 	InputStream* GetStream( const char* streamname );
 	const char* GetString( int index );	
 
 	bool IsOk() const { return mbOk; }
+	bool IsMapped() const { return mMappedFile.IsOpen(); }
 
 private:
+
+	struct ChunkDesc
+	{
+		int32_t miName;
+		int32_t miOffset;
+		int32_t miLength;
+	};
+
+	template <typename ReadFn>
+	bool ReadHeader( ReadFn& rd, const char* ptype, orkvector<ChunkDesc>& chunks, size_t& idatabase );
+	bool ReadMapped( const char* ptype );
+	bool ReadAllocated( const file::Path& inpath, const char* ptype );
+	void AddStream( int ic, const ChunkDesc& desc, void* pdata );
 	
 	int	mistrtablen;
 	const char* mpstrtab;
 	bool mbOk;
 
 	StreamLut mInputStreams;
+	file::MappedFile mMappedFile;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
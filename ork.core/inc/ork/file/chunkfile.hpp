@@ -64,7 +64,7 @@ Reader<Allocator>::~Reader()
     {
         const PoolString& pname = it->first;
         InputStream* stream = it->second;
-        if( stream->GetLength() )
+        if( stream->GetLength() && false==IsMapped() ) // mapped streams are not ours
         {
             mAllocator.done(pname.c_str(),stream->GetDataAt(0));
         }
@@ -72,73 +72,161 @@ Reader<Allocator>::~Reader()
 }
 ///////////////////////////////////////////////////////////////////////////////
 template <typename Allocator> 
-Reader<Allocator>::Reader( const file::Path& inpath, const char* ptype )
+Reader<Allocator>::Reader( const file::Path& inpath, const char* ptype, EReadMode emode )
     : mpstrtab( 0 )
     , mistrtablen( 0 )
     , mbOk( false )
 {
-    const Char4 good_chunk_magic("chkf");
     OrkHeapCheck();
     if( CFileEnv::GetRef().DoesFileExist( inpath ) )
     {
-        ork::CFile inputfile( inpath, ork::EFM_READ );
-        OrkHeapCheck();
-
-        ///////////////////////////
-        Char4 bad_chunk_magic;
-        inputfile.Read( & bad_chunk_magic, sizeof(bad_chunk_magic) );
-        OrkAssert( bad_chunk_magic==good_chunk_magic );
-        OrkHeapCheck();
-        ///////////////////////////
-        inputfile.Read( & mistrtablen, sizeof(mistrtablen) );
-        char* pst = new char[ mistrtablen ];
-        inputfile.Read( pst, mistrtablen );
-        mpstrtab = pst;
-        OrkHeapCheck();
-        ///////////////////////////
-        int32_t ifiletype = 0;
-        inputfile.Read( & ifiletype, sizeof(ifiletype) );
-        const char* pthistype = mpstrtab+ifiletype;
-        OrkAssert( 0 == strcmp(pthistype,ptype) );
-        OrkHeapCheck();
-        ///////////////////////////
-        int32_t inumchunks = 0;
-        inputfile.Read( & inumchunks, sizeof(inumchunks) );
-        mbOk = true;
-        ///////////////////////////
-        for( int ic=0; ic<inumchunks; ic++ )
+        if( emode==EREADMODE_MAPPED && mMappedFile.Open( inpath, true ) )
+            mbOk = ReadMapped( ptype );
+        else
+            mbOk = ReadAllocated( inpath, ptype );
+    }
+    OrkHeapCheck();
+}
+///////////////////////////////////////////////////////////////////////////////
+// rd( void* dest, size_t size ) reads the next bytes of the file
+///////////////////////////////////////////////////////////////////////////////
+template <typename Allocator> template <typename ReadFn>
+bool Reader<Allocator>::ReadHeader( ReadFn& rd, const char* ptype, orkvector<ChunkDesc>& chunks, size_t& idatabase )
+{
+    const Char4 packed_chunk_magic("chkf");
+    const Char4 aligned_chunk_magic("chka");
+    ///////////////////////////
+    Char4 chunk_magic;
+    if( false == rd( & chunk_magic, sizeof(chunk_magic) ) )
+        return false;
+    bool baligned = (chunk_magic==aligned_chunk_magic);
+    OrkAssert( baligned || chunk_magic==packed_chunk_magic );
+    if( false == (baligned || chunk_magic==packed_chunk_magic) )
+        return false;
+    ///////////////////////////
+    if( false == rd( & mistrtablen, sizeof(mistrtablen) ) || mistrtablen<=0 )
+        return false;
+    char* pst = new char[ mistrtablen ];
+    if( false == rd( pst, mistrtablen ) )
+    {
+        delete[] pst;
+        return false;
+    }
+    mpstrtab = pst;
+    ///////////////////////////
+    int32_t ifiletype = 0;
+    rd( & ifiletype, sizeof(ifiletype) );
+    const char* pthistype = GetString(ifiletype);
+    OrkAssert( 0 == strcmp(pthistype,ptype) );
+    if( 0 != strcmp(pthistype,ptype) )
+        return false;
+    ///////////////////////////
+    int32_t inumchunks = 0;
+    rd( & inumchunks, sizeof(inumchunks) );
+    OrkAssert( inumchunks>=0 && inumchunks<=kmaxstreams );
+    if( inumchunks<0 || inumchunks>kmaxstreams )
+        return false;
+    chunks.resize( inumchunks );
+    for( int ic=0; ic<inumchunks; ic++ )
+    {
+        ChunkDesc& desc = chunks[ic];
+        rd( & desc.miName, sizeof(desc.miName) );
+        rd( & desc.miOffset, sizeof(desc.miOffset) );
+        if( false == rd( & desc.miLength, sizeof(desc.miLength) ) )
+            return false;
+    }
+    ///////////////////////////
+    idatabase = sizeof(Char4) + sizeof(int32_t) + size_t(mistrtablen)
+              + 2*sizeof(int32_t) + size_t(inumchunks)*sizeof(ChunkDesc);
+    if( baligned )
+        idatabase = (idatabase+kchunkalign-1) & ~size_t(kchunkalign-1);
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////
+template <typename Allocator>
+void Reader<Allocator>::AddStream( int ic, const ChunkDesc& desc, void* pdata )
+{
+    PoolString psname = AddPooledString( GetString(desc.miName) );
+    InputStream* stream = & mStreamBank[ic];
+    new ( stream ) InputStream( desc.miLength ? pdata : 0, desc.miLength );
+    mInputStreams.AddSorted(psname,stream);
+}
+///////////////////////////////////////////////////////////////////////////////
+template <typename Allocator>
+bool Reader<Allocator>::ReadMapped( const char* ptype )
+{
+    const u8* pfile = mMappedFile.GetData();
+    size_t ifilesize = mMappedFile.GetSize();
+    size_t icursor = 0;
+    auto rd = [&]( void* pdest, size_t isize ) -> bool
+    {
+        if( icursor+isize > ifilesize )
+            return false;
+        memcpy( pdest, pfile+icursor, isize );
+        icursor += isize;
+        return true;
+    };
+    ///////////////////////////
+    orkvector<ChunkDesc> chunks;
+    size_t idatabase = 0;
+    if( false == ReadHeader( rd, ptype, chunks, idatabase ) )
+        return false;
+    ///////////////////////////
+    u8* pdata = mMappedFile.GetMutableData()+idatabase;
+    for( int ic=0; ic<int(chunks.size()); ic++ )
+    {
+        const ChunkDesc& desc = chunks[ic];
+        OrkAssert( idatabase+size_t(desc.miOffset)+size_t(desc.miLength) <= ifilesize );
+        if( idatabase+size_t(desc.miOffset)+size_t(desc.miLength) > ifilesize )
+            return false;
+        AddStream( ic, desc, pdata+desc.miOffset );
+    }
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////
+template <typename Allocator>
+bool Reader<Allocator>::ReadAllocated( const file::Path& inpath, const char* ptype )
+{
+    ork::CFile inputfile( inpath, ork::EFM_READ );
+    size_t icursor = 0;
+    auto rd = [&]( void* pdest, size_t isize ) -> bool
+    {
+        icursor += isize;
+        return ork::EFEC_FILE_OK == inputfile.Read( pdest, isize );
+    };
+    ///////////////////////////
+    orkvector<ChunkDesc> chunks;
+    size_t idatabase = 0;
+    if( false == ReadHeader( rd, ptype, chunks, idatabase ) )
+        return false;
+    ///////////////////////////
+    for( int ic=0; ic<int(chunks.size()); ic++ )
+    {
+        const ChunkDesc& desc = chunks[ic];
+        PoolString psname = AddPooledString( GetString(desc.miName) );
+        void* pdata = 0;
+        if( desc.miLength )
         {
-            int32_t ichunkid, ioffset, ichunklen;
-            inputfile.Read( & ichunkid, sizeof(ichunkid) );
-            inputfile.Read( & ioffset, sizeof(ioffset) );
-            inputfile.Read( & ichunklen, sizeof(ichunklen) );
-            PoolString psname = AddPooledString( GetString(ichunkid) );
-            InputStream* stream = & mStreamBank[ic];
-            OrkHeapCheck();
-            if( ichunklen )
-            {
-                void* pdata = mAllocator.alloc( psname.c_str(), ichunklen );
-                OrkAssert( pdata != 0 );
-                new ( stream ) InputStream( pdata, ichunklen );
-                mInputStreams.AddSorted(psname,stream);
-            }
-            else
-            {
-                new ( stream ) InputStream( 0, 0 );
-                mInputStreams.AddSorted(psname,stream);
-            }
-            OrkHeapCheck();
+            pdata = mAllocator.alloc( psname.c_str(), desc.miLength );
+            OrkAssert( pdata != 0 );
         }
-        ///////////////////////////
-        for( int ic=0; ic<inumchunks; ic++ )
+        AddStream( ic, desc, pdata );
+    }
+    ///////////////////////////
+    for( int ic=0; ic<int(chunks.size()); ic++ )
+    {
+        const ChunkDesc& desc = chunks[ic];
+        if( 0 == desc.miLength )
+            continue;
+        size_t ipos = idatabase+size_t(desc.miOffset);
+        if( ipos != icursor )
         {
-            if( mStreamBank[ic].GetLength() )
-            {
-                inputfile.Read( mStreamBank[ic].GetDataAt(0), mStreamBank[ic].GetLength() );
-            }
+            inputfile.SeekFromStart( ipos );
+            icursor = ipos;
         }
-        ///////////////////////////
+        rd( mStreamBank[ic].GetDataAt(0), desc.miLength );
     }
+    return true;
 }
 ////////////////////////////////////////////////////////////////////////////////////
 template <typename Allocator> InputStream* Reader<Allocator>::GetStream( const char* streamname )
@@ -0,0 +1,51 @@
+////////////////////////////////////////////////////////////////
+// Orkid Media Engine
+// Copyright 1996-2012, Michael T. Mayers.
+// Distributed under the Boost Software License - Version 1.0 - August 17, 2003
+// see http://www.boost.org/LICENSE_1_0.txt
+////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <ork/orktypes.h>
+#include <ork/file/path.h>
+#include <ork/orkstl.h>
+
+namespace ork { namespace file {
+
+///////////////////////////////////////////////////////////////////////////////
+// read only view of a whole file
+//  memory mapped where the platform allows it (IX), otherwise the file is
+//  read into a heap buffer. the data stays valid until Close() or destruction.
+//  bcopyonwrite : the data may be patched in place, touched pages become
+//   private copies (the file is never modified)
+///////////////////////////////////////////////////////////////////////////////
+
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open( const Path& filename, bool bcopyonwrite=false );
+	void Close();
+
+	bool IsOpen() const { return mpData!=nullptr; }
+	bool IsMapped() const { return mbMapped; }
+	const u8* GetData() const { return mpData; }
+	u8* GetMutableData() const { return mbWritable ? const_cast<u8*>(mpData) : nullptr; }
+	size_t GetSize() const { return miSize; }
+
+private:
+
+	MappedFile( const MappedFile& ); // not copyable
+	MappedFile& operator=( const MappedFile& );
+
+	const u8*		mpData;
+	size_t			miSize;
+	bool			mbMapped;
+	bool			mbWritable;
+	orkvector<u8>	mHeapCopy;
+};
+
+} }
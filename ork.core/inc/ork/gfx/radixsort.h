@@ -22,7 +22,8 @@ class RadixSort
 	~RadixSort();
 	// Sorting methods
 	RadixSort&		Sort(const U32* input, U32 nb, bool signedvalues=true);
-	RadixSort&		Sort(const float* input, U32 nb);
+	RadixSort&		Sort(const float* input, U32 nb); // keeps the previous order while nb is unchanged (temporal coherence)
+	RadixSort&		Sort(const U64* input, U32 nb); // unsigned 64 bit keys (render queue sort keys)
 
 	//! Access to results. mIndices is a list of indices in sorted order, i.e. in the order you may further process your data
 	inline	U32*			GetIndices()		const	{ return mIndices;		}
@@ -59,7 +60,7 @@ private:
 
 
 
-	void CHECK_RESIZE( U32 n );
+	void CHECK_RESIZE( U32 n, bool keeporder=false );
 
     static void RadixZeroMem( void* addr, U32 size)
     {
@@ -87,11 +88,11 @@ private:
         while(p!=pe)
         {
             /* Read input buffer in previous sorted order */
-            U32 Val = (U32)buffer[*Indices++];
+            type Val = buffer[*Indices++];
             /* Check whether already sorted or not */
-            if(type(Val)<PrevVal) { AlreadySorted = false; break; } /* Early out */
+            if(Val<PrevVal) { AlreadySorted = false; break; } /* Early out */
             /* Update for next iteration */
-            PrevVal = type(Val);
+            PrevVal = Val;
 
             /* Create histograms */
             h0[*p++]++;     h1[*p++]++;     h2[*p++]++;     h3[*p++]++;
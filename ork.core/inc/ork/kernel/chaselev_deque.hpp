@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////////
+// Orkid - Copyright 2012 Michael T. Mayers
+///////////////////////////////////////////////////////////////////////////////
+// Chase-Lev work stealing deque (bounded)
+//
+//  after "Correct and Efficient Work-Stealing for Weak Memory Models"
+//   (Le, Pop, Cohen, Zappa Nardelli - PPoPP 2013)
+//
+//  the owning thread pushes and pops at the bottom (LIFO),
+//   any other thread may steal from the top (FIFO).
+//  storage is embedded and fixed size (like MpMcRingBuf),
+//   so the element type must be trivially copyable (typically a pointer)
+//   to allow racy reads by thieves which then lose the CAS.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <ork/kernel/atomic.h>
+#include <ork/kernel/ringbuffer.hpp>
+#include <stdint.h>
+#include <type_traits>
+
+namespace ork {
+
+template<typename T,size_t max_items> class ChaseLevDeque
+{
+public:
+
+	typedef T value_type;
+
+	ChaseLevDeque();
+
+	bool push(const T& item);	// owner thread only
+	bool pop(T& item);			// owner thread only
+	bool steal(T& item);		// any thread
+	bool empty() const;
+	size_t size() const;
+
+private:
+
+	typedef char cacheline_pad_t [cacheline_size];
+	static const intptr_t kMask = intptr_t(max_items)-1;
+
+	cacheline_pad_t			mPAD0;
+	ork::atomic<intptr_t>	mTop;
+	cacheline_pad_t			mPAD1;
+	ork::atomic<intptr_t>	mBottom;
+	cacheline_pad_t			mPAD2;
+	ork::atomic<T>			mItems[max_items];
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+template<typename T,size_t max_items>
+ChaseLevDeque<T,max_items>::ChaseLevDeque()
+{
+	const bool is_size_power_of_two = (max_items >= 2) && ((max_items & (max_items - 1)) == 0);
+	static_assert(is_size_power_of_two,"max_items must be a power of two");
+	static_assert(std::is_trivially_copyable<T>::value,"ChaseLevDeque items must be trivially copyable");
+
+	mTop.store(0,MemRelaxed);
+	mBottom.store(0,MemRelaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+template<typename T,size_t max_items>
+bool ChaseLevDeque<T,max_items>::push(const T& item)
+{
+	intptr_t b = mBottom.load(MemRelaxed);
+	intptr_t t = mTop.load(MemAcquire);
+
+	if( (b-t) >= intptr_t(max_items) ) // Full ?
+		return false;
+
+	mItems[b&kMask].store(item,MemRelaxed);
+	std::atomic_thread_fence(MemRelease);
+	mBottom.store(b+1,MemRelaxed);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+template<typename T,size_t max_items>
+bool ChaseLevDeque<T,max_items>::pop(T& item)
+{
+	intptr_t b = mBottom.load(MemRelaxed)-1;
+	mBottom.store(b,MemRelaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	intptr_t t = mTop.load(MemRelaxed);
+
+	if( t > b ) // Empty ?
+	{
+		mBottom.store(b+1,MemRelaxed);
+		return false;
+	}
+
+	item = mItems[b&kMask].load(MemRelaxed);
+
+	if( t == b ) // last item, race against thieves
+	{
+		bool won = mTop.compare_exchange_strong(t,t+1,std::memory_order_seq_cst,MemRelaxed);
+		mBottom.store(b+1,MemRelaxed);
+		return won;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+template<typename T,size_t max_items>
+bool ChaseLevDeque<T,max_items>::steal(T& item)
+{
+	intptr_t t = mTop.load(MemAcquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	intptr_t b = mBottom.load(MemAcquire);
+
+	if( t >= b ) // Empty ?
+		return false;
+
+	item = mItems[t&kMask].load(MemRelaxed);
+
+	return mTop.compare_exchange_strong(t,t+1,std::memory_order_seq_cst,MemRelaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+template<typename T,size_t max_items>
+bool ChaseLevDeque<T,max_items>::empty() const
+{
+	return size()==0;
+}
+
+template<typename T,size_t max_items>
+size_t ChaseLevDeque<T,max_items>::size() const
+{
+	intptr_t b = mBottom.load(MemRelaxed);
+	intptr_t t = mTop.load(MemRelaxed);
+	return (b>t) ? size_t(b-t) : 0;
+}
+
+} // ork
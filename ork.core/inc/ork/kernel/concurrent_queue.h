@@ -11,10 +11,10 @@ namespace ork {
 
 ///////////////////////////////////////////////////////////////////////////////
 
-template <typename T,size_t max_items=256>
+template <typename T,size_t max_items=256,typename wait_policy=MpMcSleepWait>
 struct MpMcBoundedQueue
 {
-    typedef MpMcRingBuf<T,max_items> impl_t;
+    typedef MpMcRingBuf<T,max_items,wait_policy> impl_t;
     typedef T value_type;
 
     MpMcBoundedQueue()
@@ -30,6 +30,10 @@ struct MpMcBoundedQueue
     {
         mImpl.push(item,quanta_usec);
     }
+    void push(T&& item, int quanta_usec=250) // blocking
+    {
+        mImpl.push(std::move(item),quanta_usec);
+    }
     void pop(T& item, int quanta_usec=250) // blocking
     {
         mImpl.pop(item,quanta_usec);
@@ -38,6 +42,10 @@ struct MpMcBoundedQueue
     {
         return mImpl.try_push(item);
     }
+    bool try_push(T&& item) // non-blocking
+    {
+        return mImpl.try_push(std::move(item));
+    }
     bool try_pop(T& item) // non-blocking
     {
         return mImpl.try_pop(item);
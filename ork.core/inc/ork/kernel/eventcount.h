@@ -0,0 +1,112 @@
+///////////////////////////////////////////////////////////////////////////////
+// Orkid - Copyright 2012 Michael T. Mayers
+///////////////////////////////////////////////////////////////////////////////
+// EventCount
+//
+//  lets a thread park until a lock free condition might have changed,
+//   without the notifier paying for a syscall when nobody is parked.
+//
+//  waiter:                          notifier:
+//    key = ec.PrepareWait();          <make condition true>
+//    if( condition ) CancelWait();    ec.NotifyOne() / NotifyAll();
+//    else ec.Wait(key);
+//
+//  linux parks on a futex, other platforms on a mutex/condvar.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <ork/kernel/atomic.h>
+#include <stdint.h>
+#include <limits.h>
+
+#if defined(ORK_LINUX)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <mutex>
+#include <condition_variable>
+#endif
+
+namespace ork {
+
+///////////////////////////////////////////////////////////////////////////////
+
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct EventCount
+{
+	EventCount()
+	{
+		mEpoch.store(0);
+		mNumWaiters.store(0);
+	}
+
+	uint32_t PrepareWait()
+	{
+		mNumWaiters.fetch_add(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		return mEpoch.load(MemAcquire);
+	}
+
+	void CancelWait()
+	{
+		mNumWaiters.fetch_sub(1);
+	}
+
+	void Wait(uint32_t key)
+	{
+#if defined(ORK_LINUX)
+		while( mEpoch.load(MemAcquire)==key )
+			syscall(SYS_futex,(uint32_t*)&mEpoch,FUTEX_WAIT_PRIVATE,key,nullptr,nullptr,0);
+#else
+		std::unique_lock<std::mutex> lock(mMutex);
+		while( mEpoch.load(MemAcquire)==key )
+			mCondVar.wait(lock);
+#endif
+		mNumWaiters.fetch_sub(1);
+	}
+
+	void NotifyOne() { Notify(1); }
+	void NotifyAll() { Notify(INT_MAX); }
+
+private:
+
+	void Notify(int count)
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if( 0 == mNumWaiters.load(MemRelaxed) )
+			return;
+		mEpoch.fetch_add(1,MemRelease);
+#if defined(ORK_LINUX)
+		syscall(SYS_futex,(uint32_t*)&mEpoch,FUTEX_WAKE_PRIVATE,count,nullptr,nullptr,0);
+#else
+		std::unique_lock<std::mutex> lock(mMutex);
+		if( count==1 )
+			mCondVar.notify_one();
+		else
+			mCondVar.notify_all();
+#endif
+	}
+
+	static_assert(sizeof(ork::atomic<uint32_t>)==sizeof(uint32_t),"futex word must be a plain uint32_t");
+
+	ork::atomic<uint32_t>		mEpoch;
+	ork::atomic<int>			mNumWaiters;
+#if ! defined(ORK_LINUX)
+	std::mutex					mMutex;
+	std::condition_variable		mCondVar;
+#endif
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+} // namespace ork
@@ -0,0 +1,210 @@
+////////////////////////////////////////////////////////////////
+// Orkid Media Engine
+// Copyright 1996-2012, Michael T. Mayers.
+// Distributed under the Boost Software License - Version 1.0 - August 17, 2003
+// see http://www.boost.org/LICENSE_1_0.txt
+////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//	FixedLambda<Sig,tsize> is a move only std::function replacement
+//	   which stores its callable inside the object (up to tsize bytes).
+//	Callables which fit are never heap allocated, so moving one through
+//	   a queue (eg. the Opq's MpMcRingBuf) costs a few word copies.
+//	Callables which do not fit fall back to a single heap allocation,
+//	   IsInline() can be used to check.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <assert.h>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ork {
+
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename Sig, size_t tsize> class FixedLambda;
+
+template <typename R, typename... Args, size_t tsize> class FixedLambda<R(Args...),tsize>
+{
+public:
+
+	static const size_t ksize = tsize;
+
+	//////////////////////////////////////////////////////////////
+	// per callable type dispatch table
+	//////////////////////////////////////////////////////////////
+
+	struct ops_t
+	{
+		R (*mInvoke)( void* storage, Args&&... args );
+		void (*mMove)( void* dst, void* src );
+		void (*mDestroy)( void* storage );
+		bool mInline;
+	};
+
+	//////////////////////////////////////////////////////////////
+
+	FixedLambda()
+		: mOps(nullptr)
+	{
+	}
+	FixedLambda( std::nullptr_t )
+		: mOps(nullptr)
+	{
+	}
+	//////////////////////////////////////////////////////////////
+	// typed constructor
+	//////////////////////////////////////////////////////////////
+	template <typename L,
+			  typename = typename std::enable_if<!std::is_same<typename std::decay<L>::type,FixedLambda>::value>::type>
+	FixedLambda( L&& l )
+		: mOps(nullptr)
+	{
+		typedef typename std::decay<L>::type fn_t;
+		Emplace<fn_t>(std::forward<L>(l));
+	}
+	//////////////////////////////////////////////////////////////
+	FixedLambda( FixedLambda&& oth )
+		: mOps(oth.mOps)
+	{
+		if( mOps )
+		{
+			mOps->mMove(mStorage,oth.mStorage);
+			oth.mOps = nullptr;
+		}
+	}
+	//////////////////////////////////////////////////////////////
+	FixedLambda& operator = ( FixedLambda&& oth )
+	{
+		if( this != & oth )
+		{
+			clear();
+			mOps = oth.mOps;
+			if( mOps )
+			{
+				mOps->mMove(mStorage,oth.mStorage);
+				oth.mOps = nullptr;
+			}
+		}
+		return *this;
+	}
+	//////////////////////////////////////////////////////////////
+	FixedLambda& operator = ( std::nullptr_t )
+	{
+		clear();
+		return *this;
+	}
+	//////////////////////////////////////////////////////////////
+	FixedLambda( const FixedLambda& oth ) = delete;
+	FixedLambda& operator = ( const FixedLambda& oth ) = delete;
+	//////////////////////////////////////////////////////////////
+	~FixedLambda()
+	{
+		clear();
+	}
+	//////////////////////////////////////////////////////////////
+	void clear()
+	{
+		if( mOps )
+		{
+			mOps->mDestroy(mStorage);
+			mOps = nullptr;
+		}
+	}
+	//////////////////////////////////////////////////////////////
+	R operator () ( Args... args )
+	{
+		assert(mOps!=nullptr);
+		return mOps->mInvoke(mStorage,std::forward<Args>(args)...);
+	}
+	//////////////////////////////////////////////////////////////
+	explicit operator bool () const { return mOps!=nullptr; }
+	bool IsInline() const { return (mOps!=nullptr) && mOps->mInline; }
+	//////////////////////////////////////////////////////////////
+
+private:
+
+	//////////////////////////////////////////////////////////////
+	// callable lives in mStorage
+	//////////////////////////////////////////////////////////////
+	template <typename F> struct inline_impl
+	{
+		static R invoke( void* storage, Args&&... args )
+		{
+			return (*static_cast<F*>(storage))(std::forward<Args>(args)...);
+		}
+		static void move( void* dst, void* src )
+		{
+			F* psrc = static_cast<F*>(src);
+			new (dst) F(std::move(*psrc));
+			psrc->~F();
+		}
+		static void destroy( void* storage )
+		{
+			static_cast<F*>(storage)->~F();
+		}
+		static const ops_t* get()
+		{
+			static const ops_t the_ops = { &invoke, &move, &destroy, true };
+			return & the_ops;
+		}
+	};
+	//////////////////////////////////////////////////////////////
+	// callable too big, mStorage holds a heap pointer
+	//////////////////////////////////////////////////////////////
+	template <typename F> struct heap_impl
+	{
+		static R invoke( void* storage, Args&&... args )
+		{
+			return (**static_cast<F**>(storage))(std::forward<Args>(args)...);
+		}
+		static void move( void* dst, void* src )
+		{
+			*static_cast<F**>(dst) = *static_cast<F**>(src);
+		}
+		static void destroy( void* storage )
+		{
+			delete *static_cast<F**>(storage);
+		}
+		static const ops_t* get()
+		{
+			static const ops_t the_ops = { &invoke, &move, &destroy, false };
+			return & the_ops;
+		}
+	};
+	//////////////////////////////////////////////////////////////
+	template <typename F, typename L> void Emplace( L&& l )
+	{
+		const bool fits = (sizeof(F)<=tsize)
+					   && (alignof(F)<=alignof(std::max_align_t))
+					   && std::is_nothrow_move_constructible<F>::value;
+		EmplaceImpl<F>(std::forward<L>(l),std::integral_constant<bool,fits>());
+	}
+	template <typename F, typename L> void EmplaceImpl( L&& l, std::true_type )
+	{
+		new (mStorage) F(std::forward<L>(l));
+		mOps = inline_impl<F>::get();
+	}
+	template <typename F, typename L> void EmplaceImpl( L&& l, std::false_type )
+	{
+		*reinterpret_cast<F**>(mStorage) = new F(std::forward<L>(l));
+		mOps = heap_impl<F>::get();
+	}
+	//////////////////////////////////////////////////////////////
+
+	static_assert(tsize>=sizeof(void*),"FixedLambda must at least hold a pointer");
+
+	alignas(std::max_align_t) char	mStorage[tsize];
+	const ops_t*					mOps;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+} // namespace ork
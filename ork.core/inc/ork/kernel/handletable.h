@@ -0,0 +1,149 @@
+////////////////////////////////////////////////////////////////
+// Orkid Media Engine
+// Copyright 1996-2012, Michael T. Mayers.
+// Distributed under the Boost Software License - Version 1.0 - August 17, 2003
+// see http://www.boost.org/LICENSE_1_0.txt
+////////////////////////////////////////////////////////////////
+
+// Generation checked handle table
+
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdint.h>
+#include <ork/orkstl.h>
+
+///////////////////////////////////////////////////////////////////////////////
+namespace ork{
+///////////////////////////////////////////////////////////////////////////////
+
+struct TableHandle
+{
+	uint32_t	muSlot;
+	uint32_t	muGeneration;	// 0 is never handed out
+
+	TableHandle() : muSlot(0), muGeneration(0) {}
+	TableHandle( uint32_t uslot, uint32_t ugen ) : muSlot(uslot), muGeneration(ugen) {}
+
+	bool IsNull() const { return 0==muGeneration; }
+	bool operator==( const TableHandle& oth ) const { return (muSlot==oth.muSlot) && (muGeneration==oth.muGeneration); }
+	bool operator!=( const TableHandle& oth ) const { return false==(*this==oth); }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// HandleTable : items stored contiguously, addressed by TableHandle
+//
+//  the items are kept dense, so iterating them (begin/end) is a linear walk.
+//   a handle goes stale once its item is removed (its slot's generation
+//   moves on), Get then returns null.
+//  Remove moves the last item into the removed one's place (constant time),
+//   so iteration order is the order of addition only until the first Remove.
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+class HandleTable
+{
+public:
+
+	typedef typename orkvector<T>::iterator iterator;
+	typedef typename orkvector<T>::const_iterator const_iterator;
+
+	TableHandle Add( const T& item )
+	{
+		uint32_t uslot;
+		if( mFreeSlots.size() )
+		{
+			uslot = mFreeSlots.back();
+			mFreeSlots.pop_back();
+		}
+		else
+		{
+			uslot = uint32_t(mSlots.size());
+			mSlots.push_back( Slot(1) );
+		}
+		Slot& slot = mSlots[uslot];
+		slot.muDense = uint32_t(mItems.size());
+		mItems.push_back(item);
+		mItemSlots.push_back(uslot);
+		return TableHandle( uslot, slot.muGeneration );
+	}
+
+	bool Remove( TableHandle h )
+	{
+		if( false==IsValid(h) )
+			return false;
+		Slot& slot = mSlots[h.muSlot];
+		uint32_t udense = slot.muDense;
+		uint32_t ulast = uint32_t(mItems.size())-1;
+		if( udense != ulast )
+		{
+			mItems[udense] = std::move(mItems[ulast]);
+			mItemSlots[udense] = mItemSlots[ulast];
+			mSlots[mItemSlots[udense]].muDense = udense;
+		}
+		mItems.pop_back();
+		mItemSlots.pop_back();
+		slot.muDense = kNoItem;
+		if( 0 == ++slot.muGeneration )
+			slot.muGeneration = 1;
+		mFreeSlots.push_back(h.muSlot);
+		return true;
+	}
+
+	void Clear() // all handles go stale
+	{
+		for( size_t i=0; i<mItemSlots.size(); i++ )
+		{
+			Slot& slot = mSlots[mItemSlots[i]];
+			slot.muDense = kNoItem;
+			if( 0 == ++slot.muGeneration )
+				slot.muGeneration = 1;
+			mFreeSlots.push_back(mItemSlots[i]);
+		}
+		mItems.clear();
+		mItemSlots.clear();
+	}
+
+	bool IsValid( TableHandle h ) const
+	{
+		return (h.muSlot<mSlots.size()) && (h.muGeneration==mSlots[h.muSlot].muGeneration) && (mSlots[h.muSlot].muDense!=kNoItem);
+	}
+
+	T* Get( TableHandle h ) { return IsValid(h) ? & mItems[mSlots[h.muSlot].muDense] : nullptr; }
+	const T* Get( TableHandle h ) const { return IsValid(h) ? & mItems[mSlots[h.muSlot].muDense] : nullptr; }
+
+	// position of the item in iteration order (-1 for a stale handle)
+	int IndexOf( TableHandle h ) const { return IsValid(h) ? int(mSlots[h.muSlot].muDense) : -1; }
+	TableHandle HandleAt( size_t idx ) const { return TableHandle( mItemSlots[idx], mSlots[mItemSlots[idx]].muGeneration ); }
+
+	size_t size() const { return mItems.size(); }
+	bool empty() const { return mItems.empty(); }
+	T& operator[]( size_t idx ) { return mItems[idx]; }
+	const T& operator[]( size_t idx ) const { return mItems[idx]; }
+	iterator begin() { return mItems.begin(); }
+	iterator end() { return mItems.end(); }
+	const_iterator begin() const { return mItems.begin(); }
+	const_iterator end() const { return mItems.end(); }
+
+private:
+
+	static const uint32_t kNoItem = 0xffffffff;
+
+	struct Slot
+	{
+		uint32_t	muGeneration;
+		uint32_t	muDense;	// index into mItems, kNoItem when free
+
+		Slot( uint32_t ugen ) : muGeneration(ugen), muDense(kNoItem) {}
+	};
+
+	orkvector<T>			mItems;
+	orkvector<uint32_t>		mItemSlots;		// slot of each item
+	orkvector<Slot>			mSlots;
+	orkvector<uint32_t>		mFreeSlots;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+} // namespace ork
+///////////////////////////////////////////////////////////////////////////////
@@ -5,6 +5,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 #include <ork/kernel/concurrent_queue.h>
 #include <ork/kernel/any.h>
+#include <ork/kernel/fixedlambda.h>
 #define _DEBUG_OPQ
 #include <ork/orkstl.h>
 #include <ork/util/Context.h>
@@ -16,6 +17,7 @@
 #include "semaphore.h"
 
 #include <set>
+#include <vector>
 
 ///////////////////////////////////////////////////////////////////////////////
 namespace ork {
@@ -28,9 +30,25 @@ void SetCurrentThreadName(const char* threadName);
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-typedef any128 op_wrap_t;
-
+struct Op;
 struct Opq;
+struct OpGroup;
+struct OpqWorker;
+struct OpqSlotPool;
+
+///////////////////////////////////////////////////////////////////////////////
+// EOPQMODE_SHARED       : workers scan all groups, pop from the shared group queues
+// EOPQMODE_WORKSTEALING : ops pushed from a worker go to that worker's
+//                          Chase-Lev deque, idle workers steal from each other.
+//                          limited (serial/maxinflight) groups and pushes
+//                          from foreign threads still use the group queues.
+///////////////////////////////////////////////////////////////////////////////
+
+enum EOpqMode
+{
+	EOPQMODE_SHARED = 0,
+	EOPQMODE_WORKSTEALING,
+};
 
 struct BarrierSyncReq
 {
@@ -38,20 +56,41 @@ struct BarrierSyncReq
 	Future& mFuture;
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// Op is move only, its lambda is stored inline (up to kinlinesize bytes
+//  of captures) and mName is not owned (use literals or PoolString::c_str())
+//  so pushing an op and moving it through the group queue never allocates.
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename L> using enable_if_oplambda_t = typename std::enable_if<
+	(false==std::is_same<typename std::decay<L>::type,Op>::value)
+ && (false==std::is_same<typename std::decay<L>::type,BarrierSyncReq>::value)>::type;
+
 struct Op
 {
-	op_wrap_t mWrapped;	
-	std::string mName;
+	static const size_t kinlinesize = 96;
+	typedef FixedLambda<void(),kinlinesize> lambda_t;
+
+	lambda_t mLambda;
+	const char* mName;
 
-	Op(const Op& oth);
-	Op(const BarrierSyncReq& op,const std::string& name="");
-	Op(const void_lambda_t& op,const std::string& name="");
 	Op();
+	Op(Op&& oth);
+	Op(const BarrierSyncReq& op,const char* name=nullptr);
+	template <typename L, typename = enable_if_oplambda_t<L>>
+	Op(L&& op,const char* name=nullptr)
+		: mLambda(std::forward<L>(op))
+		, mName(name)
+	{
+	}
 	~Op();
-	void SetOp(const op_wrap_t& op);
 
-	void QueueASync(Opq&q) const;
-	void QueueSync(Opq&q) const;
+	Op& operator = (Op&& oth);
+	Op(const Op& oth) = delete;
+	Op& operator = (const Op& oth) = delete;
+
+	void QueueASync(Opq&q);
+	void QueueSync(Opq&q);
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -71,6 +110,7 @@ struct OpqSynchro
 	int NumOps() const;
 
 	ork::atomic<int> 				mOpCounter;
+	ork::atomic<int> 				mNumWaiters;
 	std::condition_variable			mOpWaitCV;
 	std::mutex 						mOpWaitMtx;
 
@@ -89,10 +129,13 @@ struct OpGroup
 {
 
 	OpGroup(Opq*popq, const char* pname);
-	void push( const Op& the_op );
+	void push( Op&& the_op );
+	bool try_push( Op&& the_op ); // never blocks, false if the queue is full (or throttled)
 	bool try_pop( Op& out_op );
 	void drain();
 	void MakeSerial() { mLimitMaxOpsInFlight=1; }
+	bool TryBeginOp(); // claim an in flight slot (honors mLimitMaxOpsInFlight)
+	void EndOp();
 
 	////////////////////////////////
 
@@ -117,13 +160,18 @@ struct OpGroup
 
 struct Opq
 {
-	Opq(int inumthreads, const char* name = "DefOpQ");
+	Opq(int inumthreads, const char* name = "DefOpQ", EOpqMode mode = EOPQMODE_SHARED);
 	~Opq();
 
-	void push(const Op& the_op);
-	void push(const void_lambda_t& l,const std::string& name="");
+	void push(Op&& the_op);
 	void push(const BarrierSyncReq& s);
-	void push_sync(const Op& the_op);
+	template <typename L, typename = enable_if_oplambda_t<L>>
+	void push(L&& l,const char* name=nullptr)
+	{
+		push(Op(std::forward<L>(l),name));
+	}
+	bool try_push(Op&& the_op); // never blocks, false if the default group is full
+	void push_sync(Op&& the_op);
 	void sync();
 	void drain();
 
@@ -133,7 +181,12 @@ struct Opq
 	static Opq* GlobalSerQ();
 
 	bool Process();
+	bool ProcessGroups();
+	bool ProcessWorker(OpqWorker* pworker);
+	void RunOp(Op& the_op, OpGroup* pgrp);
+	void NotifyWorkers();
 
+	EOpqMode					mMode;
 	OpGroup* 					mDefaultGroup;
 	//ork::atomic<int>			 mOpCounter;
 	ork::atomic<int>			 mGroupCounter;
@@ -144,6 +197,10 @@ struct Opq
 
 	ork::semaphore mSemaphore;
 
+	std::vector<OpqWorker*>		mWorkers;	// EOPQMODE_WORKSTEALING only
+	OpqSlotPool*				mSlotPool;	// EOPQMODE_WORKSTEALING only
+	ork::atomic<int>			mNumSleepingWorkers;
+
 	bool mbGoingDown;
 	ork::atomic<int> mThreadsRunning;
 	std::string mName;
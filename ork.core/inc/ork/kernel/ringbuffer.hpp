@@ -24,13 +24,93 @@
 #pragma once
 
 #include <ork/kernel/atomic.h>
+#include <ork/kernel/eventcount.h>
 #include <unistd.h>
+#include <thread>
+#include <utility>
 
 namespace ork {
 
 static const size_t cacheline_size = 64;
 
-template<typename T,size_t max_items> class MpMcRingBuf
+///////////////////////////////////////////////////////////////////////////////
+// blocking push/pop wait policies
+//
+//  MpMcSleepWait    : poll with usleep(quanta) (the original behaviour),
+//                      try_push/try_pop pay nothing extra.
+//  MpMcAdaptiveWait : spin, then yield, then park on an EventCount.
+//                      wakeup latency is a futex wake instead of a quanta,
+//                      try_push/try_pop pay a fence + load to check for
+//                      parked threads.
+///////////////////////////////////////////////////////////////////////////////
+
+struct MpMcSleepWait
+{
+	template <typename try_op_t> void block_push( try_op_t op, int quanta_usec )
+	{
+		while(false==op())
+			usleep(quanta_usec);
+	}
+	template <typename try_op_t> void block_pop( try_op_t op, int quanta_usec )
+	{
+		while(false==op())
+			usleep(quanta_usec);
+	}
+	void notify_pushed() {}
+	void notify_popped() {}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct MpMcAdaptiveWait
+{
+	static const int kspins = 256;
+	static const int kyields = 16;
+
+	template <typename try_op_t> void block_push( try_op_t op, int quanta_usec )
+	{
+		block(mNotFull,op);
+	}
+	template <typename try_op_t> void block_pop( try_op_t op, int quanta_usec )
+	{
+		block(mNotEmpty,op);
+	}
+	void notify_pushed() { mNotEmpty.NotifyOne(); }
+	void notify_popped() { mNotFull.NotifyOne(); }
+
+private:
+
+	template <typename try_op_t> static void block( EventCount& ec, try_op_t& op )
+	{
+		for( int i=0; i<kspins; i++ )
+		{
+			if( op() ) return;
+			cpu_relax();
+		}
+		for( int i=0; i<kyields; i++ )
+		{
+			if( op() ) return;
+			std::this_thread::yield();
+		}
+		for(;;)
+		{
+			uint32_t key = ec.PrepareWait();
+			if( op() )
+			{
+				ec.CancelWait();
+				return;
+			}
+			ec.Wait(key);
+		}
+	}
+
+	EventCount mNotEmpty;
+	EventCount mNotFull;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+template<typename T,size_t max_items,typename wait_policy=MpMcSleepWait> class MpMcRingBuf
 {
 
 public:
@@ -43,14 +123,18 @@ public:
 	MpMcRingBuf(const MpMcRingBuf&oth);
 
 	void push(const T& data,int quanta_usec=250);
+	void push(T&& data,int quanta_usec=250);
 	void pop(T& data,int quanta_usec=250);
 	bool try_push(const T& data);
-	bool try_pop(T& data);
+	bool try_push(T&& data);
+	bool try_pop(T& data); // moves the item out of its cell
 
 private:
 
 	typedef char cacheline_pad_t [cacheline_size];
 
+	template <typename U> bool try_push_impl(U&& data);
+
 	struct cell_t
 	{
 		cell_t()
@@ -78,6 +162,8 @@ private:
 
 	};
 
+	cell_t* claim_push_cell(size_t& pos);
+
 	cacheline_pad_t         mPAD0;
 	cell_t  		        mCellBuffer[max_items];
 	const size_t            kBufferMask;
@@ -86,6 +172,7 @@ private:
 	cacheline_pad_t         mPAD2;
 	ork::atomic<size_t>     mDequeuePos;
 	cacheline_pad_t         mPAD3;
+	wait_policy             mWaitPolicy;
 
 }; 
 
@@ -95,8 +182,8 @@ private:
 ///////////////////////////////////////////////////////////////////////////////
 
 
-template<typename T,size_t max_items>
-MpMcRingBuf<T,max_items>::MpMcRingBuf()
+template<typename T,size_t max_items,typename wait_policy>
+MpMcRingBuf<T,max_items,wait_policy>::MpMcRingBuf()
 	: kBufferMask(max_items - 1)
 {
 
@@ -114,8 +201,8 @@ MpMcRingBuf<T,max_items>::MpMcRingBuf()
 	mDequeuePos.store(0,MemRelaxed);
 }
 
-template<typename T,size_t max_items>
-MpMcRingBuf<T,max_items>::MpMcRingBuf(const MpMcRingBuf&oth)
+template<typename T,size_t max_items,typename wait_policy>
+MpMcRingBuf<T,max_items,wait_policy>::MpMcRingBuf(const MpMcRingBuf&oth)
 	: kBufferMask(oth.kBufferMask)
 {
 	size_t bufsize = kBufferMask+1;
@@ -133,44 +220,51 @@ MpMcRingBuf<T,max_items>::MpMcRingBuf(const MpMcRingBuf&oth)
 
 ///////////////////////////////////////////////////////////////////////////////
 
-template<typename T,size_t max_items>
-MpMcRingBuf<T,max_items>::~MpMcRingBuf()
+template<typename T,size_t max_items,typename wait_policy>
+MpMcRingBuf<T,max_items,wait_policy>::~MpMcRingBuf()
 {
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-template<typename T,size_t max_items>
-void MpMcRingBuf<T,max_items>::push(const T& item,int quanta)
+template<typename T,size_t max_items,typename wait_policy>
+void MpMcRingBuf<T,max_items,wait_policy>::push(const T& item,int quanta)
 {
-	bool bpushed = try_push(item);
-	while(false==bpushed)
-	{
-		usleep(quanta);
-		bpushed = try_push(item);
-	}
+	if( try_push(item) )
+		return;
+	mWaitPolicy.block_push( [&]() -> bool { return try_push(item); }, quanta );
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-template<typename T,size_t max_items>
-void MpMcRingBuf<T,max_items>::pop(T& item,int quanta)
+template<typename T,size_t max_items,typename wait_policy>
+void MpMcRingBuf<T,max_items,wait_policy>::push(T&& item,int quanta)
 {
-	bool popped = try_pop(item);
-	while(false==popped)
-	{
-		usleep(quanta);
-		popped = try_pop(item);
-	}
+	if( try_push(std::move(item)) )
+		return;
+	mWaitPolicy.block_push( [&]() -> bool { return try_push(std::move(item)); }, quanta );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+template<typename T,size_t max_items,typename wait_policy>
+void MpMcRingBuf<T,max_items,wait_policy>::pop(T& item,int quanta)
+{
+	if( try_pop(item) )
+		return;
+	mWaitPolicy.block_pop( [&]() -> bool { return try_pop(item); }, quanta );
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// claim a cell for writing, nullptr if full
+//  the cell must then be published with mSequence.store(pos+1)
 ///////////////////////////////////////////////////////////////////////////////
 
-template<typename T,size_t max_items>
-bool MpMcRingBuf<T,max_items>::try_push(const T& data)
+template<typename T,size_t max_items,typename wait_policy>
+typename MpMcRingBuf<T,max_items,wait_policy>::cell_t* MpMcRingBuf<T,max_items,wait_policy>::claim_push_cell(size_t& pos)
 {
 	cell_t* cell = nullptr;
-	size_t pos = mEnqueuePos.load(MemRelaxed);
+	pos = mEnqueuePos.load(MemRelaxed);
 	for (;;)
 	{
 		cell = mCellBuffer + (pos & kBufferMask);
@@ -187,21 +281,47 @@ bool MpMcRingBuf<T,max_items>::try_push(const T& data)
 		}
 		//////////////////////////////////////
 		else if (dif < 0) // Full ?
-			return false;
+			return nullptr;
 		//////////////////////////////////////
 		else
 			pos = mEnqueuePos.load(MemRelaxed);
 	}
+	return cell;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+template<typename T,size_t max_items,typename wait_policy>
+template<typename U>
+bool MpMcRingBuf<T,max_items,wait_policy>::try_push_impl(U&& data)
+{
+	size_t pos = 0;
+	cell_t* cell = claim_push_cell(pos);
+	if( nullptr == cell )
+		return false;
 
-	cell->mData = data;
+	cell->mData = std::forward<U>(data);
 	cell->mSequence.store(pos + 1,MemRelease);
+	mWaitPolicy.notify_pushed();
 	return true;
 }
 
+template<typename T,size_t max_items,typename wait_policy>
+bool MpMcRingBuf<T,max_items,wait_policy>::try_push(const T& data)
+{
+	return try_push_impl(data);
+}
+
+template<typename T,size_t max_items,typename wait_policy>
+bool MpMcRingBuf<T,max_items,wait_policy>::try_push(T&& data)
+{
+	return try_push_impl(std::move(data));
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
-template<typename T,size_t max_items>
-bool MpMcRingBuf<T,max_items>::try_pop(T& data)
+template<typename T,size_t max_items,typename wait_policy>
+bool MpMcRingBuf<T,max_items,wait_policy>::try_pop(T& data)
 {
 	cell_t* cell;
 
@@ -232,8 +352,9 @@ bool MpMcRingBuf<T,max_items>::try_pop(T& data)
 	//////////////////////
 	// Read From Cell 
 	//////////////////////
-	data = cell->mData;
+	data = std::move(cell->mData);
 	cell->mSequence.store(1+pos+kBufferMask,MemRelease);
+	mWaitPolicy.notify_popped();
 	return true;
 
 }
@@ -19,6 +19,20 @@
 namespace ork {
 ///////////////////////////////////////////////////////////////////////////////
 
+///
+/// The interned record a PoolString points at, the hash and length are
+/// computed once when the string is pooled.
+///
+
+struct PoolStringNode
+{
+	const char *mpString;
+	size_t mHash;
+	size_t mLength;
+};
+
+size_t PoolStringHash(const char *string, size_t length);
+
 ///
 /// PoolStrings are like ConstStrings except their string pointers are
 /// guaranteed to be one-one with their data.  Comparisons between PoolStrings is
@@ -26,8 +40,8 @@ namespace ork {
 /// different orderings on different runs/platforms.
 ///
 /// To conserve space, and because PoolStrings are used in maps,
-/// there is no need to store the length of the string in the
-/// structure.
+/// the handle is a single pointer to its PoolStringNode, which holds
+/// the length and the precomputed hash.
 ///
 /// Consider PoolString the same thing as a const char * for use in maps
 /// with pooling keeping them unique.
@@ -46,6 +60,10 @@ public:
 	const char *data() const;
 	/// @return a chararcter pointer to NUL terminated data.
 	const char *c_str() const;
+	/// @return the length of the string (0 if not set).
+	size_t length() const;
+	/// @return the hash computed when the string was pooled (0 if not set).
+	size_t hash() const;
 
 	/// Casts this string to a PieceString
 	operator PieceString() const;
@@ -68,20 +86,20 @@ public:
 private:
 	friend class StringPool;
 
-	/// Constructs a pool string from a character pointer, used by StringPool.
-	PoolString(const char *string);
+	/// Constructs a pool string from its node, used by StringPool.
+	PoolString(const PoolStringNode *node);
 
 	int compare(const PoolString &) const;
 
-	/// The character pointer to the string data
-	const char *mpString;
+	/// The interned string
+	const PoolStringNode *mpNode;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
 inline
 PoolString::PoolString()
-	: mpString(NULL)
+	: mpNode(NULL)
 {}
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -89,7 +107,7 @@ PoolString::PoolString()
 inline
 const char *PoolString::data() const
 {
-	return mpString;
+	return mpNode ? mpNode->mpString : NULL;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -97,7 +115,23 @@ const char *PoolString::data() const
 inline
 const char *PoolString::c_str() const
 {
-	return mpString;
+	return mpNode ? mpNode->mpString : NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+inline
+size_t PoolString::length() const
+{
+	return mpNode ? mpNode->mLength : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+inline
+size_t PoolString::hash() const
+{
+	return mpNode ? mpNode->mHash : 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -106,7 +140,7 @@ const char *PoolString::c_str() const
 inline
 bool PoolString::operator ==(const PoolString &other) const
 {
-	return mpString == other.mpString;
+	return mpNode == other.mpNode;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -114,7 +148,7 @@ bool PoolString::operator ==(const PoolString &other) const
 inline
 bool PoolString::operator < (const PoolString &other) const
 {
-	return mpString < other.mpString;
+	return mpNode < other.mpNode;
 }
 #endif
 
@@ -13,41 +13,75 @@
 
 #include <ork/orkstl.h>
 #include <ork/kernel/mutex.h>
+#include <ork/kernel/atomic.h>
 
 ///////////////////////////////////////////////////////////////////////////////
 namespace ork {
 ///////////////////////////////////////////////////////////////////////////////
 
+struct StringPoolShard;
+
+///
+/// Concurrent string interner.
+///
+/// Strings are hash sharded, each shard is an open addressed table of
+/// PoolStringNode pointers. Finding a string which is already pooled
+/// never locks (tables are only ever published whole, and retired tables
+/// are kept alive), adding one locks only its shard.
+///
+
 class StringPool
 {
 public:
-	typedef orkvector<const char * > VecType;
+	static const int knumshards = 32;
 
 	explicit StringPool(const StringPool *parent = NULL);
+	~StringPool();
+
 	PoolString String(const PieceString &);
 	PoolString Literal(const ConstString &);
 	PoolString Find(const PieceString &) const;
 
-	int LiteralIndex(const ConstString &);
-	int StringIndex(const PieceString &);
-	int FindIndex(const PieceString &) const;
 	int Size() const;
-	PoolString FromIndex(int) const;
+
 private:
-	const char *FindRecursive(const PieceString &) const;
-	const char *FindFirst(const PieceString &, VecType::iterator &);
-	VecType::size_type BinarySearch(const PieceString &, bool &) const;
 
-	VecType										mStringPool;
-	mutable ork::recursive_mutex				mStringPoolMutex;
+	StringPool(const StringPool &); // not copyable
+	StringPool &operator=(const StringPool &);
+
+	const PoolStringNode *FindLocal(const PieceString &, size_t hash) const;
+	const PoolStringNode *FindRecursive(const PieceString &, size_t hash) const;
+	PoolString Add(const PieceString &, bool bliteral);
 
-	void Lock() const { mStringPoolMutex.Lock(); }
-	void UnLock() const { mStringPoolMutex.UnLock(); }
+	StringPoolShard *mShards;
+	ork::atomic<int> miSize;
 
 protected:
 	const StringPool *mParent;
 };
 
+///
+/// Index addressed pool of string back references for the binary
+/// archives : an index is the sorted position of the string at the time
+/// it is looked up, as written by BinarySerializer. Not thread safe.
+///
+
+class IndexedStringPool
+{
+public:
+	typedef orkvector<const char *> VecType;
+
+	void Literal(const char *);
+	int FindIndex(const PieceString &) const;
+	const char *FromIndex(int) const;
+	int Size() const { return int(mStrings.size()); }
+
+private:
+	VecType::size_type BinarySearch(const PieceString &, bool &) const;
+
+	VecType mStrings;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 }
 ///////////////////////////////////////////////////////////////////////////////
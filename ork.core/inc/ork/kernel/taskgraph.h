@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// Orkid - Copyright 2012 Michael T. Mayers
+///////////////////////////////////////////////////////////////////////////////
+// TaskGraph
+//
+//  dependency graph of tasks which runs on an Opq without blocking any
+//   of its threads: a task becomes ready when its last predecessor
+//   finishes. ready tasks go on the graph's own list, and an op which
+//   runs one of them is pushed from the thread which finished the
+//   predecessor (so in EOPQMODE_WORKSTEALING the continuation lands on
+//   that worker's own deque). Wait() only ever runs tasks of its graph.
+//
+//  TaskGraph tg;
+//  Task* a = tg.CreateTask([](){...},"a");
+//  Task* b = tg.CreateTask([](){...},"b");
+//  Task* c = tg.ParallelFor(0,n,64,[](int ib,int ie){...},"c");
+//  Task* d = tg.CreateTask([](){...},"d");
+//  tg.Precede(a,c);
+//  tg.Precede(b,c);
+//  tg.Precede(c,d);      // a and b, then c (in parallel), then d
+//  tg.Launch(ConcurrentOpQ());
+//  ...
+//  tg.Wait();            // or tg.SetOnComplete(..) and never wait
+//
+//  a graph is built once and can be launched again once it completed,
+//   so per frame pipelines do not need to rebuild (or allocate).
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <ork/kernel/opq.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+///////////////////////////////////////////////////////////////////////////////
+namespace ork {
+///////////////////////////////////////////////////////////////////////////////
+
+struct TaskGraph;
+struct TaskReadyList;
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct Task
+{
+	typedef Op::lambda_t lambda_t;
+
+	Task(TaskGraph* ptg, lambda_t&& l, const char* name);
+
+	TaskGraph* 				mGraph;
+	lambda_t				mLambda;		// may be empty (fork/join nodes)
+	const char*				mName;
+	Task*					mEntry;			// task which receives dependencies
+											//  (this, or a ParallelFor's fork)
+	std::vector<Task*>		mSuccessors;
+	int						mNumDeps;
+	ork::atomic<int>		mPendingDeps;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct TaskGraph
+{
+	typedef Task::lambda_t lambda_t;
+	typedef FixedLambda<void(int,int),Op::kinlinesize> range_lambda_t;
+
+	TaskGraph();
+	~TaskGraph();
+
+	////////////////////////////////
+	// building (not while launched)
+	////////////////////////////////
+
+	Task* CreateTask(lambda_t&& l, const char* name=nullptr);
+	template <typename L, typename = enable_if_oplambda_t<L>>
+	Task* CreateTask(L&& l, const char* name=nullptr)
+	{
+		return CreateTask(lambda_t(std::forward<L>(l)),name);
+	}
+
+	// l(ib,ie) is called for each [ib,ie) chunk of at most igrain items,
+	//  returns the join task (dependencies added to it gate the chunks)
+	Task* ParallelFor(int ibegin, int iend, int igrain, range_lambda_t&& l, const char* name=nullptr);
+
+	void Precede(Task* pred, Task* succ); // succ runs after pred finished
+	Task* Continue(Task* pred, lambda_t&& l, const char* name=nullptr);
+
+	void SetOnComplete(lambda_t&& l); // runs on the thread finishing the last task
+	void Clear();
+
+	////////////////////////////////
+	// running
+	////////////////////////////////
+
+	void Launch(Opq& the_opq);
+	void Wait(); // helps run this graph's ready tasks while waiting
+	bool IsComplete() const { return false==mLaunched.load(MemAcquire); }
+	int NumTasks() const { return int(mTasks.size()); }
+
+private:
+
+	void Schedule(Task* ptask);
+	void RunTask(Task* ptask);
+	void Finish();
+
+	std::shared_ptr<TaskReadyList>	mReady;	// shared with the queued ops,
+											//  which may outlive the graph
+	std::deque<Task>			mTasks;
+	std::deque<range_lambda_t>	mRangeLambdas;
+	lambda_t					mOnComplete;
+	Opq*						mOpq;
+	ork::atomic<int>			mNumPending;
+	ork::atomic<bool>			mLaunched;
+	std::mutex					mDoneMtx;
+	std::condition_variable		mDoneCV;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// one shot blocking parallel for (the calling thread helps)
+///////////////////////////////////////////////////////////////////////////////
+
+void parallel_for(Opq& the_opq, int ibegin, int iend, int igrain, TaskGraph::range_lambda_t&& l);
+
+///////////////////////////////////////////////////////////////////////////////
+} // namespace ork
+///////////////////////////////////////////////////////////////////////////////
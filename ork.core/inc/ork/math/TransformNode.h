@@ -28,6 +28,8 @@ struct Transform3DMatrix
 	typedef CReal			ScaType;
 	typedef CMatrix4&		MatType;
 
+	Transform3DMatrix();
+
 	void SetMatrix( const CMatrix4& );
 	const CMatrix4& GetMatrix() const;
 	CVector3		GetPosition() const;
@@ -37,9 +39,14 @@ struct Transform3DMatrix
 	void			SetScale( const float scale);
 	void			SetPosition( const CVector3& pos );
 
+	/// changes whenever the matrix is set, unique across all transforms
+	///  (so a copy carries the stamp of the matrix it copied)
+	uint32_t		GetVersion() const { return mVersion; }
+
 private:
 	
 	CMatrix4				mMatrix;	/// matrix in world space
+	uint32_t				mVersion;
 
 };
 
@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+// Orkid
+// Copyrigh 1996-2009, Michael T. Mayers
+// See License at OrkidRoot/license.html or http://www.tweakoz.com/orkid/license.html
+///////////////////////////////////////////////////////////////////////////////
+// RaytBvh : raytracer acceleration structure (replaces FixedGrid)
+//
+//  binned SAH build, nodes flattened depth first into one array
+//   (left child is always node+1, so only the right child index is stored).
+//  triangles are copied into a compact (vertex,edge,edge) array in leaf
+//   order, non triangle primitives fall back to Primitive::Intersect().
+//
+//  queries:
+//   FindNearest : closest hit (single ray or 4 ray packet)
+//   Occluded    : any hit (shadow rays), stops at the first hit
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <ork/orkstl.h>
+#include <ork/math/cvector2.h>
+#include <ork/math/cvector3.h>
+#include <ork/math/line.h>
+#include <ork/math/box.h>
+
+///////////////////////////////////////////////////////////////////////////////
+namespace ork {
+///////////////////////////////////////////////////////////////////////////////
+
+class Primitive;
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct RaytBvhNode // 32 bytes, 2 per cacheline
+{
+	float	mMin[3];
+	u32		mIndex;		// leaf: first primitive, inner: right child node
+	float	mMax[3];
+	u16		mCount;		// leaf: number of primitives, inner: 0
+	u16		mAxis;		// inner: split axis (child order for traversal)
+
+	bool IsLeaf() const { return mCount!=0; }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct RaytBvhTri
+{
+	float	mV0[3];
+	float	mE1[3];
+	float	mE2[3];
+	u32		mGeneric;	// 1 : not a triangle, use Primitive::Intersect()
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// 4 coherent rays, structure of arrays
+///////////////////////////////////////////////////////////////////////////////
+
+struct RaytBvhPacket
+{
+	static const int ksize = 4;
+
+	float				mOrgX[ksize], mOrgY[ksize], mOrgZ[ksize];
+	float				mDirX[ksize], mDirY[ksize], mDirZ[ksize];
+	float				mDist[ksize];	// in: max distance, out: hit distance
+	const Primitive*	mPrim[ksize];	// FindNearest result (null on miss)
+	u32					mActive;		// lane mask of rays to trace
+	u32					mHits;			// lane mask of rays which hit
+
+	RaytBvhPacket() : mActive(0), mHits(0) {}
+	void SetRay( int ilane, const Ray3& ray, float fmaxdist );
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+class RaytBvh
+{
+public:
+
+	static const int kmaxleafprims = 4;
+	static const int knumbins = 16;
+	static const int kmaxdepth = 64;
+
+	RaytBvh();
+
+	void Build( const orkvector<const Primitive*>& prims );
+	void Clear();
+
+	bool FindNearest( const Ray3& ray, float& dist, const Primitive*& prim ) const;
+	bool Occluded( const Ray3& ray, float fmaxdist ) const;
+
+	void FindNearest( RaytBvhPacket& packet ) const;
+	void Occluded( RaytBvhPacket& packet ) const;
+
+	const AABox& GetBounds() const { return mBounds; }
+	int NumNodes() const { return int(mNodes.size()); }
+	int NumPrimitives() const { return int(mPrims.size()); }
+	size_t MemoryUsage() const;
+
+private:
+
+	struct BuildPrim
+	{
+		float mMin[3];
+		float mMax[3];
+		float mCentroid[3];
+		u32 mIndex;
+	};
+
+	void BuildRecursive( const orkvector<const Primitive*>& prims, u32 inode, orkvector<BuildPrim>& bprims, int ifirst, int icount, int idepth );
+
+	orkvector<RaytBvhNode>			mNodes;
+	orkvector<RaytBvhTri>			mTris;
+	orkvector<const Primitive*>		mPrims;
+	AABox							mBounds;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+} // namespace ork
+///////////////////////////////////////////////////////////////////////////////
@@ -16,12 +16,13 @@
 #include <ork/math/cvector3.h>
 #include <ork/kernel/mutex.h>
 #include <ork/kernel/any.h>
+#include <functional>
 
 ///////////////////////////////////////////////////////////////////////////////
 namespace ork {
 ///////////////////////////////////////////////////////////////////////////////
 
-class FixedGrid;
+class RaytBvh;
 
 #define HIT		 1		// Ray hit primitive
 #define MISS	 0		// Ray missed primitive
@@ -51,6 +52,19 @@ struct RayBundle
 	fixedvector<Ray3,16>	mRays;
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// screen / uv space tile, pixels [miX0,miX1) x [miY0,miY1)
+///////////////////////////////////////////////////////////////////////////////
+
+struct RayTile
+{
+	int miIndex;
+	int miX0, miY0;
+	int miX1, miY1;
+
+	bool Contains( int ix, int iy ) const { return (ix>=miX0)&&(ix<miX1)&&(iy>=miY0)&&(iy<miY1); }
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -61,7 +75,9 @@ struct Jitterer
 
 	CVector3	sample[1024];
 
-	Jitterer( int ikos, float fradius, const CVector3& dX, const CVector3& dY );
+	// useed!=0 : each sample gets a random offset inside its stratum
+	//  (seed per tile, so the result does not depend on thread scheduling)
+	Jitterer( int ikos, float fradius, const CVector3& dX, const CVector3& dY, u32 useed=0 );
 	const CVector3& GetSample( int idx ) const { return sample[idx]; }
 
 };
@@ -211,7 +227,7 @@ class Primitive
 {
 public:
 	Primitive() : mLastRayID(-1) , mMaterial(0), mBakeShader(0) {}
-	~Primitive();
+	virtual ~Primitive();
 	BakeShader* GetBakeShader() const { return mBakeShader; }
 	void SetBakeShader( BakeShader* mtl ) { mBakeShader = mtl; }
 	Material* GetMaterial() const { return mMaterial; }
@@ -226,7 +242,9 @@ public:
 	virtual int Intersect( const Ray3& a_Ray, CVector3& isect, float& a_Dist ) const = 0;
 	virtual CVector3 GetNormal( const CVector3& pos ) const = 0;
 	virtual bool IntersectBox( const AABox& a_Box ) const = 0;
-	virtual void Rasterize( Engine* peng ) const = 0;
+	virtual void Rasterize( Engine* peng, const RayTile& tile ) const = 0;
+	// uv space pixel rect touched by Rasterize (false: unknown, goes to all tiles)
+	virtual bool GetRasterRect( const Engine* peng, int& ix0, int& iy0, int& ix1, int& iy1 ) const { return false; }
 	//////////////////////////////////////////////////
 
 protected:
@@ -253,7 +271,7 @@ public:
 	virtual int Intersect( const Ray3& a_Ray, CVector3& isect, float& a_Dist ) const;
 	virtual CVector3 GetNormal( const CVector3& pos ) const;
 	virtual bool IntersectBox( const AABox& a_Box ) const;
-	virtual void Rasterize( Engine* peng ) const;
+	virtual void Rasterize( Engine* peng, const RayTile& tile ) const;
 };
 
 class RaytTriangle : public Primitive
@@ -277,7 +295,8 @@ public:
 	virtual int Intersect( const Ray3& a_Ray, CVector3& isect, float& a_Dist ) const;
 	virtual CVector3 GetNormal( const CVector3& pos ) const;
 	virtual bool IntersectBox( const AABox& a_Box ) const;
-	virtual void Rasterize( Engine* peng ) const;
+	virtual void Rasterize( Engine* peng, const RayTile& tile ) const;
+	virtual bool GetRasterRect( const Engine* peng, int& ix0, int& iy0, int& ix1, int& iy1 ) const;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -311,7 +330,7 @@ public:
 	void ExitScene();
 	////////////////////////////////////////////////////////
 	const AABox& GetExtends() const { return mExtends; }
-	FixedGrid* GetFixedGrid() const { return mpFixedGrid; }
+	const RaytBvh* GetBvh() const { return mpBvh; }
 	void AddGeoSet( const std::string& name, RgmGeoSet* pset );
 	void RemoveGeoSet( const std::string& name );
 	const RgmGeoSet* FindGeoSet( const std::string& name ) const;
@@ -325,7 +344,7 @@ private:
 	orkmap<std::string,const RgmGeoSet*>	mGeoSets;
 	orkvector<RgmLight>						mLights;
 	AABox mExtends;
-	FixedGrid*	mpFixedGrid;
+	RaytBvh*	mpBvh;
 	
 };
 
@@ -380,10 +399,12 @@ struct SpanCtx
 {
 	bool swap_xy;
 	bool flip_y;  
+	const RayTile* mpClip; // only pixels inside are written
 
-	SpanCtx()
+	SpanCtx( const RayTile* pclip=nullptr )
 		: swap_xy(false)
 		, flip_y(false)
+		, mpClip(pclip)
 	{
 	}
 };
@@ -398,7 +419,8 @@ class Engine
 	~Engine();
 	void SetTarget( RayPixel* dest, int w, int h );
 	Scene* GetScene() { return mScene; }
-	bool FindNearest( const FixedGrid* fg, const Ray3& a_Ray, const float tmin, const float tmax, float& dist, const Primitive*& prim );
+	bool FindNearest( const Ray3& a_Ray, float& dist, const Primitive*& prim ) const;
+	bool Occluded( const Ray3& a_Ray, float fmaxdist ) const;
 	const Primitive* Raytrace( const Ray3& ray, const int depth, const float rindex, CVector3& acc, float& dist );
 	void InitRender( CVector3& eye, CVector3& tgt );
 	const Primitive* RenderRay( CVector3 screenpos, CVector3& acc );
@@ -427,11 +449,30 @@ class Engine
 	void RasterizeTriangle(	const BakeShader& shader,
 							int x1, int y1, const BakeShadowFragment& d1, 
 							int x2, int y2, const BakeShadowFragment& d2, 
-							int x3, int y3, const BakeShadowFragment& d3 );
+							int x3, int y3, const BakeShadowFragment& d3,
+							const RayTile& tile );
+
+	////////////////////////////////////////////////////////
+	// tiled rendering / baking
+	//  tiles run on a workstealing Opq (0 threads : GetNumCores()).
+	//  every fProgressInterval seconds the finished tiles are written to
+	//   <OutputName>.progress (resumable) and <OutputName>.ppm (preview).
+	////////////////////////////////////////////////////////
+
+	typedef std::function<int(const RayTile&)> tile_fn_t; // returns num rays
+
+	void SetNumThreads( int inumthreads ) { miNumThreads=inumthreads; }
+	void SetTileSize( int isize ) { miTileSize=isize; }
+	void SetTargetSize( int isize ) { miTargetSize=isize; }
+	void SetProgressInterval( float fseconds ) { mfProgressInterval=fseconds; }
+	void SetResume( bool bresume ) { mbResume=bresume; }
+	int RunTiles( const std::string& OutputName, u32 ukind, const tile_fn_t& fn );
   
 
 	private:
 
+	void GetTileGrid( int& itilesize, int& inumtx, int& inumty ) const;
+
 	Scene*					mScene;
 	RayPixel*				mDest;
 	BakeShadowFragment*		mFragments;
@@ -440,6 +481,11 @@ class Engine
 	CVector3				mCornerTL, mCornerTR, mCornerBL, mCornerBR;
 	CVector3				mDX, mDY;
 	int*					mMod;
+	int						miNumThreads;
+	int						miTileSize;
+	int						miTargetSize;
+	float					mfProgressInterval;
+	bool					mbResume;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
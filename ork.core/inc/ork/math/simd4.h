@@ -0,0 +1,164 @@
+///////////////////////////////////////////////////////////////////////////////
+// Orkid
+// Copyrigh 1996-2009, Michael T. Mayers
+// See License at OrkidRoot/license.html or http://www.tweakoz.com/orkid/license.html
+///////////////////////////////////////////////////////////////////////////////
+// simd4 : 4 lane float / mask / int, SSE2 or plain C
+//
+//  for structure of arrays loops (4 elements per step), eg.
+//   f4 x = f4::load(px+i); (x*f4(2.0f)).store(px+i);
+//  loada/storea need 16 byte aligned pointers, load/store do not.
+//  masks (m4) are full lanes, vmask() packs them into the low 4 bits.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <ork/orktypes.h>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ORK_SIMD4_SSE
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+namespace ork { namespace simd {
+///////////////////////////////////////////////////////////////////////////////
+
+#if defined(ORK_SIMD4_SSE)
+
+struct f4
+{
+	__m128 v;
+	f4() {}
+	f4( __m128 x ) : v(x) {}
+	explicit f4( float f ) : v(_mm_set1_ps(f)) {}
+	static f4 load( const float* p ) { return _mm_loadu_ps(p); }
+	static f4 loada( const float* p ) { return _mm_load_ps(p); }
+	void store( float* p ) const { _mm_storeu_ps(p,v); }
+	void storea( float* p ) const { _mm_store_ps(p,v); }
+};
+typedef f4 m4;
+
+struct i4
+{
+	__m128i v;
+	i4() {}
+	i4( __m128i x ) : v(x) {}
+	explicit i4( U32 u ) : v(_mm_set1_epi32(int(u))) {}
+	i4( U32 a, U32 b, U32 c, U32 d ) : v(_mm_set_epi32(int(d),int(c),int(b),int(a))) {}
+	static i4 loada( const U32* p ) { return _mm_load_si128((const __m128i*)p); }
+	void storea( U32* p ) const { _mm_store_si128((__m128i*)p,v); }
+};
+
+inline f4 operator + ( f4 a, f4 b ) { return _mm_add_ps(a.v,b.v); }
+inline f4 operator - ( f4 a, f4 b ) { return _mm_sub_ps(a.v,b.v); }
+inline f4 operator * ( f4 a, f4 b ) { return _mm_mul_ps(a.v,b.v); }
+inline f4 operator / ( f4 a, f4 b ) { return _mm_div_ps(a.v,b.v); }
+inline f4 vmin( f4 a, f4 b ) { return _mm_min_ps(a.v,b.v); }
+inline f4 vmax( f4 a, f4 b ) { return _mm_max_ps(a.v,b.v); }
+inline f4 vrcp( f4 a ) { return _mm_div_ps(_mm_set1_ps(1.0f),a.v); }
+inline f4 vsqrt( f4 a ) { return _mm_sqrt_ps(a.v); }
+inline m4 vlt( f4 a, f4 b ) { return _mm_cmplt_ps(a.v,b.v); }
+inline m4 vle( f4 a, f4 b ) { return _mm_cmple_ps(a.v,b.v); }
+inline m4 vand( m4 a, m4 b ) { return _mm_and_ps(a.v,b.v); }
+inline m4 vor( m4 a, m4 b ) { return _mm_or_ps(a.v,b.v); }
+inline m4 vandnot( m4 a, m4 b ) { return _mm_andnot_ps(a.v,b.v); } // (~a)&b
+inline int vmask( m4 a ) { return _mm_movemask_ps(a.v); }
+inline m4 vlanes( int imask )
+{
+	return _mm_cmpneq_ps( _mm_and_ps( _mm_castsi128_ps(_mm_set1_epi32(imask)),
+									  _mm_castsi128_ps(_mm_set_epi32(8,4,2,1)) ),
+						  _mm_setzero_ps() );
+}
+inline f4 vselect( m4 m, f4 a, f4 b ) { return _mm_or_ps(_mm_and_ps(m.v,a.v),_mm_andnot_ps(m.v,b.v)); }
+
+inline i4 operator & ( i4 a, i4 b ) { return _mm_and_si128(a.v,b.v); }
+inline i4 operator | ( i4 a, i4 b ) { return _mm_or_si128(a.v,b.v); }
+inline i4 operator ^ ( i4 a, i4 b ) { return _mm_xor_si128(a.v,b.v); }
+template <int ishift> inline i4 vshl( i4 a ) { return _mm_slli_epi32(a.v,ishift); }
+template <int ishift> inline i4 vshr( i4 a ) { return _mm_srli_epi32(a.v,ishift); }
+inline m4 viszero( i4 a ) { return _mm_castsi128_ps(_mm_cmpeq_epi32(a.v,_mm_setzero_si128())); }
+inline i4 vasbits( m4 m ) { return _mm_castps_si128(m.v); }
+inline f4 vbitsasfloat( i4 a ) { return _mm_castsi128_ps(a.v); }
+
+#else
+
+struct f4
+{
+	float v[4];
+	f4() {}
+	explicit f4( float f ) { v[0]=v[1]=v[2]=v[3]=f; }
+	static f4 load( const float* p ) { f4 r; for( int i=0; i<4; i++ ) r.v[i]=p[i]; return r; }
+	static f4 loada( const float* p ) { return load(p); }
+	void store( float* p ) const { for( int i=0; i<4; i++ ) p[i]=v[i]; }
+	void storea( float* p ) const { store(p); }
+};
+struct m4
+{
+	bool v[4];
+};
+struct i4
+{
+	U32 v[4];
+	i4() {}
+	explicit i4( U32 u ) { v[0]=v[1]=v[2]=v[3]=u; }
+	i4( U32 a, U32 b, U32 c, U32 d ) { v[0]=a; v[1]=b; v[2]=c; v[3]=d; }
+	static i4 loada( const U32* p ) { i4 r; for( int i=0; i<4; i++ ) r.v[i]=p[i]; return r; }
+	void storea( U32* p ) const { for( int i=0; i<4; i++ ) p[i]=v[i]; }
+};
+#define ORK_F4_OP(expr) f4 r; for( int i=0; i<4; i++ ) r.v[i]=(expr); return r;
+#define ORK_M4_OP(expr) m4 r; for( int i=0; i<4; i++ ) r.v[i]=(expr); return r;
+#define ORK_I4_OP(expr) i4 r; for( int i=0; i<4; i++ ) r.v[i]=(expr); return r;
+inline f4 operator + ( f4 a, f4 b ) { ORK_F4_OP(a.v[i]+b.v[i]) }
+inline f4 operator - ( f4 a, f4 b ) { ORK_F4_OP(a.v[i]-b.v[i]) }
+inline f4 operator * ( f4 a, f4 b ) { ORK_F4_OP(a.v[i]*b.v[i]) }
+inline f4 operator / ( f4 a, f4 b ) { ORK_F4_OP(a.v[i]/b.v[i]) }
+inline f4 vmin( f4 a, f4 b ) { ORK_F4_OP(a.v[i]<b.v[i] ? a.v[i] : b.v[i]) }
+inline f4 vmax( f4 a, f4 b ) { ORK_F4_OP(a.v[i]>b.v[i] ? a.v[i] : b.v[i]) }
+inline f4 vrcp( f4 a ) { ORK_F4_OP(1.0f/a.v[i]) }
+inline f4 vsqrt( f4 a ) { ORK_F4_OP(std::sqrt(a.v[i])) }
+inline m4 vlt( f4 a, f4 b ) { ORK_M4_OP(a.v[i]<b.v[i]) }
+inline m4 vle( f4 a, f4 b ) { ORK_M4_OP(a.v[i]<=b.v[i]) }
+inline m4 vand( m4 a, m4 b ) { ORK_M4_OP(a.v[i]&&b.v[i]) }
+inline m4 vor( m4 a, m4 b ) { ORK_M4_OP(a.v[i]||b.v[i]) }
+inline m4 vandnot( m4 a, m4 b ) { ORK_M4_OP((!a.v[i])&&b.v[i]) }
+inline int vmask( m4 a ) { return int(a.v[0])|(int(a.v[1])<<1)|(int(a.v[2])<<2)|(int(a.v[3])<<3); }
+inline m4 vlanes( int imask ) { ORK_M4_OP(0!=(imask&(1<<i))) }
+inline f4 vselect( m4 m, f4 a, f4 b ) { ORK_F4_OP(m.v[i] ? a.v[i] : b.v[i]) }
+inline i4 operator & ( i4 a, i4 b ) { ORK_I4_OP(a.v[i]&b.v[i]) }
+inline i4 operator | ( i4 a, i4 b ) { ORK_I4_OP(a.v[i]|b.v[i]) }
+inline i4 operator ^ ( i4 a, i4 b ) { ORK_I4_OP(a.v[i]^b.v[i]) }
+template <int ishift> inline i4 vshl( i4 a ) { ORK_I4_OP(a.v[i]<<ishift) }
+template <int ishift> inline i4 vshr( i4 a ) { ORK_I4_OP(a.v[i]>>ishift) }
+inline m4 viszero( i4 a ) { ORK_M4_OP(0==a.v[i]) }
+inline i4 vasbits( m4 m ) { ORK_I4_OP(m.v[i] ? 0xffffffff : 0) }
+inline f4 vbitsasfloat( i4 a ) { f4 r; for( int i=0; i<4; i++ ) { union { U32 u; float f; } c; c.u=a.v[i]; r.v[i]=c.f; } return r; }
+#undef ORK_F4_OP
+#undef ORK_M4_OP
+#undef ORK_I4_OP
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// helpers common to both
+///////////////////////////////////////////////////////////////////////////////
+
+// xorshift32 per lane, returns the new state
+inline i4 vxorshift( i4 s )
+{
+	s = s ^ vshl<13>(s);
+	s = s ^ vshr<17>(s);
+	s = s ^ vshl<5>(s);
+	return s;
+}
+
+// 23 random bits of each lane as a float in [0,1)
+inline f4 vunitfloat( i4 bits )
+{
+	return vbitsasfloat( vshr<9>(bits) | i4(0x3f800000) ) - f4(1.0f);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+} } // namespace ork::simd
+///////////////////////////////////////////////////////////////////////////////
@@ -22,6 +22,9 @@ public:
     /*virtual*/ void Set(const T &, Object *, size_t) const;
     /*virtual*/ size_t Count(const Object *) const;
 	/*virtual*/ bool Resize(Object *obj, size_t size) const;
+	/*virtual*/ size_t PodItemSize() const;
+	/*virtual*/ const void *PodItems(const Object *) const;
+	/*virtual*/ void *PodItems(Object *) const;
 private:
     T (Object::*mProperty)[];
     size_t mSize;
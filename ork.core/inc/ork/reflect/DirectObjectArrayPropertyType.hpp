@@ -43,4 +43,22 @@ bool DirectObjectArrayPropertyType<T>::Resize(Object *, size_t size) const
 	return size == mSize;
 }
 
+template<typename T>
+size_t DirectObjectArrayPropertyType<T>::PodItemSize() const
+{
+	return IsPodArrayItem<T>::value ? sizeof(T) : 0;
+}
+
+template<typename T>
+const void *DirectObjectArrayPropertyType<T>::PodItems(const Object *obj) const
+{
+	return IsPodArrayItem<T>::value ? &(obj->*mProperty)[0] : NULL;
+}
+
+template<typename T>
+void *DirectObjectArrayPropertyType<T>::PodItems(Object *obj) const
+{
+	return IsPodArrayItem<T>::value ? &(obj->*mProperty)[0] : NULL;
+}
+
 } }
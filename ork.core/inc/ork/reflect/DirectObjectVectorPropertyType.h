@@ -8,11 +8,19 @@
 #pragma once
 
 #include <ork/reflect/IObjectArrayPropertyType.h>
+#include <vector>
 
 #include <ork/config/config.h>
 
 namespace ork { namespace reflect {
 
+// only std::vector of raw items is known to be contiguous
+template<typename VectorType>
+struct IsPodVector { static const bool value = false; };
+
+template<typename T, typename Allocator>
+struct IsPodVector< std::vector<T,Allocator> > { static const bool value = IsPodArrayItem<T>::value; };
+
 template<typename VectorType>
 class  DirectObjectVectorPropertyType 
 	: public IObjectArrayPropertyType<typename VectorType::value_type>
@@ -26,6 +34,9 @@ private:
     /*virtual*/ void Set(const ValueType &, Object *, size_t) const;
 	/*virtual*/ size_t Count(const Object *) const;
 	/*virtual*/ bool Resize(Object *, size_t) const;
+	/*virtual*/ size_t PodItemSize() const;
+	/*virtual*/ const void *PodItems(const Object *) const;
+	/*virtual*/ void *PodItems(Object *) const;
 
 	VectorType Object::*mProperty;
 };
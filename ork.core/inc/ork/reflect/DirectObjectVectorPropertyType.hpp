@@ -43,5 +43,35 @@ bool DirectObjectVectorPropertyType<VectorType>::Resize(Object *object, size_t s
 	return Count(object) == size;
 }
 
+template<typename VectorType, bool bpod=IsPodVector<VectorType>::value>
+struct VectorPodItems
+{
+	static void *Get(VectorType &) { return NULL; }
+};
+
+template<typename VectorType>
+struct VectorPodItems<VectorType,true>
+{
+	static void *Get(VectorType &v) { return v.empty() ? NULL : v.data(); }
+};
+
+template<typename VectorType>
+size_t DirectObjectVectorPropertyType<VectorType>::PodItemSize() const
+{
+	return IsPodVector<VectorType>::value ? sizeof(ValueType) : 0;
+}
+
+template<typename VectorType>
+const void *DirectObjectVectorPropertyType<VectorType>::PodItems(const Object *object) const
+{
+	return VectorPodItems<VectorType>::Get(const_cast<VectorType &>(object->*mProperty));
+}
+
+template<typename VectorType>
+void *DirectObjectVectorPropertyType<VectorType>::PodItems(Object *object) const
+{
+	return VectorPodItems<VectorType>::Get(object->*mProperty);
+}
+
 } }
 
@@ -40,6 +40,10 @@ public:
     virtual bool Deserialize(ResizableString &) = 0;
     virtual bool DeserializeData(unsigned char *, size_t) = 0;
 
+	// true when a SerializePodArray block is next, count is set and the
+	//  items follow as DeserializeData(count*itemsize). false : item by item
+	virtual bool BeginPodArray(size_t itemsize, size_t &count) { return false; }
+
     virtual bool ReferenceObject(rtti::ICastable *) = 0;
     virtual bool BeginCommand(Command &) = 0;
     virtual bool EndCommand(const Command &) = 0;
@@ -22,6 +22,12 @@ public:
     virtual bool SerializeItem(ISerializer &, const Object *, size_t) const = 0;
 	virtual size_t Count(const Object *) const = 0;
 	virtual bool Resize(Object *obj, size_t size) const = 0;
+
+	// contiguous raw items (see IsPodArrayItem), serialized as one block
+	//  by archives which support it. PodItemSize() 0 : item by item only
+	virtual size_t PodItemSize() const { return 0; }
+	virtual const void *PodItems(const Object *) const { return NULL; }
+	virtual void *PodItems(Object *) const { return NULL; }
 private:
     /*virtual*/ bool Deserialize(IDeserializer &, Object *) const;
     /*virtual*/ bool Serialize(ISerializer &, const Object *) const;
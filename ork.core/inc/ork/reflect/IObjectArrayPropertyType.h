@@ -8,10 +8,18 @@
 #pragma once
 
 #include <cstddef>
+#include <type_traits>
 #include <ork/reflect/IObjectArrayProperty.h>
 
 namespace ork { namespace reflect {
 
+// items whose bytes are their serialized form
+template<typename T>
+struct IsPodArrayItem
+{
+	static const bool value = std::is_arithmetic<T>::value && !std::is_same<T,bool>::value;
+};
+
 template<typename T>
 class  IObjectArrayPropertyType : public IObjectArrayProperty
 {
@@ -41,6 +41,10 @@ public:
 
 	virtual bool SerializeData(unsigned char *, size_t) = 0;
 
+	// array of raw items (arithmetic types) in one block.
+	//  false : not supported, the caller serializes item by item
+	virtual bool SerializePodArray(const void *, size_t itemsize, size_t count) { return false; }
+
 	virtual bool ReferenceObject(const rtti::ICastable *) = 0;
     virtual bool BeginCommand(const Command &) = 0;
     virtual bool EndCommand(const Command &) = 0;
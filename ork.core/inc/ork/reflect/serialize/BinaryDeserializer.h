@@ -8,16 +8,25 @@
 #pragma once
 
 #include <ork/reflect/IDeserializer.h>
-#include <ork/stream/InputStreamBuffer.h>
+#include <ork/stream/IInputStream.h>
 #include <ork/kernel/string/StringPool.h>
+#include <ork/kernel/orkvector.h>
 
 
 namespace ork { namespace reflect { namespace serialize {
 
+///////////////////////////////////////////////////////////////////////////////
+// reads from a stream through a read ahead buffer (so it may consume past
+//  the end of the archive), or straight from memory (eg a file::MappedFile)
+//  which must stay valid for the lifetime of the deserializer.
+// strings live in an arena owned by the deserializer.
+///////////////////////////////////////////////////////////////////////////////
+
 class BinaryDeserializer : public IDeserializer
 {
 public:
 	BinaryDeserializer(stream::IInputStream &stream);
+	BinaryDeserializer(const void *data, size_t size);
 	~BinaryDeserializer();
 
     /*virtual*/ bool Deserialize(bool   &);
@@ -35,6 +44,7 @@ public:
     /*virtual*/ bool Deserialize(MutableString &);
     /*virtual*/ bool Deserialize(ResizableString &);
     /*virtual*/ bool DeserializeData(unsigned char *, size_t);
+    /*virtual*/ bool BeginPodArray(size_t, size_t &);
 
     /*virtual*/ bool ReferenceObject(rtti::ICastable *);
     /*virtual*/ bool BeginCommand(Command &);
@@ -44,14 +54,27 @@ private:
 
 	template<typename T>
 	bool Read(T &);
+	bool ReadBytes(unsigned char *, size_t);
+	bool Refill();
 
 	char Peek();
 	bool Match(char c);
 
-	stream::InputStreamBuffer<1> mStream;
+	char *AllocString(size_t len);
+
+	static const size_t kreadahead = 64<<10;
+	static const size_t kstringblocksize = 16<<10;
+
+	stream::IInputStream *mStream; // NULL when reading from memory
+	const unsigned char *mCursor;
+	const unsigned char *mEnd;
+	orkvector<unsigned char> mReadAhead;
+	orkvector<char *> mStringBlocks;
+	char *mStringBlock;
+	size_t mStringBlockUsed;
 	orkvector<rtti::ICastable *> mDeserializedObjects;
 	const Command *mCurrentCommand;
-	StringPool mStringPool;
+	IndexedStringPool mStringPool;
 };
 
 } } }
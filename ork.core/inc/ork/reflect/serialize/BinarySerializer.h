@@ -34,6 +34,7 @@ public:
 	/*virtual*/ void Hint(const PieceString &,intptr_t ival);
 
     /*virtual*/ bool SerializeData(unsigned char *, size_t size);
+    /*virtual*/ bool SerializePodArray(const void *, size_t itemsize, size_t count);
 
 	/*virtual*/ bool Serialize(const IProperty *);
 	/*virtual*/ bool Serialize(const IObjectProperty *, const Object *);
@@ -51,7 +52,7 @@ private:
 
     stream::IOutputStream &mStream;
 	orkvector<const rtti::ICastable *> mSerializedObjects;
-	StringPool mStringPool;
+	IndexedStringPool mStringPool;
 	const Command *mCurrentCommand;
 };
 
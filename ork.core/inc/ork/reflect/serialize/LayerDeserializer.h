@@ -38,6 +38,7 @@ public:
     /*virtual*/ bool Deserialize(MutableString &); 
     /*virtual*/ bool Deserialize(ResizableString &); 
     /*virtual*/ bool DeserializeData(unsigned char *, size_t);
+    /*virtual*/ bool BeginPodArray(size_t, size_t &);
 
     /*virtual*/ bool ReferenceObject(rtti::ICastable *);
     /*virtual*/ bool BeginCommand(Command &);
@@ -143,6 +144,12 @@ bool LayerDeserializer::DeserializeData(unsigned char *data, size_t size)
 	return mDeserializer.DeserializeData(data, size);
 }
 
+inline
+bool LayerDeserializer::BeginPodArray(size_t itemsize, size_t &count)
+{
+	return mDeserializer.BeginPodArray(itemsize, count);
+}
+
 
 inline
 bool LayerDeserializer::ReferenceObject(rtti::ICastable *object)
@@ -35,6 +35,7 @@ public:
     /*virtual*/ void Hint(const PieceString &, intptr_t ival);
 
     /*virtual*/ bool SerializeData(unsigned char *, size_t);
+    /*virtual*/ bool SerializePodArray(const void *, size_t, size_t);
 
 	/*virtual*/ bool Serialize(const IProperty *);
 	/*virtual*/ bool Serialize(const IObjectProperty *, const Object *);
@@ -127,6 +128,12 @@ bool LayerSerializer::SerializeData(unsigned char *data, size_t size)
 	return mSerializer.SerializeData(data, size);
 }
 
+inline
+bool LayerSerializer::SerializePodArray(const void *items, size_t itemsize, size_t count)
+{
+	return mSerializer.SerializePodArray(items, itemsize, count);
+}
+
 inline 
 bool LayerSerializer::Serialize(const IProperty *prop)
 {
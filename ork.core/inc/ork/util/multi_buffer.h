@@ -131,8 +131,9 @@ public:
 	/////////////////////////////	
 	private: // 
 	/////////////////////////////
-	mutable ork::MpMcBoundedQueue<T*,knumitems> mReadItems; 						
-	mutable ork::MpMcBoundedQueue<T*,knumitems> mWriteItems; 						
+	// writers block in BeginWrite, so park instead of polling
+	mutable ork::MpMcBoundedQueue<T*,knumitems,ork::MpMcAdaptiveWait> mReadItems; 						
+	mutable ork::MpMcBoundedQueue<T*,knumitems,ork::MpMcAdaptiveWait> mWriteItems; 						
 	mutable ork::MpMcBoundedQueue<T*,knumitems> mDisabledItems; 						
 	mutable ork::atomic<int> mWritesOut;
 	mutable ork::atomic<int> mReadsOut;
@@ -53,18 +53,11 @@ void Application::SetProperty( const std::string& key, anyp val )
 
 PoolString Application::AddPooledString(const PieceString &string)
 {
-	PoolString result = FindPooledString(string);
-	if(result)
-		return result;
-
-	ResizableString copy(string);
-	const char *data = copy.c_str();
-	new(&copy) ResizableString;
-
     ork::Application* papp = ApplicationStack::Top();
 	OrkAssert(papp);
 
-	return papp->GetStringPool().String(data);
+	// looks the string up without locking first, copies it if it is new
+	return papp->GetStringPool().String(string);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -118,7 +118,7 @@ std::pair<AssetSetEntry *, bool> FindAssetEntryInternal(AssetSetLevel *top_level
 	for( AssetSetLevel *level=top_level;
                         level != nullptr;
                         level = level->Parent()){
-        auto levset = level->GetSet();
+        auto& levset = level->GetSet();
 		auto it = std::find_if(
  			 levset.begin(),
 			 levset.end(),
@@ -161,6 +161,21 @@ bool AssetSet::Load(int depth)
 
 ///////////////////////////////////////////////////////////////////////////////
 
+void AssetSet::EnumerateUnloaded(orkvector<AssetSetEntry *> &entries, int depth)
+{
+	for(AssetSetLevel *level = mTopLevel; depth != 0 && level != NULL; level = level->Parent(), depth--)
+	{
+		for(orkvector<AssetSetEntry *>::size_type i = 0; i < level->GetSet().size(); ++i)
+		{
+			AssetSetEntry *entry = level->GetSet()[i];
+			if(false == entry->IsLoaded())
+				entries.push_back(entry);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 #if defined(ORKCONFIG_ASSET_UNLOAD)
 bool AssetSet::UnLoad(int depth)
 {
@@ -20,6 +20,7 @@ AssetSetEntry::AssetSetEntry(Asset *asset, AssetLoader *loader, AssetSetLevel *l
 	, mLoader(loader)
 	, mDeclareLevel(level)
 	, mLoadLevel(NULL)
+	, mStreamRequest(NULL)
 {
 }
 
@@ -29,6 +30,9 @@ bool AssetSetEntry::Load(AssetSetLevel *level)
 {
 	if(NULL == mLoadLevel)
 	{
+		if(mStreamRequest)
+			return false;
+
 			if(NULL == mLoader || false == mLoader->LoadAsset(mAsset))
 		{
 			mLoadLevel = NULL;
@@ -36,9 +40,7 @@ bool AssetSetEntry::Load(AssetSetLevel *level)
 			return false;
 		}
 
-		mLoadLevel = level;
-
-		mLoadProvider.Provide();
+		MarkLoaded(level);
 	}
 
 	return true;
@@ -46,6 +48,15 @@ bool AssetSetEntry::Load(AssetSetLevel *level)
 
 ///////////////////////////////////////////////////////////////////////////////
 
+void AssetSetEntry::MarkLoaded(AssetSetLevel *level)
+{
+	mLoadLevel = level;
+
+	mLoadProvider.Provide();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 #if defined(ORKCONFIG_ASSET_UNLOAD)
 bool AssetSetEntry::UnLoad(AssetSetLevel *level)
 {
@@ -76,6 +87,7 @@ void AssetSetEntry::OnPush(AssetSetLevel *level)
 void AssetSetEntry::OnPop(AssetSetLevel *level)
 {
 	OrkAssert(mAsset);
+	OrkAssert(NULL == mStreamRequest); // wait for streaming before popping
 
 	if(mLoadLevel == level)
 	{
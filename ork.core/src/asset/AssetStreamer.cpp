@@ -0,0 +1,366 @@
+////////////////////////////////////////////////////////////////
+// Orkid Media Engine
+// Copyright 1996-2012, Michael T. Mayers.
+// Distributed under the Boost Software License - Version 1.0 - August 17, 2003
+// see http://www.boost.org/LICENSE_1_0.txt
+////////////////////////////////////////////////////////////////
+
+#include <ork/pch.h>
+
+#include <ork/asset/Asset.h>
+#include <ork/asset/AssetStreamer.h>
+#include <ork/asset/AssetSetEntry.h>
+#include <ork/asset/AssetLoader.h>
+#include <ork/kernel/opq.h>
+
+///////////////////////////////////////////////////////////////////////////////
+namespace ork { namespace asset {
+///////////////////////////////////////////////////////////////////////////////
+
+AssetLoadRequest::AssetLoadRequest(AssetSetEntry* entry, ork::recursive_mutex* lock, Opq* decodeq)
+	: mEntry(entry)
+	, mAsset(entry->GetAsset())
+	, mLoader(entry->GetLoader())
+	, mpLock(lock)
+	, mDecodeOpQ(decodeq)
+	, mbLoaded(false)
+{
+	mPriority.store(EASSETPRI_LOW);
+	mState.store(EASSETREQ_QUEUED);
+	mRefCount.store(0);
+}
+
+void AssetLoadRequest::AddRef()
+{
+	mRefCount.fetch_add(1);
+}
+
+void AssetLoadRequest::Release()
+{
+	if( 1 == mRefCount.fetch_sub(1) )
+		delete this;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+AssetLoadHandle::AssetLoadHandle()
+	: mAsset(nullptr)
+	, mRequest(nullptr)
+{
+}
+
+AssetLoadHandle::AssetLoadHandle(Asset* asset, AssetLoadRequest* request)
+	: mAsset(asset)
+	, mRequest(request)
+{
+	if( mRequest )
+		mRequest->AddRef();
+}
+
+AssetLoadHandle::AssetLoadHandle(const AssetLoadHandle& oth)
+	: mAsset(oth.mAsset)
+	, mRequest(oth.mRequest)
+{
+	if( mRequest )
+		mRequest->AddRef();
+}
+
+AssetLoadHandle& AssetLoadHandle::operator=(const AssetLoadHandle& oth)
+{
+	if( oth.mRequest )
+		oth.mRequest->AddRef();
+	if( mRequest )
+		mRequest->Release();
+	mAsset = oth.mAsset;
+	mRequest = oth.mRequest;
+	return *this;
+}
+
+AssetLoadHandle::~AssetLoadHandle()
+{
+	if( mRequest )
+		mRequest->Release();
+}
+
+bool AssetLoadHandle::IsDone() const
+{
+	return (nullptr==mRequest) || mRequest->mFuture.IsSignaled();
+}
+
+bool AssetLoadHandle::Wait() const
+{
+	if( nullptr==mRequest )
+		return IsValid();
+
+	return AssetStreamer::GetRef().Wait(mRequest);
+}
+
+void AssetLoadHandle::Raise(EAssetLoadPriority priority) const
+{
+	if( mRequest )
+		AssetStreamer::GetRef().Raise(mRequest,priority);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+AssetStreamer& AssetStreamer::GetRef()
+{
+	static AssetStreamer gstreamer;
+	return gstreamer;
+}
+
+AssetStreamer::AssetStreamer()
+	: miNumIoThreads(kdefaultiothreads)
+	, mbGoingDown(false)
+{
+	miNumPending.store(0);
+}
+
+AssetStreamer::~AssetStreamer()
+{
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mbGoingDown = true;
+	}
+	mIoCV.notify_all();
+	for( ork::Thread* pthread : mIoThreads )
+	{
+		pthread->join();
+		delete pthread;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AssetStreamer::SetNumIoThreads(int inumthreads)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	OrkAssert( mIoThreads.empty() );
+	miNumIoThreads = std::max(1,std::min(inumthreads,int(kmaxiothreads)));
+}
+
+void AssetStreamer::StartIoThreads() // mMutex held
+{
+	for( int i=0; i<miNumIoThreads; i++ )
+	{
+		ork::Thread* pthread = new ork::Thread("AssetIo");
+		pthread->start( [this](){ IoThreadLoop(); } );
+		mIoThreads.push_back(pthread);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+AssetLoadHandle AssetStreamer::Request(AssetSetEntry* entry, ork::recursive_mutex& lock, EAssetLoadPriority priority, Opq* decodeq)
+{
+	if( entry->IsLoaded() )
+		return AssetLoadHandle(entry->GetAsset());
+
+	AssetLoadRequest* request = entry->GetStreamRequest();
+
+	if( request ) // coalesce
+	{
+		Raise(request,priority);
+		return AssetLoadHandle(entry->GetAsset(),request);
+	}
+
+	request = new AssetLoadRequest(entry,&lock,decodeq);
+	request->AddRef(); // the entry's reference, until decoded
+	entry->SetStreamRequest(request);
+	miNumPending.fetch_add(1);
+
+	{
+		std::unique_lock<std::mutex> qlock(mMutex);
+		if( mIoThreads.empty() )
+			StartIoThreads();
+		Enqueue(request,priority);
+	}
+	mIoCV.notify_one();
+
+	return AssetLoadHandle(entry->GetAsset(),request);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// a raised request is queued again at its new priority, the stale queue
+//  entry is dropped when popped (it is no longer EASSETREQ_QUEUED by then)
+///////////////////////////////////////////////////////////////////////////////
+
+void AssetStreamer::Raise(AssetLoadRequest* request, EAssetLoadPriority priority)
+{
+	bool bqueued = false;
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		if( request->mState.load()==EASSETREQ_QUEUED && int(priority)>request->mPriority.load() )
+		{
+			Enqueue(request,priority);
+			bqueued = true;
+		}
+	}
+	if( bqueued )
+		mIoCV.notify_one();
+}
+
+void AssetStreamer::Enqueue(AssetLoadRequest* request, int ipriority)
+{
+	request->AddRef(); // the queue's reference
+	request->mPriority.store(ipriority);
+	mIoQueues[ipriority].push_back(request);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AssetStreamer::IoThreadLoop()
+{
+	for( ;; )
+	{
+		AssetLoadRequest* request = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			for( ;; )
+			{
+				if( mbGoingDown )
+					return;
+				for( int ipri=EASSETPRI_COUNT-1; ipri>=0 && nullptr==request; ipri-- )
+				{
+					if( false == mIoQueues[ipri].empty() )
+					{
+						request = mIoQueues[ipri].front();
+						mIoQueues[ipri].pop_front();
+					}
+				}
+				if( request )
+					break;
+				mIoCV.wait(lock);
+			}
+		}
+
+		int istate = EASSETREQ_QUEUED;
+		if( request->mState.compare_exchange_strong(istate,EASSETREQ_READING) )
+		{
+			Read(request);
+			QueueDecode(request);
+		}
+
+		request->Release(); // the queue's reference
+	}
+}
+
+void AssetStreamer::Read(AssetLoadRequest* request)
+{
+	if( request->mLoader )
+		request->mLoader->PrefetchAsset(request->mAsset);
+
+	request->mState.store(EASSETREQ_READ);
+}
+
+void AssetStreamer::QueueDecode(AssetLoadRequest* request)
+{
+	Opq* decodeq = request->mDecodeOpQ ? request->mDecodeOpQ : & ConcurrentOpQ();
+	request->AddRef(); // the decode op's reference
+	decodeq->push( [this,request]()
+	{
+		TryDecode(request);
+		request->Release();
+	}, "AssetDecode" );
+}
+
+bool AssetStreamer::TryDecode(AssetLoadRequest* request)
+{
+	int istate = EASSETREQ_READ;
+	if( false == request->mState.compare_exchange_strong(istate,EASSETREQ_DECODING) )
+		return false;
+
+	Decode(request);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// the waiter reads a request still in the io queue itself, and decodes it
+//  itself unless the request must decode on another thread's Opq.
+//  the io thread which later pops it, and the decode op, find it claimed.
+///////////////////////////////////////////////////////////////////////////////
+
+bool AssetStreamer::Wait(AssetLoadRequest* request)
+{
+	Raise(request,EASSETPRI_CRITICAL);
+
+	OpqTest* ptest = OpqTest::GetContext();
+	Opq* decodeq = request->mDecodeOpQ;
+	bool bdecodehere = (nullptr==decodeq) || (ptest && ptest->mOPQ==decodeq);
+
+	for( ;; )
+	{
+		int istate = EASSETREQ_QUEUED;
+		if( request->mState.compare_exchange_strong(istate,EASSETREQ_READING) )
+		{
+			Read(request);
+			if( false == bdecodehere )
+				QueueDecode(request);
+		}
+
+		if( bdecodehere && TryDecode(request) )
+			break;
+
+		istate = request->mState.load();
+		if( istate==EASSETREQ_DECODING || istate==EASSETREQ_DONE )
+			break;
+		if( istate==EASSETREQ_READ && false==bdecodehere )
+			break;
+
+		usleep(100); // being read by an io thread
+	}
+
+	request->mFuture.WaitForSignal();
+	return request->mbLoaded;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AssetStreamer::Decode(AssetLoadRequest* request)
+{
+	AssetSetEntry* entry = request->mEntry;
+	Asset* asset = request->mAsset;
+	bool bok = true;
+
+	request->mpLock->Lock();
+	bool bneedsload = (false == entry->IsLoaded());
+	request->mpLock->UnLock();
+
+	// the manager lock is not held while decoding, so loads of other
+	//  assets (of this type too) are not serialized behind this one
+	if( bneedsload )
+		bok = (nullptr != request->mLoader) && request->mLoader->LoadAsset(asset);
+
+	request->mpLock->Lock();
+	{
+		if( bneedsload && bok )
+			entry->MarkLoaded(asset->GetClass()->GetAssetSet().GetTopLevel());
+		entry->SetStreamRequest(nullptr);
+	}
+	request->mpLock->UnLock();
+
+	request->mbLoaded = bok;
+	request->mState.store(EASSETREQ_DONE);
+	request->mFuture.Signal<bool>(bok);
+
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		miNumPending.fetch_sub(1);
+	}
+	mDoneCV.notify_all();
+
+	request->Release(); // the entry's reference
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AssetStreamer::WaitAll()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	while( miNumPending.load() != 0 )
+		mDoneCV.wait(lock);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+} }
+///////////////////////////////////////////////////////////////////////////////
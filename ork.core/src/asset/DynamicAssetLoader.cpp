@@ -23,6 +23,7 @@ namespace ork { namespace asset {
 DynamicAssetLoader::DynamicAssetLoader()
 	: mCheckFn(nullptr)
 	, mLoadFn(nullptr)
+	, mPrefetchFn(nullptr)
 	, mEnumFn(nullptr)
 {
 
@@ -77,6 +78,12 @@ void DynamicAssetLoader::DestroyAsset(Asset *asset)
 {
 }
 
+void DynamicAssetLoader::PrefetchAsset(Asset *asset)
+{
+	if( mPrefetchFn )
+		mPrefetchFn(asset);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 } }
 ///////////////////////////////////////////////////////////////////////////////
@@ -274,6 +274,37 @@ bool FileAssetLoader::LoadAsset(Asset *asset)
 	return out;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// reads the file through its CFileDev so it is resident (os file cache)
+//  by the time LoadFileAsset opens it on the decode queue
+///////////////////////////////////////////////////////////////////////////////
+
+void FileAssetLoader::PrefetchAsset(Asset *asset)
+{
+	ArrayString<256> asset_name;
+
+	if(false == FindAsset(asset->GetName(), asset_name))
+		return;
+
+	ork::CFile file( file::Path(asset_name.c_str()), ork::EFM_READ );
+
+	if(false == file.IsOpen())
+		return;
+
+	static const size_t kblocksize = 256<<10;
+	orkvector<char> block(kblocksize);
+
+	size_t ilength = 0;
+	file.GetLength(ilength);
+
+	for( size_t ipos=0; ipos<ilength; ipos+=kblocksize )
+	{
+		size_t iread = std::min(kblocksize,ilength-ipos);
+		if( ork::EFEC_FILE_OK != file.Read( block.data(), iread ) )
+			break;
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 } }
 ///////////////////////////////////////////////////////////////////////////////
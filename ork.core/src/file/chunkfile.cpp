@@ -150,9 +150,15 @@ void Writer::WriteToFile( const file::Path& outpath )
 {
 	ork::CFile outputfile( outpath, ork::EFM_WRITE );
 
-	Char4 chunk_magic("chkf");
+	Char4 chunk_magic("chka");
 	//swapbytes_dynamic( chunk_magic );
 
+	static const unsigned char kzeros[kchunkalign] = { 0 };
+	auto padding = []( int ipos ) -> int
+	{
+		return (kchunkalign-(ipos%kchunkalign))%kchunkalign;
+	};
+
 	////////////////////////
 	outputfile.Write( & chunk_magic, sizeof(chunk_magic) );
 	////////////////////////
@@ -160,16 +166,19 @@ void Writer::WriteToFile( const file::Path& outpath )
 	OutputStream	StringBlockStream;
 	StringBlockStream.Write( (const unsigned char*) string_block.data(), string_block.size() );
 	int istringblksize = StringBlockStream.GetSize();
+	int iheadersize = sizeof(chunk_magic)+sizeof(istringblksize)+istringblksize;
 
 	////////////////////////
 	swapbytes_dynamic( istringblksize );
 	outputfile.Write( & istringblksize, sizeof(istringblksize) );
 	outputfile.Write( StringBlockStream.GetData(), StringBlockStream.GetSize() );
 	////////////////////////
-	swapbytes_dynamic( mFileType );
-	outputfile.Write( & mFileType, sizeof(mFileType) );
+	int ifiletype = mFileType;
+	swapbytes_dynamic( ifiletype );
+	outputfile.Write( & ifiletype, sizeof(ifiletype) );
 	////////////////////////
 	int inumchunks = (int) mOutputStreams.size();
+	iheadersize += sizeof(ifiletype)+sizeof(inumchunks)+inumchunks*3*sizeof(int);
 	swapbytes_dynamic( inumchunks );
 	outputfile.Write( & inumchunks, sizeof(inumchunks) );
 	////////////////////////
@@ -180,28 +189,33 @@ void Writer::WriteToFile( const file::Path& outpath )
 		int ichunkid = it->first;
 		OutputStream* stream = it->second;
 		int ichunklen = stream->GetSize();
+		int ichunkoffset = ioffset;
 		////////////////////////
 		swapbytes_dynamic( ichunkid );
-		swapbytes_dynamic( ioffset );
+		swapbytes_dynamic( ichunkoffset );
 		swapbytes_dynamic( ichunklen );
 		outputfile.Write( & ichunkid, sizeof(ichunkid) );
-		outputfile.Write( & ioffset, sizeof(ioffset) );
+		outputfile.Write( & ichunkoffset, sizeof(ichunkoffset) );
 		outputfile.Write( & ichunklen, sizeof(ichunklen) );
 		////////////////////////
 
-		ioffset += ichunklen;
+		ioffset += stream->GetSize();
+		ioffset += padding(ioffset);
 	}
 
 	////////////////////////
+	// chunk data starts aligned, so the aligned offsets above are aligned in the file too
+	////////////////////////
+	outputfile.Write( kzeros, padding(iheadersize) );
 	for( orkmap<int,OutputStream*>::const_iterator it=mOutputStreams.begin(); it!=mOutputStreams.end(); it++ )
 	{
-		int ichunkid = it->first;
 		OutputStream* stream = it->second;
 		int ichunklen = stream->GetSize();
 		if( ichunklen && stream->GetData() )
 		{
 			outputfile.Write( stream->GetData(), ichunklen );
 		}
+		outputfile.Write( kzeros, padding(ichunklen) );
 	}
 
 }
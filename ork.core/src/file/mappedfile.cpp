@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////
+// Orkid Media Engine
+// Copyright 1996-2012, Michael T. Mayers.
+// Distributed under the Boost Software License - Version 1.0 - August 17, 2003
+// see http://www.boost.org/LICENSE_1_0.txt
+////////////////////////////////////////////////////////////////
+
+#include <ork/pch.h>
+#include <ork/file/mappedfile.h>
+#include <stdio.h>
+
+#if defined(IX)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace ork { namespace file {
+
+///////////////////////////////////////////////////////////////////////////////
+
+MappedFile::MappedFile()
+	: mpData(nullptr)
+	, miSize(0)
+	, mbMapped(false)
+	, mbWritable(false)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool MappedFile::Open( const Path& filename, bool bcopyonwrite )
+{
+	Close();
+
+	Path abspath = filename.ToAbsolute();
+
+#if defined(IX)
+	int fd = open( abspath.c_str(), O_RDONLY );
+	if( fd>=0 )
+	{
+		struct stat st;
+		if( 0==fstat( fd, &st ) && st.st_size>0 )
+		{
+			int iprot = bcopyonwrite ? (PROT_READ|PROT_WRITE) : PROT_READ;
+			void* pmap = mmap( nullptr, size_t(st.st_size), iprot, MAP_PRIVATE, fd, 0 );
+			if( pmap != MAP_FAILED )
+			{
+				madvise( pmap, size_t(st.st_size), MADV_SEQUENTIAL );
+				mpData = (const u8*) pmap;
+				miSize = size_t(st.st_size);
+				mbMapped = true;
+				mbWritable = bcopyonwrite;
+			}
+		}
+		close( fd ); // the mapping keeps its own reference
+		if( mbMapped )
+			return true;
+	}
+#endif
+
+	//////////////////////////////////////
+	// fallback : read it all
+	//////////////////////////////////////
+
+	FILE* fin = fopen( abspath.c_str(), "rb" );
+	if( nullptr == fin )
+		return false;
+
+	fseek( fin, 0, SEEK_END );
+	long ilen = ftell( fin );
+	fseek( fin, 0, SEEK_SET );
+	if( ilen>0 )
+	{
+		mHeapCopy.resize( size_t(ilen) );
+		if( 1==fread( mHeapCopy.data(), size_t(ilen), 1, fin ) )
+		{
+			mpData = mHeapCopy.data();
+			miSize = size_t(ilen);
+			mbWritable = true;
+		}
+		else
+			mHeapCopy.clear();
+	}
+	fclose( fin );
+
+	return IsOpen();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void MappedFile::Close()
+{
+#if defined(IX)
+	if( mbMapped )
+		munmap( (void*) mpData, miSize );
+#endif
+	mpData = nullptr;
+	miSize = 0;
+	mbMapped = false;
+	mbWritable = false;
+	mHeapCopy.clear();
+	mHeapCopy.shrink_to_fit();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+} }
@@ -9,6 +9,7 @@
 #include <ork/util/Context.hpp>
 #include <ork/kernel/debug.h>
 #include <ork/kernel/future.hpp>
+#include <ork/kernel/chaselev_deque.hpp>
 
 //#define DEBUG_OPQ_CALLSTACK
 ///////////////////////////////////////////////////////////////////////
@@ -16,25 +17,21 @@ template class ork::util::ContextTLS<ork::OpqTest>;
 ///////////////////////////////////////////////////////////////////////
 namespace ork {
 ////////////////////////////////////////////////////////////////////////////////
-Op::Op(const void_lambda_t& op,const std::string& name)
-	: mName(name)
-{
-	SetOp(op);
-}
-////////////////////////////////////////////////////////////////////////////////
-Op::Op(const BarrierSyncReq& op,const std::string& name)
-	: mName(name)
+Op::Op(const BarrierSyncReq& op,const char* name)
+	: mLambda([op](){ op.mFuture.Signal<bool>(true); })
+	, mName(name)
 {
-	SetOp(op);
 }
 ////////////////////////////////////////////////////////////////////////////////
-Op::Op(const Op& oth)
-	: mName(oth.mName)
-	, mWrapped(oth.mWrapped)
+Op::Op(Op&& oth)
+	: mLambda(std::move(oth.mLambda))
+	, mName(oth.mName)
 {
+	oth.mName = nullptr;
 }
 ////////////////////////////////////////////////////////////////////////////////
 Op::Op()
+	: mName(nullptr)
 {
 }
 ////////////////////////////////////////////////////////////////////////////////
@@ -42,42 +39,159 @@ Op::~Op()
 {
 }
 ////////////////////////////////////////////////////////////////////////////////
-void Op::SetOp(const op_wrap_t& op)
+Op& Op::operator = (Op&& oth)
 {
-	if( op.IsA<void_lambda_t>() )
-	{
-		mWrapped = op;
-	}
-	else if( op.IsA<BarrierSyncReq>() )
-	{
-		mWrapped = op;
-	}
-	else // unhandled op type
-	{
-		assert(false);
-	}
+	mLambda = std::move(oth.mLambda);
+	mName = oth.mName;
+	oth.mName = nullptr;
+	return *this;
 }
 ///////////////////////////////////////////////////////////////////////////
-void Op::QueueASync(Opq&q) const
+void Op::QueueASync(Opq&q)
 {
-	q.push(*this);
+	q.push(std::move(*this));
 }
-void Op::QueueSync(Opq&q) const
+void Op::QueueSync(Opq&q)
 {
 	AssertNotOnOpQ(q);
-	q.push(*this);
+	q.push(std::move(*this));
 	Future the_fut;
 	BarrierSyncReq R(the_fut);
 	q.push(R);
 	the_fut.GetResult();
 }
 ///////////////////////////////////////////////////////////////////////////
+// EOPQMODE_WORKSTEALING support
+///////////////////////////////////////////////////////////////////////////
+struct OpqSlot
+{
+	Op mOp;
+	OpGroup* mGroup;
+	OpqSlot() : mGroup(nullptr) {}
+};
+///////////////////////////////////////////////////////////////////////////
+struct OpqSlotPool
+{
+	static const size_t kmaxslots = 16<<10;
+
+	OpqSlotPool()
+	{
+		mSlots = new OpqSlot[kmaxslots];
+		for( size_t i=0; i<kmaxslots; i++ )
+			mFreeSlots.try_push(mSlots+i);
+	}
+	~OpqSlotPool()
+	{
+		delete[] mSlots;
+	}
+
+	OpqSlot* mSlots;
+	MpMcBoundedQueue<OpqSlot*,kmaxslots> mFreeSlots;
+};
+///////////////////////////////////////////////////////////////////////////
+struct OpqWorker
+{
+	static const size_t kdequesize = 1<<10;
+	static const size_t kslotbatch = 32;
+	static const int kgroupscaninterval = 16;
+
+	OpqWorker(Opq*popq,int index)
+		: mpOpQ(popq)
+		, mIndex(index)
+		, mStealSeed(u32(index)*2654435761u+1)
+		, mOpsSinceGroupScan(0)
+	{
+		mSlotCache.reserve(kslotbatch*2+1);
+	}
+
+	////////////////////////////////
+
+	OpqSlot* AllocSlot()
+	{
+		if( mSlotCache.empty() )
+		{
+			OpqSlot* pslot = nullptr;
+			for( size_t i=0; i<kslotbatch && mpOpQ->mSlotPool->mFreeSlots.try_pop(pslot); i++ )
+				mSlotCache.push_back(pslot);
+			if( mSlotCache.empty() )
+				return nullptr;
+		}
+		OpqSlot* rval = mSlotCache.back();
+		mSlotCache.pop_back();
+		return rval;
+	}
+	void FreeSlot(OpqSlot* pslot)
+	{
+		mSlotCache.push_back(pslot);
+		if( mSlotCache.size() > kslotbatch*2 )
+		{
+			for( size_t i=0; i<kslotbatch; i++ )
+			{
+				mpOpQ->mSlotPool->mFreeSlots.try_push(mSlotCache.back());
+				mSlotCache.pop_back();
+			}
+		}
+	}
+
+	////////////////////////////////
+
+	bool PushOp(Op& the_op,OpGroup*pgrp) // moves from the_op on success
+	{
+		OpqSlot* pslot = AllocSlot();
+		if( nullptr == pslot )
+			return false;
+		pslot->mOp = std::move(the_op);
+		pslot->mGroup = pgrp;
+		if( mDeque.push(pslot) )
+			return true;
+		the_op = std::move(pslot->mOp);
+		FreeSlot(pslot);
+		return false;
+	}
+
+	////////////////////////////////
+	// random victim, then walk all others
+
+	bool Steal(OpqSlot*& pslot)
+	{
+		const auto& workers = mpOpQ->mWorkers;
+		int inumw = int(workers.size());
+		mStealSeed ^= mStealSeed<<13;
+		mStealSeed ^= mStealSeed>>17;
+		mStealSeed ^= mStealSeed<<5;
+		int ibase = int(mStealSeed%u32(inumw));
+		for( int i=0; i<inumw; i++ )
+		{
+			OpqWorker* victim = workers[(ibase+i)%inumw];
+			if( victim!=this && victim->mDeque.steal(pslot) )
+				return true;
+		}
+		return false;
+	}
+
+	////////////////////////////////
+
+	Opq* mpOpQ;
+	int mIndex;
+	u32 mStealSeed;
+	int mOpsSinceGroupScan;
+	std::vector<OpqSlot*> mSlotCache; // owner thread only
+	ChaseLevDeque<OpqSlot*,kdequesize> mDeque;
+};
+///////////////////////////////////////////////////////////////////////////
 struct OpqThreadData
 {
 	Opq* mpOpQ;
+	OpqWorker* mpWorker;
 	int miThreadID;
-	OpqThreadData() : mpOpQ(nullptr), miThreadID(0) {}
+	OpqThreadData() : mpOpQ(nullptr), mpWorker(nullptr), miThreadID(0) {}
 };
+static ThreadLocal OpqThreadData* gcuropqthread = nullptr;
+static OpqWorker* CurrentOpqWorker(const Opq* popq)
+{
+	const OpqThreadData* ptd = gcuropqthread;
+	return (ptd && ptd->mpOpQ==popq) ? ptd->mpWorker : nullptr;
+}
 ///////////////////////////////////////////////////////////////////////////
 struct OpqDrained : public IOpqSynchrComparison
 {
@@ -88,10 +202,12 @@ struct OpqDrained : public IOpqSynchrComparison
 };
 ///////////////////////////////////////////////////////////////////////////
 struct OpqThreadImpl : public ork::Thread {
+	static const int kidlespins = 64;
 	OpqThreadData mData;
-	OpqThreadImpl(Opq*popq,int thid)
+	OpqThreadImpl(Opq*popq,int thid,OpqWorker*pworker)
 	{
 		mData.mpOpQ = popq;
+		mData.mpWorker = pworker;
 		mData.miThreadID = thid;
 	}
 void run() // virtual
@@ -101,8 +217,6 @@ void run() // virtual
 	std::string opqn = popq->mName;
 	SetCurrentThreadName( opqn.c_str() );
 
-	popq->mThreadsRunning++;
-
 	static int icounter = 0;
 	int thid = opqthreaddata->miThreadID+4;
 	std::string channam = CreateFormattedString("opqth%d",int(thid));
@@ -114,9 +228,33 @@ void run() // virtual
 	//}
 
 	OpqTest opqtest(popq);
+	gcuropqthread = opqthreaddata;
+
+	OpqWorker* pworker = opqthreaddata->mpWorker;
 
 	while(false==popq->mbGoingDown)
 	{
+		if( pworker ) // EOPQMODE_WORKSTEALING
+		{
+			if( popq->ProcessWorker(pworker) ) continue;
+
+			bool item_processed = false;
+			for( int i=0; i<kidlespins && (false==item_processed); i++ )
+			{
+				std::this_thread::yield();
+				item_processed = popq->ProcessWorker(pworker);
+			}
+			if( item_processed ) continue;
+
+			// announce we are going to sleep, then check once more
+			//  so a concurrent push either sees us or we see its op
+			popq->mNumSleepingWorkers++;
+			if( false == popq->ProcessWorker(pworker) )
+				popq->mSemaphore.wait();
+			popq->mNumSleepingWorkers--;
+			continue;
+		}
+
 		popq->mSemaphore.wait(); // wait for an op (without spinning)
 
 		if( popq->mbGoingDown ) continue; // exit clause
@@ -126,6 +264,8 @@ void run() // virtual
 
 	}
 
+	gcuropqthread = nullptr;
+
 	popq->mThreadsRunning--;
 
 	//printf( "popq<%p> thread exiting...\n", popq );
@@ -135,84 +275,128 @@ void run() // virtual
 ///////////////////////////////////////////////////////////////////////////
 bool Opq::Process()
 {
-	bool rval = false;
-
+	if( mMode==EOPQMODE_WORKSTEALING )
+		return ProcessWorker(CurrentOpqWorker(this));
 
+	return ProcessGroups();
+}
+///////////////////////////////////////////////////////////////////////////
+bool Opq::ProcessGroups()
+{
 	Op the_op;
 
-	OpGroup* pexecgrp = nullptr;
-
-	int num_groups = mGroupCounter;
-	OpGroup* ptstgrp = nullptr;
 	for( auto& grp : mOpGroups )
 	{
-		int ioif = grp->mOpsInFlightCounter;
-		int imax = grp->mLimitMaxOpsInFlight;
-		int inumops = grp->mSynchro.NumOps();
+		if( grp->mSynchro.NumOps()<=0 )
+			continue;
+
+		if( false == grp->TryBeginOp() )
+			continue;
 
-		if( (inumops>0) && ((imax==0) || (ioif < imax)) )
+		if( grp->try_pop(the_op) )
 		{
-			if( grp->try_pop(the_op) )
-			{
-				pexecgrp = grp;
-				break;
-			}
+			RunOp(the_op,grp);
+			return true;
 		}
+
+		grp->EndOp();
 	}
+	return false;
+}
+///////////////////////////////////////////////////////////////////////////
+// pworker is null when called from a thread which is not one of our workers
+//  (eg. a queue with 0 threads pumped by its owner), which can only steal
+///////////////////////////////////////////////////////////////////////////
+bool Opq::ProcessWorker(OpqWorker* pworker)
+{
+	bool groups_first = true;
 
-	if( pexecgrp )
+	if( pworker )
 	{
-		pexecgrp->mOpsInFlightCounter++;
+		groups_first = (++pworker->mOpsSinceGroupScan >= OpqWorker::kgroupscaninterval);
+		if( groups_first )
+			pworker->mOpsSinceGroupScan = 0;
+	}
 
-		//printf( "  runop OIF<%d>\n", int(pexecgrp->mOpsInFlightCounter) );
-		const char* ppnam = "opx";
-		
-		if( the_op.mName.length() )
-		{
-			ppnam = the_op.mName.c_str();
-		}
+	if( groups_first && ProcessGroups() )
+		return true;
 
-		if( the_op.mWrapped.IsA<void_lambda_t>() )
-		{
-			the_op.mWrapped.Get<void_lambda_t>()();
-		}
-		else if( the_op.mWrapped.IsA<BarrierSyncReq>() )
-		{	
-			auto& R = the_op.mWrapped.Get<BarrierSyncReq>();
-			R.mFuture.Signal<bool>(true);
-		}
-		else
-		{
-			printf( "unknown opq invokable type\n" );
-		}
+	OpqSlot* pslot = nullptr;
 
-		this->mSynchro.RemItem();
-		pexecgrp->mSynchro.RemItem();
+	bool got_slot = false;
 
-		pexecgrp->mOpsInFlightCounter--;
-		rval=true;
+	if( pworker )
+		got_slot = pworker->mDeque.pop(pslot) || pworker->Steal(pslot);
+	else
+	{
+		for( auto w : mWorkers )
+			if( (got_slot=w->mDeque.steal(pslot)) )
+				break;
 	}
-	return rval;
+
+	if( false == got_slot )
+		return groups_first ? false : ProcessGroups();
+
+	OpGroup* pgrp = pslot->mGroup;
+	pgrp->TryBeginOp(); // deque ops are always from unlimited groups
+	RunOp(pslot->mOp,pgrp);
+	pslot->mOp = Op(); // release captures
+
+	if( pworker )
+		pworker->FreeSlot(pslot);
+	else
+		mSlotPool->mFreeSlots.try_push(pslot);
+
+	return true;
+}
+///////////////////////////////////////////////////////////////////////////
+// run an op whose in flight slot was claimed with pgrp->TryBeginOp()
+///////////////////////////////////////////////////////////////////////////
+void Opq::RunOp(Op& the_op, OpGroup* pgrp)
+{
+	//printf( "  runop OIF<%d>\n", int(pgrp->mOpsInFlightCounter) );
+	OrkAssert( bool(the_op.mLambda) ); // pushed an empty Op
+
+	if( the_op.mLambda )
+		the_op.mLambda();
+
+	this->mSynchro.RemItem();
+	pgrp->mSynchro.RemItem();
+
+	pgrp->EndOp();
 }
 ///////////////////////////////////////////////////////////////////////////
-void Opq::push(const Op& the_op)
+void Opq::NotifyWorkers()
 {
-	mDefaultGroup->push(the_op);
+	if( mMode==EOPQMODE_SHARED )
+	{
+		mSemaphore.notify();
+		return;
+	}
+	// pairs with the sleeping worker's increment-then-recheck
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if( mNumSleepingWorkers.load()>0 )
+		mSemaphore.notify();
 }
-void Opq::push(const void_lambda_t& l,const std::string& name)
+///////////////////////////////////////////////////////////////////////////
+void Opq::push(Op&& the_op)
 {
-	mDefaultGroup->push(Op(l,name));
+	mDefaultGroup->push(std::move(the_op));
 }
 void Opq::push(const BarrierSyncReq& s)
 {
 	mDefaultGroup->push(Op(s));	
 }
+bool Opq::try_push(Op&& the_op)
+{
+	return mDefaultGroup->try_push(std::move(the_op));
+}
 
 ///////////////////////////////////////////////////////////////////////////
-void Opq::push_sync(const Op& the_op)
+void Opq::push_sync(Op&& the_op)
 {
 	AssertNotOnOpQ(*this);
-	push(the_op);
+	push(std::move(the_op));
 	Future the_fut;
 	BarrierSyncReq R(the_fut);
 	push(R);
@@ -242,19 +426,31 @@ OpGroup* Opq::CreateOpGroup(const char* pname)
 	return pgrp;
 }
 ///////////////////////////////////////////////////////////////////////////
-Opq::Opq(int inumthreads, const char* name)
-	: mbGoingDown(false)
-	, mName(name)
+Opq::Opq(int inumthreads, const char* name, EOpqMode mode)
+	: mMode(mode)
 	, mSemaphore(name)
+	, mSlotPool(nullptr)
+	, mbGoingDown(false)
+	, mName(name)
 {
 	mGroupCounter = 0;
 	mThreadsRunning = 0;
+	mNumSleepingWorkers = 0;
 
 	mDefaultGroup = CreateOpGroup("defconq");
 
+	if( mMode==EOPQMODE_WORKSTEALING )
+	{
+		mSlotPool = new OpqSlotPool;
+		for( int i=0; i<inumthreads; i++ )
+			mWorkers.push_back(new OpqWorker(this,i));
+	}
+
 	for( int i=0; i<inumthreads; i++ )
 	{
-	    ork::Thread* thread_handle = new OpqThreadImpl(this,i);
+		OpqWorker* pworker = mWorkers.empty() ? nullptr : mWorkers[i];
+	    ork::Thread* thread_handle = new OpqThreadImpl(this,i,pworker);
+	    mThreadsRunning++; // counted before start, so a short lived Opq waits for threads not yet scheduled
 	    thread_handle->start();
 	}
 }
@@ -287,6 +483,15 @@ Opq::~Opq()
 	mOpGroups.clear();
 	/////////////////////////////////
 
+	for( auto w : mWorkers )
+	{
+		delete w;
+	}
+	mWorkers.clear();
+	delete mSlotPool;
+
+	/////////////////////////////////
+
 }
 ///////////////////////////////////////////////////////////////////////////
 OpGroup::OpGroup(Opq*popq, const char* pname)
@@ -299,7 +504,7 @@ OpGroup::OpGroup(Opq*popq, const char* pname)
 	mOpSerialIndex = 0;
 }
 ///////////////////////////////////////////////////////////////////////////
-void OpGroup::push(const Op& the_op)
+void OpGroup::push(Op&& the_op)
 {
 	////////////////////////////////
 	// throttle it (limit number of ops in queue)
@@ -316,14 +521,68 @@ void OpGroup::push(const Op& the_op)
 	OpGroupThrottler throttler(*this);
 	mSynchro.WaitOnCondition(throttler);
 	////////////////////////////////
+	// count before the op becomes visible, so it cant be retired first
+	////////////////////////////////
 
-	mOps.push(the_op);
 	this->mSynchro.AddItem();
 	mpOpQ->mSynchro.AddItem();
 
 	mOpSerialIndex++;
 
-	mpOpQ->mSemaphore.notify();
+	////////////////////////////////
+	// workstealing: ops from unlimited groups pushed by one of our
+	//  workers go to its own deque (falls back to mOps if full)
+	////////////////////////////////
+
+	bool pushed = false;
+
+	if( mpOpQ->mMode==EOPQMODE_WORKSTEALING && 0==mLimitMaxOpsInFlight )
+	{
+		OpqWorker* pworker = CurrentOpqWorker(mpOpQ);
+		if( pworker )
+			pushed = pworker->PushOp(the_op,this);
+	}
+
+	if( false == pushed )
+		mOps.push(std::move(the_op));
+
+	mpOpQ->NotifyWorkers();
+}
+///////////////////////////////////////////////////////////////////////////
+// same as push, but gives up instead of waiting on the throttle or on
+//  a full group queue (the op is left untouched then)
+///////////////////////////////////////////////////////////////////////////
+bool OpGroup::try_push(Op&& the_op)
+{
+	int imaxq = int(mLimitMaxOpsQueued);
+	if( imaxq!=0 && mSynchro.NumOps()>=imaxq )
+		return false;
+
+	this->mSynchro.AddItem();
+	mpOpQ->mSynchro.AddItem();
+
+	bool pushed = false;
+
+	if( mpOpQ->mMode==EOPQMODE_WORKSTEALING && 0==mLimitMaxOpsInFlight )
+	{
+		OpqWorker* pworker = CurrentOpqWorker(mpOpQ);
+		if( pworker )
+			pushed = pworker->PushOp(the_op,this);
+	}
+
+	if( false == pushed )
+		pushed = mOps.try_push(std::move(the_op));
+
+	if( false == pushed )
+	{
+		this->mSynchro.RemItem();
+		mpOpQ->mSynchro.RemItem();
+		return false;
+	}
+
+	mOpSerialIndex++;
+	mpOpQ->NotifyWorkers();
+	return true;
 }
 ///////////////////////////////////////////////////////////////////////////
 void OpGroup::drain()
@@ -338,31 +597,65 @@ bool OpGroup::try_pop( Op& out_op )
 	return rval;
 }
 ///////////////////////////////////////////////////////////////////////////
+bool OpGroup::TryBeginOp()
+{
+	int imax = mLimitMaxOpsInFlight;
+	if( imax==0 )
+	{
+		mOpsInFlightCounter++;
+		return true;
+	}
+	int ioif = mOpsInFlightCounter.load();
+	while( ioif < imax )
+	{
+		if( mOpsInFlightCounter.compare_exchange_weak(ioif,ioif+1) )
+			return true;
+	}
+	return false;
+}
+///////////////////////////////////////////////////////////////////////////
+void OpGroup::EndOp()
+{
+	mOpsInFlightCounter--;
+}
+///////////////////////////////////////////////////////////////////////////
+// the counter is lock free, the mutex is only taken to wake waiters
+//  (waiters register under the lock before testing the condition)
+///////////////////////////////////////////////////////////////////////////
 OpqSynchro::OpqSynchro()
 {
 	mOpCounter = 0;
+	mNumWaiters = 0;
 }
 ///////////////////////////////////////////////////////////////////////////
 void OpqSynchro::AddItem()
 {
-	mtx_lock_t lock(mOpWaitMtx);
 	mOpCounter++;
-	mOpWaitCV.notify_one();
+	if( mNumWaiters.load()>0 )
+	{
+		mtx_lock_t lock(mOpWaitMtx);
+		mOpWaitCV.notify_all();
+	}
 }
 ///////////////////////////////////////////////////////////////////////////
 void OpqSynchro::RemItem()
 {
-	mtx_lock_t lock(mOpWaitMtx);
 	mOpCounter--;
-	mOpWaitCV.notify_one();
+	if( mNumWaiters.load()>0 )
+	{
+		mtx_lock_t lock(mOpWaitMtx);
+		mOpWaitCV.notify_all();
+	}
 }
 ///////////////////////////////////////////////////////////////////////////
 void OpqSynchro::WaitOnCondition(const IOpqSynchrComparison& comparator)
 {
 	mtx_lock_t lock(mOpWaitMtx);
+	mNumWaiters++;
 	while( false == comparator.IsConditionMet(*this) )
 	{	mOpWaitCV.wait(lock);
 	}
+	mNumWaiters--;
 }
 ///////////////////////////////////////////////////////////////////////////
 int OpqSynchro::NumOps() const
@@ -388,8 +681,15 @@ Opq& MainThreadOpQ()
 	return gmainthrq;
 }
 ///////////////////////////////////////////////////////////////////////
+// one thread per core, less the update and render threads (which help
+//  out when they wait on it, TaskGraph::Wait / parallel_for)
+static int ConcurrentThreadCount()
+{
+	int inumcores = int(std::thread::hardware_concurrency());
+	return (inumcores>3) ? (inumcores-2) : 1;
+}
 #if 1
-static Opq gconopq(1,"ConcOpQ");
+static Opq gconopq(ConcurrentThreadCount(),"ConcOpQ",EOPQMODE_WORKSTEALING);
 Opq& ConcurrentOpQ()
 {
 	return gconopq;
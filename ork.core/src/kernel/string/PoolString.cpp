@@ -17,15 +17,15 @@
 #include <cstring>
 
 #ifndef ORK_CONFIG_EDITORBUILD
-# define COMPARE(op,y) mpString op (y).mpString
+# define COMPARE(op,y) mpNode op (y).mpNode
 #else
 # define COMPARE(op,y) compare(y) op 0
 #endif
 
 namespace ork {
 
-PoolString::PoolString(const char *string)
-	: mpString(string)
+PoolString::PoolString(const PoolStringNode *node)
+	: mpNode(node)
 {
 }
 
@@ -68,14 +68,14 @@ bool PoolString::operator !=(const PoolString &other) const
 
 PoolString::operator bool() const
 {
-	return mpString != NULL;
+	return mpNode != NULL;
 }
 
 ///////////////////////////////////////////////////////////
 
 bool PoolString::empty() const
 {
-	return NULL == mpString || mpString[0] == '\0';
+	return NULL == mpNode || mpNode->mLength == 0;
 }
 
 ///////////////////////////////////////////////////////////
@@ -83,10 +83,10 @@ bool PoolString::empty() const
 int PoolString::compare(const PoolString & rhs) const
 {
 #ifdef ORK_CONFIG_EDITORBUILD
-	if(mpString == rhs.mpString) return 0;
-	else if(mpString == NULL) return -1;
-	else if(rhs.mpString == NULL) return 1;
-	else return strcmp(mpString, rhs.mpString);
+	if(mpNode == rhs.mpNode) return 0;
+	else if(mpNode == NULL) return -1;
+	else if(rhs.mpNode == NULL) return 1;
+	else return strcmp(mpNode->mpString, rhs.mpNode->mpString);
 #else
 	OrkAssertNotImpl(); // not called on target platforms.
 	return 0;
@@ -95,112 +95,274 @@ int PoolString::compare(const PoolString & rhs) const
 
 ///////////////////////////////////////////////////////////
 
-StringPool::StringPool(const StringPool *parent)
-	: mParent(parent)
-	, mStringPool()
-	, mStringPoolMutex( "StringPoolMutex" )
+size_t PoolStringHash(const char *string, size_t length)
 {
-	//mStringPool.reserve( 2<<20 );
+	// 64 bit FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+	for(size_t i = 0; i < length; i++)
+	{
+		hash ^= uint64_t((unsigned char) string[i]);
+		hash *= 1099511628211ULL;
+	}
+	return size_t(hash);
 }
 
-const char *StringPool::FindRecursive(const PieceString &string) const
+///////////////////////////////////////////////////////////
+// StringPool
+///////////////////////////////////////////////////////////
+
+struct StringPoolTable
 {
-	const char *result = NULL;
-	Lock();
+	explicit StringPoolTable(size_t capacity)
+		: mMask(capacity - 1)
+		, mSlots(new ork::atomic<const PoolStringNode *>[capacity])
 	{
-		bool search_result;
-		orkvector<const char *>::size_type pos = BinarySearch(string, search_result);
+		for(size_t i = 0; i < capacity; i++)
+			mSlots[i].store(NULL, std::memory_order_relaxed);
+	}
+	~StringPoolTable()
+	{
+		delete[] mSlots;
+	}
+
+	size_t Capacity() const { return mMask + 1; }
 
-		if(search_result)
-			result = mStringPool[pos];
-		else if(mParent)
-			result = mParent->FindRecursive(string);
+	// lookups run concurrently with inserts, slots only go from NULL to a
+	// fully built node
+	const PoolStringNode *Find(const PieceString &string, size_t hash) const
+	{
+		for(size_t i = hash & mMask;; i = (i + 1) & mMask)
+		{
+			const PoolStringNode *node = mSlots[i].load(std::memory_order_acquire);
+			if(NULL == node)
+				return NULL;
+			if(node->mHash == hash
+			&& node->mLength == string.length()
+			&& 0 == std::memcmp(node->mpString, string.data(), string.length()))
+				return node;
+		}
 	}
-	UnLock();
-	return result;
-}
 
-const char *StringPool::FindFirst(const PieceString &string, VecType::iterator &it)
-{
-	const char *result = NULL;
-	Lock();
+	void Insert(const PoolStringNode *node)
 	{
-		bool search_result;
-		volatile VecType::size_type pos = BinarySearch(string, search_result);
+		size_t i = node->mHash & mMask;
+		while(mSlots[i].load(std::memory_order_relaxed))
+			i = (i + 1) & mMask;
+		mSlots[i].store(node, std::memory_order_release);
+	}
 
-		if(search_result)
-			result = mStringPool[pos];
-		else if(mParent)
-			result = mParent->FindRecursive(string);
+	size_t mMask;
+	ork::atomic<const PoolStringNode *> *mSlots;
+};
 
-		OrkHeapCheck();
+///////////////////////////////////////////////////////////
 
-		if(NULL == result)
+struct alignas(64) StringPoolShard
+{
+	static const size_t kinitialcapacity = 64;
+	static const size_t kblocksize = 16 << 10;
+
+	StringPoolShard()
+		: mCount(0)
+		, mBlockUsed(kblocksize)
+	{
+		mTable.store(NULL);
+	}
+	~StringPoolShard()
+	{
+		delete mTable.load();
+		for(StringPoolTable *table : mRetired)
+			delete table;
+		for(char *block : mBlocks)
+			delete[] block;
+	}
+
+	// node and string storage, mMutex held
+	void *Alloc(size_t size)
+	{
+		size = (size + 7) & ~size_t(7);
+		if(size > kblocksize / 4)
 		{
-			if(bool bpastend = (pos >= mStringPool.size()))
-				it = mStringPool.end();
-			else
-				it = mStringPool.begin() + pos;
+			mBlocks.push_back(new char[size]);
+			return mBlocks.back();
 		}
+		if(mBlockUsed + size > kblocksize)
+		{
+			mBlocks.push_back(new char[kblocksize]);
+			mBlockUsed = 0;
+		}
+		void *result = mBlocks.back() + mBlockUsed;
+		mBlockUsed += size;
+		return result;
 	}
-	UnLock();
-	return result;
+
+	// the old table stays valid for lookups in flight, it is only
+	// retired (freed with the pool)
+	StringPoolTable *Grow()
+	{
+		StringPoolTable *old_table = mTable.load(std::memory_order_relaxed);
+		size_t capacity = old_table ? old_table->Capacity() * 2 : kinitialcapacity;
+		StringPoolTable *new_table = new StringPoolTable(capacity);
+		if(old_table)
+		{
+			for(size_t i = 0; i < old_table->Capacity(); i++)
+				if(const PoolStringNode *node = old_table->mSlots[i].load(std::memory_order_relaxed))
+					new_table->Insert(node);
+			mRetired.push_back(old_table);
+		}
+		mTable.store(new_table, std::memory_order_release);
+		return new_table;
+	}
+
+	ork::atomic<StringPoolTable *> mTable;
+	std::mutex mMutex;
+	size_t mCount;
+	orkvector<StringPoolTable *> mRetired;
+	orkvector<char *> mBlocks;
+	size_t mBlockUsed;
+};
+
+static inline int ShardIndex(size_t hash)
+{
+	return int((uint64_t(hash) >> 32) % StringPool::knumshards);
+}
+
+///////////////////////////////////////////////////////////
+
+StringPool::StringPool(const StringPool *parent)
+	: mParent(parent)
+	, mShards(new StringPoolShard[knumshards])
+{
+	miSize.store(0);
 }
 
-int StringPool::FindIndex(const PieceString &string) const
+StringPool::~StringPool()
 {
-	orkvector<const char *>::size_type pos;
-	bool search_result = false;
-	Lock();
-	{
-		OrkAssert(mParent == NULL);
+	delete[] mShards;
+}
 
-		pos = BinarySearch(string, search_result);
+const PoolStringNode *StringPool::FindLocal(const PieceString &string, size_t hash) const
+{
+	const StringPoolTable *table = mShards[ShardIndex(hash)].mTable.load(std::memory_order_acquire);
 
+	return table ? table->Find(string, hash) : NULL;
+}
+
+const PoolStringNode *StringPool::FindRecursive(const PieceString &string, size_t hash) const
+{
+	for(const StringPool *pool = this; pool; pool = pool->mParent)
+	{
+		if(const PoolStringNode *node = pool->FindLocal(string, hash))
+			return node;
 	}
-	UnLock();
-	
-	return search_result ? int(pos) : -1;
+	return NULL;
 }
 
-int StringPool::StringIndex(const PieceString &string)
+PoolString StringPool::Add(const PieceString &string, bool bliteral)
 {
-	PoolString pooled_string = String(string);
+	size_t hash = PoolStringHash(string.data(), string.length());
+
+	if(const PoolStringNode *node = FindRecursive(string, hash))
+		return PoolString(node);
+
+	StringPoolShard &shard = mShards[ShardIndex(hash)];
+	std::lock_guard<std::mutex> lock(shard.mMutex);
 
-	return FindIndex(pooled_string);
+	// someone may have added it since the lock free lookup
+	StringPoolTable *table = shard.mTable.load(std::memory_order_relaxed);
+	if(table)
+	{
+		if(const PoolStringNode *node = table->Find(string, hash))
+			return PoolString(node);
+	}
+
+	if(NULL == table || (shard.mCount + 1) * 2 > table->Capacity())
+		table = shard.Grow();
+
+	PoolStringNode *node = NULL;
+	if(bliteral)
+	{
+		node = new(shard.Alloc(sizeof(PoolStringNode))) PoolStringNode;
+		node->mpString = string.data();
+	}
+	else
+	{
+		char *storage = static_cast<char *>(shard.Alloc(sizeof(PoolStringNode) + string.length() + 1));
+		char *new_string = storage + sizeof(PoolStringNode);
+		std::memcpy(new_string, string.data(), string.length());
+		new_string[string.length()] = '\0';
+
+		node = new(storage) PoolStringNode;
+		node->mpString = new_string;
+	}
+	node->mHash = hash;
+	node->mLength = string.length();
+
+	table->Insert(node);
+	shard.mCount++;
+	miSize.fetch_add(1);
+
+	return PoolString(node);
 }
 
-int StringPool::LiteralIndex(const ConstString &string)
+PoolString StringPool::String(const PieceString &s)
 {
-	PoolString pooled_string = Literal(string);
+	return Add(s, false);
+}
 
-	return FindIndex(pooled_string);
+PoolString StringPool::Literal(const ConstString &s)
+{
+	return Add(PieceString(s.c_str(), s.length()), true);
+}
+
+PoolString StringPool::Find(const PieceString &s) const
+{
+	return PoolString(FindRecursive(s, PoolStringHash(s.data(), s.length())));
 }
 
 int StringPool::Size() const
 {
-	return int(mStringPool.size());
+	return miSize.load();
 }
 
-PoolString StringPool::FromIndex(int index) const
+///////////////////////////////////////////////////////////
+// IndexedStringPool
+///////////////////////////////////////////////////////////
+
+void IndexedStringPool::Literal(const char *string)
 {
-	OrkAssert(mParent == NULL);
+	bool found = false;
+	VecType::size_type pos = BinarySearch(string, found);
 
-	if(index == -1 || index >= int(mStringPool.size())) 
-		return PoolString();
-	else
-		return mStringPool[orkvector<const char *>::size_type(index)];
+	if(false == found)
+		mStrings.insert(mStrings.begin() + pos, string);
 }
 
-StringPool::VecType::size_type StringPool::BinarySearch(const PieceString &string, bool &result) const
+int IndexedStringPool::FindIndex(const PieceString &string) const
+{
+	bool found = false;
+	VecType::size_type pos = BinarySearch(string, found);
+
+	return found ? int(pos) : -1;
+}
+
+const char *IndexedStringPool::FromIndex(int index) const
+{
+	if(index < 0 || index >= int(mStrings.size()))
+		return NULL;
+
+	return mStrings[VecType::size_type(index)];
+}
+
+IndexedStringPool::VecType::size_type IndexedStringPool::BinarySearch(const PieceString &string, bool &result) const
 {
 	VecType::size_type lo = 0;
-	VecType::size_type hi = mStringPool.size();
+	VecType::size_type hi = mStrings.size();
 	
 	while(lo < hi)
 	{
-		orkvector<const char *>::size_type mid = (lo + hi) / 2;
-		int cmp = string.compare(mStringPool[mid]);
+		VecType::size_type mid = (lo + hi) / 2;
+		int cmp = string.compare(mStrings[mid]);
 
 		if(cmp < 0)
 			hi = mid;
@@ -217,49 +379,6 @@ StringPool::VecType::size_type StringPool::BinarySearch(const PieceString &strin
 	return lo;
 }
 
-PoolString StringPool::String(const PieceString &s)
-{
-	const char *string = 0;
-	Lock();
-	{
-		VecType::iterator insertion_point;
-		string = FindFirst(s, insertion_point);
-		if(string == NULL)
-		{
-			char *new_string = new char[s.length() + 1];
-			std::memcpy(new_string, s.data(), s.length());
-			new_string[s.length()] = '\0';
-
-			string = new_string;
-			mStringPool.insert(insertion_point, string);
-		}
-	}
-	UnLock();
-	return PoolString(string);
-}
-
-PoolString StringPool::Literal(const ConstString &s)
-{
-	const char *string = 0;
-	Lock();
-	{
-		VecType::iterator insertion_point = mStringPool.end();
-		string = FindFirst(s, insertion_point);
-		if(string == NULL)
-		{
-			string = s.c_str();
-			mStringPool.insert(insertion_point, string);
-		}
-	}
-	UnLock();
-	return PoolString(string);
-}
-
-PoolString StringPool::Find(const PieceString &s) const
-{
-	return FindRecursive(s);
-}
-
 ///////////////////////////////////////////////////
 
 namespace reflect {
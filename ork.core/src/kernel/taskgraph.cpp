@@ -0,0 +1,261 @@
+///////////////////////////////////////////////////////////////////////
+//
+///////////////////////////////////////////////////////////////////////
+
+#include <ork/pch.h>
+#include <ork/kernel/taskgraph.h>
+#include <ork/util/Context.hpp>
+#include <thread>
+
+///////////////////////////////////////////////////////////////////////
+namespace ork {
+///////////////////////////////////////////////////////////////////////////
+// tasks which are ready to run. the opq only ever sees ops which pop
+//  one of them, so whoever gets there first (a worker or the waiter)
+//  runs it and the op left behind finds the list empty. a task on the
+//  list keeps its graph pending, so a popped task's graph is alive.
+///////////////////////////////////////////////////////////////////////////
+struct TaskReadyList
+{
+	void Push(Task* ptask)
+	{
+		std::lock_guard<std::mutex> lock(mMtx);
+		mTasks.push_back(ptask);
+	}
+	Task* TryPop()
+	{
+		std::lock_guard<std::mutex> lock(mMtx);
+		if( mTasks.empty() )
+			return nullptr;
+		Task* rval = mTasks.back();
+		mTasks.pop_back();
+		return rval;
+	}
+	void Reserve(size_t inum)
+	{
+		std::lock_guard<std::mutex> lock(mMtx);
+		mTasks.reserve(inum);
+	}
+
+	std::mutex			mMtx;
+	std::vector<Task*>	mTasks;
+};
+///////////////////////////////////////////////////////////////////////////
+Task::Task(TaskGraph* ptg, lambda_t&& l, const char* name)
+	: mGraph(ptg)
+	, mLambda(std::move(l))
+	, mName(name)
+	, mEntry(this)
+	, mNumDeps(0)
+{
+	mPendingDeps = 0;
+}
+///////////////////////////////////////////////////////////////////////////
+TaskGraph::TaskGraph()
+	: mReady(std::make_shared<TaskReadyList>())
+	, mOpq(nullptr)
+{
+	mNumPending = 0;
+	mLaunched = false;
+}
+///////////////////////////////////////////////////////////////////////////
+TaskGraph::~TaskGraph()
+{
+	Wait();
+}
+///////////////////////////////////////////////////////////////////////////
+Task* TaskGraph::CreateTask(lambda_t&& l, const char* name)
+{
+	assert(IsComplete());
+	mTasks.emplace_back(this,std::move(l),name);
+	return & mTasks.back();
+}
+///////////////////////////////////////////////////////////////////////////
+void TaskGraph::Precede(Task* pred, Task* succ)
+{
+	assert(IsComplete());
+	assert(pred->mGraph==this && succ->mGraph==this);
+	Task* pentry = succ->mEntry;
+	pred->mSuccessors.push_back(pentry);
+	pentry->mNumDeps++;
+}
+///////////////////////////////////////////////////////////////////////////
+Task* TaskGraph::Continue(Task* pred, lambda_t&& l, const char* name)
+{
+	Task* rval = CreateTask(std::move(l),name);
+	Precede(pred,rval);
+	return rval;
+}
+///////////////////////////////////////////////////////////////////////////
+// chunks hang between an empty fork and an empty join, which complete
+//  inline (never queued). the chunk count is capped to keep the number
+//  of ops a single ParallelFor puts on the opq at once reasonable.
+///////////////////////////////////////////////////////////////////////////
+Task* TaskGraph::ParallelFor(int ibegin, int iend, int igrain, range_lambda_t&& l, const char* name)
+{
+	static const int kmaxchunks = 1024;
+
+	Task* pfork = CreateTask(lambda_t(),name);
+	Task* pjoin = CreateTask(lambda_t(),name);
+
+	int icount = (iend>ibegin) ? (iend-ibegin) : 0;
+	if( igrain<1 )
+		igrain = 1;
+	if( (icount+igrain-1)/igrain > kmaxchunks )
+		igrain = (icount+kmaxchunks-1)/kmaxchunks;
+
+	if( 0 == icount )
+	{
+		Precede(pfork,pjoin);
+		pjoin->mEntry = pfork;
+		return pjoin;
+	}
+
+	mRangeLambdas.emplace_back(std::move(l));
+	range_lambda_t* prange = & mRangeLambdas.back();
+
+	for( int ib=ibegin; ib<iend; ib+=igrain )
+	{
+		int ie = (iend-ib)>igrain ? (ib+igrain) : iend;
+		Task* pchunk = CreateTask([prange,ib,ie](){ (*prange)(ib,ie); },name);
+		Precede(pfork,pchunk);
+		Precede(pchunk,pjoin);
+	}
+	pjoin->mEntry = pfork; // after wiring, from now on the fork gates the chunks
+	return pjoin;
+}
+///////////////////////////////////////////////////////////////////////////
+void TaskGraph::SetOnComplete(lambda_t&& l)
+{
+	assert(IsComplete());
+	mOnComplete = std::move(l);
+}
+///////////////////////////////////////////////////////////////////////////
+void TaskGraph::Clear()
+{
+	assert(IsComplete());
+	mTasks.clear();
+	mRangeLambdas.clear();
+	mOnComplete = nullptr;
+}
+///////////////////////////////////////////////////////////////////////////
+// the launching thread holds one extra pending count until all roots
+//  are scheduled, so the graph cannot complete under its feet
+///////////////////////////////////////////////////////////////////////////
+void TaskGraph::Launch(Opq& the_opq)
+{
+	assert(IsComplete());
+
+	mOpq = & the_opq;
+	mReady->Reserve(mTasks.size()); // no allocation when relaunched
+
+	for( auto& t : mTasks )
+		t.mPendingDeps.store(t.mNumDeps,MemRelaxed);
+
+	mNumPending.store(int(mTasks.size())+1,MemRelaxed);
+	mLaunched.store(true,MemRelease);
+
+	for( auto& t : mTasks )
+		if( 0 == t.mNumDeps )
+			Schedule(&t);
+
+	if( 1 == mNumPending.fetch_sub(1) )
+		Finish();
+}
+///////////////////////////////////////////////////////////////////////////
+// back-pressure: when the opq's queue is full the task is not dropped,
+//  the scheduling thread runs a ready task of this graph itself
+///////////////////////////////////////////////////////////////////////////
+void TaskGraph::Schedule(Task* ptask)
+{
+	if( false == bool(ptask->mLambda) )
+	{
+		RunTask(ptask);
+		return;
+	}
+
+	mReady->Push(ptask);
+
+	std::shared_ptr<TaskReadyList> ready = mReady;
+	Op the_op([ready]()
+	{
+		if( Task* pready = ready->TryPop() )
+			pready->mGraph->RunTask(pready);
+	},ptask->mName);
+
+	if( false == mOpq->try_push(std::move(the_op)) )
+	{
+		if( Task* pready = mReady->TryPop() )
+			RunTask(pready);
+	}
+}
+///////////////////////////////////////////////////////////////////////////
+void TaskGraph::RunTask(Task* ptask)
+{
+	if( ptask->mLambda )
+		ptask->mLambda();
+
+	for( Task* psucc : ptask->mSuccessors )
+		if( 1 == psucc->mPendingDeps.fetch_sub(1) )
+			Schedule(psucc);
+
+	if( 1 == mNumPending.fetch_sub(1) )
+		Finish();
+}
+///////////////////////////////////////////////////////////////////////////
+void TaskGraph::Finish()
+{
+	if( mOnComplete )
+		mOnComplete();
+
+	std::unique_lock<std::mutex> lock(mDoneMtx);
+	mLaunched.store(false,MemRelease);
+	mDoneCV.notify_all();
+}
+///////////////////////////////////////////////////////////////////////////
+// the waiter runs this graph's ready tasks while it is in flight (never
+//  other ops, it may hold locks they need). it only sleeps when the opq
+//  has threads of its own and the waiter is not one of them.
+//  the final wait always goes through the mutex, so Finish() is done
+//  touching the graph before Wait() returns (and the graph may be deleted)
+///////////////////////////////////////////////////////////////////////////
+void TaskGraph::Wait()
+{
+	if( nullptr == mOpq )
+		return;
+
+	auto ot = OpqTest::GetContext();
+	bool on_opq = ot && (ot->mOPQ==mOpq);
+
+	while( mLaunched.load(MemAcquire) )
+	{
+		if( Task* pready = mReady->TryPop() )
+		{
+			RunTask(pready);
+			continue;
+		}
+		if( int(mOpq->mThreadsRunning)>0 && false==on_opq )
+			break;
+		std::this_thread::yield();
+	}
+
+	std::unique_lock<std::mutex> lock(mDoneMtx);
+	while( mLaunched.load(MemAcquire) )
+		mDoneCV.wait(lock);
+}
+///////////////////////////////////////////////////////////////////////////
+void parallel_for(Opq& the_opq, int ibegin, int iend, int igrain, TaskGraph::range_lambda_t&& l)
+{
+	if( (iend-ibegin) <= igrain )
+	{
+		if( iend>ibegin )
+			l(ibegin,iend);
+		return;
+	}
+	TaskGraph tg;
+	tg.ParallelFor(ibegin,iend,igrain,std::move(l),"parallel_for");
+	tg.Launch(the_opq);
+	tg.Wait();
+}
+///////////////////////////////////////////////////////////////////////////
+} // namespace ork
@@ -12,6 +12,7 @@
 #include <ork/kernel/prop.h>
 #include <ork/kernel/prop.hpp>
 #include <ork/reflect/BidirectionalSerializer.h>
+#include <ork/kernel/atomic.h>
 
 namespace ork {
 
@@ -213,6 +214,18 @@ template class CPropType<TransformNode>;
 
 ///////////////////////////////////////////////////////////////////////////////
 
+static ork::atomic<uint32_t> gTransformVersion(0);
+
+static uint32_t NextTransformVersion()
+{
+	return gTransformVersion.fetch_add(1,MemRelaxed)+1;
+}
+
+Transform3DMatrix::Transform3DMatrix()
+	: mVersion(0)
+{
+}
+
 const CMatrix4& Transform3DMatrix::GetMatrix() const
 {
 	return mMatrix;
@@ -221,6 +234,7 @@ const CMatrix4& Transform3DMatrix::GetMatrix() const
 void Transform3DMatrix::SetMatrix(const CMatrix4& mat)
 {
 	mMatrix = mat;
+	mVersion = NextTransformVersion();
 }
 
 CVector3 Transform3DMatrix::GetPosition() const
@@ -253,6 +267,7 @@ void Transform3DMatrix::SetRotation( const CQuaternion &nq )
 	CReal Scale;
 	mMatrix.DecomposeMatrix( pos, oq, Scale );
 	mMatrix.ComposeMatrix( pos, nq, Scale );
+	mVersion = NextTransformVersion();
 }
 
 void Transform3DMatrix::SetScale( const float nscale)
@@ -262,6 +277,7 @@ void Transform3DMatrix::SetScale( const float nscale)
 	CReal Scale;
 	mMatrix.DecomposeMatrix( pos, q, Scale );
 	mMatrix.ComposeMatrix( pos, q, nscale );
+	mVersion = NextTransformVersion();
 }
 
 void Transform3DMatrix::SetPosition( const CVector3& npos )
@@ -271,6 +287,7 @@ void Transform3DMatrix::SetPosition( const CVector3& npos )
 	CReal Scale;
 	mMatrix.DecomposeMatrix( pos, q, Scale );
 	mMatrix.ComposeMatrix( npos, q, Scale );
+	mVersion = NextTransformVersion();
 }
 
 
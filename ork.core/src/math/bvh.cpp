@@ -0,0 +1,662 @@
+///////////////////////////////////////////////////////////////////////////////
+// Orkid
+// Copyrigh 1996-2009, Michael T. Mayers
+// See License at OrkidRoot/license.html or http://www.tweakoz.com/orkid/license.html
+///////////////////////////////////////////////////////////////////////////////
+
+#include <ork/pch.h>
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <ork/orkconfig.h>
+#include <ork/orktypes.h>
+#include <ork/math/bvh.h>
+#include <ork/math/raytracer.h>
+#include <ork/math/simd4.h>
+
+///////////////////////////////////////////////////////////////////////////////
+namespace ork {
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+using namespace simd;
+
+///////////////////////////////////////////////////////////////////////////////
+
+inline float SurfaceArea( const float* pmin, const float* pmax )
+{
+	float dx = pmax[0]-pmin[0];
+	float dy = pmax[1]-pmin[1];
+	float dz = pmax[2]-pmin[2];
+	return 2.0f*(dx*dy+dy*dz+dz*dx);
+}
+
+struct BinBox
+{
+	float mMin[3];
+	float mMax[3];
+	int mCount;
+
+	BinBox() : mCount(0)
+	{
+		mMin[0]=mMin[1]=mMin[2]=std::numeric_limits<float>::max();
+		mMax[0]=mMax[1]=mMax[2]=-std::numeric_limits<float>::max();
+	}
+	void Grow( const float* pmin, const float* pmax )
+	{
+		for( int a=0; a<3; a++ )
+		{
+			mMin[a] = std::min(mMin[a],pmin[a]);
+			mMax[a] = std::max(mMax[a],pmax[a]);
+		}
+	}
+	float Area() const { return mCount ? SurfaceArea(mMin,mMax) : 0.0f; }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// single ray vs (v0,e1,e2) triangle, Moller-Trumbore, two sided
+///////////////////////////////////////////////////////////////////////////////
+
+inline bool IntersectTri( const RaytBvhTri& tri, const float* org, const float* dir, float& fdist )
+{
+	const float* e1 = tri.mE1;
+	const float* e2 = tri.mE2;
+	float px = dir[1]*e2[2]-dir[2]*e2[1];
+	float py = dir[2]*e2[0]-dir[0]*e2[2];
+	float pz = dir[0]*e2[1]-dir[1]*e2[0];
+	float det = e1[0]*px+e1[1]*py+e1[2]*pz;
+	if( std::abs(det)<1.0e-12f )
+		return false;
+	float inv = 1.0f/det;
+	float tx = org[0]-tri.mV0[0];
+	float ty = org[1]-tri.mV0[1];
+	float tz = org[2]-tri.mV0[2];
+	float u = (tx*px+ty*py+tz*pz)*inv;
+	if( u<0.0f || u>1.0f )
+		return false;
+	float qx = ty*e1[2]-tz*e1[1];
+	float qy = tz*e1[0]-tx*e1[2];
+	float qz = tx*e1[1]-ty*e1[0];
+	float v = (dir[0]*qx+dir[1]*qy+dir[2]*qz)*inv;
+	if( v<0.0f || (u+v)>1.0f )
+		return false;
+	float t = (e2[0]*qx+e2[1]*qy+e2[2]*qz)*inv;
+	if( t<=0.0f || t>=fdist )
+		return false;
+	fdist = t;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+inline bool IntersectBox( const RaytBvhNode& node, const float* org, const float* idir, float fdist )
+{
+	float tmin = 0.0f;
+	float tmax = fdist;
+	for( int a=0; a<3; a++ )
+	{
+		float t0 = (node.mMin[a]-org[a])*idir[a];
+		float t1 = (node.mMax[a]-org[a])*idir[a];
+		tmin = std::max(tmin,std::min(t0,t1));
+		tmax = std::min(tmax,std::max(t0,t1));
+	}
+	return tmin<=tmax;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// packet in SoA registers
+///////////////////////////////////////////////////////////////////////////////
+
+struct Packet4
+{
+	f4 ox, oy, oz;
+	f4 dx, dy, dz;
+	f4 ix, iy, iz;
+
+	Packet4( const RaytBvhPacket& p )
+	{
+		ox = f4::load(p.mOrgX); oy = f4::load(p.mOrgY); oz = f4::load(p.mOrgZ);
+		dx = f4::load(p.mDirX); dy = f4::load(p.mDirY); dz = f4::load(p.mDirZ);
+		ix = vrcp(dx); iy = vrcp(dy); iz = vrcp(dz);
+	}
+
+	int IntersectBox( const RaytBvhNode& node, f4 dist ) const
+	{
+		f4 t0x = (f4(node.mMin[0])-ox)*ix;
+		f4 t1x = (f4(node.mMax[0])-ox)*ix;
+		f4 t0y = (f4(node.mMin[1])-oy)*iy;
+		f4 t1y = (f4(node.mMax[1])-oy)*iy;
+		f4 t0z = (f4(node.mMin[2])-oz)*iz;
+		f4 t1z = (f4(node.mMax[2])-oz)*iz;
+		f4 tmin = vmax(vmax(vmin(t0x,t1x),vmin(t0y,t1y)),vmax(vmin(t0z,t1z),f4(0.0f)));
+		f4 tmax = vmin(vmin(vmax(t0x,t1x),vmax(t0y,t1y)),vmin(vmax(t0z,t1z),dist));
+		return vmask(vle(tmin,tmax));
+	}
+
+	// returns lanes (within ilanes) which hit closer than dist, dist updated
+	int IntersectTri( const RaytBvhTri& tri, f4& dist, int ilanes ) const
+	{
+		f4 e1x(tri.mE1[0]), e1y(tri.mE1[1]), e1z(tri.mE1[2]);
+		f4 e2x(tri.mE2[0]), e2y(tri.mE2[1]), e2z(tri.mE2[2]);
+		f4 px = dy*e2z-dz*e2y;
+		f4 py = dz*e2x-dx*e2z;
+		f4 pz = dx*e2y-dy*e2x;
+		f4 det = e1x*px+e1y*py+e1z*pz;
+		f4 inv = vrcp(det);
+		f4 tx = ox-f4(tri.mV0[0]);
+		f4 ty = oy-f4(tri.mV0[1]);
+		f4 tz = oz-f4(tri.mV0[2]);
+		f4 u = (tx*px+ty*py+tz*pz)*inv;
+		f4 qx = ty*e1z-tz*e1y;
+		f4 qy = tz*e1x-tx*e1z;
+		f4 qz = tx*e1y-ty*e1x;
+		f4 v = (dx*qx+dy*qy+dz*qz)*inv;
+		f4 t = (e2x*qx+e2y*qy+e2z*qz)*inv;
+		f4 zero(0.0f);
+		m4 hit = vand(vand(vle(zero,u),vle(zero,v)),vle(u+v,f4(1.0f)));
+		hit = vand(hit,vand(vlt(zero,t),vlt(t,dist)));
+		hit = vand(hit,vlanes(ilanes));
+		dist = vselect(hit,t,dist);
+		return vmask(hit);
+	}
+};
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+void RaytBvhPacket::SetRay( int ilane, const Ray3& ray, float fmaxdist )
+{
+	mOrgX[ilane] = ray.mOrigin.GetX();
+	mOrgY[ilane] = ray.mOrigin.GetY();
+	mOrgZ[ilane] = ray.mOrigin.GetZ();
+	mDirX[ilane] = ray.mDirection.GetX();
+	mDirY[ilane] = ray.mDirection.GetY();
+	mDirZ[ilane] = ray.mDirection.GetZ();
+	mDist[ilane] = fmaxdist;
+	mPrim[ilane] = nullptr;
+	mActive |= (1<<ilane);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+RaytBvh::RaytBvh()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void RaytBvh::Clear()
+{
+	mNodes.clear();
+	mTris.clear();
+	mPrims.clear();
+	mBounds = AABox();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t RaytBvh::MemoryUsage() const
+{
+	return mNodes.capacity()*sizeof(RaytBvhNode)
+		 + mTris.capacity()*sizeof(RaytBvhTri)
+		 + mPrims.capacity()*sizeof(const Primitive*);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void RaytBvh::Build( const orkvector<const Primitive*>& prims )
+{
+	Clear();
+
+	int inumprims = int(prims.size());
+	if( 0 == inumprims )
+		return;
+
+	orkvector<BuildPrim> bprims;
+	bprims.resize(inumprims);
+
+	for( int i=0; i<inumprims; i++ )
+	{
+		AABox box = prims[i]->GetAABox();
+		BuildPrim& bp = bprims[i];
+		for( int a=0; a<3; a++ )
+		{
+			bp.mMin[a] = box.Min()[a];
+			bp.mMax[a] = box.Max()[a];
+			bp.mCentroid[a] = (bp.mMin[a]+bp.mMax[a])*0.5f;
+		}
+		bp.mIndex = u32(i);
+	}
+
+	mNodes.reserve(inumprims*2);
+	mTris.reserve(inumprims);
+	mPrims.reserve(inumprims);
+
+	mNodes.push_back(RaytBvhNode());
+	BuildRecursive(prims,0,bprims,0,inumprims,0);
+
+	for( size_t i=0; i<mPrims.size(); i++ )
+	{
+		RaytBvhTri& tri = mTris[i];
+		const RaytTriangle* ptri = dynamic_cast<const RaytTriangle*>(mPrims[i]);
+		tri.mGeneric = (nullptr==ptri);
+		if( ptri )
+		{
+			const CVector3& v0 = ptri->GetVertex(0)->pos;
+			const CVector3& v1 = ptri->GetVertex(1)->pos;
+			const CVector3& v2 = ptri->GetVertex(2)->pos;
+			for( int a=0; a<3; a++ )
+			{
+				tri.mV0[a] = v0[a];
+				tri.mE1[a] = v1[a]-v0[a];
+				tri.mE2[a] = v2[a]-v0[a];
+			}
+		}
+	}
+
+	const RaytBvhNode& root = mNodes[0];
+	mBounds = AABox( CVector3(root.mMin[0],root.mMin[1],root.mMin[2]),
+					 CVector3(root.mMax[0],root.mMax[1],root.mMax[2]) );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// inode is always the last node pushed, so its left child lands at inode+1
+///////////////////////////////////////////////////////////////////////////////
+
+void RaytBvh::BuildRecursive( const orkvector<const Primitive*>& prims, u32 inode, orkvector<BuildPrim>& bprims, int ifirst, int icount, int idepth )
+{
+	BinBox bounds, cbounds;
+	for( int i=ifirst; i<ifirst+icount; i++ )
+	{
+		const BuildPrim& bp = bprims[i];
+		bounds.Grow(bp.mMin,bp.mMax);
+		cbounds.Grow(bp.mCentroid,bp.mCentroid);
+	}
+	for( int a=0; a<3; a++ )
+	{
+		mNodes[inode].mMin[a] = bounds.mMin[a];
+		mNodes[inode].mMax[a] = bounds.mMax[a];
+	}
+
+	/////////////////////////////////////
+	// leaf ?
+	/////////////////////////////////////
+
+	if( icount<=kmaxleafprims || idepth>=kmaxdepth )
+	{
+		OrkAssert(icount<0x10000);
+		RaytBvhNode& node = mNodes[inode];
+		node.mIndex = u32(mPrims.size());
+		node.mCount = u16(icount);
+		node.mAxis = 0;
+		for( int i=ifirst; i<ifirst+icount; i++ )
+		{
+			mPrims.push_back(prims[bprims[i].mIndex]);
+			mTris.push_back(RaytBvhTri());
+		}
+		return;
+	}
+
+	/////////////////////////////////////
+	// binned SAH over all 3 axes
+	/////////////////////////////////////
+
+	int ibestaxis = -1;
+	int ibestsplit = -1;
+	float fbestcost = std::numeric_limits<float>::max();
+
+	for( int a=0; a<3; a++ )
+	{
+		float fext = cbounds.mMax[a]-cbounds.mMin[a];
+		if( fext<=0.0f )
+			continue;
+		float fscale = float(knumbins)*0.9999f/fext;
+
+		BinBox bins[knumbins];
+		for( int i=ifirst; i<ifirst+icount; i++ )
+		{
+			const BuildPrim& bp = bprims[i];
+			int ib = int((bp.mCentroid[a]-cbounds.mMin[a])*fscale);
+			bins[ib].Grow(bp.mMin,bp.mMax);
+			bins[ib].mCount++;
+		}
+
+		float rarea[knumbins];
+		int rcount[knumbins];
+		BinBox racc;
+		for( int ib=knumbins-1; ib>0; ib-- )
+		{
+			racc.Grow(bins[ib].mMin,bins[ib].mMax);
+			racc.mCount += bins[ib].mCount;
+			rarea[ib] = racc.Area();
+			rcount[ib] = racc.mCount;
+		}
+		BinBox lacc;
+		for( int ib=0; ib<knumbins-1; ib++ )
+		{
+			lacc.Grow(bins[ib].mMin,bins[ib].mMax);
+			lacc.mCount += bins[ib].mCount;
+			if( 0==lacc.mCount || 0==rcount[ib+1] )
+				continue;
+			float fcost = lacc.Area()*float(lacc.mCount) + rarea[ib+1]*float(rcount[ib+1]);
+			if( fcost<fbestcost )
+			{
+				fbestcost = fcost;
+				ibestaxis = a;
+				ibestsplit = ib;
+			}
+		}
+	}
+
+	/////////////////////////////////////
+	// partition (median fallback when centroids coincide)
+	/////////////////////////////////////
+
+	BuildPrim* pbeg = bprims.data()+ifirst;
+	BuildPrim* pend = pbeg+icount;
+	BuildPrim* pmid = nullptr;
+
+	if( ibestaxis>=0 )
+	{
+		int a = ibestaxis;
+		float fmin = cbounds.mMin[a];
+		float fscale = float(knumbins)*0.9999f/(cbounds.mMax[a]-fmin);
+		pmid = std::partition( pbeg, pend, [=](const BuildPrim& bp)
+		{
+			return int((bp.mCentroid[a]-fmin)*fscale)<=ibestsplit;
+		});
+	}
+	if( pmid==nullptr || pmid==pbeg || pmid==pend )
+	{
+		int a = (ibestaxis>=0) ? ibestaxis : 0;
+		ibestaxis = a;
+		pmid = pbeg+icount/2;
+		std::nth_element( pbeg, pmid, pend, [=](const BuildPrim& l, const BuildPrim& r)
+		{
+			return l.mCentroid[a]<r.mCentroid[a];
+		});
+	}
+
+	int ileft = int(pmid-pbeg);
+
+	/////////////////////////////////////
+
+	u32 ileftnode = u32(mNodes.size());
+	mNodes.push_back(RaytBvhNode());
+	BuildRecursive(prims,ileftnode,bprims,ifirst,ileft,idepth+1);
+
+	u32 irightnode = u32(mNodes.size());
+	mNodes.push_back(RaytBvhNode());
+	BuildRecursive(prims,irightnode,bprims,ifirst+ileft,icount-ileft,idepth+1);
+
+	RaytBvhNode& node = mNodes[inode];
+	node.mIndex = irightnode;
+	node.mCount = 0;
+	node.mAxis = u16(ibestaxis);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+bool RaytBvh::FindNearest( const Ray3& ray, float& dist, const Primitive*& prim ) const
+{
+	if( mNodes.empty() )
+		return false;
+
+	const float org[3] = { ray.mOrigin.GetX(), ray.mOrigin.GetY(), ray.mOrigin.GetZ() };
+	const float dir[3] = { ray.mDirection.GetX(), ray.mDirection.GetY(), ray.mDirection.GetZ() };
+	const float idir[3] = { 1.0f/dir[0], 1.0f/dir[1], 1.0f/dir[2] };
+
+	bool bhit = false;
+	u32 stack[kmaxdepth*2];
+	int isp = 0;
+	stack[isp++] = 0;
+
+	while( isp )
+	{
+		const RaytBvhNode& node = mNodes[stack[--isp]];
+		if( false == IntersectBox(node,org,idir,dist) )
+			continue;
+
+		if( node.IsLeaf() )
+		{
+			for( u32 i=node.mIndex; i<node.mIndex+node.mCount; i++ )
+			{
+				const RaytBvhTri& tri = mTris[i];
+				if( tri.mGeneric )
+				{
+					CVector3 isect;
+					float ftemp = dist;
+					if( mPrims[i]->Intersect(ray,isect,ftemp) && ftemp>0.0f && ftemp<dist )
+					{
+						dist = ftemp;
+						prim = mPrims[i];
+						bhit = true;
+					}
+				}
+				else if( IntersectTri(tri,org,dir,dist) )
+				{
+					prim = mPrims[i];
+					bhit = true;
+				}
+			}
+			continue;
+		}
+
+		u32 ileft = u32(&node-mNodes.data())+1;
+		u32 iright = node.mIndex;
+		if( dir[node.mAxis]>=0.0f ) // near child last (popped first)
+		{
+			stack[isp++] = iright;
+			stack[isp++] = ileft;
+		}
+		else
+		{
+			stack[isp++] = ileft;
+			stack[isp++] = iright;
+		}
+	}
+	return bhit;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool RaytBvh::Occluded( const Ray3& ray, float fmaxdist ) const
+{
+	if( mNodes.empty() )
+		return false;
+
+	const float org[3] = { ray.mOrigin.GetX(), ray.mOrigin.GetY(), ray.mOrigin.GetZ() };
+	const float dir[3] = { ray.mDirection.GetX(), ray.mDirection.GetY(), ray.mDirection.GetZ() };
+	const float idir[3] = { 1.0f/dir[0], 1.0f/dir[1], 1.0f/dir[2] };
+
+	u32 stack[kmaxdepth*2];
+	int isp = 0;
+	stack[isp++] = 0;
+
+	while( isp )
+	{
+		const RaytBvhNode& node = mNodes[stack[--isp]];
+		if( false == IntersectBox(node,org,idir,fmaxdist) )
+			continue;
+
+		if( node.IsLeaf() )
+		{
+			for( u32 i=node.mIndex; i<node.mIndex+node.mCount; i++ )
+			{
+				const RaytBvhTri& tri = mTris[i];
+				float fdist = fmaxdist;
+				if( tri.mGeneric )
+				{
+					CVector3 isect;
+					if( mPrims[i]->Intersect(ray,isect,fdist) && fdist>0.0f && fdist<fmaxdist )
+						return true;
+				}
+				else if( IntersectTri(tri,org,dir,fdist) )
+					return true;
+			}
+			continue;
+		}
+
+		stack[isp++] = node.mIndex;
+		stack[isp++] = u32(&node-mNodes.data())+1;
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// packets : a node is visited if any live lane hits its box,
+//  child order follows the first live lane's direction
+///////////////////////////////////////////////////////////////////////////////
+
+void RaytBvh::FindNearest( RaytBvhPacket& packet ) const
+{
+	packet.mHits = 0;
+	for( int l=0; l<RaytBvhPacket::ksize; l++ )
+		packet.mPrim[l] = nullptr;
+
+	int iactive = int(packet.mActive&0xf);
+	if( mNodes.empty() || 0==iactive )
+		return;
+
+	const Packet4 p4(packet);
+	f4 dist = f4::load(packet.mDist);
+	int ilead = 0;
+	while( 0==(iactive&(1<<ilead)) ) ilead++;
+	const float* dirs[3] = { packet.mDirX, packet.mDirY, packet.mDirZ };
+
+	u32 stack[kmaxdepth*2];
+	int isp = 0;
+	stack[isp++] = 0;
+
+	while( isp )
+	{
+		const RaytBvhNode& node = mNodes[stack[--isp]];
+		int ilanes = p4.IntersectBox(node,dist)&iactive;
+		if( 0==ilanes )
+			continue;
+
+		if( node.IsLeaf() )
+		{
+			for( u32 i=node.mIndex; i<node.mIndex+node.mCount; i++ )
+			{
+				const RaytBvhTri& tri = mTris[i];
+				int ihits = 0;
+				if( tri.mGeneric )
+				{
+					float fdist[RaytBvhPacket::ksize];
+					dist.store(fdist);
+					for( int l=0; l<RaytBvhPacket::ksize; l++ )
+					{
+						if( 0==(ilanes&(1<<l)) )
+							continue;
+						Ray3 ray( CVector3(packet.mOrgX[l],packet.mOrgY[l],packet.mOrgZ[l]),
+								  CVector3(packet.mDirX[l],packet.mDirY[l],packet.mDirZ[l]) );
+						CVector3 isect;
+						float ftemp = fdist[l];
+						if( mPrims[i]->Intersect(ray,isect,ftemp) && ftemp>0.0f && ftemp<fdist[l] )
+						{
+							fdist[l] = ftemp;
+							ihits |= (1<<l);
+						}
+					}
+					dist = f4::load(fdist);
+				}
+				else
+					ihits = p4.IntersectTri(tri,dist,ilanes);
+
+				if( ihits )
+				{
+					packet.mHits |= u32(ihits);
+					for( int l=0; l<RaytBvhPacket::ksize; l++ )
+						if( ihits&(1<<l) )
+							packet.mPrim[l] = mPrims[i];
+				}
+			}
+			continue;
+		}
+
+		u32 ileft = u32(&node-mNodes.data())+1;
+		u32 iright = node.mIndex;
+		if( dirs[node.mAxis][ilead]>=0.0f )
+		{
+			stack[isp++] = iright;
+			stack[isp++] = ileft;
+		}
+		else
+		{
+			stack[isp++] = ileft;
+			stack[isp++] = iright;
+		}
+	}
+
+	dist.store(packet.mDist);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void RaytBvh::Occluded( RaytBvhPacket& packet ) const
+{
+	packet.mHits = 0;
+
+	int ilive = int(packet.mActive&0xf);
+	if( mNodes.empty() || 0==ilive )
+		return;
+
+	const Packet4 p4(packet);
+	const f4 maxdist = f4::load(packet.mDist);
+
+	u32 stack[kmaxdepth*2];
+	int isp = 0;
+	stack[isp++] = 0;
+
+	while( isp && ilive )
+	{
+		const RaytBvhNode& node = mNodes[stack[--isp]];
+		int ilanes = p4.IntersectBox(node,maxdist)&ilive;
+		if( 0==ilanes )
+			continue;
+
+		if( node.IsLeaf() )
+		{
+			for( u32 i=node.mIndex; (i<node.mIndex+node.mCount) && ilanes; i++ )
+			{
+				const RaytBvhTri& tri = mTris[i];
+				int ihits = 0;
+				if( tri.mGeneric )
+				{
+					for( int l=0; l<RaytBvhPacket::ksize; l++ )
+					{
+						if( 0==(ilanes&(1<<l)) )
+							continue;
+						Ray3 ray( CVector3(packet.mOrgX[l],packet.mOrgY[l],packet.mOrgZ[l]),
+								  CVector3(packet.mDirX[l],packet.mDirY[l],packet.mDirZ[l]) );
+						CVector3 isect;
+						float ftemp = packet.mDist[l];
+						if( mPrims[i]->Intersect(ray,isect,ftemp) && ftemp>0.0f && ftemp<packet.mDist[l] )
+							ihits |= (1<<l);
+					}
+				}
+				else
+				{
+					f4 dist = maxdist;
+					ihits = p4.IntersectTri(tri,dist,ilanes);
+				}
+				ilanes &= ~ihits;
+				ilive &= ~ihits;
+				packet.mHits |= u32(ihits);
+			}
+			continue;
+		}
+
+		stack[isp++] = node.mIndex;
+		stack[isp++] = u32(&node-mNodes.data())+1;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+} // namespace ork
+///////////////////////////////////////////////////////////////////////////////
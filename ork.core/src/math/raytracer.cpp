@@ -14,11 +14,14 @@
 #include <ork/math/raytracer.h>
 #include <ork/math/sphere.h>
 #include <ork/math/plane.h>
-#include <ork/math/octree.h>
+#include <ork/math/bvh.h>
 #include <ork/math/collision_test.h>
 #include <ork/kernel/Array.h>
 #include <ork/kernel/Array.hpp>
 #include <ork/kernel/gstack.h>
+#include <ork/kernel/opq.h>
+#include <ork/kernel/taskgraph.h>
+#include <ork/kernel/timer.h>
 #include <ork/file/chunkfile.h>
 #include <ork/file/chunkfile.hpp>
 #include <queue>
@@ -40,6 +43,9 @@ s64 giNumRays = 0;
 
 namespace ork {
 
+// rays traced by this thread, RunTiles adds each tile's to giNumRays
+static ThreadLocal s64 gtlNumRays = 0;
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -73,7 +79,7 @@ void RgmTri::Compute()
 
 }
 
-Jitterer::Jitterer( int ikos, float fradius, const CVector3& dX, const CVector3& dY )
+Jitterer::Jitterer( int ikos, float fradius, const CVector3& dX, const CVector3& dY, u32 useed )
 {
 	miKos = ikos;
 
@@ -90,7 +96,17 @@ Jitterer::Jitterer( int ikos, float fradius, const CVector3& dX, const CVector3&
 		for( int ix=-ikos; ix<=ikos; ix++ )
 		{
 			float fx = fradius*float(ix)/float(idiv);
-			sample[isamp++] = dX*fx+dY*fy;
+			if( useed && ikos>0 )
+			{	// jitter within the cell, xorshift so it only depends on the seed
+				float fcell = fradius/float(idiv);
+				useed ^= useed<<13; useed ^= useed>>17; useed ^= useed<<5;
+				float jx = float(useed&0xffff)*(1.0f/65536.0f)-0.5f;
+				useed ^= useed<<13; useed ^= useed>>17; useed ^= useed<<5;
+				float jy = float(useed&0xffff)*(1.0f/65536.0f)-0.5f;
+				sample[isamp++] = dX*(fx+jx*fcell)+dY*(fy+jy*fcell);
+			}
+			else
+				sample[isamp++] = dX*fx+dY*fy;
 		}
 	}
 	OrkAssert(isamp==miNumSamples);
@@ -343,7 +359,28 @@ bool RaytTriangle::IntersectBox( const AABox& a_Box ) const
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void RaytTriangle::Rasterize( Engine* peng ) const
+bool RaytTriangle::GetRasterRect( const Engine* peng, int& ix0, int& iy0, int& ix1, int& iy1 ) const
+{
+	int iw = peng->GetWidth();
+	int ih = peng->GetHeight();
+
+	const CVector2* uvs[3] = { & mRgmPoly->mpv0->uv, & mRgmPoly->mpv1->uv, & mRgmPoly->mpv2->uv };
+
+	for( int i=0; i<3; i++ )
+	{
+		int ix = int(uvs[i]->GetX()*iw);
+		int iy = int(uvs[i]->GetY()*ih);
+		ix0 = (i==0) ? ix : std::min(ix0,ix);
+		iy0 = (i==0) ? iy : std::min(iy0,iy);
+		ix1 = (i==0) ? ix : std::max(ix1,ix);
+		iy1 = (i==0) ? iy : std::max(iy1,iy);
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void RaytTriangle::Rasterize( Engine* peng, const RayTile& tile ) const
 {
 	int iw = peng->GetWidth();
 	int ih = peng->GetHeight();
@@ -368,7 +405,8 @@ void RaytTriangle::Rasterize( Engine* peng ) const
 	peng->RasterizeTriangle(	*bshader,
 								int(v0.GetX()), int(v0.GetY()), bv0, 
 								int(v1.GetX()), int(v1.GetY()), bv1, 
-								int(v2.GetX()), int(v2.GetY()), bv2);
+								int(v2.GetX()), int(v2.GetY()), bv2,
+								tile );
 
 }
 
@@ -420,7 +458,7 @@ bool RaytSphere::IntersectBox( const AABox& a_Box ) const
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void RaytSphere::Rasterize( Engine* peng ) const
+void RaytSphere::Rasterize( Engine* peng, const RayTile& tile ) const
 {
 }
 
@@ -481,7 +519,7 @@ CVector3 RaytSphere::GetNormal( const CVector3& a_Pos ) const
 
 Scene::Scene()
 	: mExtends()
-	, mpFixedGrid(0)
+	, mpBvh(0)
 {
 }
 
@@ -495,8 +533,8 @@ Scene::~Scene()
 
 void Scene::ExitScene()
 {
-	if( mpFixedGrid ) delete mpFixedGrid;
-	mpFixedGrid = 0;
+	if( mpBvh ) delete mpBvh;
+	mpBvh = 0;
 }
 
 bool Scene::InitScene( const AABox& scene_box )
@@ -513,7 +551,7 @@ bool Scene::InitScene( const AABox& scene_box )
 
 	mExtends = scene_box;
 
-	mpFixedGrid = new FixedGrid;
+	mpBvh = new RaytBvh;
 
 	orkvector<const Primitive*> Prims;
 
@@ -536,7 +574,7 @@ bool Scene::InitScene( const AABox& scene_box )
 	}
 
 
-	mpFixedGrid->BuildGrid( scene_box, Prims );
+	mpBvh->Build( Prims );
 
 	return true;
 }
@@ -726,11 +764,18 @@ RgmModel* LoadRgmFile( const char* pfilename, RgmShaderBuilder& shbuilder )
 ///////////////////////////////////////////////////////////////////////////////
 
 Engine::Engine()
+	: mDest(nullptr)
+	, mFragments(nullptr)
+	, miNumThreads(0)
+	, miTileSize(32)
+	, miTargetSize(kIW)
+	, mfProgressInterval(60.0f)
+	, mbResume(false)
 {
 	mScene = new Scene();
 	//KdTree::SetMemoryManager( new MManager() );
 	mMod = new int[64];
-	mMod = (int*)((((unsigned long)mMod) + 32) & (0xffffffff - 31));
+	mMod = (int*)((uintptr_t(mMod) + 32) & ~uintptr_t(31)); // pointer sized mask (was truncated to 32 bits)
 	mMod[0] = 0, mMod[1] = 1, mMod[2] = 2, mMod[3] = 0, mMod[4] = 1;
 	//m_Stack = new kdstack[64];
 	//m_Stack = (kdstack*)((((unsigned long)m_Stack) + 32) & (0xffffffff - 31));
@@ -763,6 +808,20 @@ static float AreaOfTri( const CVector3& A, const CVector3& B, const CVector3& C
 
 ///////////////////////////////////////////////////////////////////////////////
 
+bool Engine::FindNearest( const Ray3& ray, float& dist, const Primitive*& prim ) const
+{
+	gtlNumRays++;
+	return mScene->GetBvh()->FindNearest( ray, dist, prim );
+}
+
+bool Engine::Occluded( const Ray3& ray, float fmaxdist ) const
+{
+	gtlNumRays++;
+	return mScene->GetBvh()->Occluded( ray, fmaxdist );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 const Primitive* Engine::Raytrace( const Ray3& ray, const int irecdepth, const float irindex, CVector3& acc, float& dist )
 {
 	const Primitive* prim = 0;
@@ -773,7 +832,7 @@ const Primitive* Engine::Raytrace( const Ray3& ray, const int irecdepth, const f
 
 	acc = CVector3(0.1f,0.1f,0.2f);
 	CVector3 P;
-	bool bhit = GetScene()->GetFixedGrid()->FindNearest( ray, dist, P, prim );
+	bool bhit = FindNearest( ray, dist, prim );
 	if (false==bhit) return 0;
 
 /*	const RgmTri& tri = *prim->mRgmPoly;
@@ -833,19 +892,9 @@ const Primitive* Engine::Raytrace( const Ray3& ray, const int irecdepth, const f
 	{
 		const float shadowbias = 0.1f;
 		Ray3 RayToLight( P+LightDir*shadowbias, LightDir );
-		const Primitive* primL = 0;
-
-		float shadowdist = 100000.0f;
-		CVector3 ShadowPos;
-		bool bshadowhit = GetScene()->GetFixedGrid()->FindNearest( RayToLight, shadowdist, ShadowPos, primL );
-
-		if( bshadowhit )
-		{
-			float disttolight = LMP.Mag();
-			if( shadowdist<disttolight )
-			{	acc *= 0.5f;
-				return primL;
-			}
+		if( Occluded( RayToLight, LMP.Mag() ) )
+		{	acc *= 0.5f;
+			return prim;
 		}
 	}*/
 
@@ -898,7 +947,7 @@ void Engine::DrawSpan(	const BakeShader& shader,
 		{
 			output->insert( SpanFragment(X, Y, d) );
 		}
-		else
+		else if( nullptr==ctx.mpClip || ctx.mpClip->Contains(X,Y) )
 		{
 			int ipix = (Y*miW)+X;
 			mFragments[ipix] = d;
@@ -946,9 +995,10 @@ void Engine::DrawSpanE( const BakeShader& shader,
 void Engine::RasterizeTriangle(	const BakeShader& shader,
 								int x1, int y1, const BakeShadowFragment& d1, 
 								int x2, int y2, const BakeShadowFragment& d2, 
-								int x3, int y3, const BakeShadowFragment& d3 )
+								int x3, int y3, const BakeShadowFragment& d3,
+								const RayTile& tile )
   
-{	SpanCtx ctx;
+{	SpanCtx ctx(&tile);
 
 	orkset<SpanFragment> scanned_pnts;
 	// sorted in y val, and in x val if y val the same.
@@ -1067,228 +1117,332 @@ const Primitive* Engine::RenderRay( CVector3 screen_pos, CVector3& acc )
 	return prim;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// tile progress snapshot, <OutputName>.progress :
+//  header, one done flag per tile, then the RayPixel target
 ///////////////////////////////////////////////////////////////////////////////
 
-struct RenderingJobCtx
+struct RayTileProgressHeader
 {
-	Engine*			mpEngine;
-	int				miCore;
-	int				miNumCores;
-	int				miNumRays;
+	u32 mMagic;
+	u32 mKind;
+	u32 mWidth;
+	u32 mHeight;
+	u32 mTileSize;
+	u32 mNumTiles;
 };
 
+static const u32 kRayTileProgressMagic = 0x47505452; // 'RTPG'
+
 ///////////////////////////////////////////////////////////////////////////////
 
-void* RenderingJobThread(void *vptr_args)
+static void WriteTileProgress( const std::string& OutputName, const RayTileProgressHeader& hdr, const u8* pdone, const RayPixel* ppixels )
 {
-	RenderingJobCtx* mpCtx = (RenderingJobCtx*)	vptr_args;
+	size_t inumpix = size_t(hdr.mWidth)*size_t(hdr.mHeight);
 
-	mpCtx->miNumRays = 0;
-	int ih = mpCtx->mpEngine->GetHeight();
-	int iw = mpCtx->mpEngine->GetWidth();
-
-	const CVector3& cTL = mpCtx->mpEngine->CornerTL();
-	const CVector3& cTR = mpCtx->mpEngine->CornerTR();
-	const CVector3& cBL = mpCtx->mpEngine->CornerBL();
-	const CVector3& cBR = mpCtx->mpEngine->CornerBR();
-
-	const CVector3& cQX = (cTR-cTL)*1.0f/float(iw);
-	const CVector3& cQY = (cBL-cTL)*1.0f/float(ih);
+	//////////////////////////////////////
+	// written aside then renamed, so an interrupted write
+	//  never clobbers the previous snapshot
+	//////////////////////////////////////
 
-	const Jitterer my_jitter( kOS, kJITTER, cQX, cQY );
+	std::string progname = OutputName+".progress";
+	std::string tmpname = progname+".tmp";
+	FILE* fout = fopen( tmpname.c_str(), "wb" );
+	if( fout )
+	{
+		bool bok = (1==fwrite( &hdr, sizeof(hdr), 1, fout ));
+		bok = bok && (hdr.mNumTiles==fwrite( pdone, 1, hdr.mNumTiles, fout ));
+		bok = bok && (inumpix==fwrite( ppixels, sizeof(RayPixel), inumpix, fout ));
+		fclose( fout );
+		if( bok )
+			rename( tmpname.c_str(), progname.c_str() );
+		else
+			orkprintf( "failed to write <%s>\n", tmpname.c_str() );
+	}
 
+	//////////////////////////////////////
+	// preview
+	//////////////////////////////////////
 
-	for ( int y = mpCtx->miCore; y < ih; y+=mpCtx->miNumCores )
+	std::string ppmname = OutputName+".ppm";
+	FILE* fppm = fopen( ppmname.c_str(), "wb" );
+	if( fppm )
 	{
-		if( y%64 == mpCtx->miCore ) orkprintf( "core<%d> y<%d>\n", mpCtx->miCore, y );
-		
-		float fy = float(y)/float(ih);
-		CVector3 lSC, rSC;
-		lSC.Lerp( cTL, cBL, fy );
-		rSC.Lerp( cTR, cBR, fy );
-		for ( int x = 0; x < iw; x++ )
-		{	float fx = float(x)/float(iw);
-			CVector3 screen_pos, jittered_pos;
-			screen_pos.Lerp( lSC, rSC, fx );
-			
-			CVector3 acc( 0, 0, 0 );
-			for( int isamp=0; isamp<my_jitter.miNumSamples; isamp++ )
+		fprintf( fppm, "P6\n%d %d\n255\n", int(hdr.mWidth), int(hdr.mHeight) );
+		orkvector<u8> row( hdr.mWidth*3 );
+		for( u32 iy=0; iy<hdr.mHeight; iy++ )
+		{
+			const RayPixel* prow = ppixels+size_t(iy)*hdr.mWidth;
+			for( u32 ix=0; ix<hdr.mWidth; ix++ )
 			{
-				jittered_pos = screen_pos+my_jitter.GetSample(isamp);
-							
-				CVector3 sample( 0, 0, 0 );
-
-				const Primitive* prim = mpCtx->mpEngine->RenderRay( jittered_pos, sample );
-				acc += sample;
-				mpCtx->miNumRays++;
+				row[ix*3+0] = prow[ix].r;
+				row[ix*3+1] = prow[ix].g;
+				row[ix*3+2] = prow[ix].b;
 			}
-
-			acc = acc*(1.0f/float(my_jitter.miNumSamples));
-			int red, green, blue;
-			red = (int)(acc.GetX() * 256);
-			green = (int)(acc.GetY() * 256);
-			blue = (int)(acc.GetZ() * 256);
-			if (red > 255) red = 255;
-			if (green > 255) green = 255;
-			if (blue > 255) blue = 255;
-			if (red < 0) red = 0;
-			if (green < 0) green = 0;
-			if (blue < 0) blue = 0;
-			int ipix = (y*iw)+((iw-1)-x);
-			RayPixel& rp = mpCtx->mpEngine->RefPixel(ipix);
-			rp.r = red;
-			rp.g = green;
-			rp.b = blue;
-
+			fwrite( row.data(), 1, row.size(), fppm );
 		}
+		fclose( fppm );
 	}
-	return 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
+
+static bool ReadTileProgress( const std::string& OutputName, const RayTileProgressHeader& hdr, u8* pdone, RayPixel* ppixels )
+{
+	std::string progname = OutputName+".progress";
+	FILE* fin = fopen( progname.c_str(), "rb" );
+	if( nullptr == fin )
+		return false;
+
+	size_t inumpix = size_t(hdr.mWidth)*size_t(hdr.mHeight);
+
+	RayTileProgressHeader fhdr;
+	bool bok = (1==fread( &fhdr, sizeof(fhdr), 1, fin ));
+	bok = bok && (0==memcmp( &fhdr, &hdr, sizeof(hdr) ));
+	bok = bok && (hdr.mNumTiles==fread( pdone, 1, hdr.mNumTiles, fin ));
+	bok = bok && (inumpix==fread( ppixels, sizeof(RayPixel), inumpix, fin ));
+	fclose( fin );
+
+	if( false == bok )
+		orkprintf( "ignoring progress file <%s> (does not match)\n", progname.c_str() );
+	return bok;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Engine::GetTileGrid( int& itilesize, int& inumtx, int& inumty ) const
+{
+	itilesize = (miTileSize>0) ? miTileSize : 32;
+	inumtx = (miW+itilesize-1)/itilesize;
+	inumty = (miH+itilesize-1)/itilesize;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
+// runs fn once per tile (not already done in a resumed snapshot).
+//  a tile only writes its own pixels and its samples are seeded from the
+//  tile index, so the result does not depend on the thread count.
 ///////////////////////////////////////////////////////////////////////////////
 
-bool Engine::Render( const AABox& bbox, const std::string& OutputName )
-{		
-	RayPixel* pixels = new RayPixel[kIW*kIW];
-	memset( (void*) pixels, 0, sizeof(RayPixel)*kIW*kIW );
+int Engine::RunTiles( const std::string& OutputName, u32 ukind, const tile_fn_t& fn )
+{
+	int itilesize, inumtx, inumty;
+	GetTileGrid( itilesize, inumtx, inumty );
+	const int inumtiles = inumtx*inumty;
+
+	RayTileProgressHeader hdr;
+	hdr.mMagic = kRayTileProgressMagic;
+	hdr.mKind = ukind;
+	hdr.mWidth = u32(miW);
+	hdr.mHeight = u32(miH);
+	hdr.mTileSize = u32(itilesize);
+	hdr.mNumTiles = u32(inumtiles);
 
-	CVector3 dim = (bbox.Max()-bbox.Min());
-	CVector3 ctr = CVector3(0.0f,275.0f,0.0f)+(bbox.Min()+bbox.Max())*0.5f;
-	CVector3 eye = ctr+CVector3(0.0f,30.0f,75.0f);
+	//////////////////////////////////////
+	// resume ?
+	//////////////////////////////////////
 
-	SetTarget( pixels, kIW, kIW );
+	orkvector<u8> resumed( inumtiles, 0 );
+	int inumresumed = 0;
+	if( mbResume )
+	{
+		if( ReadTileProgress( OutputName, hdr, resumed.data(), mDest ) )
+		{
+			for( u8 d : resumed )
+				inumresumed += int(d!=0);
+		}
+		else
+		{
+			std::fill( resumed.begin(), resumed.end(), 0 );
+			memset( (void*) mDest, 0, sizeof(RayPixel)*miW*miH );
+		}
+	}
 
-	GetScene()->InitScene(bbox);
-	InitRender(eye, ctr);
+	std::vector<ork::atomic<int>> tiledone( inumtiles );
+	for( int i=0; i<inumtiles; i++ )
+		tiledone[i].store( int(resumed[i]), MemRelaxed );
 
-	/////////////////////////////////////////////////////////////////
+	int inumthreads = (miNumThreads>0) ? miNumThreads : GetNumCores();
 
-	int inumcores = GetNumCores();
-	orkvector<RenderingJobCtx*>	JobCtxVect;
-#if 0
-	orkvector<pthread_t>		ThreadVect;
-	f64 ftimeA = CSystem::GetRef().GetSystemRelTime(  );
-	for( int ic=0; ic<inumcores; ic++ )
+	orkprintf( "RunTiles <%s> kind<%u> tiles<%d> resumed<%d> threads<%d>\n", OutputName.c_str(), ukind, inumtiles, inumresumed, inumthreads );
+
+	//////////////////////////////////////
+
+	ork::atomic<int> numrays;
+	ork::atomic<s64> numtraced;
+	ork::atomic<int> numdone;
+	ork::atomic<bool> writing;
+	ork::atomic<float> flastwrite;
+	numrays = 0;
+	numtraced = 0;
+	numdone = inumresumed;
+	writing = false;
+	flastwrite = get_sync_time();
+
+	// flags are snapshot before the pixels, tiles finishing
+	//  during the write are simply redone on resume
+	auto write_progress = [&]()
 	{
-		RenderingJobCtx* ctx = new RenderingJobCtx;
-		ctx->mpEngine = this;
-		ctx->miNumCores = inumcores;
-		ctx->miCore = ic;
+		orkvector<u8> snap( inumtiles );
+		for( int i=0; i<inumtiles; i++ )
+			snap[i] = u8(tiledone[i].load(MemAcquire));
+		WriteTileProgress( OutputName, hdr, snap.data(), mDest );
+	};
 
-		pthread_t job_thread;
-		if (pthread_create(&job_thread, NULL, RenderingJobThread, (void*)ctx) != 0)
+	auto run_tiles = [&]( int ibeg, int iend )
+	{
+		for( int it=ibeg; it<iend; it++ )
 		{
-			OrkAssert(false);
+			if( tiledone[it].load(MemRelaxed) )
+				continue;
+
+			RayTile tile;
+			tile.miIndex = it;
+			tile.miX0 = (it%inumtx)*itilesize;
+			tile.miY0 = (it/inumtx)*itilesize;
+			tile.miX1 = std::min( tile.miX0+itilesize, miW );
+			tile.miY1 = std::min( tile.miY0+itilesize, miH );
+
+			s64 itraced = gtlNumRays;
+			numrays += fn( tile );
+			numtraced.fetch_add( gtlNumRays-itraced, MemRelaxed );
+			tiledone[it].store( 1, MemRelease );
+			int idone = ++numdone;
+
+			if( mfProgressInterval<=0.0f )
+				continue;
+			float fnow = get_sync_time();
+			if( (fnow-flastwrite.load()) < mfProgressInterval )
+				continue;
+			bool bexpected = false;
+			if( writing.compare_exchange_strong( bexpected, true ) )
+			{
+				flastwrite = fnow;
+				orkprintf( "RunTiles <%s> %d/%d tiles\n", OutputName.c_str(), idone, inumtiles );
+				write_progress();
+				writing = false;
+			}
 		}
+	};
 
-		ThreadVect.push_back(job_thread);
-		JobCtxVect.push_back(ctx);
-	}
-	for( orkvector<pthread_t>::iterator it=ThreadVect.begin(); it!=ThreadVect.end(); it++ )
 	{
-		pthread_t job = (*it);
-		pthread_join(job, NULL);
+		Opq tileq( inumthreads, "RayTileQ", EOPQMODE_WORKSTEALING );
+		TaskGraph tg;
+		tg.ParallelFor( 0, inumtiles, 1, [&run_tiles](int ib,int ie){ run_tiles(ib,ie); }, "RayTile" );
+		tg.Launch( tileq );
+		tg.Wait();
 	}
-	int inumrays = 0;
-	for( orkvector<RenderingJobCtx*>::iterator it=JobCtxVect.begin(); it!=JobCtxVect.end(); it++ )
-	{
-		RenderingJobCtx* ctx = *it;
-		inumrays += ctx->miNumRays;
-	}
-	f64 ftimeB = CSystem::GetRef().GetSystemRelTime(  );
-	f64 ftime = ftimeB-ftimeA;
-	float frayspersec = float(inumrays)/ftime;
-	orkprintf( "Rays<%d> Time<%f? RaysPerSec<%f>\n", inumrays, ftime,  frayspersec );
+	giNumRays += numtraced.load();
 
-	/////////////////////////////////////////////////////////////////
-	GetScene()->ExitScene();
-#endif
-
-/*	ilInit();
-	ILuint image;
-	ilGenImages(1, &image);
-	ilBindImage(image);
-	if (!ilTexImage(kIW, kIW, 1, 3, IL_RGB, IL_UNSIGNED_BYTE, pixels))
-	{
-		ILenum error = ilGetError();
-		orkprintf("Failed to create image (%04X)\n", error);
-	}
+	if( mfProgressInterval>0.0f )
+		write_progress();
 
-	ilEnable(IL_FILE_OVERWRITE);
-	if (!ilSaveImage(OutputName.c_str()))
-	{
-		ILenum error = ilGetError();
-		orkprintf("Failed to save to %s (%04X)\n", OutputName.c_str(), error);
-	}
-*/
-	return true;
+	return int(numrays);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-struct BakingJobCtx
+bool Engine::Render( const AABox& bbox, const std::string& OutputName )
 {
-	Engine*			mpEngine;
-	int				miCore;
-	int				miNumCores;
-	int				miNumRays;
-};
+	const int iKIW = miTargetSize;
+	RayPixel* pixels = new RayPixel[iKIW*iKIW];
+	memset( (void*) pixels, 0, sizeof(RayPixel)*iKIW*iKIW );
 
-///////////////////////////////////////////////////////////////////////////////
+	CVector3 dim = (bbox.Max()-bbox.Min());
+	CVector3 ctr = CVector3(0.0f,275.0f,0.0f)+(bbox.Min()+bbox.Max())*0.5f;
+	CVector3 eye = ctr+CVector3(0.0f,30.0f,75.0f);
 
-void* BakingJobThread( void* pval )
-{
-	BakingJobCtx* mpCtx = (BakingJobCtx*) pval;
+	SetTarget( pixels, iKIW, iKIW );
 
-	const orkmap<std::string,const RgmGeoSet*>& geosets = mpCtx->mpEngine->GetScene()->GetGeoSets();
-	
-	for( orkmap<std::string,const RgmGeoSet*>::const_iterator it=geosets.begin(); it!=geosets.end(); it++ )
+	GetScene()->InitScene(bbox);
+	InitRender(eye, ctr);
+
+	/////////////////////////////////////////////////////////////////
+
+	const int iw = GetWidth();
+	const int ih = GetHeight();
+	const CVector3 cQX = (mCornerTR-mCornerTL)*(1.0f/float(iw));
+	const CVector3 cQY = (mCornerBL-mCornerTL)*(1.0f/float(ih));
+
+	auto render_tile = [&]( const RayTile& tile ) -> int
 	{
-		const std::string& geoname = it->first;
-		if( geoname.find( "raster_" ) != std::string::npos )
+		int inumrays = 0;
+
+		for ( int y = tile.miY0; y < tile.miY1; y++ )
 		{
-			const RgmGeoSet* RasterSet = it->second;
+			float fy = float(y)/float(ih);
+			CVector3 lSC, rSC;
+			lSC.Lerp( mCornerTL, mCornerBL, fy );
+			rSC.Lerp( mCornerTR, mCornerBR, fy );
+			for ( int x = tile.miX0; x < tile.miX1; x++ )
+			{	float fx = float(x)/float(iw);
+				// seeded by pixel, so neither tiles nor the tile size show in the pattern
+				const Jitterer my_jitter( kOS, kJITTER, cQX, cQY, (u32(y)*u32(iw)+u32(x)+1u)*2654435761u );
+				CVector3 screen_pos, jittered_pos;
+				screen_pos.Lerp( lSC, rSC, fx );
+
+				CVector3 acc( 0, 0, 0 );
+				for( int isamp=0; isamp<my_jitter.miNumSamples; isamp++ )
+				{
+					jittered_pos = screen_pos+my_jitter.GetSample(isamp);
+					CVector3 sample( 0, 0, 0 );
+					RenderRay( jittered_pos, sample );
+					acc += sample;
+					inumrays++;
+				}
 
-			int inumtri = RasterSet->NumPrimitives();
-			int iw = mpCtx->mpEngine->GetWidth();
-			int ih = mpCtx->mpEngine->GetHeight();
-			int itrictr = inumtri/mpCtx->miNumCores;
+				acc = acc*(1.0f/float(my_jitter.miNumSamples));
+				int red = (int)(acc.GetX() * 256);
+				int green = (int)(acc.GetY() * 256);
+				int blue = (int)(acc.GetZ() * 256);
+				if (red > 255) red = 255;
+				if (green > 255) green = 255;
+				if (blue > 255) blue = 255;
+				if (red < 0) red = 0;
+				if (green < 0) green = 0;
+				if (blue < 0) blue = 0;
+				int ipix = (y*iw)+((iw-1)-x);
+				RayPixel& rp = RefPixel(ipix);
+				rp.r = red;
+				rp.g = green;
+				rp.b = blue;
+				rp.a = 255;
+			}
+		}
+		return inumrays;
+	};
 
-			int icntdwn = (inumtri>>8); // 
+	f64 ftimeA = get_sync_time();
+	int inumrays = RunTiles( OutputName, 0, render_tile );
+	f64 ftime = get_sync_time()-ftimeA;
+	float frayspersec = float(inumrays)/ftime;
+	orkprintf( "Rays<%d> Time<%f> RaysPerSec<%f>\n", inumrays, ftime,  frayspersec );
 
-			if( 0 == icntdwn ) icntdwn = 1;
+	/////////////////////////////////////////////////////////////////
+	GetScene()->ExitScene();
 
-			for( int ip=mpCtx->miCore; ip<inumtri; ip+=mpCtx->miNumCores )
-			{
-				if( itrictr%icntdwn == 0 ) orkprintf( "core<%d> numleft<%d> geoname<%s>\n", mpCtx->miCore, itrictr, geoname.c_str() );
-				itrictr--;
-				const Primitive* prim = RasterSet->GetPrimitive(ip);
-				prim->Rasterize( mpCtx->mpEngine );
-			}		
-		}
-	}
-	return 0;
+	return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
 bool Engine::Bake( const AABox& bbox, const std::string& OutputName )
-{		
+{
 	int iKKos = kOS;
 
 	int idim = (iKKos*2)+1;
 	int iNumSamples = idim*idim;
 
 	int idiv = (kOS==0) ? 1 : kOS;
-	int iKIW = idim*kIW;
-
+	int iKIW = idim*miTargetSize;
 
 	RayPixel* pixels = new RayPixel[iKIW*iKIW];
 	memset( (void*) pixels, 0, sizeof(RayPixel)*iKIW*iKIW );
 	mFragments = new BakeShadowFragment[iKIW*iKIW];
-	memset( (void*) mFragments, 0, sizeof(BakeShadowFragment)*kIW*kIW );
+	memset( (void*) mFragments, 0, sizeof(BakeShadowFragment)*iKIW*iKIW );
 
 	CVector3 dim = (bbox.Max()-bbox.Min());
 	CVector3 ctr = (bbox.Min()+bbox.Max())*0.5f;
@@ -1302,46 +1456,59 @@ bool Engine::Bake( const AABox& bbox, const std::string& OutputName )
 	InitRender(eye, ctr);
 
 	/////////////////////////////////////////////////////////////////
+	// bin raster triangles into uv tiles, keeping the serial
+	//  (geoset,primitive) order within each tile so overlapping
+	//  uv shells resolve exactly like a single threaded bake
 	/////////////////////////////////////////////////////////////////
-	/////////////////////////////////////////////////////////////////
-	//f64 ftimeA = CSystem::GetRef().GetSystemRelTime(  );
-	{
-		int inumcores = GetNumCores();
-		orkvector<BakingJobCtx*>	JobCtxVect;
-#if 0
-		orkvector<pthread_t>	ThreadVect;
-		for( int ic=0; ic<inumcores; ic++ )
-		{
-			BakingJobCtx* ctx = new BakingJobCtx;
-			ctx->mpEngine = this;
-			ctx->miNumCores = inumcores;
-			ctx->miCore = ic;
 
-			pthread_t job_thread;
-			if (pthread_create(&job_thread, NULL, BakingJobThread, (void*)ctx) != 0)
-			{
-				OrkAssert(false);
-			}
+	int itilesize, inumtx, inumty;
+	GetTileGrid( itilesize, inumtx, inumty );
+	orkvector<orkvector<const Primitive*>> tilebins( inumtx*inumty );
 
-			ThreadVect.push_back(job_thread);
+	const orkmap<std::string,const RgmGeoSet*>& geosets = GetScene()->GetGeoSets();
+	for( orkmap<std::string,const RgmGeoSet*>::const_iterator it=geosets.begin(); it!=geosets.end(); it++ )
+	{
+		const std::string& geoname = it->first;
+		if( geoname.find( "raster_" ) == std::string::npos )
+			continue;
 
-			JobCtxVect.push_back(ctx);
-		}
-		for( orkvector<pthread_t>::iterator it=ThreadVect.begin(); it!=ThreadVect.end(); it++ )
+		const RgmGeoSet* RasterSet = it->second;
+		int inumtri = RasterSet->NumPrimitives();
+		for( int ip=0; ip<inumtri; ip++ )
 		{
-			pthread_t job = (*it);
-			pthread_join(job, NULL);
+			const Primitive* prim = RasterSet->GetPrimitive(ip);
+			int ix0 = 0, iy0 = 0, ix1 = miW-1, iy1 = miH-1;
+			if( prim->GetRasterRect( this, ix0, iy0, ix1, iy1 ) )
+			{
+				ix0 = std::max(ix0,0);
+				iy0 = std::max(iy0,0);
+				ix1 = std::min(ix1,miW-1);
+				iy1 = std::min(iy1,miH-1);
+				if( ix0>ix1 || iy0>iy1 )
+					continue;
+			}
+			for( int ity=iy0/itilesize; ity<=iy1/itilesize; ity++ )
+				for( int itx=ix0/itilesize; itx<=ix1/itilesize; itx++ )
+					tilebins[ity*inumtx+itx].push_back(prim);
 		}
-		int inumrays = 0;
-		//for( orkvector<BakingJobCtx*>::iterator it=JobCtxVect.begin(); it!=JobCtxVect.end(); it++ )
-		//{
-		//	RenderingJobCtx* ctx = *it;
-		//	inumrays += ctx->miNumRays;
-		//}		
-		#endif
 	}
-	//f64 ftimeB = CSystem::GetRef().GetSystemRelTime(  );
-	f64 ftime = 1.0; //ftimeB-ftimeA;
+
+	auto bake_tile = [&]( const RayTile& tile ) -> int
+	{
+		for( const Primitive* prim : tilebins[tile.miIndex] )
+			prim->Rasterize( this, tile );
+		return 0;
+	};
+
+	/////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////
+
+	int inumthreads = (miNumThreads>0) ? miNumThreads : GetNumCores();
+
+	f64 ftimeA = get_sync_time();
+	RunTiles( OutputName, 1, bake_tile );
+	f64 ftime = get_sync_time()-ftimeA;
 	int inrays = int(giNumRays);
 
 	float frayspersec = float(inrays)/ftime;
@@ -1352,11 +1519,14 @@ bool Engine::Bake( const AABox& bbox, const std::string& OutputName )
 	/////////////////////////////////////////////////////////////////
 	GetScene()->ExitScene();
 	/////////////////////////////////////////////////////////////////
-	/////////////////////////////////////////////////////////////////
+	// grow uv shells, only unwritten pixels (a==0) change and only
+	//  written ones (a!=0) are read, so rows are independent
 	/////////////////////////////////////////////////////////////////
 	orkprintf( "growing uv shells...\n" );
 	static const int kgrowamt = 7;
-	for( int iy=0; iy<iKIW; iy++ )
+	auto grow_rows = [&]( int iybeg, int iyend )
+	{
+	for( int iy=iybeg; iy<iyend; iy++ )
 	{	for( int ix=0; ix<iKIW; ix++ )
 		{	int ipix = (iy*iKIW)+ix;
 			RayPixel& pixel = pixels[ipix];
@@ -1376,7 +1546,7 @@ bool Engine::Bake( const AABox& bbox, const std::string& OutputName )
 						if( ox==0 && oy==0 ) continue;
 						if( inx<0 ) continue;
 						if( inx>=iKIW ) continue;
-						int ipix2 = (iny*kIW)+inx;
+						int ipix2 = (iny*iKIW)+inx;
 						const RayPixel& opix = pixels[ipix2];
 						if( opix.a != 0 )
 						{	faccr += float(opix.r);
@@ -1392,15 +1562,33 @@ bool Engine::Bake( const AABox& bbox, const std::string& OutputName )
 					pixel.b = u8(faccb/fnums);
 				}
 			}
-		}	
+		}
+	}
+	};
+	{
+		Opq growq( inumthreads, "RayGrowQ", EOPQMODE_WORKSTEALING );
+		parallel_for( growq, 0, iKIW, 16, grow_rows );
 	}
 	/////////////////////////////////////////////////////////////////
 	/////////////////////////////////////////////////////////////////
 	/////////////////////////////////////////////////////////////////
 
+	if( mfProgressInterval>0.0f )
+	{
+		RayTileProgressHeader hdr;
+		hdr.mMagic = kRayTileProgressMagic;
+		hdr.mKind = 1;
+		hdr.mWidth = u32(miW);
+		hdr.mHeight = u32(miH);
+		hdr.mTileSize = u32(itilesize);
+		hdr.mNumTiles = u32(inumtx*inumty);
+		orkvector<u8> alldone( hdr.mNumTiles, 1 );
+		WriteTileProgress( OutputName, hdr, alldone.data(), pixels );
+	}
+
 /*	boost::gil::rgb8_image_t img(iKIW,iKIW);
 	boost::gil::rgb8_view_t myview = boost::gil::view(img);
- 
+
 	for( int iy=0; iy<iKIW; iy++ )
 	{
 		for( int ix=0; ix<iKIW; ix++ )
@@ -1417,10 +1605,10 @@ bool Engine::Bake( const AABox& bbox, const std::string& OutputName )
 	orkprintf( "saving image...\n" );
 
 	//boost::gil::png_write_view(OutputName.c_str(), boost::gil::view(img));
-	
+
 	delete[] pixels;
 	delete[] mFragments;
-	delete GetScene()->GetFixedGrid();
+	GetScene()->ExitScene();
 	*/
 
 	return true;
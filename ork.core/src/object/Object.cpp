@@ -18,6 +18,7 @@
 #include <ork/rtti/downcast.h>
 
 #include <ork/stream/FileInputStream.h>
+#include <ork/file/mappedfile.h>
 #include <ork/stream/StringInputStream.h>
 #include <ork/reflect/serialize/XMLDeserializer.h>
 #include <ork/reflect/serialize/XMLSerializer.h>
@@ -175,8 +176,7 @@ Object *Object::Clone() const
 
 		GetClass()->Description().SerializeProperties(oser, this);
 
-		ork::stream::StringInputStream istream(str);
-		ork::reflect::serialize::BinaryDeserializer biniser(istream);
+		ork::reflect::serialize::BinaryDeserializer biniser(str.data(), str.length());
 		ork::reflect::serialize::ShallowDeserializer iser(biniser);
 
 		GetClass()->Description().DeserializeProperties(iser, clone);
@@ -250,17 +250,25 @@ reflect::BidirectionalSerializer &operator ||(reflect::BidirectionalSerializer &
 static Object *LoadObjectFromFile(ConstString filename, bool binary)
 {
 	float ftime1 = ork::CSystem::GetRef().GetLoResRelTime();
-	stream::FileInputStream stream(filename.c_str());
 
 	Object *object = NULL;
-	if(binary)
+	file::MappedFile mapped;
+	if(binary && mapped.Open(file::Path(filename.c_str())))
 	{
+		reflect::serialize::BinaryDeserializer deserializer(mapped.GetData(), mapped.GetSize());
+
+		DeserializeUnknownObject(deserializer, object);
+	}
+	else if(binary)
+	{
+		stream::FileInputStream stream(filename.c_str());
 		reflect::serialize::BinaryDeserializer deserializer(stream);
 
 		DeserializeUnknownObject(deserializer, object);
 	}
 	else
 	{
+		stream::FileInputStream stream(filename.c_str());
 		reflect::serialize::XMLDeserializer deserializer(stream);
 
 		DeserializeUnknownObject(deserializer, object);
@@ -20,6 +20,25 @@ bool IObjectArrayProperty::Deserialize(IDeserializer &deserializer, Object *obj)
 	bool result = true;
 	int deser_count;
 
+	if(size_t itemsize = PodItemSize())
+	{
+		size_t count = 0;
+		if(deserializer.BeginPodArray(itemsize, count))
+		{
+			if(false == Resize(obj, count))
+			{
+				// still consume the items, so the archive stays in sync
+				orkvector<unsigned char> discard(count * itemsize);
+				if(count)
+					deserializer.DeserializeData(discard.data(), discard.size());
+				return false;
+			}
+			if(0 == count)
+				return true;
+			return deserializer.DeserializeData(static_cast<unsigned char *>(PodItems(obj)), count * itemsize);
+		}
+	}
+
 	Command command;
 
 	if(deserializer.BeginCommand(command))
@@ -69,6 +88,12 @@ bool IObjectArrayProperty::Serialize(ISerializer &serializer, const Object *obj)
 	bool result = true;
 	size_t count = Count(obj);
 
+	if(size_t itemsize = PodItemSize())
+	{
+		if(serializer.SerializePodArray(count ? PodItems(obj) : NULL, itemsize, count))
+			return true;
+	}
+
 	Command command(Command::EATTRIBUTE, "size");
 
 	if(false == serializer.BeginCommand(command))
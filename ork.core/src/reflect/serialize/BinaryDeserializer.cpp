@@ -18,17 +18,111 @@
 namespace ork { namespace reflect { namespace serialize {
 
 BinaryDeserializer::BinaryDeserializer(stream::IInputStream &stream)
-    : mStream(stream)
+    : mStream(&stream)
+	, mCursor(NULL)
+	, mEnd(NULL)
+	, mStringBlock(NULL)
+	, mStringBlockUsed(kstringblocksize)
+    , mCurrentCommand(NULL)
+{
+}
+
+BinaryDeserializer::BinaryDeserializer(const void *data, size_t size)
+    : mStream(NULL)
+	, mCursor(static_cast<const unsigned char *>(data))
+	, mEnd(static_cast<const unsigned char *>(data) + size)
+	, mStringBlock(NULL)
+	, mStringBlockUsed(kstringblocksize)
     , mCurrentCommand(NULL)
 {
 }
 
 BinaryDeserializer::~BinaryDeserializer()
 {
-	for(int i = 0; i < mStringPool.Size(); i++)
-		delete mStringPool.FromIndex(i).c_str();
+	for(orkvector<char *>::size_type i = 0; i < mStringBlocks.size(); i++)
+		delete[] mStringBlocks[i];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// string arena, strings larger than a block get a block of their own
+///////////////////////////////////////////////////////////////////////////////
+
+char *BinaryDeserializer::AllocString(size_t len)
+{
+	if(len > kstringblocksize / 4)
+	{
+		mStringBlocks.push_back(new char[len]);
+		return mStringBlocks.back();
+	}
+
+	if(mStringBlockUsed + len > kstringblocksize)
+	{
+		mStringBlock = new char[kstringblocksize];
+		mStringBlocks.push_back(mStringBlock);
+		mStringBlockUsed = 0;
+	}
+
+	char *rval = mStringBlock + mStringBlockUsed;
+	mStringBlockUsed += len;
+	return rval;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool BinaryDeserializer::Refill()
+{
+	if(NULL == mStream)
+		return false;
+
+	mReadAhead.resize(kreadahead);
+	size_t amount = mStream->Read(mReadAhead.data(), kreadahead);
+	if(amount == stream::IInputStream::kEOF)
+		amount = 0;
+
+	mCursor = mReadAhead.data();
+	mEnd = mCursor + amount;
+	return amount > 0;
 }
 
+bool BinaryDeserializer::ReadBytes(unsigned char *dst, size_t size)
+{
+	for(;;)
+	{
+		size_t avail = size_t(mEnd - mCursor);
+		size_t amount = (size < avail) ? size : avail;
+		if(amount)
+		{
+			memcpy(dst, mCursor, amount);
+			mCursor += amount;
+			dst += amount;
+			size -= amount;
+		}
+
+		if(0 == size)
+			return true;
+
+		if(NULL == mStream)
+			return false;
+
+		// large blocks bypass the read ahead buffer
+		while(size >= kreadahead)
+		{
+			size_t got = mStream->Read(dst, size);
+			if(got == stream::IInputStream::kEOF || got == 0)
+				return false;
+			dst += got;
+			size -= got;
+		}
+		if(0 == size)
+			return true;
+
+		if(false == Refill())
+			return false;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 template<>
 bool BinaryDeserializer::Read<ConstString>(ConstString &text)
 {
@@ -40,8 +134,8 @@ bool BinaryDeserializer::Read<ConstString>(ConstString &text)
 	{
 		int len = -(len_or_backref + 1);
 		
-		char *data = new char[len + 1];
-		mStream.Read(reinterpret_cast<unsigned char *>(data), size_t(len));
+		char *data = AllocString(size_t(len) + 1);
+		ReadBytes(reinterpret_cast<unsigned char *>(data), size_t(len));
 		data[len] = '\0';
 
 		text = data;
@@ -51,7 +145,7 @@ bool BinaryDeserializer::Read<ConstString>(ConstString &text)
 	}
 	else
 	{
-		text = mStringPool.FromIndex(len_or_backref).c_str();
+		text = mStringPool.FromIndex(len_or_backref);
 		return true;
 	}
 }
@@ -59,7 +153,13 @@ bool BinaryDeserializer::Read<ConstString>(ConstString &text)
 template<typename T>
 bool BinaryDeserializer::Read(T &value)
 {
-	return mStream.Read(reinterpret_cast<unsigned char *>(&value), sizeof(T)) == sizeof(T);
+	if(size_t(mEnd - mCursor) >= sizeof(T))
+	{
+		memcpy(&value, mCursor, sizeof(T));
+		mCursor += sizeof(T);
+		return true;
+	}
+	return ReadBytes(reinterpret_cast<unsigned char *>(&value), sizeof(T));
 }
 
 template bool BinaryDeserializer::Read<char>(char &);
@@ -134,15 +234,10 @@ int BinaryDeserializer::FindObject(rtti::ICastable *object)
 
 char BinaryDeserializer::Peek()
 {
-	char c;
-	if(mStream.Peek(reinterpret_cast<unsigned char *>(&c), 1) == 1)
-	{
-		return c;
-	}
-	else
-	{
+	if(mCursor == mEnd && false == Refill())
 		return 0;
-	}
+
+	return char(*mCursor);
 }
 
 bool BinaryDeserializer::Match(char c)
@@ -220,7 +315,32 @@ bool BinaryDeserializer::Deserialize(ResizableString &text)
 
 bool BinaryDeserializer::DeserializeData(unsigned char *data, size_t size)
 {
-	return mStream.Read(data, size) == int(size);
+	return ReadBytes(data, size);
+}
+
+bool BinaryDeserializer::BeginPodArray(size_t itemsize, size_t &count)
+{
+	if(false == Match('D'))
+		return false;
+
+	int archived_itemsize = 0;
+	int archived_count = 0;
+	Read(archived_itemsize);
+	Read(archived_count);
+
+	count = size_t(archived_count);
+
+	if(size_t(archived_itemsize) != itemsize)
+	{
+		orkprintf("BinaryDeserializer:: pod array item size mismatch (archive<%d> expected<%d>), skipping\n",
+			archived_itemsize, int(itemsize));
+		orkvector<unsigned char> discard(size_t(archived_itemsize) * count);
+		if(count)
+			ReadBytes(discard.data(), discard.size());
+		count = 0;
+	}
+
+	return true;
 }
 
 bool BinaryDeserializer::BeginCommand(Command &command)
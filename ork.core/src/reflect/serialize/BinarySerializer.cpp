@@ -24,7 +24,7 @@ BinarySerializer::BinarySerializer(stream::IOutputStream &stream)
 BinarySerializer::~BinarySerializer()
 {
 	for(int i = 0; i < mStringPool.Size(); i++)
-		delete mStringPool.FromIndex(i).c_str();
+		delete[] mStringPool.FromIndex(i);
 }
 
 bool BinarySerializer::WriteHeader(char type, PieceString text)
@@ -246,4 +246,15 @@ bool BinarySerializer::SerializeData(unsigned char *data, size_t size)
 	return result;
 }
 
+// 'D' itemsize count items..., read back by BinaryDeserializer::BeginPodArray
+bool BinarySerializer::SerializePodArray(const void *items, size_t itemsize, size_t count)
+{
+	bool result = Write('D');
+	result = Write(int(itemsize)) && result;
+	result = Write(int(count)) && result;
+	if(count)
+		result = mStream.Write(static_cast<const unsigned char *>(items), itemsize * count) && result;
+	return result;
+}
+
 } } }
@@ -0,0 +1,271 @@
+#include <ork/pch.h>
+
+#include <unittest++/UnitTest++.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <ork/asset/Asset.h>
+#include <ork/asset/AssetManager.h>
+#include <ork/asset/AssetManager.hpp>
+#include <ork/asset/DynamicAssetLoader.h>
+#include <ork/kernel/timer.h>
+#include <ork/kernel/string/PieceString.h>
+
+///////////////////////////////////////////////////////////////////////////////
+namespace ork { namespace test {
+///////////////////////////////////////////////////////////////////////////////
+
+// "strm://" assets, io and decode are simulated with sleeps
+
+class StreamTestAsset : public ork::asset::Asset
+{
+	RttiDeclareConcrete( StreamTestAsset, ork::asset::Asset );
+
+public:
+	StreamTestAsset() { mNumLoads.store(0); }
+	ork::atomic<int> mNumLoads;
+};
+
+typedef asset::AssetManager<StreamTestAsset> StreamTestManager;
+
+struct StreamTestState
+{
+	StreamTestState()
+	{
+		mIoSleepUsec.store(0);
+		mDecodeSleepUsec.store(0);
+		mNumGated.store(0);
+		mGateOpen.store(1);
+	}
+
+	ork::atomic<int> mIoSleepUsec;
+	ork::atomic<int> mDecodeSleepUsec;
+	ork::atomic<int> mNumGated;		// io threads parked in a "strm://gate" prefetch
+	ork::atomic<int> mGateOpen;
+
+	std::mutex mOrderMutex;
+	orkvector<std::string> mPrefetchOrder;
+};
+
+static StreamTestState gstreamtest;
+
+void StreamTestAsset::Describe()
+{
+	auto loader = new asset::DynamicAssetLoader;
+
+	loader->mCheckFn = []( const PieceString& name )
+	{
+		return 0 == strncmp( name.data(), "strm://", 7 );
+	};
+	loader->mPrefetchFn = []( asset::Asset* passet )
+	{
+		const char* pname = passet->GetName().c_str();
+		if( 0 == strncmp( pname, "strm://gate", 11 ) )
+		{
+			gstreamtest.mNumGated.fetch_add(1);
+			while( 0 == gstreamtest.mGateOpen.load() )
+				usleep(100);
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(gstreamtest.mOrderMutex);
+			gstreamtest.mPrefetchOrder.push_back(pname);
+		}
+		usleep( gstreamtest.mIoSleepUsec.load() );
+	};
+	loader->mLoadFn = []( asset::Asset* passet ) -> bool
+	{
+		// the outer asset needs the inner one to decode
+		if( 0 == strcmp( passet->GetName().c_str(), "strm://nest_outer" ) )
+		{
+			asset::AssetLoadHandle hinner = StreamTestManager::LoadAsync( "strm://nest_inner" );
+			if( false == hinner.Wait() )
+				return false;
+		}
+		usleep( gstreamtest.mDecodeSleepUsec.load() );
+		rtti::safe_downcast<StreamTestAsset*>(passet)->mNumLoads.fetch_add(1);
+		return true;
+	};
+	GetClassStatic()->AddLoader( loader );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+} } // namespace ork::test
+///////////////////////////////////////////////////////////////////////////////
+
+INSTANTIATE_TRANSPARENT_RTTI(ork::test::StreamTestAsset,"test/StreamTestAsset");
+
+using namespace ork;
+using namespace ork::test;
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(AssetStreamCoalesce)
+{
+	gstreamtest.mIoSleepUsec.store(2000);
+	gstreamtest.mDecodeSleepUsec.store(2000);
+
+	asset::AssetLoadHandle h0 = StreamTestManager::LoadAsync( "strm://coalesce", asset::EASSETPRI_LOW );
+	asset::AssetLoadHandle h1 = StreamTestManager::LoadAsync( "strm://coalesce", asset::EASSETPRI_HIGH );
+	asset::AssetLoadHandle h2 = StreamTestManager::LoadAsync( "strm://coalesce" );
+
+	CHECK( h0.IsValid() );
+	CHECK( h0.GetAsset()==h1.GetAsset() && h1.GetAsset()==h2.GetAsset() );
+
+	// a synchronous load of a streaming asset waits for the stream
+	StreamTestAsset* passet = StreamTestManager::Load( "strm://coalesce" );
+	CHECK( passet==h0.GetAsset<StreamTestAsset>() );
+	CHECK( passet->IsLoaded() );
+	CHECK( h0.Wait() && h1.IsDone() && h2.IsDone() );
+	CHECK_EQUAL( 1, passet->mNumLoads.load() );
+
+	// loaded assets complete immediately
+	asset::AssetLoadHandle h3 = StreamTestManager::LoadAsync( "strm://coalesce" );
+	CHECK( h3.IsDone() && h3.Wait() );
+	CHECK_EQUAL( 1, passet->mNumLoads.load() );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(AssetStreamPriority)
+{
+	gstreamtest.mIoSleepUsec.store(0);
+	gstreamtest.mDecodeSleepUsec.store(0);
+	gstreamtest.mPrefetchOrder.clear();
+
+	// park every io thread so the rest queues up
+	gstreamtest.mGateOpen.store(0);
+	gstreamtest.mNumGated.store(0);
+	int inumio = asset::AssetStreamer::GetRef().GetNumIoThreads();
+	orkvector<asset::AssetLoadHandle> gates;
+	for( int i=0; i<inumio; i++ )
+	{
+		char name[64];
+		snprintf( name, sizeof(name), "strm://gate%d", i );
+		gates.push_back( StreamTestManager::LoadAsync( name, asset::EASSETPRI_CRITICAL ) );
+	}
+	while( gstreamtest.mNumGated.load() != inumio )
+		usleep(100);
+
+	asset::AssetLoadHandle hlow = StreamTestManager::LoadAsync( "strm://prio_low", asset::EASSETPRI_LOW );
+	asset::AssetLoadHandle hnorm = StreamTestManager::LoadAsync( "strm://prio_normal", asset::EASSETPRI_NORMAL );
+	asset::AssetLoadHandle hhigh = StreamTestManager::LoadAsync( "strm://prio_high", asset::EASSETPRI_HIGH );
+	asset::AssetLoadHandle hraised = StreamTestManager::LoadAsync( "strm://prio_raised", asset::EASSETPRI_LOW );
+	hraised.Raise( asset::EASSETPRI_CRITICAL );
+
+	gstreamtest.mGateOpen.store(1);
+	asset::AssetStreamer::GetRef().WaitAll();
+
+	CHECK( hlow.IsDone() && hnorm.IsDone() && hhigh.IsDone() && hraised.IsDone() );
+	CHECK_EQUAL( 4, int(gstreamtest.mPrefetchOrder.size()) );
+	if( gstreamtest.mPrefetchOrder.size() == 4 )
+	{
+		// io threads pop in priority order, with more than one io thread
+		//  neighbours may record out of order
+		const auto& order = gstreamtest.mPrefetchOrder;
+		auto index_of = [&]( const char* pname ) -> int
+		{
+			for( int i=0; i<int(order.size()); i++ )
+				if( order[i]==pname )
+					return i;
+			return -1;
+		};
+		int islack = (inumio>1) ? 1 : 0;
+		CHECK( index_of("strm://prio_raised") <= 0+islack );
+		CHECK( index_of("strm://prio_high") <= 1+islack );
+		CHECK( index_of("strm://prio_low") >= 3-islack );
+	}
+	for( auto& h : gates )
+		CHECK( h.Wait() );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// with every io thread parked, a waiter reads and decodes the request itself,
+//  including a request waited on from inside another asset's decode
+
+TEST(AssetStreamWaitInline)
+{
+	gstreamtest.mIoSleepUsec.store(0);
+	gstreamtest.mDecodeSleepUsec.store(0);
+
+	gstreamtest.mGateOpen.store(0);
+	gstreamtest.mNumGated.store(0);
+	int inumio = asset::AssetStreamer::GetRef().GetNumIoThreads();
+	orkvector<asset::AssetLoadHandle> gates;
+	for( int i=0; i<inumio; i++ )
+	{
+		char name[64];
+		snprintf( name, sizeof(name), "strm://gate_inline%d", i );
+		gates.push_back( StreamTestManager::LoadAsync( name, asset::EASSETPRI_CRITICAL ) );
+	}
+	while( gstreamtest.mNumGated.load() != inumio )
+		usleep(100);
+
+	asset::AssetLoadHandle hinner = StreamTestManager::LoadAsync( "strm://nest_inner", asset::EASSETPRI_LOW );
+	asset::AssetLoadHandle houter = StreamTestManager::LoadAsync( "strm://nest_outer", asset::EASSETPRI_LOW );
+
+	CHECK( houter.Wait() );
+	CHECK( hinner.IsDone() );
+	CHECK( houter.GetAsset()->IsLoaded() && hinner.GetAsset()->IsLoaded() );
+	CHECK_EQUAL( 1, houter.GetAsset<StreamTestAsset>()->mNumLoads.load() );
+	CHECK_EQUAL( 1, hinner.GetAsset<StreamTestAsset>()->mNumLoads.load() );
+
+	// the io threads drop the stale queue entries
+	gstreamtest.mGateOpen.store(1);
+	asset::AssetStreamer::GetRef().WaitAll();
+	CHECK_EQUAL( 1, houter.GetAsset<StreamTestAsset>()->mNumLoads.load() );
+	CHECK_EQUAL( 1, hinner.GetAsset<StreamTestAsset>()->mNumLoads.load() );
+	for( auto& h : gates )
+		CHECK( h.Wait() );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// the update thread only pays for the requests, not for the loads
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(AssetStreamBench)
+{
+	const int knumassets = 32;
+	gstreamtest.mIoSleepUsec.store(3000);
+	gstreamtest.mDecodeSleepUsec.store(3000);
+
+	char name[64];
+
+	// serial, on the calling thread
+	for( int i=0; i<knumassets; i++ )
+	{
+		snprintf( name, sizeof(name), "strm://bench_sync%d", i );
+		StreamTestManager::Create( name );
+	}
+	float ft0 = get_sync_time();
+	StreamTestManager::AutoLoad();
+	float ft1 = get_sync_time();
+
+	// streamed
+	for( int i=0; i<knumassets; i++ )
+	{
+		snprintf( name, sizeof(name), "strm://bench_async%d", i );
+		StreamTestManager::Create( name );
+	}
+	float ft2 = get_sync_time();
+	int inumrequested = StreamTestManager::AutoLoadAsync();
+	float ft3 = get_sync_time();
+	asset::AssetStreamer::GetRef().WaitAll();
+	float ft4 = get_sync_time();
+
+	bool ballloaded = true;
+	for( int i=0; i<knumassets; i++ )
+	{
+		snprintf( name, sizeof(name), "strm://bench_async%d", i );
+		StreamTestAsset* passet = StreamTestManager::Find( name );
+		ballloaded &= passet && passet->IsLoaded() && passet->mNumLoads.load()==1;
+	}
+
+	printf( "AssetStreamBench %d assets : AutoLoad<%f ms> AutoLoadAsync call<%f ms> streamed<%f ms>\n",
+			knumassets, (ft1-ft0)*1000.0f, (ft3-ft2)*1000.0f, (ft4-ft2)*1000.0f );
+
+	CHECK_EQUAL( knumassets, inumrequested );
+	CHECK( ballloaded );
+	CHECK( (ft3-ft2) < (ft1-ft0) );
+}
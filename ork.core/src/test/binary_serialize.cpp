@@ -0,0 +1,221 @@
+#include <ork/pch.h>
+
+#include <unittest++/UnitTest++.h>
+#include <stdio.h>
+
+#include <ork/kernel/timer.h>
+#include <ork/object/Object.h>
+#include <ork/reflect/RegisterProperty.h>
+#include <ork/reflect/DirectObjectVectorPropertyType.hpp>
+#include <ork/reflect/DirectObjectArrayPropertyType.hpp>
+#include <ork/reflect/serialize/BinarySerializer.h>
+#include <ork/reflect/serialize/BinaryDeserializer.h>
+#include <ork/reflect/serialize/LayerSerializer.h>
+#include <ork/stream/ResizableStringOutputStream.h>
+#include <ork/stream/StringInputStream.h>
+#include <ork/file/mappedfile.h>
+
+///////////////////////////////////////////////////////////////////////////////
+namespace ork { namespace test {
+///////////////////////////////////////////////////////////////////////////////
+
+class BinSerTestObject : public ork::Object
+{
+	RttiDeclareConcrete( BinSerTestObject, ork::Object );
+
+public:
+
+	BinSerTestObject() : mScalar(0.0f) { memset( mFixed, 0, sizeof(mFixed) ); }
+
+	orkvector<float>	mFloats;
+	orkvector<int>		mInts;
+	orkvector<bool>		mBools;
+	int					mFixed[16];
+	float				mScalar;
+
+	void Fill( int inumfloats )
+	{
+		mFloats.resize(inumfloats);
+		for( int i=0; i<inumfloats; i++ )
+			mFloats[i] = float(i)*0.25f;
+		mInts.resize(77);
+		for( int i=0; i<77; i++ )
+			mInts[i] = i*i-1000;
+		mBools.resize(5);
+		for( int i=0; i<5; i++ )
+			mBools[i] = (i&1);
+		for( int i=0; i<16; i++ )
+			mFixed[i] = 16-i;
+		mScalar = 3.5f;
+	}
+
+	bool Equals( const BinSerTestObject& oth ) const
+	{
+		return	mFloats == oth.mFloats
+			&&	mInts == oth.mInts
+			&&	mBools == oth.mBools
+			&&	0 == memcmp( mFixed, oth.mFixed, sizeof(mFixed) )
+			&&	mScalar == oth.mScalar;
+	}
+};
+
+void BinSerTestObject::Describe()
+{
+	ork::reflect::RegisterArrayProperty( "Floats", &BinSerTestObject::mFloats );
+	ork::reflect::RegisterArrayProperty( "Ints", &BinSerTestObject::mInts );
+	ork::reflect::RegisterArrayProperty( "Bools", &BinSerTestObject::mBools );
+	ork::reflect::RegisterArrayProperty( "Fixed", &BinSerTestObject::mFixed );
+	ork::reflect::RegisterProperty( "Scalar", &BinSerTestObject::mScalar );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// writes arrays item by item, like archives from before the pod path
+///////////////////////////////////////////////////////////////////////////////
+
+class LegacyArraySerializer : public ork::reflect::serialize::LayerSerializer
+{
+public:
+	LegacyArraySerializer( ork::reflect::ISerializer& ser ) : LayerSerializer(ser) {}
+	bool SerializePodArray( const void*, size_t, size_t ) override { return false; }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+} } // namespace ork::test
+///////////////////////////////////////////////////////////////////////////////
+
+INSTANTIATE_TRANSPARENT_RTTI(ork::test::BinSerTestObject,"test/BinSerTestObject");
+
+using namespace ork;
+using namespace ork::test;
+
+static void BinSerWrite( const BinSerTestObject& obj, ResizableString& str, bool blegacy )
+{
+	stream::ResizableStringOutputStream ostream(str);
+	reflect::serialize::BinarySerializer binoser(ostream);
+	LegacyArraySerializer legacy(binoser);
+	reflect::ISerializer& ser = blegacy ? static_cast<reflect::ISerializer&>(legacy) : binoser;
+	obj.GetClass()->Description().SerializeProperties( ser, &obj );
+}
+
+static bool BinSerRead( reflect::IDeserializer& deser, BinSerTestObject& obj )
+{
+	return obj.GetClass()->Description().DeserializeProperties( deser, &obj );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(BinarySerializePodRoundTrip)
+{
+	BinSerTestObject src;
+	src.Fill(1000);
+
+	for( int ilegacy=0; ilegacy<2; ilegacy++ )
+	{
+		ResizableString str;
+		BinSerWrite( src, str, ilegacy!=0 );
+
+		// through a stream
+		{
+			BinSerTestObject dst;
+			stream::StringInputStream istream(str);
+			reflect::serialize::BinaryDeserializer deser(istream);
+			CHECK( BinSerRead( deser, dst ) );
+			CHECK( src.Equals(dst) );
+		}
+		// straight from memory
+		{
+			BinSerTestObject dst;
+			reflect::serialize::BinaryDeserializer deser(str.data(), str.length());
+			CHECK( BinSerRead( deser, dst ) );
+			CHECK( src.Equals(dst) );
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(BinarySerializeMappedFile)
+{
+	BinSerTestObject src;
+	src.Fill(100000);
+
+	ResizableString str;
+	BinSerWrite( src, str, false );
+
+	const char* fname = "/tmp/ork_binser_test.bin";
+	FILE* fout = fopen( fname, "wb" );
+	CHECK( fout!=nullptr );
+	if( nullptr == fout )
+		return;
+	fwrite( str.data(), 1, str.length(), fout );
+	fclose( fout );
+
+	file::MappedFile mapped;
+	CHECK( mapped.Open( file::Path(fname) ) );
+	CHECK_EQUAL( size_t(str.length()), mapped.GetSize() );
+
+	BinSerTestObject dst;
+	{
+		reflect::serialize::BinaryDeserializer deser( mapped.GetData(), mapped.GetSize() );
+		CHECK( BinSerRead( deser, dst ) );
+	}
+	CHECK( src.Equals(dst) );
+
+	mapped.Close();
+	remove( fname );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(BinarySerializePodBench)
+{
+	const int knumfloats = 1<<20;
+	const int kiters = 4;
+
+	BinSerTestObject src;
+	src.Fill(knumfloats);
+
+	ResizableString legacystr, podstr;
+	BinSerWrite( src, legacystr, true );
+	BinSerWrite( src, podstr, false );
+
+	float ftimes[3] = { 0.0f, 0.0f, 0.0f };
+	bool bok = true;
+
+	for( int it=0; it<kiters; it++ )
+	{
+		BinSerTestObject a, b, c;
+
+		float ft0 = get_sync_time();
+		{
+			stream::StringInputStream istream(legacystr);
+			reflect::serialize::BinaryDeserializer deser(istream);
+			bok &= BinSerRead( deser, a );
+		}
+		float ft1 = get_sync_time();
+		{
+			stream::StringInputStream istream(podstr);
+			reflect::serialize::BinaryDeserializer deser(istream);
+			bok &= BinSerRead( deser, b );
+		}
+		float ft2 = get_sync_time();
+		{
+			reflect::serialize::BinaryDeserializer deser(podstr.data(), podstr.length());
+			bok &= BinSerRead( deser, c );
+		}
+		float ft3 = get_sync_time();
+
+		ftimes[0] += ft1-ft0;
+		ftimes[1] += ft2-ft1;
+		ftimes[2] += ft3-ft2;
+		bok &= src.Equals(a) && src.Equals(b) && src.Equals(c);
+	}
+
+	printf( "BinarySerializePodBench %d floats : archive legacy<%d KB> pod<%d KB>\n", knumfloats, int(legacystr.length()>>10), int(podstr.length()>>10) );
+	printf( "  per item (stream)  : %f ms\n", ftimes[0]*1000.0f/float(kiters) );
+	printf( "  pod block (stream) : %f ms\n", ftimes[1]*1000.0f/float(kiters) );
+	printf( "  pod block (memory) : %f ms\n", ftimes[2]*1000.0f/float(kiters) );
+
+	CHECK( bok );
+	CHECK( podstr.length() < legacystr.length() );
+}
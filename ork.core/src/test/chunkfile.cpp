@@ -0,0 +1,175 @@
+#include <ork/pch.h>
+
+#include <unittest++/UnitTest++.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <ork/file/chunkfile.h>
+#include <ork/file/chunkfile.hpp>
+
+using namespace ork;
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct ChunkTestAllocator
+{
+	static int gnumallocs;
+	static int gnumdones;
+
+	void* alloc( const char* pchkname, int ilen )
+	{
+		gnumallocs++;
+		return new char[ilen];
+	}
+	void done( const char* pchkname, void* pdata )
+	{
+		gnumdones++;
+		delete[] (char*) pdata;
+	}
+};
+
+int ChunkTestAllocator::gnumallocs = 0;
+int ChunkTestAllocator::gnumdones = 0;
+
+typedef chunkfile::Reader<ChunkTestAllocator> ChunkTestReader;
+
+static const char* kchunktestname = "/tmp/ork_chunkfile_test.xgx";
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void ChunkTestWrite()
+{
+	chunkfile::Writer writer( "xgx" );
+	chunkfile::OutputStream* hdr = writer.AddStream( "header" );
+	chunkfile::OutputStream* dat = writer.AddStream( "modeldata" );
+	writer.AddStream( "empty" );
+
+	hdr->AddItem( 0x01234567 );
+	hdr->AddItem( writer.GetStringIndex( "joint_a" ) );
+	hdr->AddItem( 2.5f );
+	for( int i=0; i<1001; i++ ) // odd length, so the next chunk needs padding
+		dat->AddItem( (unsigned char)(i&0xff) );
+
+	writer.WriteToFile( kchunktestname );
+}
+
+static bool ChunkTestCheck( ChunkTestReader& reader )
+{
+	chunkfile::InputStream* hdr = reader.GetStream( "header" );
+	chunkfile::InputStream* dat = reader.GetStream( "modeldata" );
+	chunkfile::InputStream* empty = reader.GetStream( "empty" );
+	if( false==reader.IsOk() || 0==hdr || 0==dat || 0==empty )
+		return false;
+
+	int itag = 0, ijoint = 0;
+	float fval = 0.0f;
+	hdr->GetItem( itag );
+	hdr->GetItem( ijoint );
+	hdr->GetItem( fval );
+	bool bok = (itag==0x01234567)
+			&& (0==strcmp( reader.GetString(ijoint), "joint_a" ))
+			&& (fval==2.5f)
+			&& (dat->GetLength()==1001)
+			&& (empty->GetLength()==0);
+
+	const unsigned char* pdat = (const unsigned char*) dat->GetDataAt(0);
+	for( int i=0; bok && i<1001; i++ )
+		bok &= (pdat[i]==(unsigned char)(i&0xff));
+	return bok;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(ChunkFileAllocatedRead)
+{
+	ChunkTestWrite();
+	ChunkTestAllocator::gnumallocs = 0;
+	ChunkTestAllocator::gnumdones = 0;
+	{
+		ChunkTestReader reader( kchunktestname, "xgx" );
+		CHECK( false==reader.IsMapped() );
+		CHECK( ChunkTestCheck( reader ) );
+	}
+	CHECK_EQUAL( 2, ChunkTestAllocator::gnumallocs );
+	CHECK_EQUAL( 2, ChunkTestAllocator::gnumdones );
+	remove( kchunktestname );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(ChunkFileMappedRead)
+{
+	ChunkTestWrite();
+	ChunkTestAllocator::gnumallocs = 0;
+	ChunkTestAllocator::gnumdones = 0;
+	{
+		ChunkTestReader reader( kchunktestname, "xgx", chunkfile::EREADMODE_MAPPED );
+		CHECK( reader.IsMapped() );
+		CHECK( ChunkTestCheck( reader ) );
+
+		// chunks are aligned relative to the start of the file
+		chunkfile::InputStream* hdr = reader.GetStream( "header" );
+		chunkfile::InputStream* dat = reader.GetStream( "modeldata" );
+		if( hdr && dat )
+		{
+			CHECK_EQUAL( 0, int( uintptr_t(hdr->GetDataAt(0)) % chunkfile::kchunkalign ) );
+			CHECK_EQUAL( 0, int( uintptr_t(dat->GetDataAt(0)) % chunkfile::kchunkalign ) );
+
+			// copy on write, patching stays private to this reader
+			*(unsigned char*) dat->GetDataAt(0) = 0xee;
+		}
+	}
+	CHECK_EQUAL( 0, ChunkTestAllocator::gnumallocs );
+	CHECK_EQUAL( 0, ChunkTestAllocator::gnumdones );
+
+	ChunkTestReader reader( kchunktestname, "xgx", chunkfile::EREADMODE_MAPPED );
+	CHECK( ChunkTestCheck( reader ) );
+	remove( kchunktestname );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// packed "chkf" files written before chunk alignment still load in both modes
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(ChunkFileLegacyRead)
+{
+	static const char kstrtab[] = "xgx\0header\0data";
+	const int istrtablen = sizeof(kstrtab);
+	const int ichunks[2][3] = { { 4, 0, 8 }, { 11, 8, 3 } }; // name, offset, length
+	const int ihdrdata[2] = { 42, -7 };
+	const unsigned char udata[3] = { 1, 2, 3 };
+
+	FILE* fout = fopen( kchunktestname, "wb" );
+	CHECK( fout!=nullptr );
+	if( nullptr==fout )
+		return;
+	const int ifiletype = 0, inumchunks = 2;
+	fwrite( "chkf", 4, 1, fout );
+	fwrite( & istrtablen, sizeof(int), 1, fout );
+	fwrite( kstrtab, istrtablen, 1, fout );
+	fwrite( & ifiletype, sizeof(int), 1, fout );
+	fwrite( & inumchunks, sizeof(int), 1, fout );
+	fwrite( ichunks, sizeof(ichunks), 1, fout );
+	fwrite( ihdrdata, sizeof(ihdrdata), 1, fout );
+	fwrite( udata, sizeof(udata), 1, fout );
+	fclose( fout );
+
+	for( int imode=0; imode<2; imode++ )
+	{
+		ChunkTestReader reader( kchunktestname, "xgx", chunkfile::EReadMode(imode) );
+		CHECK( reader.IsOk() );
+		chunkfile::InputStream* hdr = reader.GetStream( "header" );
+		chunkfile::InputStream* dat = reader.GetStream( "data" );
+		CHECK( hdr && dat );
+		if( 0==hdr || 0==dat )
+			continue;
+		int ia = 0, ib = 0;
+		hdr->GetItem( ia );
+		hdr->GetItem( ib );
+		CHECK_EQUAL( 42, ia );
+		CHECK_EQUAL( -7, ib );
+		CHECK_EQUAL( 3, dat->GetLength() );
+		CHECK_EQUAL( 0, memcmp( dat->GetDataAt(0), udata, 3 ) );
+	}
+	remove( kchunktestname );
+}
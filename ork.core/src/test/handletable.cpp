@@ -0,0 +1,139 @@
+#include <ork/pch.h>
+
+#include <unittest++/UnitTest++.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <ork/kernel/handletable.h>
+#include <ork/kernel/string/StringPool.h>
+#include <ork/kernel/timer.h>
+
+using namespace ork;
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(HandleTableGenerations)
+{
+	HandleTable<int> table;
+
+	TableHandle h[8];
+	for( int i=0; i<8; i++ )
+		h[i] = table.Add( i*10 );
+	CHECK_EQUAL( 8, int(table.size()) );
+	CHECK( false==h[0].IsNull() );
+	CHECK( TableHandle().IsNull() );
+	CHECK( nullptr==table.Get( TableHandle() ) );
+
+	// removal moves the last item into the hole, the moved item's handle follows it
+	CHECK( table.Remove( h[2] ) );
+	CHECK( table.Remove( h[5] ) );
+	CHECK( false==table.Remove( h[5] ) );
+	const int kexpected[6] = { 0, 10, 70, 30, 40, 60 };
+	CHECK_EQUAL( 6, int(table.size()) );
+	for( int i=0; i<6; i++ )
+		CHECK_EQUAL( kexpected[i], table[i] );
+	CHECK_EQUAL( 4, table.IndexOf(h[4]) );
+	CHECK( table.HandleAt(4)==h[4] );
+	CHECK_EQUAL( 2, table.IndexOf(h[7]) );
+	CHECK( table.HandleAt(2)==h[7] );
+	CHECK_EQUAL( 70, *table.Get(h[7]) );
+	CHECK_EQUAL( 60, *table.Get(h[6]) );
+
+	// removing the last item moves nothing
+	CHECK( table.Remove( h[6] ) );
+	CHECK_EQUAL( 5, int(table.size()) );
+	CHECK_EQUAL( 2, table.IndexOf(h[7]) );
+	h[6] = table.Add( 60 );
+
+	// stale handles stay stale once their slot is reused
+	CHECK( nullptr==table.Get( h[2] ) );
+	TableHandle hn = table.Add( 99 );
+	CHECK( hn.muSlot==h[5].muSlot || hn.muSlot==h[2].muSlot );
+	CHECK( hn!=h[5] && hn!=h[2] );
+	CHECK( nullptr==table.Get( h[5] ) );
+	CHECK( nullptr==table.Get( h[2] ) );
+	CHECK_EQUAL( 99, *table.Get(hn) );
+	CHECK_EQUAL( 99, table[6] );
+
+	table.Clear();
+	CHECK( table.empty() );
+	CHECK( nullptr==table.Get( h[0] ) );
+	CHECK( nullptr==table.Get( hn ) );
+	TableHandle ha = table.Add( 1 );
+	CHECK_EQUAL( 1, *table.Get(ha) );
+	CHECK( false==table.IsValid( h[0] ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// per frame walk over every entity, the way SceneInst used to (orkmap keyed
+//  by name) against a HandleTable of the same pointers, and of the objects
+//  themselves. the objects are allocated between other allocations, like
+//  entities spawned over the course of a level
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct BenchEntity
+{
+	float	mfValue;
+	char	mPad[124];
+};
+
+}
+
+TEST(HandleTableIterationBench)
+{
+	const int kcounts[3] = { 1000, 10000, 100000 };
+
+	for( int ic=0; ic<3; ic++ )
+	{
+		const int inum = kcounts[ic];
+		const int knumframes = 10000000/inum;
+		StringPool names;
+		orkmap<PoolString,BenchEntity*> bymap;
+		HandleTable<BenchEntity*> byptr;
+		HandleTable<BenchEntity> byval;
+		orkvector<char*> junk;
+
+		for( int i=0; i<inum; i++ )
+		{
+			BenchEntity* pent = new BenchEntity;
+			pent->mfValue = float(i&7);
+			junk.push_back( new char[32+(i%5)*48] );
+			char name[32];
+			snprintf( name, sizeof(name), "ent%d", (i*7919)%inum );
+			bymap[names.String(name)] = pent;
+			byptr.Add( pent );
+			byval.Add( *pent );
+		}
+
+		float ft0 = get_sync_time();
+		double fsum_map = 0.0;
+		for( int f=0; f<knumframes; f++ )
+			for( orkmap<PoolString,BenchEntity*>::const_iterator it=bymap.begin(); it!=bymap.end(); it++ )
+				fsum_map += it->second->mfValue;
+		float ft1 = get_sync_time();
+		double fsum_ptr = 0.0;
+		for( int f=0; f<knumframes; f++ )
+			for( HandleTable<BenchEntity*>::const_iterator it=byptr.begin(); it!=byptr.end(); it++ )
+				fsum_ptr += (*it)->mfValue;
+		float ft2 = get_sync_time();
+		double fsum_val = 0.0;
+		for( int f=0; f<knumframes; f++ )
+			for( HandleTable<BenchEntity>::const_iterator it=byval.begin(); it!=byval.end(); it++ )
+				fsum_val += it->mfValue;
+		float ft3 = get_sync_time();
+
+		float fus = 1.0e6f/float(knumframes);
+		printf( "HandleTableIterationBench entities<%d> per frame : orkmap<%f us> table(ptr)<%f us> table(val)<%f us>\n",
+				inum, (ft1-ft0)*fus, (ft2-ft1)*fus, (ft3-ft2)*fus );
+
+		CHECK_EQUAL( fsum_map, fsum_ptr );
+		CHECK_EQUAL( fsum_map, fsum_val );
+
+		for( HandleTable<BenchEntity*>::iterator it=byptr.begin(); it!=byptr.end(); it++ )
+			delete (*it);
+		for( size_t i=0; i<junk.size(); i++ )
+			delete[] junk[i];
+	}
+}
@@ -91,3 +91,133 @@ TEST(opq_maxinflight)
 }
 
 ///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+// push/pop throughput, shared group queues vs workstealing deques
+//  "external" : ops pushed from a foreign thread
+//  "fanout"   : ops pushed from ops (what task graphs / parallel_for do)
+///////////////////////////////////////////////////////////////////////////////
+
+static float opq_bench_external( EOpqMode mode, int inumthreads, int inumops, bool& bok )
+{
+    auto popq = new Opq(inumthreads,"benchq",mode);
+
+    ork::atomic<int> counter;
+    counter = 0;
+    void_lambda_t lam = [&](){ counter++; };
+
+    ork::Timer measure;
+    measure.Start();
+    for( int i=0; i<inumops; i++ )
+        popq->push(lam);
+    popq->drain();
+    float elapsed = measure.SecsSinceStart();
+
+    bok = bok && (counter==inumops);
+    delete popq;
+    return float(inumops)/elapsed;
+}
+
+static float opq_bench_fanout( EOpqMode mode, int inumthreads, int inumrounds, int inumroots, int inumchildren, bool& bok )
+{
+    auto popq = new Opq(inumthreads,"benchq",mode);
+
+    ork::atomic<int> counter;
+    counter = 0;
+    void_lambda_t child = [&](){ counter++; };
+    void_lambda_t root = [&]()
+    {
+        for( int i=0; i<inumchildren; i++ )
+            popq->push(child);
+        counter++;
+    };
+
+    // in rounds, so a round fits the group queue (a worker blocked
+    //  pushing into a full queue in shared mode might be the only consumer)
+    ork::Timer measure;
+    measure.Start();
+    for( int r=0; r<inumrounds; r++ )
+    {
+        for( int i=0; i<inumroots; i++ )
+            popq->push(root);
+        popq->drain();
+    }
+    float elapsed = measure.SecsSinceStart();
+
+    int inumops = inumrounds*inumroots*(inumchildren+1);
+    bok = bok && (counter==inumops);
+    delete popq;
+    return float(inumops)/elapsed;
+}
+
+TEST(opq_workstealing_bench)
+{
+    const int kops = 64<<10;
+    const int krounds = 32;
+    const int kroots = 16;
+    const int kchildren = 128;
+
+    bool bok = true;
+
+    for( int inumthreads=1; inumthreads<=16; inumthreads*=2 )
+    {
+        float shr_ext = opq_bench_external(EOPQMODE_SHARED,inumthreads,kops,bok);
+        float wst_ext = opq_bench_external(EOPQMODE_WORKSTEALING,inumthreads,kops,bok);
+        float shr_fan = opq_bench_fanout(EOPQMODE_SHARED,inumthreads,krounds,kroots,kchildren,bok);
+        float wst_fan = opq_bench_fanout(EOPQMODE_WORKSTEALING,inumthreads,krounds,kroots,kchildren,bok);
+
+        printf( "opqbench nthr<%d> external ops/sec shared<%d> workstealing<%d> : fanout ops/sec shared<%d> workstealing<%d>\n",
+                inumthreads, int(shr_ext), int(wst_ext), int(shr_fan), int(wst_fan) );
+    }
+
+    CHECK(bok);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// serial groups keep their ordering and exclusivity in workstealing mode
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(opq_workstealing_serial)
+{
+    const int knumthreads = 8;
+    const int kops = 16<<10;
+
+    auto popq = new Opq(knumthreads,"wsq",EOPQMODE_WORKSTEALING);
+    auto pserial = popq->CreateOpGroup("serial");
+    pserial->MakeSerial();
+
+    ork::atomic<int> ops_in_flight;
+    ork::atomic<int> max_in_flight;
+    ork::atomic<int> order_errors;
+    ork::atomic<int> counter;
+    ork::atomic<int> serial_counter;
+    ops_in_flight = 0;
+    max_in_flight = 0;
+    order_errors = 0;
+    counter = 0;
+    serial_counter = 0;
+
+    for( int i=0; i<kops; i++ )
+    {
+        // interleave unlimited ops which spawn more unlimited ops
+        popq->push([&](){ popq->push([&](){ counter++; }); });
+
+        pserial->push(Op([&,i]()
+        {
+            int ioif = ++ops_in_flight;
+            if( ioif>max_in_flight ) max_in_flight = ioif;
+            counter++;
+            // the i'th serial op must be the i'th to run
+            if( serial_counter.fetch_add(1)!=i ) order_errors++;
+            ops_in_flight--;
+        },"serial"));
+    }
+
+    popq->drain();
+
+    CHECK(max_in_flight==1);
+    CHECK(order_errors==0);
+    CHECK(counter==kops*2);
+    CHECK(serial_counter==kops);
+
+    delete popq;
+}
@@ -0,0 +1,89 @@
+#include <unittest++/UnitTest++.h>
+#include <stdlib.h>
+#include <new>
+
+#include <ork/kernel/atomic.h>
+#include <ork/kernel/opq.h>
+
+using namespace ork;
+
+///////////////////////////////////////////////////////////////////////////////
+// counting allocator (whole test binary, only counts while enabled)
+///////////////////////////////////////////////////////////////////////////////
+
+static ork::atomic<int> gnumallocs(0);
+static ork::atomic<bool> gcountallocs(false);
+
+void* operator new(size_t size)
+{
+    if( gcountallocs.load(MemRelaxed) )
+        gnumallocs++;
+    void* ptr = malloc(size ? size : 1);
+    if( nullptr == ptr )
+        throw std::bad_alloc();
+    return ptr;
+}
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// a frame's worth of small-capture ops on the main thread and concurrent
+//  queues must not touch the heap
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(opq_frame_noalloc)
+{
+    const int knumframes = 16;
+    const int knumops = 1000;
+
+    Opq& mtq = MainThreadOpQ();
+    Opq& conq = ConcurrentOpQ();
+
+    ork::atomic<int> counter;
+    counter = 0;
+
+    auto run_frame = [&]()
+    {
+        for( int i=0; i<knumops; i++ )
+        {
+            int* pdata = nullptr;
+            float fval = float(i);
+            conq.push([&counter,pdata,fval](){ counter++; },"conop");
+            mtq.push([&counter,i](){ counter+=(i&1); },"mtop");
+        }
+        OpqTest ot(&mtq);
+        while( mtq.Process() ) {}
+        conq.drain();
+    };
+
+    run_frame(); // warm up
+
+    gnumallocs = 0;
+    gcountallocs = true;
+    for( int f=0; f<knumframes; f++ )
+        run_frame();
+    gcountallocs = false;
+
+    printf( "opq_frame_noalloc frames<%d> ops<%d> allocs<%d>\n", knumframes, knumframes*knumops*2, int(gnumallocs) );
+
+    CHECK_EQUAL(0,int(gnumallocs));
+    CHECK_EQUAL((knumframes+1)*knumops*3/2,int(counter));
+
+    ///////////////////////////////////////////
+    // oversized captures fall back to one heap allocation
+    ///////////////////////////////////////////
+
+    struct big_t { char mData[Op::kinlinesize*2]; };
+    big_t big;
+    big.mData[0] = 1;
+
+    gnumallocs = 0;
+    gcountallocs = true;
+    Op bigop([big,&counter](){ counter+=big.mData[0]; },"bigop");
+    gcountallocs = false;
+
+    CHECK_EQUAL(false,bigop.mLambda.IsInline());
+    CHECK_EQUAL(1,int(gnumallocs));
+}
@@ -0,0 +1,350 @@
+#include <unittest++/UnitTest++.h>
+#include <cmath>
+#include <string.h>
+
+#include <ork/math/cvector2.h>
+#include <ork/math/cvector3.h>
+#include <ork/math/raytracer.h>
+#include <ork/math/octree.h>
+#include <ork/math/bvh.h>
+#include <ork/kernel/timer.h>
+
+using namespace ork;
+
+///////////////////////////////////////////////////////////////////////////////
+// benchmark scene : rolling heightfield plus scattered boxes
+///////////////////////////////////////////////////////////////////////////////
+
+struct BvhTestScene
+{
+	static const int kgrid = 96;
+	static const int knumboxes = 300;
+	static const float kextent;
+
+	orkvector<RgmVertex>		mVerts;
+	orkvector<RgmTri>			mTris;
+	orkvector<const Primitive*>	mPrims;
+	AABox						mBounds;
+
+	BvhTestScene()
+	{
+		const int kboxverts = 8;
+		const int kboxtris = 12;
+		int inumverts = (kgrid+1)*(kgrid+1) + knumboxes*kboxverts;
+		int inumtris = kgrid*kgrid*2 + knumboxes*kboxtris;
+		mVerts.resize(inumverts);
+		mTris.reserve(inumtris);
+
+		int iv = 0;
+		for( int iz=0; iz<=kgrid; iz++ )
+			for( int ix=0; ix<=kgrid; ix++ )
+			{
+				float fx = kextent*(float(ix)/float(kgrid)-0.5f);
+				float fz = kextent*(float(iz)/float(kgrid)-0.5f);
+				float fy = 4.0f*sinf(fx*0.07f)*cosf(fz*0.05f);
+				mVerts[iv++].pos = CVector3(fx,fy,fz);
+			}
+		for( int iz=0; iz<kgrid; iz++ )
+			for( int ix=0; ix<kgrid; ix++ )
+			{
+				int i00 = iz*(kgrid+1)+ix;
+				int i10 = i00+1;
+				int i01 = i00+(kgrid+1);
+				int i11 = i01+1;
+				AddTri(i00,i01,i10);
+				AddTri(i10,i01,i11);
+			}
+
+		u32 useed = 12345;
+		auto frand = [&]() -> float
+		{
+			useed = useed*1664525u+1013904223u;
+			return float(useed>>8)/float(1<<24);
+		};
+		static const int kboxidx[kboxtris*3] =
+		{
+			0,2,1, 1,2,3, 4,5,6, 5,7,6, 0,1,4, 1,5,4,
+			2,6,3, 3,6,7, 0,4,2, 2,4,6, 1,3,5, 3,7,5,
+		};
+		for( int ib=0; ib<knumboxes; ib++ )
+		{
+			CVector3 ctr( kextent*(frand()-0.5f), 2.0f+frand()*6.0f, kextent*(frand()-0.5f) );
+			CVector3 ext( 0.5f+frand()*3.0f, 0.5f+frand()*4.0f, 0.5f+frand()*3.0f );
+			int ibase = iv;
+			for( int c=0; c<8; c++ )
+			{
+				CVector3 s( (c&1)?1.0f:-1.0f, (c&2)?1.0f:-1.0f, (c&4)?1.0f:-1.0f );
+				mVerts[iv++].pos = ctr+CVector3(s.GetX()*ext.GetX(),s.GetY()*ext.GetY(),s.GetZ()*ext.GetZ());
+			}
+			for( int t=0; t<kboxtris; t++ )
+				AddTri(ibase+kboxidx[t*3+0],ibase+kboxidx[t*3+1],ibase+kboxidx[t*3+2]);
+		}
+
+		mBounds.BeginGrow();
+		for( const auto& v : mVerts )
+			mBounds.Grow(v.pos);
+		mBounds.EndGrow();
+
+		for( auto& tri : mTris )
+		{
+			tri.Compute();
+			RaytTriangle* prim = new RaytTriangle(tri.mpv0,tri.mpv1,tri.mpv2);
+			prim->mRgmPoly = & tri;
+			mPrims.push_back(prim);
+		}
+	}
+	~BvhTestScene()
+	{
+		for( auto p : mPrims )
+			delete p;
+	}
+	void AddTri( int i0, int i1, int i2 )
+	{
+		RgmTri tri;
+		tri.mpv0 = & mVerts[i0];
+		tri.mpv1 = & mVerts[i1];
+		tri.mpv2 = & mVerts[i2];
+		mTris.push_back(tri);
+	}
+
+	// reference : test every triangle
+	bool BruteForce( const Ray3& ray, float& dist ) const
+	{
+		bool bhit = false;
+		for( const auto& tri : mTris )
+		{
+			CVector3 e1 = tri.mpv1->pos-tri.mpv0->pos;
+			CVector3 e2 = tri.mpv2->pos-tri.mpv0->pos;
+			CVector3 p = ray.mDirection.Cross(e2);
+			float det = e1.Dot(p);
+			if( std::abs(det)<1.0e-12f ) continue;
+			float inv = 1.0f/det;
+			CVector3 t = ray.mOrigin-tri.mpv0->pos;
+			float u = t.Dot(p)*inv;
+			if( u<0.0f || u>1.0f ) continue;
+			CVector3 q = t.Cross(e1);
+			float v = ray.mDirection.Dot(q)*inv;
+			if( v<0.0f || u+v>1.0f ) continue;
+			float d = e2.Dot(q)*inv;
+			if( d>0.0f && d<dist )
+			{
+				dist = d;
+				bhit = true;
+			}
+		}
+		return bhit;
+	}
+};
+const float BvhTestScene::kextent = 200.0f;
+
+///////////////////////////////////////////////////////////////////////////////
+// primary ray through pixel (ix,iy) of a camera looking down at the scene
+///////////////////////////////////////////////////////////////////////////////
+
+static Ray3 BvhTestCameraRay( int ix, int iy, int ires )
+{
+	CVector3 eye( -120.0f, 60.0f, -120.0f );
+	CVector3 fwd = (CVector3(0.0f,0.0f,0.0f)-eye).Normal();
+	CVector3 rgt = fwd.Cross(CVector3(0.0f,1.0f,0.0f)).Normal();
+	CVector3 up = rgt.Cross(fwd).Normal();
+	float fx = (float(ix)+0.5f)/float(ires)*2.0f-1.0f;
+	float fy = (float(iy)+0.5f)/float(ires)*2.0f-1.0f;
+	CVector3 dir = (fwd+rgt*(fx*0.6f)+up*(fy*0.6f)).Normal();
+	return Ray3(eye,dir);
+}
+
+static const float kbvhtestfar = 100000.0f;
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(RaytBvhMatchesBruteForce)
+{
+	BvhTestScene scene;
+	RaytBvh bvh;
+	bvh.Build(scene.mPrims);
+
+	CHECK_EQUAL(int(scene.mPrims.size()),bvh.NumPrimitives());
+
+	const int kres = 64;
+	int inummismatch = 0;
+	int inumhits = 0;
+	int inumshadowmismatch = 0;
+	const CVector3 light(50.0f,150.0f,30.0f);
+
+	for( int iy=0; iy<kres; iy+=2 )
+		for( int ix=0; ix<kres; ix+=2 )
+		{
+			RaytBvhPacket packet, shadowpacket;
+			Ray3 rays[4];
+			for( int l=0; l<4; l++ )
+			{
+				rays[l] = BvhTestCameraRay(ix+(l&1),iy+(l>>1),kres);
+				packet.SetRay(l,rays[l],kbvhtestfar);
+			}
+			bvh.FindNearest(packet);
+
+			for( int l=0; l<4; l++ )
+			{
+				float fref = kbvhtestfar;
+				bool bref = scene.BruteForce(rays[l],fref);
+
+				float fsingle = kbvhtestfar;
+				const Primitive* psingle = nullptr;
+				bool bsingle = bvh.FindNearest(rays[l],fsingle,psingle);
+
+				bool bpacket = 0!=(packet.mHits&(1<<l));
+				float fpacket = packet.mDist[l];
+
+				bool bok = (bref==bsingle) && (bref==bpacket);
+				if( bok && bref )
+				{
+					bok &= std::abs(fref-fsingle)<1.0e-3f*fref;
+					bok &= std::abs(fref-fpacket)<1.0e-3f*fref;
+					bok &= (psingle!=nullptr) && (packet.mPrim[l]==psingle);
+				}
+				inummismatch += int(false==bok);
+				inumhits += int(bref);
+
+				//////////////////////////
+				// shadow ray from the hit point
+				//////////////////////////
+
+				CVector3 pos = rays[l].mOrigin+rays[l].mDirection*(bref ? fref : 10.0f);
+				CVector3 tolight = light-pos;
+				float fdisttolight = tolight.Mag();
+				Ray3 sray( pos+tolight.Normal()*0.01f, tolight.Normal() );
+				shadowpacket.SetRay(l,sray,fdisttolight);
+
+				float fsref = fdisttolight;
+				bool bsref = scene.BruteForce(sray,fsref);
+				bool bssingle = bvh.Occluded(sray,fdisttolight);
+				inumshadowmismatch += int(bsref!=bssingle);
+			}
+
+			bvh.Occluded(shadowpacket);
+			for( int l=0; l<4; l++ )
+			{
+				bool bssingle = bvh.Occluded(Ray3(CVector3(shadowpacket.mOrgX[l],shadowpacket.mOrgY[l],shadowpacket.mOrgZ[l]),
+												  CVector3(shadowpacket.mDirX[l],shadowpacket.mDirY[l],shadowpacket.mDirZ[l])),
+											shadowpacket.mDist[l]);
+				inumshadowmismatch += int(bssingle!=(0!=(shadowpacket.mHits&(1<<l))));
+			}
+		}
+
+	printf( "RaytBvh prims<%d> nodes<%d> hits<%d> mismatches<%d> shadow mismatches<%d>\n",
+			bvh.NumPrimitives(), bvh.NumNodes(), inumhits, inummismatch, inumshadowmismatch );
+
+	CHECK(inumhits>0);
+	CHECK_EQUAL(0,inummismatch);
+	CHECK_EQUAL(0,inumshadowmismatch);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// rays/sec : FixedGrid (before) vs RaytBvh single ray and 2x2 packets (after)
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(RaytBvhBench)
+{
+	BvhTestScene scene;
+	const int kres = 512;
+	const int knumrays = kres*kres;
+	const CVector3 light(50.0f,150.0f,30.0f);
+
+	printf( "RaytBvhBench scene tris<%d> rays<%d>\n", int(scene.mPrims.size()), knumrays );
+
+	int ihitsgrid = 0, ihitssingle = 0, ihitspacket = 0, ioccsingle = 0, ioccpacket = 0;
+
+	////////////////////////////////////
+	// FixedGrid
+	////////////////////////////////////
+
+	{
+		float ft0 = ork::get_sync_time();
+		FixedGrid* grid = new FixedGrid;
+		grid->BuildGrid(scene.mBounds,scene.mPrims);
+		float ft1 = ork::get_sync_time();
+		for( int iy=0; iy<kres; iy++ )
+			for( int ix=0; ix<kres; ix++ )
+			{
+				Ray3 ray = BvhTestCameraRay(ix,iy,kres);
+				float fdist = kbvhtestfar;
+				CVector3 isect;
+				const Primitive* prim = nullptr;
+				ihitsgrid += int(grid->FindNearest(ray,fdist,isect,prim));
+			}
+		float ft2 = ork::get_sync_time();
+		size_t igridmem = size_t(256*256*256)*sizeof(ObjectList*);
+		delete grid;
+		printf( "  FixedGrid  build<%gs> mem>=%dMB primary<%g rays/s> hits<%d>\n",
+				ft1-ft0, int(igridmem>>20), float(knumrays)/(ft2-ft1), ihitsgrid );
+	}
+
+	////////////////////////////////////
+	// RaytBvh
+	////////////////////////////////////
+
+	float ft0 = ork::get_sync_time();
+	RaytBvh bvh;
+	bvh.Build(scene.mPrims);
+	float ft1 = ork::get_sync_time();
+
+	orkvector<Ray3> shadowrays;
+	orkvector<float> shadowdists;
+	shadowrays.reserve(knumrays);
+	shadowdists.reserve(knumrays);
+
+	for( int iy=0; iy<kres; iy++ )
+		for( int ix=0; ix<kres; ix++ )
+		{
+			Ray3 ray = BvhTestCameraRay(ix,iy,kres);
+			float fdist = kbvhtestfar;
+			const Primitive* prim = nullptr;
+			bool bhit = bvh.FindNearest(ray,fdist,prim);
+			ihitssingle += int(bhit);
+			CVector3 pos = ray.mOrigin+ray.mDirection*(bhit ? fdist : 10.0f);
+			CVector3 tolight = light-pos;
+			shadowrays.push_back(Ray3(pos+tolight.Normal()*0.01f,tolight.Normal()));
+			shadowdists.push_back(tolight.Mag());
+		}
+	float ft2 = ork::get_sync_time();
+
+	for( int iy=0; iy<kres; iy+=2 )
+		for( int ix=0; ix<kres; ix+=2 )
+		{
+			RaytBvhPacket packet;
+			for( int l=0; l<4; l++ )
+				packet.SetRay(l,BvhTestCameraRay(ix+(l&1),iy+(l>>1),kres),kbvhtestfar);
+			bvh.FindNearest(packet);
+			for( int l=0; l<4; l++ )
+				ihitspacket += int(0!=(packet.mHits&(1<<l)));
+		}
+	float ft3 = ork::get_sync_time();
+
+	for( int i=0; i<knumrays; i++ )
+		ioccsingle += int(bvh.Occluded(shadowrays[i],shadowdists[i]));
+	float ft4 = ork::get_sync_time();
+
+	for( int iy=0; iy<kres; iy+=2 )
+		for( int ix=0; ix<kres; ix+=2 )
+		{
+			RaytBvhPacket packet;
+			for( int l=0; l<4; l++ )
+			{
+				int i = (iy+(l>>1))*kres+ix+(l&1);
+				packet.SetRay(l,shadowrays[i],shadowdists[i]);
+			}
+			bvh.Occluded(packet);
+			for( int l=0; l<4; l++ )
+				ioccpacket += int(0!=(packet.mHits&(1<<l)));
+		}
+	float ft5 = ork::get_sync_time();
+
+	printf( "  RaytBvh    build<%gs> mem<%dKB> nodes<%d>\n", ft1-ft0, int(bvh.MemoryUsage()>>10), bvh.NumNodes() );
+	printf( "  RaytBvh    primary single<%g rays/s> packet4<%g rays/s> hits<%d/%d>\n",
+			float(knumrays)/(ft2-ft1), float(knumrays)/(ft3-ft2), ihitssingle, ihitspacket );
+	printf( "  RaytBvh    shadow  single<%g rays/s> packet4<%g rays/s> occluded<%d/%d>\n",
+			float(knumrays)/(ft4-ft3), float(knumrays)/(ft5-ft4), ioccsingle, ioccpacket );
+
+	CHECK_EQUAL(ihitssingle,ihitspacket);
+	CHECK_EQUAL(ioccsingle,ioccpacket);
+}
@@ -0,0 +1,312 @@
+#include <unittest++/UnitTest++.h>
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+
+#include <ork/math/cvector2.h>
+#include <ork/math/cvector3.h>
+#include <ork/math/raytracer.h>
+#include <ork/kernel/timer.h>
+
+using namespace ork;
+
+///////////////////////////////////////////////////////////////////////////////
+// bake test scene : uv mapped ground grid (raster_) with boxes casting
+//  shadows on it (caster_), baked with a simple shadow shader
+///////////////////////////////////////////////////////////////////////////////
+
+struct TileBakeShader : public BakeShader
+{
+	TileBakeShader( Engine& eng ) : BakeShader(eng), mpComputed(nullptr) { mNumCalls = 0; }
+
+	void Compute( int ix, int iy ) const final
+	{
+		mNumCalls++;
+		int ipix = (iy*mEngine.GetWidth())+ix;
+		if( mpComputed && ipix<int(mpComputed->size()) )
+			(*mpComputed)[ipix]++; // a pixel belongs to one tile, one thread
+		const BakeShadowFragment& frag = mEngine.RefFragment(ipix);
+		CVector3 tolight = CVector3(40.0f,120.0f,25.0f)-frag.mPos;
+		float fdist = tolight.Mag();
+		Ray3 ray( frag.mPos+CVector3(0.0f,0.01f,0.0f), tolight*(1.0f/fdist) );
+		bool bshadow = mEngine.Occluded( ray, fdist );
+		RayPixel& pix = mEngine.RefPixel(ipix);
+		u8 uc = bshadow ? 64 : 224;
+		pix.r = uc;
+		pix.g = u8((ix*255)/mEngine.GetWidth());
+		pix.b = u8((iy*255)/mEngine.GetHeight());
+		pix.a = 255;
+	}
+
+	mutable ork::atomic<int> mNumCalls;
+	orkvector<u8>* mpComputed;
+};
+
+struct TileBakeScene
+{
+	static const int kgrid = 24;
+	static const int knumboxes = 12;
+
+	orkvector<RgmVertex>	mVerts;
+	orkvector<RgmTri>		mTris;
+	orkvector<Primitive*>	mPrims;
+	RgmGeoSet				mRasterSet;
+	RgmGeoSet				mCasterSet;
+	AABox					mBounds;
+
+	TileBakeScene( BakeShader* pshader )
+	{
+		mVerts.resize( (kgrid+1)*(kgrid+1) + knumboxes*8 );
+		mTris.reserve( kgrid*kgrid*2 + knumboxes*12 );
+
+		int iv = 0;
+		for( int iz=0; iz<=kgrid; iz++ )
+			for( int ix=0; ix<=kgrid; ix++ )
+			{
+				float fu = float(ix)/float(kgrid);
+				float fv = float(iz)/float(kgrid);
+				RgmVertex& v = mVerts[iv++];
+				v.pos = CVector3( 100.0f*(fu-0.5f), 0.0f, 100.0f*(fv-0.5f) );
+				v.nrm = CVector3( 0.0f, 1.0f, 0.0f );
+				v.uv = CVector2( 0.02f+fu*0.96f, 0.02f+fv*0.96f );
+			}
+		for( int iz=0; iz<kgrid; iz++ )
+			for( int ix=0; ix<kgrid; ix++ )
+			{
+				int i00 = iz*(kgrid+1)+ix;
+				AddTri( i00, i00+(kgrid+1), i00+1 );
+				AddTri( i00+1, i00+(kgrid+1), i00+(kgrid+2) );
+			}
+		const int inumgroundtris = int(mTris.size());
+
+		static const int kboxidx[12*3] =
+		{
+			0,2,1, 1,2,3, 4,5,6, 5,7,6, 0,1,4, 1,5,4,
+			2,6,3, 3,6,7, 0,4,2, 2,4,6, 1,3,5, 3,7,5,
+		};
+		u32 useed = 777;
+		auto frand = [&]() -> float
+		{
+			useed = useed*1664525u+1013904223u;
+			return float(useed>>8)/float(1<<24);
+		};
+		for( int ib=0; ib<knumboxes; ib++ )
+		{
+			CVector3 ctr( 80.0f*(frand()-0.5f), 4.0f+frand()*6.0f, 80.0f*(frand()-0.5f) );
+			int ibase = iv;
+			for( int c=0; c<8; c++ )
+			{
+				CVector3 s( (c&1)?3.0f:-3.0f, (c&2)?3.0f:-3.0f, (c&4)?3.0f:-3.0f );
+				mVerts[iv++].pos = ctr+s;
+			}
+			for( int t=0; t<12; t++ )
+				AddTri( ibase+kboxidx[t*3+0], ibase+kboxidx[t*3+1], ibase+kboxidx[t*3+2] );
+		}
+
+		mBounds.BeginGrow();
+		for( const auto& v : mVerts )
+			mBounds.Grow(v.pos);
+		mBounds.EndGrow();
+
+		for( int it=0; it<int(mTris.size()); it++ )
+		{
+			RgmTri& tri = mTris[it];
+			tri.Compute();
+			RaytTriangle* prim = new RaytTriangle(tri.mpv0,tri.mpv1,tri.mpv2);
+			prim->mRgmPoly = & tri;
+			prim->SetBakeShader( pshader );
+			mPrims.push_back(prim);
+			if( it<inumgroundtris )
+				mRasterSet.AddPrimitive(prim);
+			else
+				mCasterSet.AddPrimitive(prim);
+		}
+	}
+	~TileBakeScene()
+	{
+		for( auto p : mPrims )
+			delete p;
+	}
+	void AddTri( int i0, int i1, int i2 )
+	{
+		RgmTri tri;
+		tri.mpv0 = & mVerts[i0];
+		tri.mpv1 = & mVerts[i1];
+		tri.mpv2 = & mVerts[i2];
+		mTris.push_back(tri);
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+static const int ktilebakesize = 256;
+
+static void TileBake( int inumthreads, bool bresume, float fprogress, const char* outname, orkvector<RayPixel>& result, int& inumcalls, orkvector<u8>* pcomputed=nullptr )
+{
+	Engine eng;
+	TileBakeShader shader(eng);
+	shader.mpComputed = pcomputed;
+	if( pcomputed )
+		pcomputed->assign( ktilebakesize*ktilebakesize, 0 );
+	TileBakeScene scene(&shader);
+	eng.GetScene()->AddGeoSet( "raster_ground", & scene.mRasterSet );
+	eng.GetScene()->AddGeoSet( "caster_boxes", & scene.mCasterSet );
+	eng.SetTargetSize( ktilebakesize );
+	eng.SetNumThreads( inumthreads );
+	eng.SetProgressInterval( fprogress );
+	eng.SetResume( bresume );
+
+	eng.Bake( scene.mBounds, outname );
+
+	result.resize( eng.GetWidth()*eng.GetHeight() );
+	for( int i=0; i<int(result.size()); i++ )
+		result[i] = eng.RefPixel(i);
+	inumcalls = shader.mNumCalls;
+}
+
+static int CountMismatches( const orkvector<RayPixel>& a, const orkvector<RayPixel>& b )
+{
+	if( a.size()!=b.size() )
+		return -1;
+	int inum = 0;
+	for( size_t i=0; i<a.size(); i++ )
+		inum += int( 0!=memcmp( &a[i], &b[i], sizeof(RayPixel) ) );
+	return inum;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(RaytTileBakeDeterministic)
+{
+	orkvector<RayPixel> serial, threaded;
+	int inumcalls1 = 0, inumcalls4 = 0;
+
+	float ft0 = get_sync_time();
+	TileBake( 1, false, 0.0f, "/tmp/ork_raytile_det", serial, inumcalls1 );
+	float ft1 = get_sync_time();
+	TileBake( 4, false, 0.0f, "/tmp/ork_raytile_det", threaded, inumcalls4 );
+	float ft2 = get_sync_time();
+
+	int inumlit = 0;
+	for( const auto& p : serial )
+		inumlit += int(p.a!=0);
+
+	printf( "RaytTileBake %dx%d lit<%d> 1 thread<%f s> 4 threads<%f s>\n", ktilebakesize, ktilebakesize, inumlit, ft1-ft0, ft2-ft1 );
+
+	CHECK( inumlit>0 );
+	CHECK_EQUAL( inumcalls1, inumcalls4 );
+	CHECK_EQUAL( 0, CountMismatches(serial,threaded) );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(RaytTileBakeResume)
+{
+	const char* outname = "/tmp/ork_raytile_resume";
+	std::string progname = std::string(outname)+".progress";
+	std::string ppmname = std::string(outname)+".ppm";
+	remove( progname.c_str() );
+
+	orkvector<RayPixel> first, resumed;
+	int inumcalls1 = 0, inumcalls2 = 0;
+
+	// a tiny interval snapshots after every tile, the final snapshot has them all
+	TileBake( 2, false, 0.0001f, outname, first, inumcalls1 );
+	TileBake( 2, true, 0.0001f, outname, resumed, inumcalls2 );
+
+	CHECK( inumcalls1>0 );
+	CHECK_EQUAL( 0, inumcalls2 );
+	CHECK_EQUAL( 0, CountMismatches(first,resumed) );
+
+	FILE* fppm = fopen( ppmname.c_str(), "rb" );
+	CHECK( fppm!=nullptr );
+	if( fppm )
+		fclose( fppm );
+
+	remove( progname.c_str() );
+	remove( ppmname.c_str() );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// a snapshot with every other tile undone (and its pixels cleared) resumes
+//  into the same image, only the undone tiles are baked again
+
+TEST(RaytTileBakeResumePartial)
+{
+	const char* outname = "/tmp/ork_raytile_partial";
+	std::string progname = std::string(outname)+".progress";
+	std::string ppmname = std::string(outname)+".ppm";
+	remove( progname.c_str() );
+
+	orkvector<RayPixel> full, resumed;
+	orkvector<u8> computedfull, computedresumed;
+	int inumcalls1 = 0, inumcalls2 = 0;
+
+	TileBake( 2, false, 0.0001f, outname, full, inumcalls1, &computedfull );
+
+	//////////////////////////////////////
+	// header (magic kind w h tilesize numtiles), done flags, pixels
+	//////////////////////////////////////
+
+	FILE* fprog = fopen( progname.c_str(), "r+b" );
+	CHECK( fprog!=nullptr );
+	if( nullptr==fprog )
+		return;
+	u32 hdr[6];
+	bool bok = (1==fread( hdr, sizeof(hdr), 1, fprog ));
+	const int iw = int(hdr[2]), ih = int(hdr[3]);
+	const int itilesize = int(hdr[4]);
+	const int inumtiles = int(hdr[5]);
+	const int inumtx = (iw+itilesize-1)/itilesize;
+	orkvector<u8> done( inumtiles );
+	orkvector<RayPixel> pixels( iw*ih );
+	bok = bok && (size_t(inumtiles)==fread( done.data(), 1, inumtiles, fprog ));
+	bok = bok && (pixels.size()==fread( pixels.data(), sizeof(RayPixel), pixels.size(), fprog ));
+	CHECK( bok );
+
+	auto tile_of = [&]( int ipix ) -> int
+	{
+		return ((ipix/iw)/itilesize)*inumtx + (ipix%iw)/itilesize;
+	};
+
+	int inumundone = 0;
+	for( int it=0; it<inumtiles; it+=2 )
+	{
+		inumundone += int(done[it]!=0);
+		done[it] = 0;
+	}
+	for( int ipix=0; ipix<iw*ih; ipix++ )
+		if( 0==done[tile_of(ipix)] )
+			memset( (void*) & pixels[ipix], 0, sizeof(RayPixel) );
+
+	fseek( fprog, sizeof(hdr), SEEK_SET );
+	bok = bok && (size_t(inumtiles)==fwrite( done.data(), 1, inumtiles, fprog ));
+	bok = bok && (pixels.size()==fwrite( pixels.data(), sizeof(RayPixel), pixels.size(), fprog ));
+	fclose( fprog );
+	CHECK( bok );
+
+	TileBake( 2, true, 0.0f, outname, resumed, inumcalls2, &computedresumed );
+
+	//////////////////////////////////////
+	// only (and all of) the undone tiles' pixels were computed again,
+	//  as often as in the full bake
+	//////////////////////////////////////
+
+	int inumexpected = 0, inumoutside = 0;
+	for( int ipix=0; ipix<iw*ih; ipix++ )
+	{
+		bool bundone = (0==done[tile_of(ipix)]);
+		inumexpected += bundone ? int(computedfull[ipix]) : 0;
+		inumoutside += int( (false==bundone) && computedresumed[ipix] );
+	}
+
+	CHECK_EQUAL( inumtiles/2, inumundone );
+	CHECK( inumcalls2>0 );
+	CHECK( inumcalls2<inumcalls1 );
+	CHECK_EQUAL( inumexpected, inumcalls2 );
+	CHECK_EQUAL( 0, inumoutside );
+	CHECK_EQUAL( 0, CountMismatches(full,resumed) );
+
+	remove( progname.c_str() );
+	remove( ppmname.c_str() );
+}
@@ -9,6 +9,11 @@
 #include <ork/kernel/svariant.h>
 #include <ork/kernel/timer.h>
 #include <ork/kernel/fixedstring.h>
+#include <ork/kernel/concurrent_queue.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
 
 using namespace ork;
 
@@ -133,3 +138,85 @@ TEST(OrkMpMcRingBuf)
 }
 
 ///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// producer to (blocked) consumer handoff latency, per wait policy
+///////////////////////////////////////////////////////////////////////////////
+
+static int64_t handoff_nanos()
+{
+	auto t = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+}
+
+template <typename queue_type> struct handoff_latency
+{
+	static const int knumsamples = 2000;
+	static const int knumbuckets = 24; // log2(nanosec)
+
+	queue_type mQueue;
+
+	int Run(const char* policy_name)
+	{
+		std::vector<int64_t> latencies;
+		latencies.reserve(knumsamples);
+		int histogram[knumbuckets] = {0};
+
+		std::thread consumer([&]()
+		{
+			for( int i=0; i<knumsamples; i++ )
+			{
+				int64_t stamp = 0;
+				mQueue.pop(stamp); // blocking
+				int64_t lat = handoff_nanos()-stamp;
+				latencies.push_back(lat);
+				int ib = 0;
+				while( (ib<knumbuckets-1) && (int64_t(2)<<ib)<=lat ) ib++;
+				histogram[ib]++;
+			}
+		});
+
+		for( int i=0; i<knumsamples; i++ )
+		{
+			usleep(100+(i%5)*50); // let the consumer go idle
+			mQueue.push(handoff_nanos());
+		}
+		consumer.join();
+
+		std::sort(latencies.begin(),latencies.end());
+		int64_t p50 = latencies[latencies.size()/2];
+		int64_t p99 = latencies[(latencies.size()*99)/100];
+		int64_t pmax = latencies.back();
+
+		printf( "handoff latency policy<%s> samples<%d> p50<%dus> p99<%dus> max<%dus>\n",
+				policy_name, int(latencies.size()), int(p50/1000), int(p99/1000), int(pmax/1000) );
+
+		for( int ib=0; ib<knumbuckets; ib++ )
+		{
+			if( histogram[ib]==0 ) continue;
+			double lo = double(int64_t(1)<<ib)/1000.0;
+			double hi = double(int64_t(2)<<ib)/1000.0;
+			printf( "  [%9.1fus .. %9.1fus) %6d ", lo, hi, histogram[ib] );
+			for( int j=0; j<(histogram[ib]*60)/knumsamples; j++ ) printf( "#" );
+			printf( "\n" );
+		}
+		return int(latencies.size());
+	}
+};
+
+TEST(OrkMpMcHandoffLatency)
+{
+	typedef ork::MpMcBoundedQueue<int64_t,256,ork::MpMcSleepWait> sleep_q_t;
+	typedef ork::MpMcBoundedQueue<int64_t,256,ork::MpMcAdaptiveWait> adaptive_q_t;
+
+	auto sleepq = new handoff_latency<sleep_q_t>;
+	auto adaptq = new handoff_latency<adaptive_q_t>;
+
+	CHECK_EQUAL(handoff_latency<sleep_q_t>::knumsamples,sleepq->Run("sleep"));
+	CHECK_EQUAL(handoff_latency<adaptive_q_t>::knumsamples,adaptq->Run("adaptive"));
+
+	delete sleepq;
+	delete adaptq;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,189 @@
+#include <ork/pch.h>
+
+#include <unittest++/UnitTest++.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+#include <ork/kernel/string/StringPool.h>
+#include <ork/kernel/timer.h>
+
+using namespace ork;
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(StringPoolIntern)
+{
+	StringPool pool;
+
+	PoolString a = pool.String( "Position" );
+	PoolString b = pool.String( PieceString("Position.x",8) );
+	CHECK( a );
+	CHECK( a==b );
+	CHECK( a.c_str()==b.c_str() );
+	CHECK_EQUAL( 8, int(a.length()) );
+	CHECK_EQUAL( PoolStringHash("Position",8), a.hash() );
+	CHECK_EQUAL( 0, strcmp( a.c_str(), "Position" ) );
+
+	CHECK( pool.Find( "Position" )==a );
+	CHECK( false==bool(pool.Find( "Rotation" )) );
+	CHECK( false==bool(PoolString()) );
+	CHECK_EQUAL( 1, pool.Size() );
+
+	// literals keep the callers pointer
+	static const char kliteral[] = "data://tex/checker";
+	PoolString l = pool.Literal( kliteral );
+	CHECK( l.c_str()==kliteral );
+	CHECK( pool.String( "data://tex/checker" )==l );
+
+	PoolString e = pool.String( "" );
+	CHECK( e && e.empty() );
+	CHECK( e!=PoolString() );
+
+	// children see, but do not duplicate, their parents strings
+	StringPool child( & pool );
+	CHECK( child.String( "Position" )==a );
+	CHECK_EQUAL( 0, child.Size() );
+	CHECK( child.String( "Scale" )!=a );
+	CHECK( false==bool(pool.Find( "Scale" )) );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(StringPoolGrow)
+{
+	StringPool pool;
+	const int knumstrings = 20000;
+	char name[64];
+
+	orkvector<PoolString> strings;
+	for( int i=0; i<knumstrings; i++ )
+	{
+		snprintf( name, sizeof(name), "ent%d/comp/prop", i );
+		strings.push_back( pool.String( name ) );
+	}
+	CHECK_EQUAL( knumstrings, pool.Size() );
+
+	bool ballfound = true;
+	for( int i=0; i<knumstrings; i++ )
+	{
+		snprintf( name, sizeof(name), "ent%d/comp/prop", i );
+		ballfound &= (pool.Find( name )==strings[i]);
+		ballfound &= (0==strcmp( strings[i].c_str(), name ));
+	}
+	CHECK( ballfound );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// many threads interning a mostly pooled corpus (property, plug and asset
+//  names), against the previous single sorted vector behind one lock
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct LockedSortedPool
+{
+	~LockedSortedPool()
+	{
+		for( int i=0; i<mPool.Size(); i++ )
+			delete[] mPool.FromIndex(i);
+	}
+	size_t String( const PieceString& str )
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		int index = mPool.FindIndex( str );
+		if( index >= 0 )
+			return strlen( mPool.FromIndex(index) );
+		char* copy = new char[str.length()+1];
+		memcpy( copy, str.data(), str.length() );
+		copy[str.length()] = '\0';
+		mPool.Literal( copy );
+		return str.length();
+	}
+	std::mutex mMutex;
+	IndexedStringPool mPool;
+};
+
+struct StringPoolCorpus
+{
+	StringPoolCorpus()
+	{
+		static const char* kprefixes[] = { "Position", "Rotation", "Scale", "Color", "Texture", "Input", "Output", "Mute" };
+		static const char* kdirs[] = { "data://tex/", "data://mesh/", "data://anim/", "data://fx/" };
+		char name[128];
+		for( int i=0; i<1024; i++ )
+		{
+			switch( i%3 )
+			{
+				case 0: snprintf( name, sizeof(name), "%s%d", kprefixes[i%8], i ); break;
+				case 1: snprintf( name, sizeof(name), "plg_%s_%d", kprefixes[(i/3)%8], i ); break;
+				case 2: snprintf( name, sizeof(name), "%sasset_%04d", kdirs[i%4], i ); break;
+			}
+			mNames.push_back( name );
+		}
+	}
+	orkvector<std::string> mNames;
+};
+
+}
+
+template <typename Fn> static double StringPoolBenchRun( int inumthreads, int inumops, Fn fn )
+{
+	orkvector<std::thread> threads;
+	float ft0 = get_sync_time();
+	for( int it=0; it<inumthreads; it++ )
+		threads.push_back( std::thread( [=]() { fn( it, inumops ); } ) );
+	for( auto& t : threads )
+		t.join();
+	float ft1 = get_sync_time();
+	return double(inumthreads*inumops) / std::max( double(ft1-ft0), 1.0e-6 );
+}
+
+TEST(StringPoolContentionBench)
+{
+	static const StringPoolCorpus corpus;
+	const int knumnames = int(corpus.mNames.size());
+	const int knumops = 200000;
+
+	for( int inumthreads=1; inumthreads<=8; inumthreads*=2 )
+	{
+		StringPool sharded;
+		LockedSortedPool locked;
+		ork::atomic<int> imismatch;
+		imismatch.store(0);
+
+		// 1 in 16 ops adds a string unique to its thread, the rest hit the corpus
+		auto make_op = [&]( auto&& intern )
+		{
+			return [&,intern]( int ithread, int inumops )
+			{
+				char name[64];
+				int icorpus = ithread*131;
+				for( int i=0; i<inumops; i++ )
+				{
+					if( 0==(i&15) )
+					{
+						snprintf( name, sizeof(name), "tmp_%d_%d", ithread, i );
+						if( intern( PieceString(name) )!=strlen(name) )
+							imismatch.fetch_add(1);
+					}
+					else
+					{
+						const std::string& str = corpus.mNames[(icorpus++ * 7)%knumnames];
+						if( intern( PieceString(str.c_str(),str.length()) )!=str.length() )
+							imismatch.fetch_add(1);
+					}
+				}
+			};
+		};
+
+		double fsharded = StringPoolBenchRun( inumthreads, knumops, make_op( [&]( const PieceString& s ) { return sharded.String(s).length(); } ) );
+		double flocked = StringPoolBenchRun( inumthreads, knumops, make_op( [&]( const PieceString& s ) { return locked.String(s); } ) );
+
+		printf( "StringPoolContentionBench threads<%d> sharded<%f Mops/s> locked sorted<%f Mops/s>\n",
+				inumthreads, fsharded*1.0e-6, flocked*1.0e-6 );
+
+		CHECK_EQUAL( 0, imismatch.load() );
+		CHECK_EQUAL( knumnames + inumthreads*(knumops/16), sharded.Size() );
+	}
+}
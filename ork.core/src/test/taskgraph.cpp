@@ -0,0 +1,220 @@
+#include <unittest++/UnitTest++.h>
+#include <string.h>
+#include <vector>
+
+#include <ork/kernel/timer.h>
+#include <ork/kernel/opq.h>
+#include <ork/kernel/taskgraph.h>
+
+using namespace ork;
+
+///////////////////////////////////////////////////////////////////////////////
+// (a,b) -> parallel_for -> d, relaunched, checking order via stamps
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(taskgraph_deps)
+{
+    const int knumitems = 10000;
+    const int knumlaunches = 100;
+
+    for( int imode=0; imode<2; imode++ )
+    {
+        EOpqMode emode = imode ? EOPQMODE_WORKSTEALING : EOPQMODE_SHARED;
+        auto popq = new Opq(4,"tgq",emode);
+
+        ork::atomic<int> stamp;
+        int stamp_a = 0, stamp_b = 0, stamp_d = 0;
+        ork::atomic<int> min_for_stamp, max_for_stamp;
+        std::vector<int> items(knumitems);
+        bool done_cb = false;
+
+        TaskGraph tg;
+        Task* a = tg.CreateTask([&](){ stamp_a = ++stamp; },"a");
+        Task* b = tg.CreateTask([&](){ stamp_b = ++stamp; },"b");
+        Task* c = tg.ParallelFor(0,knumitems,256,[&](int ib,int ie)
+        {
+            int s = ++stamp;
+            for( int i=ib; i<ie; i++ )
+                items[i]++;
+            int imin = min_for_stamp.load();
+            while( s<imin && false==min_for_stamp.compare_exchange_weak(imin,s) ) {}
+            int imax = max_for_stamp.load();
+            while( s>imax && false==max_for_stamp.compare_exchange_weak(imax,s) ) {}
+        },"c");
+        tg.Precede(a,c);
+        tg.Precede(b,c);
+        tg.Continue(c,[&](){ stamp_d = ++stamp; },"d");
+        tg.SetOnComplete([&](){ done_cb = true; });
+
+        bool bok = true;
+        for( int l=0; l<knumlaunches; l++ )
+        {
+            stamp = 0;
+            min_for_stamp = 1<<30;
+            max_for_stamp = 0;
+            done_cb = false;
+            tg.Launch(*popq);
+            tg.Wait();
+            bok &= tg.IsComplete() && done_cb;
+            bok &= (stamp_a<min_for_stamp) && (stamp_b<min_for_stamp);
+            bok &= (stamp_d>max_for_stamp) && (stamp_d==int(stamp));
+        }
+        CHECK(bok);
+
+        int nbad = 0;
+        for( int v : items )
+            nbad += (v!=knumlaunches);
+        CHECK_EQUAL(0,nbad);
+
+        delete popq;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// free parallel_for on a queue without threads (the caller does all work)
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(taskgraph_parallel_for)
+{
+    const int knumitems = 1<<16;
+    std::vector<int> items(knumitems);
+    for( int i=0; i<knumitems; i++ )
+        items[i] = i;
+
+    ork::atomic<int64_t> sum;
+    auto summer = [&](int ib,int ie)
+    {
+        int64_t s = 0;
+        for( int i=ib; i<ie; i++ )
+            s += items[i];
+        sum += s;
+    };
+    const int64_t kexpected = (int64_t(knumitems)*int64_t(knumitems-1))/2;
+
+    Opq localq(0,"tgq0");
+    OpqTest ot(&localq);
+    sum = 0;
+    parallel_for(localq,0,knumitems,1000,summer);
+    CHECK_EQUAL(kexpected,int64_t(sum));
+
+    auto popq = new Opq(4,"tgq4",EOPQMODE_WORKSTEALING);
+    sum = 0;
+    parallel_for(*popq,0,knumitems,1000,summer);
+    CHECK_EQUAL(kexpected,int64_t(sum));
+
+    sum = 0;
+    parallel_for(*popq,0,0,1000,summer); // empty range
+    parallel_for(*popq,5,6,1000,summer); // below grain, inline
+    CHECK_EQUAL(int64_t(5),int64_t(sum));
+    delete popq;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Wait() only runs its own graph's tasks, and a graph with more ready
+//  tasks than the opq's queue holds runs the overflow inline
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(taskgraph_wait_own_tasks)
+{
+    const int knumtasks = 10000; // more than an OpGroup queue holds
+
+    Opq localq(0,"tgq0");
+    OpqTest ot(&localq);
+
+    bool foreign_ran = false;
+    localq.push([&](){ foreign_ran = true; },"foreign");
+
+    ork::atomic<int> count;
+    count = 0;
+    TaskGraph tg;
+    for( int i=0; i<knumtasks; i++ )
+        tg.CreateTask([&](){ count++; },"t");
+    tg.Launch(localq);
+    tg.Wait();
+
+    CHECK(tg.IsComplete());
+    CHECK_EQUAL(knumtasks,int(count));
+    CHECK(false==foreign_ran);
+
+    while( localq.Process() ) {} // leftover ops find nothing to run
+    CHECK(foreign_ran);
+    CHECK_EQUAL(knumtasks,int(count));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// frame of 3 stages x 8 jobs : drain() barriers vs task graph
+//  (graph lets stage 2 of a job start as soon as its own stage 1 is done)
+///////////////////////////////////////////////////////////////////////////////
+
+static void taskgraph_busywork(int iters, ork::atomic<int>& sink)
+{
+    volatile int acc = 0;
+    for( int i=0; i<iters; i++ )
+        acc = acc*1664525+1013904223;
+    sink++;
+}
+
+TEST(taskgraph_pipeline_bench)
+{
+    const int knumframes = 200;
+    const int knumjobs = 8;
+    const int knumstages = 3;
+    const int kwork = 20000;
+
+    auto popq = new Opq(4,"tgbench",EOPQMODE_WORKSTEALING);
+    ork::atomic<int> sink;
+    sink = 0;
+
+    ////////////////////////////
+    // barriers
+    ////////////////////////////
+
+    float ft0 = ork::get_sync_time();
+    for( int f=0; f<knumframes; f++ )
+    {
+        for( int s=0; s<knumstages; s++ )
+        {
+            for( int j=0; j<knumjobs; j++ )
+            {
+                int iw = kwork*(1+((j+s)&3)); // uneven jobs
+                popq->push([&sink,iw](){ taskgraph_busywork(iw,sink); },"stage");
+            }
+            popq->drain();
+        }
+    }
+    float ft1 = ork::get_sync_time();
+
+    ////////////////////////////
+    // task graph, built once
+    ////////////////////////////
+
+    TaskGraph tg;
+    for( int j=0; j<knumjobs; j++ )
+    {
+        Task* prev = nullptr;
+        for( int s=0; s<knumstages; s++ )
+        {
+            int iw = kwork*(1+((j+s)&3));
+            Task* t = tg.CreateTask([&sink,iw](){ taskgraph_busywork(iw,sink); },"stage");
+            if( prev )
+                tg.Precede(prev,t);
+            prev = t;
+        }
+    }
+    float ft2 = ork::get_sync_time();
+    for( int f=0; f<knumframes; f++ )
+    {
+        tg.Launch(*popq);
+        tg.Wait();
+    }
+    float ft3 = ork::get_sync_time();
+
+    CHECK_EQUAL(2*knumframes*knumjobs*knumstages,int(sink));
+
+    printf( "taskgraph_pipeline_bench frames<%d> barriers<%g ms/frame> taskgraph<%g ms/frame>\n",
+            knumframes,
+            1000.0f*(ft1-ft0)/float(knumframes),
+            1000.0f*(ft3-ft2)/float(knumframes) );
+
+    delete popq;
+}
@@ -41,6 +41,8 @@ private:
 typedef ork::FixedString<65536> script_text_t;
 typedef ork::FixedString<256> script_funcname_t;
 
+struct ScriptComponentInst;
+
 struct ScriptObject
 {
 	ScriptObject();
@@ -51,8 +53,15 @@ struct ScriptObject
 	int mOnEntStart;
 	int mOnEntStop;
 	int mOnEntUpdate;
+	int mOnEntUpdateBatch; // LUA_NOREF unless the module has OnEntityUpdateBatch
     int mModTabRef;
 	int mScriptRef;
+
+	LuaSystem* mLuaSystem; // the module and its entity tables live in this state
+	int miLuaState;
+	std::vector<ScriptComponentInst*> mInstances; // started, in start order
+	int mEntTabsRef; // their entity tables, as a lua array
+	bool mbEntTabsDirty;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -61,6 +70,7 @@ struct ScriptComponentInst : public ent::ComponentInst
 {
 	ScriptComponentInst( const ScriptComponentData& cd, ork::ent::Entity* pent );
 	const ScriptComponentData&	GetCD() const { return mCD; }
+	const LuaRef& GetEntTable() const { return mEntTable; }
 
 private:
 
@@ -89,9 +99,16 @@ public:
 	ScriptManagerComponentData();
 	///////////////////////////////////////////////////////
 
+	bool IsBatchedUpdate() const { return mbBatchedUpdate; }
+	int GetNumWorkerStates() const { return miNumWorkerStates; }
+	void SetBatchedUpdate( bool bv ) { mbBatchedUpdate=bv; }
+	void SetNumWorkerStates( int inum ) { miNumWorkerStates=inum; }
+
 private:
     ork::ent::System* createSystem(ork::ent::SceneInst *pinst) const final;
 
+	bool mbBatchedUpdate;
+	int miNumWorkerStates;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -108,6 +125,13 @@ public:
 
 	ScriptObject* FlyweightScriptObject( const ork::file::Path& key );
 
+	bool IsBatchedUpdate() const { return mSMCD.IsBatchedUpdate(); }
+	void OnScriptStart( ScriptComponentInst* sci, ScriptObject* so );
+	void OnScriptStop( ScriptComponentInst* sci, ScriptObject* so );
+	// batched, every script is updated from the first started script component
+	bool IsBatchLeader( const ScriptComponentInst* sci ) const { return sci==mBatchLeader; }
+	void UpdateBatches( SceneInst* psi );
+
 private:
 
     ~ScriptManagerComponentInst() final;
@@ -118,7 +142,14 @@ private:
 	void DoStart(SceneInst *psi) final;
 	void DoStop(SceneInst *inst) final;
 
+	void InitLuaState( LuaSystem* luasys );
+	void UpdateBatch( ScriptObject* so, double dt );
+
+	const ScriptManagerComponentData& mSMCD;
 	anyp mLuaManager;
+	std::vector<LuaSystem*> mLuaStates; // [0] is mLuaManager's, the others run on workers
+	std::vector<int> mBatchDriverRefs; // per state
+	ScriptComponentInst* mBatchLeader;
 	std::string mScriptText;
 	std::map<ork::file::Path,ScriptObject*> mScriptObjects;
 	int mScriptRef;
@@ -8,9 +8,53 @@
 #pragma once
 
 #include <ork/kernel/tempstring.h>
+#include <ork/kernel/string/PoolString.h>
 
 namespace ork { namespace ent {
 
 typedef Char8 ComponentName;
 
+///////////////////////////////////////////////////////////////////////////////
+// what the components of a family touch in DoUpdate
+//
+//  SceneInst::Update runs the families whose accesses do not conflict at the
+//   same time on ConcurrentOpQ, and families which conflict in update order.
+//  a described family must not spawn, activate or deactivate entities, notify
+//   other entities or touch anything not covered by its bits.
+//  families never described touch everything and update on UpdateSerialOpQ
+//   in order, the way every family always did.
+///////////////////////////////////////////////////////////////////////////////
+
+enum EFamilyAccess
+{
+	EFA_INPUT		= 1<<0,		// input devices
+	EFA_XFORM		= 1<<1,		// entity transforms (DagNode)
+	EFA_PHYSICS		= 1<<2,		// physics world and bodies
+	EFA_POSE		= 1<<3,		// model poses (SceneInst::GetPoseBuildBatch)
+	EFA_PARTICLES	= 1<<4,		// particle systems (SceneInst::GetParticleUpdateBatch)
+	EFA_LIGHTS		= 1<<5,
+	EFA_AUDIO		= 1<<6,
+	EFA_CAMERAS		= 1<<7,
+	EFA_USER		= 1<<16,	// first bit free for applications
+	EFA_ALL			= 0xffffffff,
+};
+
+struct ComponentFamilyAccess
+{
+	uint32_t	muReads;
+	uint32_t	muWrites;
+	bool		mbConcurrent;	// the family's components may update at the same time as each other
+	bool		mbDescribed;
+
+	ComponentFamilyAccess() : muReads(EFA_ALL), muWrites(EFA_ALL), mbConcurrent(false), mbDescribed(false) {}
+
+	bool ConflictsWith( const ComponentFamilyAccess& oth ) const
+	{
+		return (muWrites&(oth.muReads|oth.muWrites)) || (oth.muWrites&muReads);
+	}
+};
+
+void DescribeFamily( PoolString family, uint32_t ureads, uint32_t uwrites, bool bconcurrent );
+ComponentFamilyAccess GetFamilyAccess( PoolString family );
+
 } } // namespace ork::ent
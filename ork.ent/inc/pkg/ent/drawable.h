@@ -43,6 +43,7 @@ namespace lev2 { class GfxMaterialFxEffectInstance; }
 namespace ent {
 
 class SceneInst;
+class Drawable;
 class DrawableBuffer;
 
 ///////////////////////////////////////////////////////////////////////////
@@ -97,18 +98,96 @@ struct Layer
 
 ///////////////////////////////////////////////////////////////////////////
 
+struct DrawableBufChunk
+{
+	static const int kmaxitems = 256;
+	DrawableBufItem				mItems[kmaxitems];
+	int							miNumItems;
+	DrawableBufChunk*			mNextOverflow;	// DrawableBufArena::Alloc past its chunks
+}; // ~ 36K
+
+///////////////////////////////////////////////////////////////////////////
+// chunks for the layers of one DrawableBuffer, reused frame after frame.
+//  Alloc is lock free, past the chunks it has it allocates new ones which
+//  it keeps from the next Reset on.
+///////////////////////////////////////////////////////////////////////////
+
+class DrawableBufArena
+{
+public:
+
+	DrawableBufArena();
+	~DrawableBufArena();
+
+	DrawableBufChunk* Alloc();	// any thread
+	void Reset();				// no Alloc in flight, every chunk is free again
+
+	int GetNumChunks() const { return int(mChunks.size()); }
+
+private:
+
+	orkvector<DrawableBufChunk*>		mChunks;
+	ork::atomic<int>					miNextChunk;
+	ork::atomic<DrawableBufChunk*>		mOverflow;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// one writer at a time, layers of a DrawableBufWriter are appended to
+//  the buffer's at UnLockWriteBuffer
+///////////////////////////////////////////////////////////////////////////
+
 struct DrawableBufLayer
 {
-	static const int kmaxitems = 4096;
-	DrawableBufItem				mDrawBufItems[kmaxitems];
-	int							miItemIndex;
-	int							miBufferIndex;
+	orkvector<DrawableBufChunk*>	mChunks;
+	int								miItemIndex;	// last item, -1 when empty
+	int								miBufferIndex;
+	DrawableBufArena*				mArena;
+
 	bool HasData() const { return (miItemIndex!=-1); }
-	void Reset(const DrawableBuffer& dB);
+	int GetNumItems() const { return miItemIndex+1; }
+	void Reset(DrawableBuffer& dB);
 	DrawableBufItem& Queue(const DrawQueueXfData& xfdata,const Drawable*d);
-	
+	void Append( DrawableBufLayer& src ); // takes src's items (after ours), src ends up empty
+
+	template <typename L> void ForEachItem( L&& l ) const
+	{
+		for( size_t ic=0; ic<mChunks.size(); ic++ )
+		{
+			const DrawableBufChunk* pchunk = mChunks[ic];
+			for( int i=0; i<pchunk->miNumItems; i++ )
+				l( pchunk->mItems[i] );
+		}
+	}
+
 	DrawableBufLayer();
-}; // ~ 100K
+};
+
+///////////////////////////////////////////////////////////////////////////
+// queues into a DrawableBuffer from another thread than the one holding
+//  it. each concurrent task has its own writer (DrawableBuffer::GetWriter),
+//  what it queued is merged in writer order at UnLockWriteBuffer.
+///////////////////////////////////////////////////////////////////////////
+
+class DrawableBufWriter
+{
+public:
+
+	static const int kmaxlayers = 8;
+
+	DrawableBufWriter();
+
+	DrawableBufLayer* MergeLayer( const PoolString& layername );
+
+private:
+
+	friend class DrawableBuffer;
+
+	void Reset(DrawableBuffer& dB);
+
+	DrawableBufLayer								mRawLayers[kmaxlayers];
+	ork::fixedlut<PoolString,DrawableBufLayer*,kmaxlayers>	mLayerLut;
+	int												miNumLayersUsed;
+};
 
 ///////////////////////////////////////////////////////////////////////////
 
@@ -127,8 +206,11 @@ public:
 	typedef ork::fixedlut<PoolString,DrawableBufLayer*,kmaxlayers>	LayerLut;
 
 	CameraLut										mCameraDataLUT;
+	DrawableBufArena								mArena;
 	DrawableBufLayer								mRawLayers[kmaxlayers];
 	int												miNumLayersUsed;
+	orkvector<DrawableBufWriter*>					mWriters;
+	int												miNumWritersUsed;
 	LayerLut										mLayerLut;
 	int												miBufferIndex;
 	int												miReadCount;
@@ -162,7 +244,13 @@ public:
 
 	DrawableBufLayer* MergeLayer( const PoolString& layername );
 
-}; // ~1MiB
+	// writers for concurrent queueing, made on the write buffer's thread
+	//  (before the tasks using them start), merged at UnLockWriteBuffer
+	void ReserveWriters( int inumwriters );
+	DrawableBufWriter& GetWriter( int iwriter ) { return *mWriters[iwriter]; }
+	void MergeWriters();
+
+}; // ~ 13K, the items live in mArena
 
 
 class Drawable : public ork::Object
@@ -175,7 +263,10 @@ public:
 	virtual ~Drawable();
 
 	virtual void QueueToRenderer(const DrawableBufItem& item, lev2::Renderer* prenderer) const = 0; // 	AssertOnOpQ2( MainThreadOpQ() );
-	virtual void QueueToLayer(const DrawQueueXfData& xfdata, DrawableBufLayer&buffer) const = 0;  // AssertOnOpQ2( UpdateSerialOpQ() );
+	virtual void QueueToLayer(const DrawQueueXfData& xfdata, DrawableBufLayer&buffer) const = 0;  // update thread, or a worker through a DrawableBufWriter
+
+	// bounding sphere in entity space, false if unknown (never culled)
+	virtual bool GetBoundingSphere( CVector3& ctr, float& frad ) const { return false; }
 
 	const ork::Object* GetOwner() const { return mOwner; }
 	void SetOwner( const ork::Object* owner ) { mOwner=owner; }
@@ -225,14 +316,14 @@ public:
 
 	void SetModelInst(lev2::XgmModelInst* pModelInst);// { mModelInst = pModelInst; }
 	lev2::XgmModelInst* GetModelInst() const { return mModelInst; }
-	void SetScale( float fscale ) { mfScale=fscale; }
+	void SetScale( float fscale );
 	float GetScale() const { return mfScale; }
 
 	const CVector3& GetRotate() const { return mRotate; }
 	const CVector3& GetOffset() const { return mOffset; }
 
 	void SetRotate( const CVector3& v ) { mRotate=v; }
-	void SetOffset( const CVector3& v ) { mOffset=v; }
+	void SetOffset( const CVector3& v );
 
 	void SetEngineParamFloat(int idx, float fv);
 	float GetEngineParamFloat(int idx) const;
@@ -243,8 +334,9 @@ private:
 	
 	void QueueToRenderer(const DrawableBufItem& item, lev2::Renderer* renderer) const override;	
 	void QueueToLayer(const DrawQueueXfData& xfdata, DrawableBufLayer&buffer) const override;
-	
+	bool GetBoundingSphere( CVector3& ctr, float& frad ) const override;
 
+	Entity*				mEntity;
 	lev2::XgmModelInst*	mModelInst;
 	lev2::XgmWorldPose*	mpWorldPose;
 	float				mfScale;
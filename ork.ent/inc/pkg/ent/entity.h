@@ -12,6 +12,7 @@
 #include <pkg/ent/component.h>
 #include <pkg/ent/componenttable.h>
 #include <ork/math/TransformNode.h>
+#include <ork/kernel/handletable.h>
 
 #include <ork/kernel/string/ArrayString.h>
 
@@ -228,11 +229,25 @@ public:
 	const DagNode& GetDagNode() const { return mDagNode; }
 	DagNode& GetDagNode() { return mDagNode; }
 
+	const Transform3DMatrix& GetEffectiveTransform() const; // the transform GetEffectiveMatrix reads
 	CMatrix4 GetEffectiveMatrix() const; // get Entity matrix if scene is running, EntData matrix if scene is stopped
 	void SetDynMatrix( const CMatrix4& mtx ); // set this (Entity) matrix
 
 	void AddDrawable( const PoolString& layername, Drawable* pdrw );// { mDrawable.push_back(pdrw); }
 
+	////////////////////////////////////////////////////////////////
+	// bounds (for culling)
+
+	bool GetBoundingSphere( CVector3& ctr, float& frad ) const; // world space around all drawables, false if any is unknown
+	void InvalidateBounds() { mBoundsVersion++; } // a drawable's bounds changed
+	uint32_t GetBoundsVersion() const { return mBoundsVersion; }
+
+	////////////////////////////////////////////////////////////////
+	// slot in the SceneInst entity table (SceneInst::GetEntity(TableHandle))
+
+	TableHandle GetHandle() const { return mHandle; }
+	void SetHandle( TableHandle h ) { mHandle = h; }
+
 	DrawableVector* GetDrawables( const PoolString& layer );
 	const DrawableVector* GetDrawables( const PoolString& layer ) const;
 
@@ -268,6 +283,8 @@ private:
 	//DrawableVector							mDrawable; //e Will this go away?  Could go into a component query at activate
 	LayerMap								mLayerMap;
 	DagNode									mDagNode;
+	uint32_t								mBoundsVersion;
+	TableHandle								mHandle;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////
+// Orkid Media Engine
+// Copyright 1996-2012, Michael T. Mayers.
+// Distributed under the Boost Software License - Version 1.0 - August 17, 2003
+// see http://www.boost.org/LICENSE_1_0.txt
+////////////////////////////////////////////////////////////////
+
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////
+
+#include <ork/orkstl.h>
+#include <pkg/ent/componentfamily.h>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace ork {
+
+struct TaskGraph;
+
+namespace ent {
+
+class SceneInst;
+class ComponentInst;
+
+///////////////////////////////////////////////////////////////////////////////
+// a family's last update (SceneInst::GetFamilyTimings)
+///////////////////////////////////////////////////////////////////////////////
+
+struct FamilyTiming
+{
+	PoolString	mFamily;
+	int			miNumComponents;
+	float		mfTime;			// seconds, from its first component starting to its last one done
+	bool		mbConcurrent;	// on ConcurrentOpQ, else inline on UpdateSerialOpQ
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// FamilyUpdateSchedule : how SceneInst::Update runs its component families
+//
+//  the families with active components are split into segments, in update
+//   order. an undescribed family (GetFamilyAccess) is a segment of its own
+//   and is updated inline, a run of described families is one TaskGraph in
+//   which each family waits for the earlier ones it conflicts with, and a
+//   concurrent family's components are updated in parallel chunks.
+//  a run in which nothing can overlap (one family after the other, no
+//   concurrent family with more than a chunk) is updated inline instead,
+//   a graph would only add its launch and wait to the update.
+//  rebuilt after the active components changed (Invalidate), otherwise the
+//   same graphs are launched again every update.
+///////////////////////////////////////////////////////////////////////////////
+
+class FamilyUpdateSchedule
+{
+public:
+
+	FamilyUpdateSchedule();
+	~FamilyUpdateSchedule();
+
+	void SetFamilies( const PoolString* families, int inumfamilies ); // in update order
+	void Invalidate() { mbDirty = true; }
+	void Run( SceneInst* psi ); // on UpdateSerialOpQ
+
+	const orkvector<FamilyTiming>& GetTimings() const { return mTimings; } // last Run
+
+	// what a build does with the accesses and component counts of the families
+	//  which have components : segstarts[s] is the first family of segment s,
+	//  seggraph[s] tells if it runs as a graph (else it is one inline family),
+	//  preds[i] lists the families family i waits for (all in its segment).
+	//  exposed for tests
+	static void Plan( const ComponentFamilyAccess* access, const int* numcomps, int inum,
+					  orkvector<int>& segstarts, orkvector<bool>& seggraph,
+					  orkvector<orkvector<int>>& preds );
+
+	static const int kgrain = 32; // components per chunk of a concurrent family
+
+private:
+
+	struct Family
+	{
+		PoolString					mName;
+		int							miOrder;		// into mOrder
+		ComponentFamilyAccess		mAccess;
+		orkvector<ComponentInst*>	mComponents;	// graph families only
+		float						mfStart;
+		float						mfTime;
+	};
+
+	struct Segment
+	{
+		int				miFirst;	// into mFamilies
+		int				miCount;
+		TaskGraph*		mGraph;		// null for an inline family
+	};
+
+	void Build( SceneInst* psi, int ifirstorder );
+	void Clear();
+
+	orkvector<PoolString>		mOrder;
+	orkvector<Family>			mFamilies;
+	orkvector<Segment>			mSegments;
+	orkvector<FamilyTiming>		mTimings;
+	bool						mbDirty;
+	bool						mbPartial;	// built from the middle of a Run
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+}}
@@ -18,6 +18,7 @@
 #include <ork/event/Event.h>
 #include <ork/kernel/any.h>
 #include <ork/kernel/future.hpp>
+#include <ork/kernel/handletable.h>
 #include <ork/math/cmatrix4.h>
 #include <ork/file/path.h>
 
@@ -32,9 +33,16 @@ namespace lev2 { class XgmModel; }
 namespace lev2 { class XgmModelInst; }
 namespace lev2 { class Renderer; }
 namespace lev2 { class LightManager; }
+namespace lev2 { namespace particle { class SystemUpdateBatch; } }
+namespace lev2 { class XgmPoseBatch; }
 
 namespace ent {
 
+class SceneCullIndex;
+struct CullStats;
+class FamilyUpdateSchedule;
+struct FamilyTiming;
+
 ///////////////////////////////////////////////////////////////////////////////
 
 enum EUpdateState
@@ -235,10 +243,11 @@ class SceneInst : public ork::Object
 
 public:
 
-	typedef orkmap<PoolString, orklist<ComponentInst*> > ActiveComponentType;
+	typedef orkvector<ComponentInst*> ComponentList; // per family, in activation order
+	typedef orkmap<PoolString, ComponentList > ActiveComponentType;
 	typedef orklut<const ork::object::ObjectClass*,System*> SystemLut;
-	typedef orklist<ComponentInst*> ComponentList;
 	typedef orkset<Entity*> EntitySet;
+	typedef HandleTable<Entity*> EntityTable;
 
 	SceneInst( const SceneData* sdata, Application *application );
 	~SceneInst();
@@ -262,7 +271,11 @@ public:
 	const EntitySet& GetActiveEntities() const { return mActiveEntities; }
 	EntitySet& GetActiveEntities() { return mActiveEntities; }
 
-	const orkmap<PoolString, Entity*>& Entities() const { return mEntities; }
+	const orkmap<PoolString, Entity*>& Entities() const { return mEntities; } // by name
+
+	// every entity, contiguous and in the order they were added (for per frame walks)
+	const EntityTable& GetEntityTable() const { return mEntityTable; }
+	Entity* GetEntity( TableHandle h ) const { Entity* const* ppent = mEntityTable.Get(h); return ppent ? *ppent : nullptr; }
 
 	///////////////////////////////////////////////////
 
@@ -284,6 +297,15 @@ public:
 	void QueueAllDrawablesToBuffer(ork::ent::DrawableBuffer& buffer) const;
 	void RenderDrawableBuffer(lev2::Renderer *renderer,const ork::ent::DrawableBuffer& dbuffer, const PoolString& LayerName ) const;
 
+	// frustum cull QueueAllDrawablesToBuffer against the scene cameras (SetCameraData).
+	//  only for apps which render through those cameras (not the editor or vr views),
+	//  faspect is the widest aspect ratio they are rendered at
+	void EnableCulling( bool bena, float faspect=16.0f/9.0f );
+	const CullStats& GetCullStats() const { return *mCullStats; } // last QueueAllDrawablesToBuffer
+	// queue the drawables of QueueAllDrawablesToBuffer on the concurrent opq. only for
+	//  scenes whose drawables (and CallbackDrawable queue callbacks) are thread safe
+	void EnableConcurrentQueue( bool bena );
+
 	///////////////////////////////////////////////////
 
 	CompositingManagerComponentInst* GetCMCI();
@@ -298,6 +320,10 @@ public:
 
 	void UpdateActiveComponents(ork::PoolString family );
 
+	// per family update times of the last update step (see DescribeFamily)
+	const orkvector<FamilyTiming>& GetFamilyTimings() const;
+	FamilyUpdateSchedule& GetFamilySchedule() { return *mFamilySchedule; } // invalidated by (de)activation
+
 	void QueueActivateEntity(const EntityActivationQueueItem& item);
 	void QueueDeactivateEntity(Entity *entity);
 
@@ -339,10 +365,17 @@ public:
 
 	size_t GetEntityUpdateCount() const { return mEntityUpdateCount; }
 
+	// particle systems queued here during UpdateEntityComponents are updated
+	//  as independent tasks on ConcurrentOpQ once the components are done
+	lev2::particle::SystemUpdateBatch& GetParticleUpdateBatch() { return *mParticleUpdateBatch; }
+	// likewise skeleton poses (XgmLocalPose::BuildPose)
+	lev2::XgmPoseBatch& GetPoseBuildBatch() { return *mPoseBuildBatch; }
+
 private:
 
 	void DecomposeEntities();
 	void ComposeEntities();
+	void InsertEntity( const PoolString& name, Entity* pent );
 	void LinkEntities();
 	void UnLinkEntities();
 	void StartEntities();
@@ -366,7 +399,8 @@ protected:
 	orkmap<PoolString, Archetype*>			mDynamicArchetypes;
 
 	orkmap<PoolString,Layer*>				mLayers;
-	orkmap<PoolString,Entity*>				mEntities;
+	orkmap<PoolString,Entity*>				mEntities;		// name index into mEntityTable
+	EntityTable								mEntityTable;
 	EntitySet								mActiveEntities;
 	float									mGameTime;			// current game clock time (stops on pause)
 	float									mDeltaTime;			// time since last update (0 on pause)
@@ -381,6 +415,14 @@ protected:
 	float									mfAvgDtAcc;
 	float									mfAvgDtCtr;
 	size_t 									mEntityUpdateCount;
+	lev2::particle::SystemUpdateBatch*		mParticleUpdateBatch;
+	lev2::XgmPoseBatch*						mPoseBuildBatch;
+	SceneCullIndex*							mCullIndex;
+	CullStats*								mCullStats;
+	bool									mbCullingEnabled;
+	float									mfCullAspect;
+	bool									mbConcurrentQueue;
+	FamilyUpdateSchedule*					mFamilySchedule;
 
 	CameraLut								mCameraLut;		// camera list
 
@@ -0,0 +1,132 @@
+////////////////////////////////////////////////////////////////
+// Orkid Media Engine
+// Copyright 1996-2012, Michael T. Mayers.
+// Distributed under the Boost Software License - Version 1.0 - August 17, 2003
+// see http://www.boost.org/LICENSE_1_0.txt
+////////////////////////////////////////////////////////////////
+
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////
+
+#include <ork/orkstl.h>
+#include <ork/math/cvector3.h>
+#include <unordered_map>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace ork {
+
+struct Frustum;
+struct Transform3DMatrix;
+
+namespace ent {
+
+class Entity;
+
+///////////////////////////////////////////////////////////////////////////////
+// per frame culling counters (SceneInst::QueueAllDrawablesToBuffer)
+///////////////////////////////////////////////////////////////////////////////
+
+struct CullStats
+{
+	int miNumEntities;			// in the index
+	int miNumVisible;			// queued (includes unbounded)
+	int miNumCulled;			// not queued
+	int miNumUnbounded;			// no bounds (yet), always queued
+	int miNumRefit;				// bounds recomputed this frame
+	int miNumFrustums;
+	int miNumNodesTested;		// octree nodes tested against a frustum
+	int miNumSpheresTested;		// entity spheres tested against a frustum
+
+	CullStats() { Reset(); }
+	void Reset();
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneCullIndex : loose octree over entity bounding spheres
+//
+//  a node's bounds are twice its octant, so an entity lives at the depth its
+//   radius fits and only changes node when its center leaves the octant.
+//  Refit compares each entity's transform and bounds versions with the ones
+//   it was placed with and only recomputes the changed ones.
+//  entities outside the root are kept on a list tested one by one, entities
+//   without bounds (Entity::GetBoundingSphere false) are always visible.
+///////////////////////////////////////////////////////////////////////////////
+
+class SceneCullIndex
+{
+public:
+
+	SceneCullIndex( const CVector3& center, float fhalfsize, int imaxdepth=6 );
+
+	void AddEntity( const Entity* pent ); // unbounded until the next Refit
+	void RemoveEntity( const Entity* pent );
+	void Clear();
+
+	// recompute the bounds of entities which moved or changed
+	void Refit( CullStats& stats );
+
+	// entities touching any of the frustums (each once) and the unbounded ones
+	const orkvector<const Entity*>& Query( const Frustum* frustums, int inumfrustums, CullStats& stats );
+
+	// what Refit does per entity (world space sphere), exposed for tests
+	void Place( const Entity* pent, const CVector3& ctr, float frad );
+	void Unplace( const Entity* pent );
+
+	size_t GetNumEntities() const { return mItemLut.size(); }
+	size_t GetNumNodes() const { return mNodes.size(); }
+
+private:
+
+	static const int kUnbounded = -1;
+	static const int kOutside = -2;
+
+	struct Node
+	{
+		CVector3	mCenter;
+		float		mfHalfSize;		// of the octant, the node bounds are twice that
+		int			miChildren[8];
+		int			miParent;
+		int			miFirstItem;
+		int			miCount;		// items in this subtree
+	};
+
+	struct Item
+	{
+		const Entity*				mEntity;	// null when free
+		const Transform3DMatrix*	mXf;		// what the bounds were computed from
+		uint32_t					muXfVersion;
+		uint32_t					muBoundsVersion;
+		CVector3					mCenter;
+		float						mfRadius;
+		int							miNode;		// node index, kUnbounded or kOutside
+		int							miPrev;
+		int							miNext;
+		uint32_t					muQueryStamp;
+	};
+
+	int& ListHead( int inode );
+	void Link( int item, int inode );
+	void Unlink( int item );
+	int FindNode( const CVector3& ctr, float frad );
+	void PlaceItem( int item, const CVector3& ctr, float frad );
+	void Emit( int item );
+
+	CVector3							mRootCenter;
+	float								mfRootHalfSize;
+	int									miMaxDepth;
+	orkvector<Node>						mNodes;
+	orkvector<Item>						mItems;
+	orkvector<int>						mFreeItems;
+	std::unordered_map<const Entity*,int>	mItemLut;
+	int									miOutsideHead;
+	int									miUnboundedHead;
+	uint32_t							muQueryStamp;
+	orkvector<std::pair<int,bool>>		mStack;		// Query traversal (node, fully inside)
+	orkvector<const Entity*>			mVisible;	// Query result
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+}}
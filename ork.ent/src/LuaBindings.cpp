@@ -13,6 +13,7 @@
 #include <pkg/ent/scene.hpp>
 #include <pkg/ent/ScriptComponent.h>
 #include <ork/kernel/any.h>
+#include <ork/kernel/opq.h>
 #include <ork/math/cvector3.h>
 
 #include <sstream>
@@ -135,8 +136,40 @@ luabind::object GetVec3XZ( lua_State* L,  luabind::object o )
 /////////////////////////////////////////////////////////////////
 */
 
+static Entity* SpawnArchetype(SceneInst* psi, const char* arch, const char* entname, const fvec3& position)
+{
+    const auto& scenedata = psi->GetData();
+    auto archnamestr = std::string(arch);
+    auto entnamestr = std::string(entname);
+    auto archso = scenedata.FindSceneObjectByName(AddPooledString(archnamestr.c_str()));
+
+    printf( "SPAWN<%s:%p> ename<%s>\n", archnamestr.c_str(), archso, entnamestr.c_str() );
+
+    if( const Archetype* as_arch = rtti::autocast(archso) )
+    {
+        EntData* spawner = new EntData;
+        spawner->SetName(AddPooledString(entnamestr.c_str()));
+        spawner->SetArchetype(as_arch);
+        auto mtx = fmtx4();
+        mtx.ComposeMatrix( position, fquat(), 1.0f );
+        spawner->GetDagNode().SetTransformMatrix(mtx);
+        auto newent = psi->SpawnDynamicEntity(spawner);
+        return newent;
+    }
+    else
+    {
+        assert(false);
+        //printf( "SPAWN<%s:%p>\n", archnamestr.c_str(), archso );
+        return nullptr;
+    }
+    return nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 LuaSystem::LuaSystem(SceneInst*psi)
 	: mSceneInst(psi)
+	, mbDeferred(false)
 {
 	mLuaState = ::luaL_newstate(); // aka lua_open
 	luaL_openlibs(mLuaState);
@@ -184,7 +217,16 @@ LuaSystem::LuaSystem(SceneInst*psi)
                 auto ps = c->GetFamily();
                 return ps.c_str();
             })
-            .addFunction("sendEvent",[](ComponentInst*ci,const char* evcode, LuaRef evdata){
+            .addFunction("sendEvent",[this](ComponentInst*ci,const char* evcode, LuaRef evdata){
+                if( mbDeferred )
+                {
+                    LuaDeferredEvent dev;
+                    dev.mTarget = ci;
+                    dev.mCode = AddPooledString(evcode);
+                    dev.mData = evdata;
+                    mDeferredEvents.push_back(dev);
+                    return;
+                }
                 auto clazz = ci->GetClass();
                 auto cn = clazz->Name();
                 /*printf( "sendEvent ci<%s> code<%s> ... \n", cn.c_str(), evcode);
@@ -237,36 +279,21 @@ LuaSystem::LuaSystem(SceneInst*psi)
         .endClass()
         ////////////////////////////////////////
         .beginClass<SceneInst>("scene")
-            .addFunction("spawn",[](SceneInst* psi, const char* arch, const char* entname, LuaRef spdata)->Entity*{
-
-                const auto& scenedata = psi->GetData();
-                auto archnamestr = std::string(arch);
-                auto entnamestr = std::string(entname);
-                auto archso = scenedata.FindSceneObjectByName(AddPooledString(archnamestr.c_str()));
+            // on a worker state the entity is spawned at FlushDeferred, spawn returns nil
+            .addFunction("spawn",[this](SceneInst* psi, const char* arch, const char* entname, LuaRef spdata)->Entity*{
 
                 auto position = spdata.get<fvec3>("pos");
 
-                printf( "SPAWN<%s:%p> ename<%s>\n", archnamestr.c_str(), archso, entnamestr.c_str() );
-
-                if( const Archetype* as_arch = rtti::autocast(archso) )
-                {
-                    EntData* spawner = new EntData;
-                    spawner->SetName(AddPooledString(entnamestr.c_str()));
-                    spawner->SetArchetype(as_arch);
-                    auto mtx = fmtx4();
-                    mtx.ComposeMatrix( position, fquat(), 1.0f );
-                    spawner->GetDagNode().SetTransformMatrix(mtx);
-                    auto newent = psi->SpawnDynamicEntity(spawner);
-                    return newent;
-                }
-                else
+                if( mbDeferred )
                 {
-                    assert(false);
-                    //printf( "SPAWN<%s:%p>\n", archnamestr.c_str(), archso );
+                    LuaDeferredSpawn dsp;
+                    dsp.mArchetype = arch;
+                    dsp.mEntName = entname;
+                    dsp.mPos = position;
+                    mDeferredSpawns.push_back(dsp);
                     return nullptr;
                 }
-                return nullptr;
-
+                return SpawnArchetype(psi,arch,entname,position);
             })
         .endClass()
         ////////////////////////////////////////
@@ -338,9 +365,32 @@ LuaSystem::LuaSystem(SceneInst*psi)
 LuaSystem::~LuaSystem()
 {
 	printf( "destroy LuaState<%p>\n", mLuaState );
+	mDeferredEvents.clear(); // their LuaRefs belong to mLuaState
 	lua_close(mLuaState);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// in the order the script asked for them
+
+void LuaSystem::FlushDeferred()
+{
+	AssertOnOpQ2( UpdateSerialOpQ() );
+	OrkAssert( false==mbDeferred );
+
+	for( auto& dev : mDeferredEvents )
+	{
+		event::VEvent vev;
+		vev.mCode = dev.mCode;
+		vev.mData.Set<LuaRef>(dev.mData);
+		dev.mTarget->Notify(&vev);
+	}
+	mDeferredEvents.clear();
+
+	for( const auto& dsp : mDeferredSpawns )
+		SpawnArchetype(mSceneInst,dsp.mArchetype.c_str(),dsp.mEntName.c_str(),dsp.mPos);
+	mDeferredSpawns.clear();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 }} // namespace ork { namespace ent {
 
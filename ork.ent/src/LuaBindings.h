@@ -7,6 +7,9 @@ extern "C" {
 }
 
 #include <cxxabi.h>
+#include <vector>
+#include <string>
+#include <ork/math/cvector3.h>
 #include "LuaIntf/LuaIntf.h"
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -34,12 +37,33 @@ struct LuaOpaque16
 	}
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// what a script running on a worker state asked of the rest of the scene,
+//  held until FlushDeferred (on the update thread)
+
+struct LuaDeferredEvent
+{
+	ComponentInst*		mTarget;
+	PoolString			mCode;
+	LuaIntf::LuaRef		mData;
+};
+struct LuaDeferredSpawn
+{
+	std::string			mArchetype;
+	std::string			mEntName;
+	CVector3			mPos;
+};
+
 struct LuaSystem
 {
 	LuaSystem(SceneInst*psi);
 	~LuaSystem();
+	void FlushDeferred();
 	lua_State* mLuaState;
 	SceneInst* mSceneInst;
+	bool mbDeferred; // component events and spawns are queued, not done
+	std::vector<LuaDeferredEvent> mDeferredEvents;
+	std::vector<LuaDeferredSpawn> mDeferredSpawns;
 };
 
 bool DoString(lua_State* L, const char* str);
@@ -205,11 +205,18 @@ void ParticleControllableInst::DoUpdate(ork::ent::SceneInst *inst)
 
 		mParticleContext.BeginFrame(fcurtime);
 
+		///////////////////////////////////
+		// our systems share mParticleContext (and its event queues),
+		//  so they go in one group, updated in order on one thread
+		///////////////////////////////////
+
+		lev2::particle::SystemUpdateBatch& batch = inst->GetParticleUpdateBatch();
+		batch.BeginGroup();
 		for( orkvector<NovaParticleSystem*>::const_iterator it=mSystems.begin(); it!=mSystems.end(); it++ )
 		{
 			NovaParticleSystem* psys = (*it);
 			
-			psys->Update(deltime);
+			batch.Queue(psys,deltime);
 		}
 	}
 }
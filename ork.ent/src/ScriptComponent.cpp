@@ -13,6 +13,8 @@
 #include <pkg/ent/scene.hpp>
 #include <pkg/ent/ScriptComponent.h>
 #include <ork/kernel/any.h>
+#include <ork/kernel/opq.h>
+#include <ork/kernel/taskgraph.h>
 #include <ork/util/md5.h>
 
 #include <sstream>
@@ -20,8 +22,17 @@
 #include <cxxabi.h>
 
 ///////////////////////////////////////////////////////////////////////////////
-
-static const bool kUSEEXECTABUPDATE = false;
+// batched update of the modules without OnEntityUpdateBatch, one call into
+//  lua per module per step instead of one per entity. an entity whose
+//  update errors is reported and skipped, the rest of the module still runs
+
+static const char* kBatchDriverText =
+	"return function(fn,ents,dt)\n"
+	"    for i=1,#ents do\n"
+	"        local ok, err = pcall(fn,ents[i],dt)\n"
+	"        if not ok then print(\"LUAERR<\"..tostring(err)..\">\") end\n"
+	"    end\n"
+	"end\n";
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -62,7 +73,12 @@ void ScriptComponentData::DoRegisterWithScene( ork::ent::SceneComposer& sc )
 ///////////////////////////////////////////////////////////////////////////////
 
 ScriptObject::ScriptObject()
-	: mScriptRef(LUA_NOREF)
+	: mOnEntUpdateBatch(LUA_NOREF)
+	, mScriptRef(LUA_NOREF)
+	, mLuaSystem(nullptr)
+	, miLuaState(0)
+	, mEntTabsRef(LUA_NOREF)
+	, mbEntTabsDirty(true)
 {
 
 }
@@ -86,16 +102,13 @@ bool ScriptComponentInst::DoLink(ork::ent::SceneInst *psi)
 	if( nullptr == scm )
 		return true;
 
-	auto asluasys = scm->GetLuaManager().Get<LuaSystem*>();
-	OrkAssert(asluasys);
-	auto L = asluasys->mLuaState;
-
 	if( scm )
 	{
 		mScriptObject = scm->FlyweightScriptObject( path );
 
 		if( mScriptObject )
 		{
+			auto L = mScriptObject->mLuaSystem->mLuaState;
 			auto ent = this->GetEntity();
 
             LuaState lua = L;
@@ -127,9 +140,7 @@ bool ScriptComponentInst::DoStart(SceneInst *psi, const CMatrix4 &world)
 
 	if( scm && mScriptObject )
 	{
-		auto asluasys = scm->GetLuaManager().Get<LuaSystem*>();
-		OrkAssert(asluasys);
-		auto L = asluasys->mLuaState;
+		auto L = mScriptObject->mLuaSystem->mLuaState;
 
 		auto ent = this->GetEntity();
 		auto name = ent->GetEntData().GetName().c_str();
@@ -141,6 +152,8 @@ bool ScriptComponentInst::DoStart(SceneInst *psi, const CMatrix4 &world)
         assert(lua.isFunction(-1));
         lua.push(mEntTable);
         lua.ppcall(1,0,0);
+
+		scm->OnScriptStart( this, mScriptObject );
 	}
 	return true;
 }
@@ -150,9 +163,9 @@ void ScriptComponentInst::DoStop(SceneInst *psi)
 
 	if( scm && mScriptObject )
 	{
-		auto asluasys = scm->GetLuaManager().Get<LuaSystem*>();
-		OrkAssert(asluasys);
-		auto L = asluasys->mLuaState;
+		scm->OnScriptStop( this, mScriptObject );
+
+		auto L = mScriptObject->mLuaSystem->mLuaState;
 
 		auto ent = this->GetEntity();
 		auto name = ent->GetEntData().GetName().c_str();
@@ -173,38 +186,45 @@ void ScriptComponentInst::DoStop(SceneInst *psi)
 
 void ScriptComponentInst::DoUpdate(ork::ent::SceneInst* psi)
 {
+	auto scm = psi->FindSystem<ScriptManagerComponentInst>();
 
-	if( false == kUSEEXECTABUPDATE )
+	if( scm && mScriptObject )
 	{
-		auto scm = psi->FindSystem<ScriptManagerComponentInst>();
-
-		if( scm && mScriptObject )
+		if( scm->IsBatchedUpdate() )
 		{
-			auto asluasys = scm->GetLuaManager().Get<LuaSystem*>();
-			OrkAssert(asluasys);
-			auto L = asluasys->mLuaState;
-			auto ent = this->GetEntity();
-            double dt = psi->GetDeltaTime();
-            double gt = psi->GetGameTime();
+			if( scm->IsBatchLeader(this) )
+				scm->UpdateBatches(psi);
+			// NOP (the leader's update did ours)
+			return;
+		}
 
+		auto L = mScriptObject->mLuaSystem->mLuaState;
+		auto ent = this->GetEntity();
+        double dt = psi->GetDeltaTime();
+        double gt = psi->GetGameTime();
 
-            LuaState lua = L;
-            lua.getRef(mScriptObject->mOnEntUpdate);
-            assert(lua.isFunction(-1));
-            lua.push(mEntTable);
-            lua.push(dt);
-            lua.ppcall(2,0,0);
-		}
+
+        LuaState lua = L;
+        lua.getRef(mScriptObject->mOnEntUpdate);
+        assert(lua.isFunction(-1));
+        lua.push(mEntTable);
+        lua.push(dt);
+        lua.ppcall(2,0,0);
 	}
-	// NOP (scriptmanager will execute)
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
 void ScriptManagerComponentData::Describe()
 {
+	ork::reflect::RegisterProperty( "BatchedUpdate", & ScriptManagerComponentData::mbBatchedUpdate );
+	ork::reflect::RegisterProperty( "LuaWorkerStates", & ScriptManagerComponentData::miNumWorkerStates );
+	ork::reflect::AnnotatePropertyForEditor<ScriptManagerComponentData>("LuaWorkerStates", "editor.range.min", "0");
+	ork::reflect::AnnotatePropertyForEditor<ScriptManagerComponentData>("LuaWorkerStates", "editor.range.max", "16");
 }
 ScriptManagerComponentData::ScriptManagerComponentData()
+	: mbBatchedUpdate(true)
+	, miNumWorkerStates(0)
 {
 
 }
@@ -222,6 +242,8 @@ void ScriptManagerComponentInst::Describe()
 
 ScriptManagerComponentInst::ScriptManagerComponentInst( const ScriptManagerComponentData& data, ork::ent::SceneInst *pinst )
 	: ork::ent::System( &data, pinst )
+	, mSMCD(data)
+	, mBatchLeader(nullptr)
 	, mScriptRef(LUA_NOREF)
 {
 	printf( "SCMI<%p>\n", this );
@@ -229,37 +251,14 @@ ScriptManagerComponentInst::ScriptManagerComponentInst( const ScriptManagerCompo
 	mLuaManager.Set<LuaSystem*>(luasys);
 
 	///////////////////////////////////////////////
-
-	auto AppendPath = [&]( const char* pth )
-	{
-	    lua_getglobal( luasys->mLuaState, "package" );
-	    lua_getfield( luasys->mLuaState, -1, "path" );
-
-	    fxstring<256> lua_path;
-	    lua_path.format(	"%s;%s",
-	    					lua_tostring( luasys->mLuaState, -1 ),
-	    					pth );
-
-	    lua_pop( luasys->mLuaState, 1 );
-	    lua_pushstring( luasys->mLuaState, lua_path.c_str() );
-	    lua_setfield( luasys->mLuaState, -2, "path" );
-	    lua_pop( luasys->mLuaState, 1 );
-	};
-
-	///////////////////////////////////////////////
-	// Set Lua Search Path
+	// worker states only run batched updates
 	///////////////////////////////////////////////
 
-	auto searchpath = file::Path("src://scripts/");
-	auto abssrchpath = searchpath.ToAbsolute();
-
-	if( abssrchpath.DoesPathExist() )
-	{
-	    fxstring<256> lua_path;
-	    lua_path.format( "%s?.lua", abssrchpath.c_str() );
-	    AppendPath( lua_path.c_str() );
-	}
+	InitLuaState(luasys);
 
+	int inumworkers = data.IsBatchedUpdate() ? data.GetNumWorkerStates() : 0;
+	for( int i=0; i<inumworkers; i++ )
+		InitLuaState( new LuaSystem(pinst) );
 
 	///////////////////////////////////////////////
 	// find & init scene file
@@ -300,6 +299,54 @@ ScriptManagerComponentInst::ScriptManagerComponentInst( const ScriptManagerCompo
 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+void ScriptManagerComponentInst::InitLuaState( LuaSystem* luasys )
+{
+	auto AppendPath = [&]( const char* pth )
+	{
+	    lua_getglobal( luasys->mLuaState, "package" );
+	    lua_getfield( luasys->mLuaState, -1, "path" );
+
+	    fxstring<256> lua_path;
+	    lua_path.format(	"%s;%s",
+	    					lua_tostring( luasys->mLuaState, -1 ),
+	    					pth );
+
+	    lua_pop( luasys->mLuaState, 1 );
+	    lua_pushstring( luasys->mLuaState, lua_path.c_str() );
+	    lua_setfield( luasys->mLuaState, -2, "path" );
+	    lua_pop( luasys->mLuaState, 1 );
+	};
+
+	///////////////////////////////////////////////
+	// Set Lua Search Path
+	///////////////////////////////////////////////
+
+	auto searchpath = file::Path("src://scripts/");
+	auto abssrchpath = searchpath.ToAbsolute();
+
+	if( abssrchpath.DoesPathExist() )
+	{
+	    fxstring<256> lua_path;
+	    lua_path.format( "%s?.lua", abssrchpath.c_str() );
+	    AppendPath( lua_path.c_str() );
+	}
+
+	///////////////////////////////////////////////
+	// batch driver
+	///////////////////////////////////////////////
+
+	auto L = luasys->mLuaState;
+	int ret = luaL_loadstring(L,kBatchDriverText);
+	if( 0==ret )
+		ret = lua_pcall(L,0,1,0);
+	OrkAssert(0==ret);
+	mBatchDriverRefs.push_back( luaL_ref(L, LUA_REGISTRYINDEX) );
+
+	mLuaStates.push_back(luasys);
+}
+
 ScriptManagerComponentInst::~ScriptManagerComponentInst()
 {
 	//////////////////////////////
@@ -313,11 +360,12 @@ ScriptManagerComponentInst::~ScriptManagerComponentInst()
 	}
 
 	//////////////////////////////
-	// delete lua context
+	// delete lua contexts
 	//////////////////////////////
 	auto asluasys = mLuaManager.Get<LuaSystem*>();
 	OrkAssert(asluasys);
-	delete asluasys;
+	for( auto luasys : mLuaStates )
+		delete luasys;
 }
 
 bool ScriptManagerComponentInst::DoLink(SceneInst* psi) // final
@@ -361,14 +409,111 @@ void ScriptManagerComponentInst::DoUpdate(SceneInst* psi) // final
 	double gt = psi->GetGameTime();
 
 	//LuaProtectedCallByName( asluasys->mLuaState, mScriptRef, "OnSceneUpdate", ldt,lgt);
+}
+
+///////////////////////////////////////////////////////////////////////////////
 
-	if( kUSEEXECTABUPDATE )
+void ScriptManagerComponentInst::OnScriptStart( ScriptComponentInst* sci, ScriptObject* so )
+{
+	so->mInstances.push_back(sci);
+	so->mbEntTabsDirty = true;
+	if( nullptr == mBatchLeader )
+		mBatchLeader = sci;
+}
+
+void ScriptManagerComponentInst::OnScriptStop( ScriptComponentInst* sci, ScriptObject* so )
+{
+	auto it = std::find(so->mInstances.begin(),so->mInstances.end(),sci);
+	if( it != so->mInstances.end() )
+		so->mInstances.erase(it);
+	so->mbEntTabsDirty = true;
+
+	if( sci == mBatchLeader )
 	{
-		//luabind::object o(asluasys->mLuaState, dt );
-		//LuaProtectedCallByName( asluasys->mLuaState, mScriptRef, "UpdateSceneEntities",ldt);
+		mBatchLeader = nullptr;
+		for( auto item : mScriptObjects )
+			if( item.second->mInstances.size() )
+			{
+				mBatchLeader = item.second->mInstances.front();
+				break;
+			}
 	}
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// one call into lua per module. modules on a worker state are updated on
+//  the concurrent opq, one state per task, what they asked of other entities
+//  is done once they are all through
+
+void ScriptManagerComponentInst::UpdateBatches( SceneInst* psi )
+{
+	AssertOnOpQ2( UpdateSerialOpQ() );
+
+	double dt = psi->GetDeltaTime();
+	int inumstates = int(mLuaStates.size());
+
+	if( 1 == inumstates )
+	{
+		for( auto item : mScriptObjects )
+			UpdateBatch( item.second, dt );
+		return;
+	}
+
+	parallel_for( ConcurrentOpQ(), 0, inumstates, 1, [this,dt]( int ib, int ie )
+	{
+		for( int is=ib; is<ie; is++ )
+		{
+			LuaSystem* luasys = mLuaStates[is];
+			luasys->mbDeferred = true;
+			for( auto item : mScriptObjects )
+				if( item.second->miLuaState == is )
+					UpdateBatch( item.second, dt );
+			luasys->mbDeferred = false;
+		}
+	});
+
+	for( auto luasys : mLuaStates )
+		luasys->FlushDeferred();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ScriptManagerComponentInst::UpdateBatch( ScriptObject* so, double dt )
+{
+	int inument = int(so->mInstances.size());
+	if( 0 == inument )
+		return;
+
+	auto L = so->mLuaSystem->mLuaState;
+	LuaState lua = L;
+
+	if( so->mbEntTabsDirty )
+	{
+		lua_createtable(L,inument,0);
+		for( int i=0; i<inument; i++ )
+		{
+			lua.push(so->mInstances[i]->GetEntTable());
+			lua_rawseti(L,-2,i+1);
+		}
+		luaL_unref(L, LUA_REGISTRYINDEX, so->mEntTabsRef);
+		so->mEntTabsRef = luaL_ref(L, LUA_REGISTRYINDEX);
+		so->mbEntTabsDirty = false;
+	}
+
+	int inumargs = 2;
+	if( so->mOnEntUpdateBatch != LUA_NOREF )
+		lua.getRef(so->mOnEntUpdateBatch);
+	else
+	{
+		lua.getRef(mBatchDriverRefs[so->miLuaState]);
+		lua.getRef(so->mOnEntUpdate);
+		inumargs++;
+	}
+	lua_rawgeti(L, LUA_REGISTRYINDEX, so->mEntTabsRef);
+	lua.push(dt);
+	lua.ppcall(inumargs,0,0);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // FlyweightScriptObject - load every script file only once
 //  share across different entity instances
@@ -377,9 +522,6 @@ void ScriptManagerComponentInst::DoUpdate(SceneInst* psi) // final
 ScriptObject* ScriptManagerComponentInst::FlyweightScriptObject( const ork::file::Path& pth )
 {
 	auto abspath = pth.ToAbsolute();
-	auto asluasys = GetLuaManager().Get<LuaSystem*>();
-	OrkAssert(asluasys);
-	auto luast = asluasys->mLuaState;
 
 	ScriptObject* rval = nullptr;
 
@@ -412,6 +554,14 @@ ScriptObject* ScriptManagerComponentInst::FlyweightScriptObject( const ork::file
 			script_funcname_t postfix;
 			postfix.format("_%04x", script_index);
 
+			//////////////////////////////////////////
+			// modules are spread across the lua states
+			//////////////////////////////////////////
+
+			rval->miLuaState = script_index % int(mLuaStates.size());
+			rval->mLuaSystem = mLuaStates[rval->miLuaState];
+			auto luast = rval->mLuaSystem->mLuaState;
+
 			//printf( "\n%s\n", rval->mScriptText.c_str() );
 
 			//////////////////////////////////////////
@@ -451,6 +601,14 @@ ScriptObject* ScriptManagerComponentInst::FlyweightScriptObject( const ork::file
             rval->mOnEntStop = getMethodRef("OnEntityStop");
             rval->mOnEntUpdate = getMethodRef("OnEntityUpdate");
 
+            lua_rawgeti(luast,LUA_REGISTRYINDEX,rval->mModTabRef);
+            lua_getfield(luast,-1,"OnEntityUpdateBatch");
+            if( lua_type(luast,-1)==LUA_TFUNCTION )
+                rval->mOnEntUpdateBatch = luaL_ref(luast,LUA_REGISTRYINDEX);
+            else
+                lua_pop(luast,1);
+            lua_pop(luast,1);
+
 
 			//LuaProtectedCallByRef( luast, rval->mScriptRef );
 
@@ -755,7 +755,8 @@ void SimpleAnimatableInst::DoUpdate(ork::ent::SceneInst *inst)
 			}
 		}
 
-		mModelInst->RefLocalPose().BuildPose();
+		// blended and concatenated with the other skeletons once the components are updated
+		inst->GetPoseBuildBatch().Queue( & mModelInst->RefLocalPose() );
 
 		if(service_queue)
 		{
@@ -87,6 +87,29 @@ PoolString ComponentInst::GetFamily() const
 }
 
 
+static orkmap<PoolString,ComponentFamilyAccess>& FamilyAccessMap()
+{
+	static orkmap<PoolString,ComponentFamilyAccess> gmap;
+	return gmap;
+}
+
+void DescribeFamily( PoolString family, uint32_t ureads, uint32_t uwrites, bool bconcurrent )
+{
+	OrkAssert( false==family.empty() );
+	ComponentFamilyAccess& acc = FamilyAccessMap()[family];
+	acc.muReads = ureads;
+	acc.muWrites = uwrites;
+	acc.mbConcurrent = bconcurrent;
+	acc.mbDescribed = true;
+}
+
+ComponentFamilyAccess GetFamilyAccess( PoolString family )
+{
+	const orkmap<PoolString,ComponentFamilyAccess>& themap = FamilyAccessMap();
+	orkmap<PoolString,ComponentFamilyAccess>::const_iterator it = themap.find(family);
+	return (it!=themap.end()) ? it->second : ComponentFamilyAccess();
+}
+
 void ComponentInst::Update(SceneInst *inst)
 {
 	if( mbValid )
@@ -38,6 +38,8 @@ ork::MpMcBoundedQueue<RenderSyncToken> DrawableBuffer::mOfflineUpdateSynchro;
 
 ork::atomic<bool> DrawableBuffer::gbInsideClearAndSync;
 
+static const float kdepthsortrange = 10000.0f; // model sort key depth saturates past this
+
 Layer::Layer()
 {
 }
@@ -69,6 +71,9 @@ void DrawableBuffer::Reset()
 
 	miNumLayersUsed = 0;
 	mLayers.clear();
+	mLayerLut.clear();
+	miNumWritersUsed = 0;
+	mArena.Reset();
 	for( int il=0; il<kmaxlayers; il++ )
 	{
 		mRawLayers[il].Reset(*this);
@@ -77,11 +82,13 @@ void DrawableBuffer::Reset()
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void DrawableBufLayer::Reset(const DrawableBuffer& dB)
+void DrawableBufLayer::Reset(DrawableBuffer& dB)
 {
 	//AssertOnOpQ2( UpdateSerialOpQ() );
 	miBufferIndex = dB.miBufferIndex;
 	miItemIndex = -1;
+	mChunks.clear();
+	mArena = & dB.mArena;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -110,11 +117,17 @@ DrawableBufLayer* DrawableBuffer::MergeLayer( const PoolString& layername )
 DrawableBufItem& DrawableBufLayer::Queue( const DrawQueueXfData& xfdata,
 										  const Drawable* d )
 {
-	AssertOnOpQ2( UpdateSerialOpQ() );
-	//mDrawBufItems.push_back(DrawableBufItem()); // replace std::vector with an array so we can amortize construction costs
+	// items live in chunks from the buffer's arena, reused every frame so
+	//  their construction costs are amortized like the old fixed array
+	DrawableBufChunk* pchunk = mChunks.empty() ? nullptr : mChunks.back();
+	if( nullptr==pchunk || pchunk->miNumItems==DrawableBufChunk::kmaxitems )
+	{
+		OrkAssert( mArena!=nullptr );
+		pchunk = mArena->Alloc();
+		mChunks.push_back(pchunk);
+	}
 	miItemIndex++;
-	OrkAssert(miItemIndex<kmaxitems );
-	DrawableBufItem& item = mDrawBufItems[miItemIndex];
+	DrawableBufItem& item = pchunk->mItems[pchunk->miNumItems++];
 	item.SetDrawable(d);
 	item.mUserData0 = 0;
 	item.mUserData1 = 0;
@@ -123,17 +136,150 @@ DrawableBufItem& DrawableBufLayer::Queue( const DrawQueueXfData& xfdata,
 	return item;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// chunks are spliced, not copied. the last chunk of this layer may be left
+//  partly filled, Queue only ever fills the last one
+
+void DrawableBufLayer::Append( DrawableBufLayer& src )
+{
+	if( false==src.HasData() )
+		return;
+	mChunks.insert( mChunks.end(), src.mChunks.begin(), src.mChunks.end() );
+	miItemIndex += src.GetNumItems();
+	src.mChunks.clear();
+	src.miItemIndex = -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+DrawableBufArena::DrawableBufArena()
+	: miNextChunk(0)
+	, mOverflow(nullptr)
+{
+}
+
+DrawableBufArena::~DrawableBufArena()
+{
+	Reset();
+	for( size_t i=0; i<mChunks.size(); i++ )
+		delete mChunks[i];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// mChunks only changes in Reset, so during a frame the owned chunks are
+//  handed out with a single fetch_add. the overflow list is push only.
+
+DrawableBufChunk* DrawableBufArena::Alloc()
+{
+	int ichunk = miNextChunk.fetch_add(1);
+	DrawableBufChunk* pchunk = nullptr;
+	if( ichunk<int(mChunks.size()) )
+	{
+		pchunk = mChunks[ichunk];
+	}
+	else
+	{
+		pchunk = new DrawableBufChunk;
+		DrawableBufChunk* phead = mOverflow.load();
+		do
+		{
+			pchunk->mNextOverflow = phead;
+		}
+		while( false==mOverflow.compare_exchange_weak(phead,pchunk) );
+	}
+	pchunk->miNumItems = 0;
+	return pchunk;
+}
+
+void DrawableBufArena::Reset()
+{
+	DrawableBufChunk* pchunk = mOverflow.exchange(nullptr);
+	while( pchunk )
+	{
+		mChunks.push_back(pchunk);
+		pchunk = pchunk->mNextOverflow;
+	}
+	miNextChunk = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+DrawableBufWriter::DrawableBufWriter()
+	: miNumLayersUsed(0)
+{
+}
+
+void DrawableBufWriter::Reset(DrawableBuffer& dB)
+{
+	miNumLayersUsed = 0;
+	mLayerLut.clear();
+	for( int il=0; il<kmaxlayers; il++ )
+		mRawLayers[il].Reset(dB);
+}
+
+DrawableBufLayer* DrawableBufWriter::MergeLayer( const PoolString& layername )
+{
+	DrawableBufLayer* player = 0;
+	auto itL = mLayerLut.find(layername);
+	if( itL != mLayerLut.end() )
+	{
+		player = itL->second;
+	}
+	else
+	{
+		OrkAssert( miNumLayersUsed<kmaxlayers );
+		player = & mRawLayers[miNumLayersUsed++];
+		mLayerLut.AddSorted(layername,player);
+	}
+	return player;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void DrawableBuffer::ReserveWriters( int inumwriters )
+{
+	AssertOnOpQ2( UpdateSerialOpQ() );
+	while( int(mWriters.size())<inumwriters )
+		mWriters.push_back( new DrawableBufWriter );
+	for( int iw=miNumWritersUsed; iw<inumwriters; iw++ )
+		mWriters[iw]->Reset(*this);
+	if( inumwriters>miNumWritersUsed )
+		miNumWritersUsed = inumwriters;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// in writer order, so a frame queued concurrently draws like one queued
+//  serially in the same order
+
+void DrawableBuffer::MergeWriters()
+{
+	AssertOnOpQ2( UpdateSerialOpQ() );
+	for( int iw=0; iw<miNumWritersUsed; iw++ )
+	{
+		DrawableBufWriter* pwriter = mWriters[iw];
+		for( int il=0; il<pwriter->miNumLayersUsed; il++ )
+		{
+			const auto& entry = pwriter->mLayerLut.GetItemAtIndex(il);
+			MergeLayer(entry.first)->Append( *entry.second );
+		}
+		pwriter->Reset(*this);
+	}
+	miNumWritersUsed = 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 DrawableBuffer::DrawableBuffer(int ibidx)
 	: miBufferIndex(ibidx)
 	, miNumLayersUsed(0)
+	, miNumWritersUsed(0)
 {
 }
 
 DrawableBufLayer::DrawableBufLayer()
 	: miItemIndex(-1)
 	, miBufferIndex(-1)
+	, mArena(nullptr)
 {
 }
 
@@ -141,6 +287,8 @@ DrawableBufLayer::DrawableBufLayer()
 
 DrawableBuffer::~DrawableBuffer()
 {
+	for( size_t i=0; i<mWriters.size(); i++ )
+		delete mWriters[i];
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -197,6 +345,7 @@ DrawableBuffer* DrawableBuffer::LockWriteBuffer(int lid)
 void DrawableBuffer::UnLockWriteBuffer(DrawableBuffer*db)
 {
 	AssertOnOpQ2( UpdateSerialOpQ() );
+	db->MergeWriters();
 	gBuffers.EndWrite(db);
 }
 /////////////////////////////////////////////////////////////////////
@@ -281,7 +430,6 @@ void CameraDrawable::QueueToRenderer(const DrawableBufItem& item, lev2::Renderer
 void CameraDrawable::QueueToLayer(	const DrawQueueXfData& xfdata,
 									DrawableBufLayer&buffer) const
 {
-	AssertOnOpQ2( UpdateSerialOpQ() );
 	DrawableBufItem& item = buffer.Queue(xfdata,this);
 }
 ///////////////////////////////////////////////////////////////////////////////
@@ -304,6 +452,7 @@ Drawable::~Drawable()
 ///////////////////////////////////////////////////////////////////////////////
 ModelDrawable::ModelDrawable( Entity* pent )
 	: Drawable()
+	, mEntity( pent )
 	, mModelInst( NULL )
 	, mfScale( 1.0f )
 	, mRotate(0.0f,0.0f,0.0f)
@@ -351,6 +500,36 @@ void ModelDrawable::SetModelInst(lev2::XgmModelInst* pModelInst)
 	anyp ap;
 	ap.Set( mpWorldPose );
 	SetUserDataA(ap);
+	if( mEntity )
+		mEntity->InvalidateBounds();
+}
+void ModelDrawable::SetScale( float fscale )
+{
+	mfScale=fscale;
+	if( mEntity )
+		mEntity->InvalidateBounds();
+}
+void ModelDrawable::SetOffset( const CVector3& v )
+{
+	mOffset=v;
+	if( mEntity )
+		mEntity->InvalidateBounds();
+}
+///////////////////////////////////////////////////////////////////////////////
+// the sphere QueueToRenderer tests lights with, but around the whole box
+//  (the 0.6 of the widest side misses the corners). No model or a model
+//  still loading (empty box) is unknown.
+bool ModelDrawable::GetBoundingSphere( CVector3& ctr, float& frad ) const
+{
+	const lev2::XgmModel* Model = mModelInst ? mModelInst->GetXgmModel() : nullptr;
+	if( nullptr == Model )
+		return false;
+	CVector3 vwhd = Model->GetBoundingAA_WHD();
+	frad = 0.5f*vwhd.Mag()*mfScale;
+	if( false == (frad>0.0f) )
+		return false;
+	ctr = (mOffset + Model->GetBoundingCenter())*mfScale;
+	return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -358,7 +537,6 @@ void ModelDrawable::SetModelInst(lev2::XgmModelInst* pModelInst)
 void ModelDrawable::QueueToLayer(	const DrawQueueXfData& xfdata,
 									DrawableBufLayer&buffer) const
 {
-	AssertOnOpQ2( UpdateSerialOpQ() );
 
 	#if 1 //DRAWTHREADS
 	const lev2::XgmModel* Model = mModelInst->GetXgmModel();
@@ -622,12 +800,23 @@ void ModelDrawable::QueueToRenderer( const DrawableBufItem& item,
 						u32 imtld = ((umat>>24)&0xff);
 						u32 imtl = (imtla+imtlb+imtlc+imtld)&0xff;
 
-						int isortpass = (material->GetRenderQueueSortingData().miSortingPass+16)&0xff;
-						int isortoffs = material->GetRenderQueueSortingData().miSortingOffset;
+						const lev2::RenderQueueSortingData& sortdata = material->GetRenderQueueSortingData();
+						int isortpass = (sortdata.miSortingPass+16)&0xff;
+						int isortoffs = sortdata.miSortingOffset;
 
-						int isortkey = (isortpass<<24)|(isortoffs<<16)|imtl;
+						// depth of the model center from the near plane, front to back within a material.
+						//  transparent passes blend back to front, regardless of material
+						float fdepth = frus.mNearPlane.GetPointDistance(ctr);
+						U32 udepth = 0;
+						if( sortdata.mbTransparency )
+						{
+							udepth = lev2::RenderSortKey::QuantizeDepthBackToFront( fdepth, kdepthsortrange );
+							imtl = 0;
+						}
+						else
+							udepth = lev2::RenderSortKey::QuantizeDepth( fdepth, kdepthsortrange );
 
-						renderable.SetSortKey( isortkey );
+						renderable.SetSortKey( lev2::RenderSortKey::Compose( isortpass, isortoffs, imtl, udepth ) );
 						//orkprintf( " ModelDrawable::QueueToRenderer() rable<%p> \n", & renderable );
 
 
@@ -673,7 +862,6 @@ CallbackDrawable::~CallbackDrawable()
 void CallbackDrawable::QueueToLayer(	const DrawQueueXfData& xfdata,
 										DrawableBufLayer&buffer) const
 {
-	AssertOnOpQ2( UpdateSerialOpQ() );
 
 	DrawableBufItem& cdb = buffer.Queue(xfdata,this);
 	cdb.mUserData0 = GetUserDataA();
@@ -694,7 +882,7 @@ void CallbackDrawable::QueueToRenderer( const DrawableBufItem& item,
 	renderable.SetMatrix( item.mXfData.mWorldMatrix );
 	renderable.SetObject( GetOwner() );
 	renderable.SetRenderCallback( mRenderCallback );
-	renderable.SetSortKey( mSortKey );
+	renderable.SetSortKey( lev2::RenderSortKey::FromLegacy(mSortKey) );
 	renderable.SetDrawableDataA( GetUserDataA() );
 	renderable.SetDrawableDataB( GetUserDataB() );
 	renderable.SetUserData0( item.mUserData0 );
@@ -223,31 +223,74 @@ Entity::Entity( const EntData& edata, SceneInst *inst )
 	//, mDrawable( 0 )
 	, mComponentTable( mComponents )
 	, mSceneInst(inst)
+	, mBoundsVersion(0)
 {
 	//mDrawable.reserve(4);
 }
 ///////////////////////////////////////////////////////////////////////////////
-CMatrix4 Entity::GetEffectiveMatrix() const
+const Transform3DMatrix& Entity::GetEffectiveTransform() const
 {
-	CMatrix4 rval;
 	switch( mSceneInst->GetSceneInstMode() )
 	{
 		case ESCENEMODE_RUN:
 		case ESCENEMODE_SINGLESTEP:
 		case ESCENEMODE_PAUSE:
-		{	const DagNode& dagn = this->GetDagNode();
-			const auto& xf = dagn.GetTransformNode().GetTransform();
-			rval = xf.GetMatrix();
-			break;
-		}
+			return this->GetDagNode().GetTransformNode().GetTransform();
 		default:
-		{	const DagNode& dagn = this->GetEntData().GetDagNode();
-			const auto& xf = dagn.GetTransformNode().GetTransform();
-			rval = xf.GetMatrix();
-			break;
+			return this->GetEntData().GetDagNode().GetTransformNode().GetTransform();
+	}
+}
+///////////////////////////////////////////////////////////////////////////////
+CMatrix4 Entity::GetEffectiveMatrix() const
+{
+	return GetEffectiveTransform().GetMatrix();
+}
+///////////////////////////////////////////////////////////////////////////////
+bool Entity::GetBoundingSphere( CVector3& ctr, float& frad ) const
+{
+	bool bany = false;
+	CVector3 c;
+	float r = 0.0f;
+	for( LayerMap::const_iterator itL=mLayerMap.begin(); itL!=mLayerMap.end(); itL++ )
+	{
+		const DrawableVector* pldrawables = itL->second;
+		for( DrawableVector::const_iterator it=pldrawables->begin(); it!=pldrawables->end(); it++ )
+		{
+			CVector3 c2;
+			float r2 = 0.0f;
+			if( false == (*it)->GetBoundingSphere(c2,r2) )
+				return false;
+			if( false == bany )
+			{
+				c = c2;
+				r = r2;
+				bany = true;
+				continue;
+			}
+			// grow to enclose both
+			CVector3 d = c2-c;
+			float fd = d.Mag();
+			if( fd+r2 <= r )
+				continue;
+			if( fd+r <= r2 )
+			{
+				c = c2;
+				r = r2;
+				continue;
+			}
+			float nr = (fd+r+r2)*0.5f;
+			c += d*((nr-r)/fd);
+			r = nr;
 		}
 	}
-	return rval;
+	// no drawables : a point at the origin, nothing to draw anyway
+	const CMatrix4& mtx = GetEffectiveTransform().GetMatrix();
+	ctr = CVector4(c).Transform(mtx).GetXYZ();
+	float fscale = mtx.GetXNormal().Mag();
+	fscale = std::max( fscale, mtx.GetYNormal().Mag() );
+	fscale = std::max( fscale, mtx.GetZNormal().Mag() );
+	frad = r*fscale;
+	return true;
 }
 
 void Entity::SetDynMatrix( const CMatrix4& mtx )
@@ -395,6 +438,7 @@ void Entity::AddDrawable( const PoolString& layername, Drawable* pdrw )
 	}
 
 	pldrawables->push_back(pdrw);
+	InvalidateBounds();
 }
 
 Entity::DrawableVector* Entity::GetDrawables( const PoolString& layer )
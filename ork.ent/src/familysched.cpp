@@ -0,0 +1,274 @@
+////////////////////////////////////////////////////////////////
+// Orkid Media Engine
+// Copyright 1996-2012, Michael T. Mayers.
+// Distributed under the Boost Software License - Version 1.0 - August 17, 2003
+// see http://www.boost.org/LICENSE_1_0.txt
+////////////////////////////////////////////////////////////////
+
+#include <ork/pch.h>
+#include <pkg/ent/familysched.h>
+#include <pkg/ent/scene.h>
+#include <pkg/ent/component.h>
+#include <ork/kernel/opq.h>
+#include <ork/kernel/taskgraph.h>
+#include <ork/kernel/timer.h>
+#include <ork/lev2/gfx/gfxanim.h>
+#include <ork/lev2/gfx/particle/particle.h>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace ork { namespace ent {
+
+///////////////////////////////////////////////////////////////////////////////
+
+FamilyUpdateSchedule::FamilyUpdateSchedule()
+	: mbDirty( true )
+	, mbPartial( false )
+{
+}
+
+FamilyUpdateSchedule::~FamilyUpdateSchedule()
+{
+	Clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FamilyUpdateSchedule::SetFamilies( const PoolString* families, int inumfamilies )
+{
+	mOrder.assign( families, families+inumfamilies );
+	mbDirty = true;
+}
+
+void FamilyUpdateSchedule::Clear()
+{
+	for( size_t i=0; i<mSegments.size(); i++ )
+		delete mSegments[i].mGraph;
+	mSegments.clear();
+	mFamilies.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// families conflicting in a graph keep their update order, so only the
+//  earlier ones of the segment are looked at. a run of described families
+//  only becomes a graph if two of its families can run at the same time
+//  (neither waits for the other, even through others) or a concurrent
+//  family has more than one chunk, else its families go inline one by one
+
+void FamilyUpdateSchedule::Plan( const ComponentFamilyAccess* access, const int* numcomps, int inum,
+								 orkvector<int>& segstarts, orkvector<bool>& seggraph,
+								 orkvector<orkvector<int>>& preds )
+{
+	segstarts.clear();
+	seggraph.clear();
+	preds.clear();
+	preds.resize(inum);
+
+	int i = 0;
+	while( i<inum )
+	{
+		if( false==access[i].mbDescribed )
+		{
+			segstarts.push_back(i);
+			seggraph.push_back(false);
+			i++;
+			continue;
+		}
+
+		int irunstart = i;
+		int irunend = i;
+		while( irunend<inum && access[irunend].mbDescribed )
+			irunend++;
+		int inumrun = irunend-irunstart;
+
+		// after[a][b] : family a (of the run) waits for family b, directly or not
+		orkvector<orkvector<bool>> after( inumrun, orkvector<bool>(inumrun,false) );
+		bool boverlap = false;
+		for( int a=0; a<inumrun; a++ )
+		{
+			int ia = irunstart+a;
+			for( int b=0; b<a; b++ )
+			{
+				if( access[irunstart+b].ConflictsWith(access[ia]) )
+				{
+					preds[ia].push_back(irunstart+b);
+					after[a][b] = true;
+					for( int c=0; c<b; c++ )
+						if( after[b][c] )
+							after[a][c] = true;
+				}
+			}
+			for( int b=0; b<a; b++ )
+				boverlap |= (false==after[a][b]);
+			boverlap |= access[ia].mbConcurrent && (numcomps[ia]>kgrain);
+		}
+
+		if( boverlap )
+		{
+			segstarts.push_back(irunstart);
+			seggraph.push_back(true);
+		}
+		else for( int ia=irunstart; ia<irunend; ia++ )
+		{
+			segstarts.push_back(ia);
+			seggraph.push_back(false);
+			preds[ia].clear();
+		}
+		i = irunend;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void FamilyUpdateSchedule::Build( SceneInst* psi, int ifirstorder )
+{
+	Clear();
+
+	int inumorder = int(mOrder.size());
+	for( int io=ifirstorder; io<inumorder; io++ )
+	{
+		const SceneInst::ComponentList& comps = psi->GetActiveComponents(mOrder[io]);
+		if( comps.empty() )
+			continue;
+		Family fam;
+		fam.mName = mOrder[io];
+		fam.miOrder = io;
+		fam.mAccess = GetFamilyAccess(fam.mName);
+		if( fam.mAccess.mbDescribed )
+			fam.mComponents.assign( comps.begin(), comps.end() );
+		fam.mfStart = 0.0f;
+		fam.mfTime = 0.0f;
+		mFamilies.push_back(fam);
+	}
+
+	int inumfams = int(mFamilies.size());
+	orkvector<ComponentFamilyAccess> access(inumfams);
+	orkvector<int> numcomps(inumfams);
+	for( int i=0; i<inumfams; i++ )
+	{
+		access[i] = mFamilies[i].mAccess;
+		numcomps[i] = int(psi->GetActiveComponents(mFamilies[i].mName).size());
+	}
+	orkvector<int> segstarts;
+	orkvector<bool> seggraph;
+	orkvector<orkvector<int>> preds;
+	Plan( access.data(), numcomps.data(), inumfams, segstarts, seggraph, preds );
+
+	int inumsegs = int(segstarts.size());
+	for( int is=0; is<inumsegs; is++ )
+	{
+		Segment seg;
+		seg.miFirst = segstarts[is];
+		seg.miCount = ((is+1)<inumsegs ? segstarts[is+1] : inumfams)-seg.miFirst;
+		seg.mGraph = nullptr;
+
+		if( seggraph[is] )
+		{
+			TaskGraph* tg = new TaskGraph;
+			orkvector<Task*> ends(inumfams,nullptr);
+			for( int i=seg.miFirst; i<seg.miFirst+seg.miCount; i++ )
+			{
+				Family* pfam = & mFamilies[i];
+				int inumcomps = int(pfam->mComponents.size());
+				int igrain = pfam->mAccess.mbConcurrent ? kgrain : inumcomps;
+
+				Task* begin = tg->CreateTask( [pfam]()
+				{
+					pfam->mfStart = get_sync_time();
+				}, "FamilyBegin" );
+				Task* body = tg->ParallelFor( 0, inumcomps, igrain, [pfam,psi]( int ib, int ie )
+				{
+					for( int ic=ib; ic<ie; ic++ )
+						pfam->mComponents[ic]->Update(psi);
+				}, pfam->mName.c_str() );
+				// the batches are only queued by families writing them, which never overlap
+				Task* end = tg->CreateTask( [pfam,psi]()
+				{
+					uint32_t uwrites = pfam->mAccess.muWrites;
+					lev2::particle::SystemUpdateBatch& psys = psi->GetParticleUpdateBatch();
+					if( (uwrites&EFA_PARTICLES) && psys.GetNumQueued() )
+						psys.Update( ConcurrentOpQ() );
+					lev2::XgmPoseBatch& poses = psi->GetPoseBuildBatch();
+					if( (uwrites&EFA_POSE) && poses.GetNumQueued() )
+						poses.Update( ConcurrentOpQ() );
+					pfam->mfTime = get_sync_time()-pfam->mfStart;
+				}, "FamilyEnd" );
+
+				tg->Precede( begin, body );
+				tg->Precede( body, end );
+				for( size_t ip=0; ip<preds[i].size(); ip++ )
+					tg->Precede( ends[preds[i][ip]], begin );
+				ends[i] = end;
+			}
+			seg.mGraph = tg;
+		}
+		mSegments.push_back(seg);
+	}
+
+	mTimings.reserve( mOrder.size() );
+	mbDirty = false;
+	mbPartial = (ifirstorder>0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// only undescribed families can change the active components (spawners,
+//  scripts..), a later segment is never run from a stale build.
+//  inline families update like they always did, through
+//  SceneInst::UpdateActiveComponents
+
+void FamilyUpdateSchedule::Run( SceneInst* psi )
+{
+	AssertOnOpQ2( UpdateSerialOpQ() );
+
+	if( mbDirty || mbPartial )
+		Build( psi, 0 );
+
+	mTimings.clear();
+
+	size_t iseg = 0;
+	while( iseg<mSegments.size() )
+	{
+		const Segment seg = mSegments[iseg];
+		const Family& first = mFamilies[seg.miFirst];
+
+		if( nullptr==seg.mGraph )
+		{
+			FamilyTiming timing;
+			timing.mFamily = first.mName;
+			timing.miNumComponents = int(psi->GetActiveComponents(first.mName).size());
+			timing.mbConcurrent = false;
+			float ft0 = get_sync_time();
+			psi->UpdateActiveComponents( first.mName );
+			timing.mfTime = get_sync_time()-ft0;
+			mTimings.push_back(timing);
+		}
+		else
+		{
+			seg.mGraph->Launch( ConcurrentOpQ() );
+			seg.mGraph->Wait();
+			for( int i=seg.miFirst; i<seg.miFirst+seg.miCount; i++ )
+			{
+				const Family& fam = mFamilies[i];
+				FamilyTiming timing;
+				timing.mFamily = fam.mName;
+				timing.miNumComponents = int(fam.mComponents.size());
+				timing.mfTime = fam.mfTime;
+				timing.mbConcurrent = true;
+				mTimings.push_back(timing);
+			}
+		}
+
+		int inextorder = mFamilies[seg.miFirst+seg.miCount-1].miOrder+1;
+		if( mbDirty )
+		{
+			Build( psi, inextorder );
+			iseg = 0;
+		}
+		else
+			iseg++;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+}}
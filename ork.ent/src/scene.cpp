@@ -398,18 +398,31 @@ void SceneData::PrepareForEdit()
 	}
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// every unloaded asset is streamed, files are read on the asset io threads
+//  while this thread decodes (loaders may need this thread's gfx target, so
+//  decodes go to a thread-less Opq which only this thread's Waits run).
+// loaded assets can declare more, so repeat until a pass loads nothing.
+///////////////////////////////////////////////////////////////////////////////
 void SceneData::AutoLoadAssets() const
 {
+	Opq decodeq(0,"SceneDecodeQ");
+	OpqTest opqtest(&decodeq);
+	orkvector<asset::AssetLoadHandle> handles;
 	bool loaded;
 	do
 	{	loaded = false;
-		loaded = asset::AssetManager<ArchetypeAsset>::AutoLoad() || loaded;
-		loaded = asset::AssetManager<lev2::XgmAnimAsset>::AutoLoad() || loaded;
-		loaded = asset::AssetManager<lev2::AudioStream>::AutoLoad() || loaded;
-		loaded = asset::AssetManager<lev2::AudioBank>::AutoLoad() || loaded;
-		loaded = asset::AssetManager<lev2::FxShaderAsset>::AutoLoad() || loaded;
-		loaded = asset::AssetManager<lev2::XgmModelAsset>::AutoLoad() || loaded;
-		loaded = asset::AssetManager<lev2::TextureAsset>::AutoLoad() || loaded;
+		handles.clear();
+		asset::AssetManager<ArchetypeAsset>::AutoLoadAsync(handles,&decodeq);
+		asset::AssetManager<lev2::XgmAnimAsset>::AutoLoadAsync(handles,&decodeq);
+		asset::AssetManager<lev2::AudioStream>::AutoLoadAsync(handles,&decodeq);
+		asset::AssetManager<lev2::AudioBank>::AutoLoadAsync(handles,&decodeq);
+		asset::AssetManager<lev2::FxShaderAsset>::AutoLoadAsync(handles,&decodeq);
+		asset::AssetManager<lev2::XgmModelAsset>::AutoLoadAsync(handles,&decodeq);
+		asset::AssetManager<lev2::TextureAsset>::AutoLoadAsync(handles,&decodeq);
+		for( const auto& handle : handles )
+			loaded = handle.Wait() || loaded;
+		while( decodeq.Process() ) {} // decode ops whose requests were waited on
 	}
 	while(loaded);
 }
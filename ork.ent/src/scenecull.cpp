@@ -0,0 +1,402 @@
+////////////////////////////////////////////////////////////////
+// Orkid Media Engine
+// Copyright 1996-2012, Michael T. Mayers.
+// Distributed under the Boost Software License - Version 1.0 - August 17, 2003
+// see http://www.boost.org/LICENSE_1_0.txt
+////////////////////////////////////////////////////////////////
+
+#include <ork/pch.h>
+#include <pkg/ent/scenecull.h>
+#include <pkg/ent/entity.h>
+#include <ork/math/frustum.h>
+#include <ork/math/TransformNode.h>
+#include <math.h>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace ork { namespace ent {
+
+///////////////////////////////////////////////////////////////////////////////
+
+void CullStats::Reset()
+{
+	miNumEntities = 0;
+	miNumVisible = 0;
+	miNumCulled = 0;
+	miNumUnbounded = 0;
+	miNumRefit = 0;
+	miNumFrustums = 0;
+	miNumNodesTested = 0;
+	miNumSpheresTested = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// frustum planes face inwards
+
+namespace {
+
+enum ECullResult
+{
+	ECULL_OUTSIDE = 0,
+	ECULL_PARTIAL,
+	ECULL_INSIDE,
+};
+
+struct CullPlanes
+{
+	const Frustum::plane_type* mPlanes[6];
+
+	CullPlanes( const Frustum& frus )
+	{
+		mPlanes[0] = & frus.mNearPlane;
+		mPlanes[1] = & frus.mFarPlane;
+		mPlanes[2] = & frus.mLeftPlane;
+		mPlanes[3] = & frus.mRightPlane;
+		mPlanes[4] = & frus.mTopPlane;
+		mPlanes[5] = & frus.mBottomPlane;
+	}
+
+	bool TestSphere( const CVector3& ctr, float frad ) const
+	{
+		for( int i=0; i<6; i++ )
+			if( mPlanes[i]->GetPointDistance(ctr) < -frad )
+				return false;
+		return true;
+	}
+
+	// axis aligned cube (center, half extent)
+	ECullResult TestCube( const CVector3& ctr, float fext ) const
+	{
+		ECullResult rval = ECULL_INSIDE;
+		for( int i=0; i<6; i++ )
+		{
+			const CVector3& n = mPlanes[i]->n;
+			float fd = mPlanes[i]->GetPointDistance(ctr);
+			float fr = fext*(fabsf(n.GetX())+fabsf(n.GetY())+fabsf(n.GetZ()));
+			if( fd < -fr )
+				return ECULL_OUTSIDE;
+			if( fd < fr )
+				rval = ECULL_PARTIAL;
+		}
+		return rval;
+	}
+};
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+SceneCullIndex::SceneCullIndex( const CVector3& center, float fhalfsize, int imaxdepth )
+	: mRootCenter( center )
+	, mfRootHalfSize( fhalfsize )
+	, miMaxDepth( imaxdepth )
+	, miOutsideHead( -1 )
+	, miUnboundedHead( -1 )
+	, muQueryStamp( 0 )
+{
+	Clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneCullIndex::Clear()
+{
+	mNodes.clear();
+	mItems.clear();
+	mFreeItems.clear();
+	mItemLut.clear();
+	miOutsideHead = -1;
+	miUnboundedHead = -1;
+
+	Node root;
+	root.mCenter = mRootCenter;
+	root.mfHalfSize = mfRootHalfSize;
+	for( int i=0; i<8; i++ )
+		root.miChildren[i] = -1;
+	root.miParent = -1;
+	root.miFirstItem = -1;
+	root.miCount = 0;
+	mNodes.push_back(root);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int& SceneCullIndex::ListHead( int inode )
+{
+	if( inode>=0 )
+		return mNodes[inode].miFirstItem;
+	return (inode==kOutside) ? miOutsideHead : miUnboundedHead;
+}
+
+void SceneCullIndex::Link( int item, int inode )
+{
+	Item& it = mItems[item];
+	int& head = ListHead(inode);
+	it.miNode = inode;
+	it.miPrev = -1;
+	it.miNext = head;
+	if( head>=0 )
+		mItems[head].miPrev = item;
+	head = item;
+	for( int in=inode; in>=0; in=mNodes[in].miParent )
+		mNodes[in].miCount++;
+}
+
+void SceneCullIndex::Unlink( int item )
+{
+	Item& it = mItems[item];
+	if( it.miPrev>=0 )
+		mItems[it.miPrev].miNext = it.miNext;
+	else
+		ListHead(it.miNode) = it.miNext;
+	if( it.miNext>=0 )
+		mItems[it.miNext].miPrev = it.miPrev;
+	for( int in=it.miNode; in>=0; in=mNodes[in].miParent )
+		mNodes[in].miCount--;
+	it.miPrev = -1;
+	it.miNext = -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// deepest node whose octant holds the center and whose half size holds the
+//  radius (so the sphere is inside the node's loose bounds)
+
+int SceneCullIndex::FindNode( const CVector3& ctr, float frad )
+{
+	CVector3 d = ctr-mRootCenter;
+	if( frad>mfRootHalfSize
+	 || fabsf(d.GetX())>mfRootHalfSize
+	 || fabsf(d.GetY())>mfRootHalfSize
+	 || fabsf(d.GetZ())>mfRootHalfSize )
+		return kOutside;
+
+	int inode = 0;
+	for( int idepth=0; idepth<miMaxDepth; idepth++ )
+	{
+		float fchildhalf = mNodes[inode].mfHalfSize*0.5f;
+		if( frad>fchildhalf )
+			break;
+		const CVector3 c = mNodes[inode].mCenter;
+		int ix = (ctr.GetX()>=c.GetX()) ? 1 : 0;
+		int iy = (ctr.GetY()>=c.GetY()) ? 1 : 0;
+		int iz = (ctr.GetZ()>=c.GetZ()) ? 1 : 0;
+		int ioct = ix|(iy<<1)|(iz<<2);
+		int ichild = mNodes[inode].miChildren[ioct];
+		if( ichild<0 )
+		{
+			Node child;
+			child.mCenter = c+CVector3( ix ? fchildhalf : -fchildhalf,
+										iy ? fchildhalf : -fchildhalf,
+										iz ? fchildhalf : -fchildhalf );
+			child.mfHalfSize = fchildhalf;
+			for( int i=0; i<8; i++ )
+				child.miChildren[i] = -1;
+			child.miParent = inode;
+			child.miFirstItem = -1;
+			child.miCount = 0;
+			ichild = int(mNodes.size());
+			mNodes.push_back(child);
+			mNodes[inode].miChildren[ioct] = ichild;
+		}
+		inode = ichild;
+	}
+	return inode;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneCullIndex::AddEntity( const Entity* pent )
+{
+	if( mItemLut.find(pent)!=mItemLut.end() )
+		return;
+	int item;
+	if( mFreeItems.size() )
+	{
+		item = mFreeItems.back();
+		mFreeItems.pop_back();
+	}
+	else
+	{
+		item = int(mItems.size());
+		mItems.push_back(Item());
+	}
+	Item& it = mItems[item];
+	it.mEntity = pent;
+	it.mXf = nullptr;
+	it.muXfVersion = 0;
+	it.muBoundsVersion = 0;
+	it.mfRadius = 0.0f;
+	it.muQueryStamp = muQueryStamp;
+	Link( item, kUnbounded );
+	mItemLut[pent] = item;
+}
+
+void SceneCullIndex::RemoveEntity( const Entity* pent )
+{
+	auto itl = mItemLut.find(pent);
+	if( itl==mItemLut.end() )
+		return;
+	int item = itl->second;
+	Unlink( item );
+	mItems[item].mEntity = nullptr;
+	mFreeItems.push_back(item);
+	mItemLut.erase(itl);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneCullIndex::PlaceItem( int item, const CVector3& ctr, float frad )
+{
+	int inode = FindNode( ctr, frad );
+	Item& it = mItems[item];
+	it.mCenter = ctr;
+	it.mfRadius = frad;
+	if( inode!=it.miNode )
+	{
+		Unlink( item );
+		Link( item, inode );
+	}
+}
+
+void SceneCullIndex::Place( const Entity* pent, const CVector3& ctr, float frad )
+{
+	auto itl = mItemLut.find(pent);
+	if( itl!=mItemLut.end() )
+		PlaceItem( itl->second, ctr, frad );
+}
+
+void SceneCullIndex::Unplace( const Entity* pent )
+{
+	auto itl = mItemLut.find(pent);
+	if( itl!=mItemLut.end() && mItems[itl->second].miNode!=kUnbounded )
+	{
+		Unlink( itl->second );
+		Link( itl->second, kUnbounded );
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneCullIndex::Refit( CullStats& stats )
+{
+	size_t inumitems = mItems.size();
+	for( size_t i=0; i<inumitems; i++ )
+	{
+		Item& it = mItems[i];
+		const Entity* pent = it.mEntity;
+		if( nullptr==pent )
+			continue;
+		const Transform3DMatrix& xf = pent->GetEffectiveTransform();
+		if( it.miNode!=kUnbounded
+		 && it.mXf==&xf
+		 && it.muXfVersion==xf.GetVersion()
+		 && it.muBoundsVersion==pent->GetBoundsVersion() )
+			continue;
+
+		// unbounded entities are asked again every frame (models still loading)
+		CVector3 ctr;
+		float frad = 0.0f;
+		if( pent->GetBoundingSphere(ctr,frad) )
+		{
+			PlaceItem( int(i), ctr, frad );
+			it.mXf = &xf;
+			it.muXfVersion = xf.GetVersion();
+			it.muBoundsVersion = pent->GetBoundsVersion();
+			stats.miNumRefit++;
+		}
+		else if( it.miNode!=kUnbounded )
+		{
+			Unlink( int(i) );
+			Link( int(i), kUnbounded );
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void SceneCullIndex::Emit( int item )
+{
+	Item& it = mItems[item];
+	if( it.muQueryStamp!=muQueryStamp )
+	{
+		it.muQueryStamp = muQueryStamp;
+		mVisible.push_back(it.mEntity);
+	}
+}
+
+const orkvector<const Entity*>& SceneCullIndex::Query( const Frustum* frustums, int inumfrustums, CullStats& stats )
+{
+	mVisible.clear();
+	muQueryStamp++;
+
+	for( int item=miUnboundedHead; item>=0; item=mItems[item].miNext )
+	{
+		Emit( item );
+		stats.miNumUnbounded++;
+	}
+
+	for( int ifr=0; ifr<inumfrustums; ifr++ )
+	{
+		CullPlanes planes( frustums[ifr] );
+
+		for( int item=miOutsideHead; item>=0; item=mItems[item].miNext )
+		{
+			const Item& it = mItems[item];
+			stats.miNumSpheresTested++;
+			if( planes.TestSphere(it.mCenter,it.mfRadius) )
+				Emit( item );
+		}
+
+		if( 0==mNodes[0].miCount )
+			continue;
+
+		mStack.clear();
+		mStack.push_back( std::make_pair(0,false) );
+		while( mStack.size() )
+		{
+			int inode = mStack.back().first;
+			bool binside = mStack.back().second;
+			mStack.pop_back();
+			const Node& node = mNodes[inode];
+
+			if( false==binside )
+			{
+				stats.miNumNodesTested++;
+				ECullResult res = planes.TestCube( node.mCenter, node.mfHalfSize*2.0f );
+				if( ECULL_OUTSIDE==res )
+					continue;
+				binside = (ECULL_INSIDE==res);
+			}
+
+			for( int item=node.miFirstItem; item>=0; item=mItems[item].miNext )
+			{
+				if( binside )
+					Emit( item );
+				else
+				{
+					const Item& it = mItems[item];
+					stats.miNumSpheresTested++;
+					if( planes.TestSphere(it.mCenter,it.mfRadius) )
+						Emit( item );
+				}
+			}
+
+			for( int i=0; i<8; i++ )
+			{
+				int ichild = node.miChildren[i];
+				if( ichild>=0 && mNodes[ichild].miCount )
+					mStack.push_back( std::make_pair(ichild,binside) );
+			}
+		}
+	}
+
+	stats.miNumFrustums += inumfrustums;
+	stats.miNumEntities = int(mItemLut.size());
+	stats.miNumVisible = int(mVisible.size());
+	stats.miNumCulled = stats.miNumEntities-stats.miNumVisible;
+	return mVisible;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+}}
@@ -13,6 +13,9 @@
 #include <pkg/ent/drawable.h>
 #include <pkg/ent/entity.h>
 #include <pkg/ent/Compositor.h>
+#include <pkg/ent/scenecull.h>
+#include <pkg/ent/familysched.h>
+#include <ork/kernel/taskgraph.h>
 #include <ork/kernel/string/string.h>
 #include <ork/reflect/RegisterProperty.h>
 #include <ork/reflect/DirectObjectMapPropertyType.h>
@@ -20,6 +23,7 @@
 #include <ork/lev2/gfx/renderer.h>
 #include <ork/lev2/gfx/gfxmodel.h>
 #include <ork/lev2/gfx/lighting/gfx_lighting.h>
+#include <ork/lev2/gfx/particle/particle.h>
 #include <ork/lev2/aud/audiodevice.h>
 #include <ork/lev2/aud/audiobank.h>
 #include <ork/asset/AssetManager.h>
@@ -106,6 +110,19 @@ void SceneInst::Describe()
 	sParticleFamily = ork::AddPooledLiteral("particle");
 	sLightFamily = ork::AddPooledLiteral("lighting");
 
+	///////////////////////////////////////////////////
+	// families the update schedule may run off UpdateSerialOpQ
+	//  the others notify entities, spawn or talk to devices : animate sends
+	//  its anim events to the entity as it updates, physics changes the
+	//  scene's delta time to update the bullet family at its own rate.
+	//  so the default families are always updated one after the other,
+	//  lighting and particle are split by animate. they are described for
+	//  the project families which can overlap them (see FamilyUpdateSchedule)
+	///////////////////////////////////////////////////
+
+	DescribeFamily( sLightFamily, EFA_XFORM, EFA_LIGHTS, false ); // nothing to update, no chunks
+	DescribeFamily( sParticleFamily, EFA_XFORM, EFA_XFORM|EFA_PARTICLES, false ); // one particle batch
+
 }
 ///////////////////////////////////////////////////////////////////////////////
 SceneInst::SceneInst( const SceneData* sdata, Application *application )
@@ -123,6 +140,14 @@ SceneInst::SceneInst( const SceneData* sdata, Application *application )
 	, mfAvgDtAcc(0.0f)
 	, mfAvgDtCtr(0.0f)
 	, mEntityUpdateCount(0)
+	, mParticleUpdateBatch( new lev2::particle::SystemUpdateBatch )
+	, mPoseBuildBatch( new lev2::XgmPoseBatch )
+	, mCullIndex( new SceneCullIndex( CVector3(0.0f,0.0f,0.0f), 16384.0f ) ) // beyond that, tested one by one
+	, mCullStats( new CullStats )
+	, mbCullingEnabled( false )
+	, mfCullAspect( 16.0f/9.0f )
+	, mbConcurrentQueue( false )
+	, mFamilySchedule( new FamilyUpdateSchedule )
 {
 	AssertOnOpQ2( UpdateSerialOpQ() );
 	OrkAssertI(mApplication, "SceneInst must be constructed with a non-NULL Application!");
@@ -130,6 +155,10 @@ SceneInst::SceneInst( const SceneData* sdata, Application *application )
 	Layer* player = new Layer;
 	AddLayer( AddPooledLiteral("Default"), player );
 
+	const PoolString families[] = { sInputFamily, sControlFamily, sPhysicsFamily, sFrustumFamily,
+									sLightFamily, sAnimateFamily, sParticleFamily, sAudioFamily };
+	mFamilySchedule->SetFamilies( families, sizeof(families)/sizeof(families[0]) );
+
 	////////////////////////////
 	// create one token
 	////////////////////////////
@@ -174,6 +203,11 @@ SceneInst::~SceneInst()
 	while(DrawableBuffer::mOfflineRenderSynchro.try_pop(rentok)){}
 	while(DrawableBuffer::mOfflineUpdateSynchro.try_pop(rentok)){}
 	////////////////////////////
+	delete mParticleUpdateBatch;
+	delete mPoseBuildBatch;
+	delete mCullIndex;
+	delete mCullStats;
+	delete mFamilySchedule;
 }
 ///////////////////////////////////////////////////////////////////////////
 
@@ -313,12 +347,17 @@ void SceneInst::SlotSceneTopoChanged()
 void SceneInst::UpdateEntityComponents(const SceneInst::ComponentList& components)
 {
 	AssertOnOpQ2( UpdateSerialOpQ() );
-	for(SceneInst::ComponentList::const_iterator it = components.begin(); it != components.end(); ++it)
+	// by index, a component may activate entities (of its own family too)
+	for( size_t i=0; i<components.size(); i++ )
 	{
-		ComponentInst* pci = (*it);
+		ComponentInst* pci = components[i];
 		OrkAssert( pci != 0 );
 		pci->Update(this);
 	}
+	if( mParticleUpdateBatch->GetNumQueued() )
+		mParticleUpdateBatch->Update( ConcurrentOpQ() );
+	if( mPoseBuildBatch->GetNumQueued() )
+		mPoseBuildBatch->Update( ConcurrentOpQ() );
 }
 ///////////////////////////////////////////////////////////////////////////
 ent::Entity* SceneInst::GetEntity( const ent::EntData* pdata ) const
@@ -332,7 +371,20 @@ void SceneInst::SetEntity( const ent::EntData* pentdata, ent::Entity* pent )
 {
 	AssertOnOpQ2( UpdateSerialOpQ() );
 	assert(pent!=nullptr);
-	mEntities[pentdata->GetName()] = pent;
+	InsertEntity( pentdata->GetName(), pent );
+}
+///////////////////////////////////////////////////////////////////////////
+void SceneInst::InsertEntity( const PoolString& name, Entity* pent )
+{
+	Entity*& slot = mEntities[name];
+	if( slot )
+	{
+		mEntityTable.Remove( slot->GetHandle() );
+		mCullIndex->RemoveEntity( slot );
+	}
+	slot = pent;
+	pent->SetHandle( mEntityTable.Add(pent) );
+	mCullIndex->AddEntity( pent );
 }
 ///////////////////////////////////////////////////////////////////////////
 #define ANSI_COLOR_RED     "\x1b[31m"
@@ -358,6 +410,7 @@ void SceneInst::EnterEditState()
 	ork::lev2::AudioDevice::GetDevice()->StopAllVoices();
 	StopEntities();
 	mActiveEntityComponents.clear();
+	mFamilySchedule->Invalidate();
 	mActiveEntities.clear();
 	mEntityDeactivateQueue.clear();
 
@@ -408,6 +461,7 @@ void SceneInst::EnterRunState()
 	ork::lev2::AudioDevice::GetDevice()->StopAllVoices();
 
 	mActiveEntityComponents.clear();
+	mFamilySchedule->Invalidate();
 	mActiveEntities.clear();
 	mEntityDeactivateQueue.clear();
 
@@ -504,17 +558,16 @@ void SceneInst::DecomposeEntities()
 	//std::string bt = get_backtrace();
 	//printf( "%s", bt.c_str() );
 	AssertOnOpQ2( UpdateSerialOpQ() );
-	for( auto item : mEntities )
+	for( ork::ent::Entity* pent : mEntityTable )
 	{
-		const ork::PoolString& name = item.first;
-		ork::ent::Entity* pent = item.second;
-
 		//ork::ent::Archetype* arch = pent->GetArchetype();
 
-		//printf( "deleting ent<%p:%s>\n", pent, name.c_str() );
+		//printf( "deleting ent<%p:%s>\n", pent, pent->GetEntData().GetName().c_str() );
 		delete pent;
 	}
 	mEntities.clear();
+	mEntityTable.Clear();
+	mCullIndex->Clear();
 
 	//printf( "/////////////////////////////////////\n");
 	//printf( "SceneInst<%p> END DecomposeEntities()\n", this );
@@ -569,7 +622,7 @@ void SceneInst::ComposeEntities()
 				arch->ComposeEntity( pent );
 			}
 			assert(pent!=nullptr);
-			mEntities[pentdata->GetName()] = pent;
+			InsertEntity( pentdata->GetName(), pent );
 		}
 	}
 
@@ -795,13 +848,9 @@ void SceneInst::ActivateEntity(ent::Entity* pent)
 			if(fam.empty())
 				continue;
 
-			ActiveComponentType::iterator itl = mActiveEntityComponents.find(fam);
-			if(itl == mActiveEntityComponents.end())
-				mActiveEntityComponents.insert(std::make_pair(fam, orklist<ork::ent::ComponentInst *>()));
-			itl = mActiveEntityComponents.find(fam);
-
-			(itl->second).push_back(cinst);
+			mActiveEntityComponents[fam].push_back(cinst);
 		}
+		mFamilySchedule->Invalidate();
 	}
 	else
 	{
@@ -849,15 +898,16 @@ void SceneInst::DeActivateEntity(ent::Entity* pent)
 		ActiveComponentType::iterator itl = mActiveEntityComponents.find(fam);
 		if(itl != mActiveEntityComponents.end())
 		{
-			orklist<ent::ComponentInst*>& thelist = (*itl).second;
+			ComponentList& thelist = (*itl).second;
 
-			orklist<ent::ComponentInst*>::iterator itc2 = std::find( thelist.begin(), thelist.end(), cinst );
+			ComponentList::iterator itc2 = std::find( thelist.begin(), thelist.end(), cinst );
 
 			// Might not be active if we didn't add it in the first place
 			if(itc2 != thelist.end())
 				thelist.erase(itc2);
 		}
 	}
+	mFamilySchedule->Invalidate();
 }
 
 bool SceneInst::IsEntityActive(Entity* pent) const
@@ -920,7 +970,7 @@ Entity* SceneInst::SpawnDynamicEntity( const ent::EntData* spawn_rec )
 	arch->LinkEntity(this,newent);
 	EntityActivationQueueItem qi( CMatrix4::Identity, newent );
 	this->QueueActivateEntity(qi);
-	mEntities[spawn_rec->GetName()]=newent;
+	InsertEntity( spawn_rec->GetName(), newent );
 	return newent;
 }
 
@@ -952,6 +1002,86 @@ static void CopyCameraData( const SceneInst::CameraLut& srclut, CameraLut& dstlu
 ///////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////
 
+// buffer is a DrawableBuffer, or one of its DrawableBufWriters
+
+template <typename B> static void QueueEntityToBuffer( const Entity* pent, B& buffer )
+{
+	const Entity::LayerMap& entlayers = pent->GetLayers();
+	//const ork::TransformNode3D& node3d = pent->GetDagNode().GetTransformNode();
+
+	DrawQueueXfData xfdata;
+	xfdata.mWorldMatrix = pent->GetEffectiveMatrix();
+
+	//node3d.GetMatrix(xfdata.mWorldMatrix);
+
+	for( Entity::LayerMap::const_iterator itL=entlayers.begin(); itL!=entlayers.end(); itL++ )
+	{
+		const PoolString& layer_name = itL->first;
+		const ent::Entity::DrawableVector* dv = itL->second;
+		DrawableBufLayer* buflayer = buffer.MergeLayer(layer_name);
+		if( dv && buflayer )
+		{
+			size_t inumdv = dv->size();
+			for(size_t i = 0; i < inumdv; i++ )
+			{	Drawable* pdrw = dv->operator[](i);
+				if( pdrw && pdrw->IsEnabled() )
+				{
+					//printf( "queue drw<%p>\n", pdrw );
+					pdrw->QueueToLayer(xfdata,*buflayer);
+				}
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void SceneInst::EnableCulling( bool bena, float faspect )
+{
+	AssertOnOpQ2( UpdateSerialOpQ() );
+	mbCullingEnabled = bena;
+	mfCullAspect = faspect;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void SceneInst::EnableConcurrentQueue( bool bena )
+{
+	AssertOnOpQ2( UpdateSerialOpQ() );
+	mbConcurrentQueue = bena;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// each range of kqueuegrain entities queues through its own writer, they
+//  are merged in range order when the buffer is unlocked
+
+static const int kqueuegrain = 256;
+
+template <typename L> static void QueueEntitiesToBuffer( const L& entities, DrawableBuffer& buffer, bool bconcurrent )
+{
+	int inument = int(entities.size());
+	if( false==bconcurrent || inument<=kqueuegrain )
+	{
+		for( int ie=0; ie<inument; ie++ )
+			QueueEntityToBuffer( entities[ie], buffer );
+		return;
+	}
+	int inumwriters = (inument+kqueuegrain-1)/kqueuegrain;
+	buffer.ReserveWriters( inumwriters );
+	parallel_for( ConcurrentOpQ(), 0, inumwriters, 1, [&entities,&buffer,inument]( int ib, int ie )
+	{
+		for( int iw=ib; iw<ie; iw++ )
+		{
+			DrawableBufWriter& writer = buffer.GetWriter(iw);
+			int iend = std::min( (iw+1)*kqueuegrain, inument );
+			for( int ient=iw*kqueuegrain; ient<iend; ient++ )
+				QueueEntityToBuffer( entities[ient], writer );
+		}
+	});
+}
+
+///////////////////////////////////////////////////////////////////////////
+
 void SceneInst::QueueAllDrawablesToBuffer(ork::ent::DrawableBuffer& buffer) const
 {
 	//orkprintf( "beg si<%p> qad2b..\n", this );
@@ -965,43 +1095,41 @@ void SceneInst::QueueAllDrawablesToBuffer(ork::ent::DrawableBuffer& buffer) cons
 
 	CopyCameraData( mCameraLut, buffer.mCameraDataLUT );
 
+	////////////////////////////////////////////////////////////////
+	// frustums of the copied cameras. The copies' own frustums are
+	//  only computed by whoever renders them, so compute them here
+	//  (gameplay matrices, as CameraDrawable draws them)
 	////////////////////////////////////////////////////////////////
 
-	float t0 = ork::CSystem::GetRef().GetLoResTime();
+	mCullStats->Reset();
 
-	for( const auto& it : mEntities )
+	Frustum frustums[ork::CameraLut::kimax];
+	int inumfrustums = 0;
+	if( mbCullingEnabled )
 	{
-		const ork::ent::Entity* pent = it.second;
-
-		const Entity::LayerMap& entlayers = pent->GetLayers();
-		//const ork::TransformNode3D& node3d = pent->GetDagNode().GetTransformNode();
-
-		//NOTE: No culling! May need "was visible last frame" hack to be fast
-
-		DrawQueueXfData xfdata;
-		xfdata.mWorldMatrix = pent->GetEffectiveMatrix();
-
-		//node3d.GetMatrix(xfdata.mWorldMatrix);
-
-		for( Entity::LayerMap::const_iterator itL=entlayers.begin(); itL!=entlayers.end(); itL++ )
+		for( auto itCAM=buffer.mCameraDataLUT.begin(); itCAM!=buffer.mCameraDataLUT.end(); itCAM++ )
 		{
-			const PoolString& layer_name = itL->first;
-			const ent::Entity::DrawableVector* dv = itL->second;
-			DrawableBufLayer* buflayer = buffer.MergeLayer(layer_name);
-			if( dv && buflayer )
-			{
-				size_t inumdv = dv->size();
-				for(size_t i = 0; i < inumdv; i++ )
-				{	Drawable* pdrw = dv->operator[](i);
-					if( pdrw && pdrw->IsEnabled() )
-					{
-						//printf( "queue drw<%p>\n", pdrw );
-						pdrw->QueueToLayer(xfdata,*buflayer);
-					}
-				}
-			}
+			const CCameraData& camdat = itCAM->second;
+			CameraCalcContext cctx;
+			camdat.CalcCameraMatrices( cctx, std::max(camdat.GetAspect(),mfCullAspect) );
+			frustums[inumfrustums++] = cctx.mFrustum;
 		}
 	}
+
+	////////////////////////////////////////////////////////////////
+
+	if( inumfrustums )
+	{
+		mCullIndex->Refit( *mCullStats );
+		const orkvector<const Entity*>& visible = mCullIndex->Query( frustums, inumfrustums, *mCullStats );
+		QueueEntitiesToBuffer( visible, buffer, mbConcurrentQueue );
+	}
+	else
+	{
+		QueueEntitiesToBuffer( mEntityTable, buffer, mbConcurrentQueue );
+		mCullStats->miNumEntities = int(mEntityTable.size());
+		mCullStats->miNumVisible = int(mEntityTable.size());
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -1031,13 +1159,12 @@ void SceneInst::RenderDrawableBuffer(lev2::Renderer *renderer, const ork::ent::D
 
 				if( DoAll || (Match && pfdata->HasLayer( TestLayerName ) ) )
 				{
-					for( int id=0; id<=player->miItemIndex; id++ )
+					player->ForEachItem( [renderer]( const DrawableBufItem& item )
 					{
-						const DrawableBufItem& item = player->mDrawBufItems[id];
 						const ork::ent::Drawable* pdrw = item.GetDrawable();
 						if(pdrw)
 							pdrw->QueueToRenderer( item, renderer );
-					}
+					});
 				}
 			}
 		}
@@ -1135,6 +1262,11 @@ void SceneInst::UpdateActiveComponents(ork::PoolString family)
 	UpdateEntityComponents(GetActiveComponents(family));
 }
 ///////////////////////////////////////////////////////////////////////////
+const orkvector<FamilyTiming>& SceneInst::GetFamilyTimings() const
+{
+	return mFamilySchedule->GetTimings();
+}
+///////////////////////////////////////////////////////////////////////////
 void SceneInst::AddLayer( const PoolString& name, Layer*player )
 {
 	orkmap<PoolString,Layer*>::const_iterator it=mLayers.find(name);
@@ -1265,18 +1397,9 @@ void SceneInst::Update()
 				if(update)
 				{
 
-					UpdateEntityComponents(GetActiveComponents(sInputFamily));
-					UpdateEntityComponents(GetActiveComponents(sControlFamily));
-					//timer1.Start();
-					UpdateEntityComponents(GetActiveComponents(sPhysicsFamily));
-					//timer1.Stop();
-					//timer2.Start();
-					UpdateEntityComponents(GetActiveComponents(sFrustumFamily));
-					//timer2.Stop();
-					UpdateEntityComponents(GetActiveComponents(sLightFamily));
-					UpdateEntityComponents(GetActiveComponents(sAnimateFamily));
-					UpdateEntityComponents(GetActiveComponents(sParticleFamily));
-					UpdateEntityComponents(GetActiveComponents(sAudioFamily));
+					// input, control, physics, frustum, lighting, animate, particle, audio
+					//  (independent described families at the same time)
+					mFamilySchedule->Run( this );
 
 					///////////////////////////////
 					// update the spawn/despawn queues
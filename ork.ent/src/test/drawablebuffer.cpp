@@ -0,0 +1,118 @@
+#include <ork/pch.h>
+#include <unittest++/UnitTest++.h>
+#include <ork/kernel/opq.h>
+#include <ork/kernel/taskgraph.h>
+#include <pkg/ent/drawable.h>
+
+using namespace ork;
+using namespace ork::ent;
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// the buffer never looks inside the drawables it is handed
+const ent::Drawable* FakeDrawable( int i ) { return reinterpret_cast<const ent::Drawable*>(size_t(i+1)*64); }
+
+bool CheckOrder( const DrawableBufLayer& layer, int inum )
+{
+	int idx = 0;
+	bool bok = (layer.GetNumItems()==inum);
+	layer.ForEachItem( [&]( const DrawableBufItem& item )
+	{
+		bok &= (item.GetDrawable()==FakeDrawable(idx++));
+	});
+	return bok && (idx==inum);
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// layers grow past a chunk, the chunks are reused by the next frame
+
+TEST(DrawableBufferGrowth)
+{
+	bool bempty = true;
+	bool border = true;
+	int inumlayers = 0;
+	int inumchunks = 0;
+
+	// MergeLayer belongs to the update thread
+	UpdateSerialOpQ().push(Op([&]()
+	{
+		DrawableBuffer* pdb = new DrawableBuffer(0);
+		PoolString layername = AddPooledLiteral("All");
+		DrawQueueXfData xfdata;
+		const int knumitems = 20*DrawableBufChunk::kmaxitems+7;
+
+		for( int iframe=0; iframe<3; iframe++ )
+		{
+			pdb->Reset();
+			DrawableBufLayer* player = pdb->MergeLayer(layername);
+			bempty &= (false==player->HasData());
+			for( int i=0; i<knumitems; i++ )
+				player->Queue( xfdata, FakeDrawable(i) );
+			border &= CheckOrder(*player,knumitems);
+			inumlayers = int(pdb->mLayerLut.size());
+		}
+		pdb->Reset();
+		inumchunks = pdb->mArena.GetNumChunks();
+		delete pdb;
+	}));
+	UpdateSerialOpQ().drain();
+
+	CHECK( bempty );
+	CHECK( border );
+	CHECK_EQUAL( 1, inumlayers );
+	CHECK_EQUAL( 21, inumchunks ); // one frame's worth
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// writers filled concurrently merge in writer order, after what the buffer
+//  queued itself
+
+TEST(DrawableBufferWriters)
+{
+	bool border = true;
+	int inumlayers = 0;
+
+	UpdateSerialOpQ().push(Op([&]()
+	{
+		DrawableBuffer* pdb = new DrawableBuffer(0);
+		PoolString layera = AddPooledLiteral("a");
+		PoolString layerb = AddPooledLiteral("b");
+		DrawQueueXfData xfdata;
+		const int knumwriters = 16;
+		const int kperwriter = 1000;
+
+		for( int iframe=0; iframe<2; iframe++ )
+		{
+			pdb->Reset();
+			pdb->MergeLayer(layera)->Queue( xfdata, FakeDrawable(0) );
+			pdb->ReserveWriters(knumwriters);
+			parallel_for( ConcurrentOpQ(), 0, knumwriters, 1, [&]( int ib, int ie )
+			{
+				for( int iw=ib; iw<ie; iw++ )
+				{
+					DrawableBufWriter& writer = pdb->GetWriter(iw);
+					for( int i=0; i<kperwriter; i++ )
+					{
+						int idx = iw*kperwriter+i;
+						writer.MergeLayer(layera)->Queue( xfdata, FakeDrawable(idx+1) );
+						writer.MergeLayer(layerb)->Queue( xfdata, FakeDrawable(idx) );
+					}
+				}
+			});
+			pdb->MergeWriters();
+
+			inumlayers = int(pdb->mLayerLut.size());
+			border &= CheckOrder(*pdb->MergeLayer(layera),knumwriters*kperwriter+1);
+			border &= CheckOrder(*pdb->MergeLayer(layerb),knumwriters*kperwriter);
+		}
+		delete pdb;
+	}));
+	UpdateSerialOpQ().drain();
+
+	CHECK( border );
+	CHECK_EQUAL( 2, inumlayers );
+}
@@ -0,0 +1,330 @@
+#include <ork/pch.h>
+#include <unittest++/UnitTest++.h>
+#include <ork/kernel/opq.h>
+#include <ork/application/application.h>
+#include <ork/reflect/RegisterProperty.h>
+#include <pkg/ent/familysched.h>
+#include <pkg/ent/component.h>
+#include <pkg/ent/componenttable.h>
+#include <pkg/ent/entity.h>
+#include <pkg/ent/scene.h>
+
+using namespace ork;
+using namespace ork::ent;
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+ComponentFamilyAccess Access( uint32_t ureads, uint32_t uwrites )
+{
+	ComponentFamilyAccess acc;
+	acc.muReads = ureads;
+	acc.muWrites = uwrites;
+	acc.mbConcurrent = true;
+	acc.mbDescribed = true;
+	return acc;
+}
+
+ork::atomic<int> gFamTestStamp;
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// undescribed families split the graphs, described ones only wait for the
+//  earlier families of their graph they conflict with
+
+TEST(FamilySchedulePlan)
+{
+	ComponentFamilyAccess access[7];
+	access[0] = ComponentFamilyAccess();							// input (undescribed)
+	access[1] = Access( EFA_XFORM, EFA_LIGHTS );					// lights
+	access[2] = Access( EFA_XFORM, EFA_POSE );						// poses
+	access[3] = Access( EFA_XFORM, EFA_XFORM|EFA_PARTICLES );		// particles
+	access[4] = Access( EFA_LIGHTS, EFA_USER );						// reads what lighting writes
+	access[5] = ComponentFamilyAccess();							// audio (undescribed)
+	access[6] = Access( EFA_XFORM, EFA_CAMERAS );
+	const int numcomps[7] = { 1, 1, 1, 1, 1, 1, 1 };
+
+	orkvector<int> segstarts;
+	orkvector<bool> seggraph;
+	orkvector<orkvector<int>> preds;
+	FamilyUpdateSchedule::Plan( access, numcomps, 7, segstarts, seggraph, preds );
+
+	CHECK_EQUAL( 4, int(segstarts.size()) );
+	CHECK_EQUAL( 0, segstarts[0] );
+	CHECK_EQUAL( 1, segstarts[1] );
+	CHECK_EQUAL( 5, segstarts[2] );
+	CHECK_EQUAL( 6, segstarts[3] );
+	CHECK( false==seggraph[0] );
+	CHECK( seggraph[1] );								// 1 and 2 can overlap
+	CHECK( false==seggraph[2] );
+	CHECK( false==seggraph[3] );						// alone, one chunk
+
+	CHECK_EQUAL( 7, int(preds.size()) );
+	CHECK( preds[1].empty() );
+	CHECK( preds[2].empty() );							// both only read transforms
+	CHECK_EQUAL( 2, int(preds[3].size()) );				// writes what 1 and 2 read
+	CHECK_EQUAL( 1, preds[3][0] );
+	CHECK_EQUAL( 2, preds[3][1] );
+	CHECK_EQUAL( 1, int(preds[4].size()) );
+	CHECK_EQUAL( 1, preds[4][0] );
+	CHECK( preds[6].empty() );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// nothing described, every family runs on its own like it used to
+
+TEST(FamilySchedulePlanUndescribed)
+{
+	ComponentFamilyAccess access[3];
+	const int numcomps[3] = { 100, 100, 100 };
+	orkvector<int> segstarts;
+	orkvector<bool> seggraph;
+	orkvector<orkvector<int>> preds;
+	FamilyUpdateSchedule::Plan( access, numcomps, 3, segstarts, seggraph, preds );
+
+	CHECK_EQUAL( 3, int(segstarts.size()) );
+	for( int i=0; i<3; i++ )
+	{
+		CHECK_EQUAL( i, segstarts[i] );
+		CHECK( false==seggraph[i] );
+		CHECK( preds[i].empty() );
+	}
+	CHECK( access[0].ConflictsWith(access[1]) );
+	CHECK( false==Access(EFA_XFORM,EFA_LIGHTS).ConflictsWith(Access(EFA_XFORM,EFA_AUDIO)) );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// described runs in which nothing can overlap stay inline, a graph is
+//  only built for real parallelism
+
+TEST(FamilySchedulePlanSerial)
+{
+	orkvector<int> segstarts;
+	orkvector<bool> seggraph;
+	orkvector<orkvector<int>> preds;
+
+	// each one waits for the one before (c for a only through b)
+	ComponentFamilyAccess chain[3];
+	chain[0] = Access( EFA_XFORM, EFA_USER );
+	chain[1] = Access( EFA_USER, EFA_USER<<1 );
+	chain[2] = Access( EFA_USER<<1, EFA_USER<<2 );
+	const int fewcomps[3] = { FamilyUpdateSchedule::kgrain, 3, 3 };
+	FamilyUpdateSchedule::Plan( chain, fewcomps, 3, segstarts, seggraph, preds );
+	CHECK_EQUAL( 3, int(segstarts.size()) );
+	for( int i=0; i<3; i++ )
+	{
+		CHECK_EQUAL( i, segstarts[i] );
+		CHECK( false==seggraph[i] );
+		CHECK( preds[i].empty() );
+	}
+
+	// more components than a chunk, the first one is updated in parallel
+	const int manycomps[3] = { FamilyUpdateSchedule::kgrain+1, 3, 3 };
+	FamilyUpdateSchedule::Plan( chain, manycomps, 3, segstarts, seggraph, preds );
+	CHECK_EQUAL( 1, int(segstarts.size()) );
+	CHECK( seggraph[0] );
+	CHECK_EQUAL( 1, int(preds[1].size()) );
+	CHECK_EQUAL( 1, int(preds[2].size()) );
+
+	// ..unless it is not concurrent
+	chain[0].mbConcurrent = false;
+	FamilyUpdateSchedule::Plan( chain, manycomps, 3, segstarts, seggraph, preds );
+	CHECK_EQUAL( 3, int(segstarts.size()) );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// the families SceneInst describes, in its update order : nothing overlaps,
+//  however many components they have
+
+TEST(FamilySchedulePlanDefault)
+{
+	const char* names[] = { "input", "control", "physics", "frustum",
+							"lighting", "animate", "particle", "audio" };
+	const int knum = sizeof(names)/sizeof(names[0]);
+	ComponentFamilyAccess access[knum];
+	int numcomps[knum];
+	for( int i=0; i<knum; i++ )
+	{
+		access[i] = GetFamilyAccess( AddPooledLiteral(names[i]) );
+		numcomps[i] = FamilyUpdateSchedule::kgrain*4;
+	}
+	CHECK( access[4].mbDescribed );
+	CHECK( access[6].mbDescribed );
+
+	orkvector<int> segstarts;
+	orkvector<bool> seggraph;
+	orkvector<orkvector<int>> preds;
+	FamilyUpdateSchedule::Plan( access, numcomps, knum, segstarts, seggraph, preds );
+	CHECK_EQUAL( knum, int(segstarts.size()) );
+	for( int i=0; i<int(segstarts.size()); i++ )
+		CHECK( false==seggraph[i] );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// components of test families, each update takes a stamp. the spawner
+//  (undescribed) activates an entity in the middle of a Run
+
+class FamTestInst : public ComponentInst
+{
+public:
+	FamTestInst( const ComponentData* data, Entity* pent )
+		: ComponentInst( data, pent ), miStamp(0), miNumUpdates(0), mpActivate(nullptr) {}
+
+	int		miStamp;
+	int		miNumUpdates;
+	Entity*	mpActivate;
+
+private:
+	void DoUpdate( SceneInst* psi ) final
+	{
+		miStamp = ++gFamTestStamp;
+		miNumUpdates++;
+		if( mpActivate )
+		{
+			psi->ActivateEntity( mpActivate );
+			mpActivate = nullptr;
+		}
+	}
+};
+
+#define FAMTEST_DATA( name, family ) \
+class name : public ComponentData \
+{ \
+	RttiDeclareConcrete( name, ComponentData ); \
+	ComponentInst* CreateComponent( Entity* pent ) const final { return new FamTestInst(this,pent); } \
+}; \
+void name::Describe() { RegisterFamily<name>(AddPooledLiteral(family)); } \
+INSTANTIATE_TRANSPARENT_RTTI( name, #name );
+
+FAMTEST_DATA( FamTestDataA, "fst_a" )
+FAMTEST_DATA( FamTestDataB, "fst_b" )
+FAMTEST_DATA( FamTestDataC, "fst_c" )
+FAMTEST_DATA( FamTestDataS, "fst_s" )
+FAMTEST_DATA( FamTestDataE, "fst_e" )
+
+///////////////////////////////////////////////////////////////////////////////
+// a (concurrent, more than a chunk) and c overlap, b waits for a,
+//  s is undescribed and activates e, which is then updated in the same Run.
+//  deactivating and activating again rebuilds the schedule
+
+TEST(FamilyScheduleRun)
+{
+	const PoolString families[] = { AddPooledLiteral("fst_a"), AddPooledLiteral("fst_b"), AddPooledLiteral("fst_c"),
+									AddPooledLiteral("fst_s"), AddPooledLiteral("fst_e") };
+	DescribeFamily( families[0], EFA_XFORM, EFA_USER, true );
+	DescribeFamily( families[1], EFA_USER, EFA_USER<<1, false );
+	DescribeFamily( families[2], EFA_XFORM, EFA_USER<<2, false );
+	DescribeFamily( families[4], EFA_XFORM, EFA_USER<<3, false );
+
+	const int knuma = FamilyUpdateSchedule::kgrain*2+5;
+	const int knumb = 3;
+
+	bool border1 = true, border2 = true, border3 = true;
+	int inumtimings = 0;
+	bool bconcurrent_a = false, bconcurrent_s = true;
+	int inumupd_e1 = 0, inumupd_e2 = 0;
+	int inumupd_b0 = 0, inumupd_b1 = 0;
+
+	UpdateSerialOpQ().push(Op([&]()
+	{
+		SceneData* scenedata = new SceneData;
+		SceneInst* psi = new SceneInst( scenedata, ApplicationStack::Top() );
+		FamilyUpdateSchedule& sched = psi->GetFamilySchedule();
+		sched.SetFamilies( families, 5 );
+
+		EntData* entdata = new EntData;
+		FamTestDataA dataa; FamTestDataB datab; FamTestDataC datac;
+		FamTestDataS datas; FamTestDataE datae;
+
+		orkvector<Entity*> entities;
+		auto make = [&]( const ComponentData& data ) -> FamTestInst*
+		{
+			Entity* pent = new Entity( *entdata, psi );
+			FamTestInst* pinst = static_cast<FamTestInst*>( data.CreateComponent(pent) );
+			pent->GetComponents().AddComponent( pinst );
+			pinst->Link( psi );
+			entities.push_back( pent );
+			return pinst;
+		};
+
+		orkvector<FamTestInst*> as, bs, cs;
+		for( int i=0; i<knuma; i++ ) as.push_back( make(dataa) );
+		for( int i=0; i<knumb; i++ ) bs.push_back( make(datab) );
+		for( int i=0; i<2; i++ ) cs.push_back( make(datac) );
+		FamTestInst* ps = make(datas);
+		FamTestInst* pe = make(datae);
+		ps->mpActivate = pe->GetEntity();
+
+		for( Entity* pent : entities )
+			if( pent!=pe->GetEntity() )
+				psi->ActivateEntity( pent );
+
+		auto check_order = [&]() -> bool
+		{
+			int imaxa = 0, iminb = 1<<30;
+			for( auto p : as ) imaxa = std::max( imaxa, p->miStamp );
+			for( auto p : bs ) if( p->GetEntity() && psi->IsEntityActive(p->GetEntity()) ) iminb = std::min( iminb, p->miStamp );
+			int imaxabc = imaxa;
+			for( auto p : bs ) imaxabc = std::max( imaxabc, p->miStamp );
+			for( auto p : cs ) imaxabc = std::max( imaxabc, p->miStamp );
+			return (imaxa<iminb) && (imaxabc<ps->miStamp) && (ps->miStamp<pe->miStamp);
+		};
+
+		////////////////////////////
+		// first run, e joins midway
+		////////////////////////////
+
+		sched.Run( psi );
+		border1 = check_order();
+		inumupd_e1 = pe->miNumUpdates;
+		const orkvector<FamilyTiming>& timings = sched.GetTimings();
+		inumtimings = int(timings.size());
+		for( const FamilyTiming& t : timings )
+		{
+			if( t.mFamily==families[0] ) bconcurrent_a = t.mbConcurrent;
+			if( t.mFamily==families[3] ) bconcurrent_s = t.mbConcurrent;
+		}
+
+		////////////////////////////
+		// deactivated, b0 is left out
+		////////////////////////////
+
+		psi->DeActivateEntity( bs[0]->GetEntity() );
+		sched.Run( psi );
+		border2 = check_order();
+		inumupd_b0 = bs[0]->miNumUpdates;
+		inumupd_e2 = pe->miNumUpdates;
+
+		////////////////////////////
+		// and back in
+		////////////////////////////
+
+		psi->ActivateEntity( bs[0]->GetEntity() );
+		sched.Run( psi );
+		border3 = check_order();
+		inumupd_b1 = bs[0]->miNumUpdates;
+
+		for( Entity* pent : entities )
+			if( psi->IsEntityActive(pent) )
+				psi->DeActivateEntity( pent );
+		for( Entity* pent : entities )
+			delete pent;
+		delete entdata;
+		delete psi;
+		delete scenedata;
+	}));
+	UpdateSerialOpQ().drain();
+
+	CHECK( border1 );
+	CHECK( border2 );
+	CHECK( border3 );
+	CHECK_EQUAL( 5, inumtimings );
+	CHECK( bconcurrent_a );
+	CHECK( false==bconcurrent_s );
+	CHECK_EQUAL( 1, inumupd_e1 );
+	CHECK_EQUAL( 2, inumupd_e2 );
+	CHECK_EQUAL( 1, inumupd_b0 );
+	CHECK_EQUAL( 2, inumupd_b1 );
+}
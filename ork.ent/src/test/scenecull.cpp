@@ -0,0 +1,175 @@
+#include <ork/pch.h>
+#include <unittest++/UnitTest++.h>
+#include <stdio.h>
+#include <math.h>
+#include <set>
+#include <ork/math/cvector2.h>
+#include <ork/math/cmatrix4.h>
+#include <ork/math/frustum.h>
+#include <ork/kernel/timer.h>
+#include <pkg/ent/scenecull.h>
+
+using namespace ork;
+using namespace ork::ent;
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct CullTestScene
+{
+	static const int knumitems = 20000;
+
+	// the index never looks inside the entities it is handed, placed by hand here
+	static const Entity* FakeEntity( int i ) { return reinterpret_cast<const Entity*>(size_t(i+1)*64); }
+
+	CullTestScene()
+		: mIndex( CVector3(0.0f,0.0f,0.0f), 1024.0f )
+		, muSeed( 12345 )
+	{
+		for( int i=0; i<knumitems; i++ )
+		{
+			mIndex.AddEntity( FakeEntity(i) );
+			Move(i);
+		}
+	}
+
+	float Rand( float fmin, float fmax )
+	{
+		muSeed = muSeed*1664525u+1013904223u;
+		return fmin+(fmax-fmin)*float(muSeed>>8)/float(1<<24);
+	}
+
+	void Move( int i )
+	{
+		// mostly small things, a few big ones and some outside the root
+		float fext = (i%97)==0 ? 1500.0f : 1000.0f;
+		mCenter[i] = CVector3( Rand(-fext,fext), Rand(-50.0f,50.0f), Rand(-fext,fext) );
+		mRadius[i] = (i%31)==0 ? Rand(50.0f,400.0f) : Rand(0.5f,8.0f);
+		mUnbounded[i] = false;
+		mIndex.Place( FakeEntity(i), mCenter[i], mRadius[i] );
+	}
+
+	static bool SphereVisible( const Frustum& frus, const CVector3& ctr, float frad )
+	{
+		const Frustum::plane_type* planes[6] = { &frus.mNearPlane, &frus.mFarPlane, &frus.mLeftPlane,
+												 &frus.mRightPlane, &frus.mTopPlane, &frus.mBottomPlane };
+		for( int i=0; i<6; i++ )
+			if( planes[i]->GetPointDistance(ctr) < -frad )
+				return false;
+		return true;
+	}
+
+	// brute force against the index, returns the number visible
+	int Check( const Frustum* frustums, int inumfrustums, CullStats& stats, bool& bmatch )
+	{
+		std::set<const Entity*> expected;
+		for( int i=0; i<knumitems; i++ )
+		{
+			if( mRemoved.count(i) )
+				continue;
+			bool bvis = mUnbounded[i];
+			for( int f=0; f<inumfrustums && false==bvis; f++ )
+				bvis = SphereVisible( frustums[f], mCenter[i], mRadius[i] );
+			if( bvis )
+				expected.insert( FakeEntity(i) );
+		}
+		const orkvector<const Entity*>& visible = mIndex.Query( frustums, inumfrustums, stats );
+		std::set<const Entity*> got( visible.begin(), visible.end() );
+		bmatch = (got==expected) && (got.size()==visible.size());
+		return int(visible.size());
+	}
+
+	SceneCullIndex mIndex;
+	CVector3 mCenter[knumitems];
+	float mRadius[knumitems];
+	bool mUnbounded[knumitems];
+	std::set<int> mRemoved;
+	uint32_t muSeed;
+};
+
+static Frustum MakeFrustum( const CVector3& eye, const CVector3& tgt, float faper, float ffar )
+{
+	CMatrix4 matv, matp;
+	matv.LookAt( eye, tgt, CVector3(0.0f,1.0f,0.0f) );
+	matp.Perspective( faper, 16.0f/9.0f, 1.0f, ffar );
+	Frustum frus;
+	frus.Set( matv, matp );
+	return frus;
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// the octree query gives exactly what testing every sphere gives, through
+//  moves, removals, unbounded entities and more than one camera
+
+TEST(SceneCullMatchesBruteForce)
+{
+	CullTestScene* scene = new CullTestScene;
+
+	Frustum frustums[2];
+	frustums[0] = MakeFrustum( CVector3(0.0f,20.0f,0.0f), CVector3(300.0f,0.0f,200.0f), 45.0f, 800.0f );
+	frustums[1] = MakeFrustum( CVector3(-900.0f,100.0f,-900.0f), CVector3(-1200.0f,0.0f,-1000.0f), 30.0f, 2000.0f );
+
+	bool bmatch = false;
+	CullStats stats;
+	int inumvis = scene->Check( frustums, 1, stats, bmatch );
+	CHECK( bmatch );
+	CHECK( inumvis > 0 );
+	CHECK( inumvis < CullTestScene::knumitems/4 );
+	CHECK_EQUAL( CullTestScene::knumitems, stats.miNumEntities );
+	CHECK_EQUAL( CullTestScene::knumitems-inumvis, stats.miNumCulled );
+	CHECK( stats.miNumSpheresTested < CullTestScene::knumitems/2 );
+
+	for( int iframe=0; iframe<8; iframe++ )
+	{
+		for( int i=iframe; i<CullTestScene::knumitems; i+=7 )
+			scene->Move(i);
+		for( int i=iframe*13; i<CullTestScene::knumitems; i+=501 )
+		{
+			scene->mUnbounded[i] = true;
+			scene->mIndex.Unplace( CullTestScene::FakeEntity(i) );
+		}
+		for( int i=iframe*17+5; i<CullTestScene::knumitems; i+=1003 )
+		{
+			scene->mRemoved.insert(i);
+			scene->mIndex.RemoveEntity( CullTestScene::FakeEntity(i) );
+		}
+		stats.Reset();
+		scene->Check( frustums, 2, stats, bmatch );
+		CHECK( bmatch );
+		CHECK_EQUAL( int(CullTestScene::knumitems-scene->mRemoved.size()), stats.miNumEntities );
+		CHECK( stats.miNumUnbounded > 0 );
+	}
+	delete scene;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// query time against testing every sphere
+
+TEST(SceneCullBench)
+{
+	CullTestScene* scene = new CullTestScene;
+	Frustum frus = MakeFrustum( CVector3(0.0f,20.0f,0.0f), CVector3(300.0f,0.0f,200.0f), 45.0f, 800.0f );
+	const int knumiters = 200;
+
+	float ft0 = get_sync_time();
+	int inumbrute = 0;
+	for( int it=0; it<knumiters; it++ )
+		for( int i=0; i<CullTestScene::knumitems; i++ )
+			inumbrute += CullTestScene::SphereVisible( frus, scene->mCenter[i], scene->mRadius[i] ) ? 1 : 0;
+	float ft1 = get_sync_time();
+	int inumindex = 0;
+	CullStats stats;
+	for( int it=0; it<knumiters; it++ )
+		inumindex += int(scene->mIndex.Query( &frus, 1, stats ).size());
+	float ft2 = get_sync_time();
+
+	float fbrute = (ft1-ft0)*1.0e6f/float(knumiters);
+	float findex = (ft2-ft1)*1.0e6f/float(knumiters);
+	printf( "SceneCullBench %d entities visible<%d> : brute<%f us> octree<%f us> (x%f) nodes<%d>\n",
+			CullTestScene::knumitems, inumindex/knumiters, fbrute, findex, fbrute/findex, int(scene->mIndex.GetNumNodes()) );
+	CHECK_EQUAL( inumbrute, inumindex );
+	delete scene;
+}
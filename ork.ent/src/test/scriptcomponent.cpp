@@ -0,0 +1,229 @@
+#include <ork/pch.h>
+#include <unittest++/UnitTest++.h>
+#include <ork/kernel/opq.h>
+#include <ork/application/application.h>
+#include <ork/file/file.h>
+#include <ork/reflect/RegisterProperty.h>
+#include <pkg/ent/entity.h>
+#include <pkg/ent/scene.h>
+#include <pkg/ent/scene.hpp>
+#include <pkg/ent/ScriptComponent.h>
+
+using namespace ork;
+using namespace ork::ent;
+
+///////////////////////////////////////////////////////////////////////////////
+// the count module errors on the entities marked bad, the notify module
+//  asks its sink for an event and the scene for an entity every update
+
+namespace {
+
+const char* kCountModuleText =
+	"local m = {}\n"
+	"function m.OnEntityLink(tab) tab.n = 0 end\n"
+	"function m.OnEntityStart(tab) end\n"
+	"function m.OnEntityStop(tab) end\n"
+	"function m.OnEntityUpdate(tab,dt)\n"
+	"    if tab.bad then error(\"bad entity\") end\n"
+	"    tab.n = tab.n+1\n"
+	"end\n"
+	"return m\n";
+
+const char* kNotifyModuleText =
+	"local m = {}\n"
+	"local nspawned = 0\n"
+	"function m.OnEntityLink(tab) tab.n = 0 end\n"
+	"function m.OnEntityStart(tab) end\n"
+	"function m.OnEntityStop(tab) end\n"
+	"function m.OnEntityUpdate(tab,dt)\n"
+	"    tab.n = tab.n+1\n"
+	"    tab.sink:sendEvent(\"scripttest\",{n=tab.n})\n"
+	"    nspawned = nspawned+1\n"
+	"    local spawned = ork.scene():spawn(tab.arch,\"scripttest_spawn\"..nspawned,{pos=ork.vec3(0,0,0)})\n"
+	"    tab.spawnednil = (spawned==nil)\n"
+	"end\n"
+	"return m\n";
+
+void WriteScript( const file::Path& pth, const char* ptext )
+{
+	CFile scriptfile( pth, EFM_WRITE );
+	scriptfile.Write( ptext, strlen(ptext) );
+	scriptfile.Close();
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace ork { namespace ent {
+
+class ScriptTestArch : public Archetype
+{
+	RttiDeclareConcrete( ScriptTestArch, Archetype );
+	void DoStartEntity( SceneInst* psi, const CMatrix4& world, Entity* pent ) const final {}
+	void DoCompose( ArchComposer& composer ) final {}
+};
+void ScriptTestArch::Describe() {}
+
+// records the events it is sent, and whether the module's last entity had
+//  been updated as often by then
+
+class ScriptTestSink : public ComponentInst
+{
+public:
+	ScriptTestSink( Entity* pent, const LuaRef& lasttab )
+		: ComponentInst( nullptr, pent ), mbAfterUpdate(true), mLastTab(lasttab) {}
+
+	orkvector<int>	mEventNs;
+	bool			mbAfterUpdate;
+
+private:
+	bool DoNotify( const ork::event::Event* event ) final
+	{
+		if( const ork::event::VEvent* vev = ork::rtti::autocast(event) )
+		{
+			const auto& LR = vev->mData.Get<LuaRef>();
+			int n = LR.get<int>("n");
+			mEventNs.push_back( n );
+			mbAfterUpdate &= (mLastTab.get<int>("n")==n);
+		}
+		return true;
+	}
+
+	LuaRef mLastTab;
+};
+
+}}
+
+INSTANTIATE_TRANSPARENT_RTTI( ork::ent::ScriptTestArch, "ScriptTestArch" );
+
+///////////////////////////////////////////////////////////////////////////////
+// a module on the main state and one on a worker state, updated from the
+//  batch leader. each entity gets its own call, one erroring entity does not
+//  keep the others of its module from updating, and the worker's events and
+//  spawns only happen at FlushDeferred, in the order they were asked for
+
+TEST(ScriptBatchedUpdate)
+{
+	const int knumframes = 2;
+
+	int inumcount[3] = { -1, -1, -1 };
+	int inumnotify[2] = { -1, -1 };
+	bool bspawnednil = true;
+	bool bafterupdate = true;
+	int inumspawned = 0;
+	orkvector<int> eventns[2];
+
+	UpdateSerialOpQ().push(Op([&]()
+	{
+		const file::Path countpath("temp://scripttest_count.lua");
+		const file::Path notifypath("temp://scripttest_notify.lua");
+		WriteScript( countpath, kCountModuleText );
+		WriteScript( notifypath, kNotifyModuleText );
+
+		SceneData* scenedata = new SceneData;
+		ScriptTestArch* parch = new ScriptTestArch;
+		parch->SetName( AddPooledLiteral("ScriptTestArch") );
+		scenedata->AddSceneObject( parch );
+
+		SceneInst* psi = new SceneInst( scenedata, ApplicationStack::Top() );
+		ScriptManagerComponentData smcd;
+		smcd.SetBatchedUpdate( true );
+		smcd.SetNumWorkerStates( 1 );
+		const SystemData& sysdata = smcd;
+		psi->AddSystem( sysdata.createSystem(psi) );
+
+		ScriptComponentData countdata;
+		ScriptComponentData notifydata;
+		countdata.SetPath( countpath );		// first loaded, main state
+		notifydata.SetPath( notifypath );	// worker state
+
+		EntData* entdata = new EntData;
+		orkvector<Entity*> entities;
+		orkvector<ScriptComponentInst*> scripts;
+		orkvector<ScriptTestSink*> sinks;
+		auto make = [&]( const ScriptComponentData& data ) -> ScriptComponentInst*
+		{
+			Entity* pent = new Entity( *entdata, psi );
+			const ComponentData& cdata = data;
+			ScriptComponentInst* pinst = static_cast<ScriptComponentInst*>( cdata.CreateComponent(pent) );
+			pent->GetComponents().AddComponent( pinst );
+			pinst->Link( psi );
+			entities.push_back( pent );
+			scripts.push_back( pinst );
+			return pinst;
+		};
+
+		for( int i=0; i<3; i++ )
+			make( countdata );
+		{	LuaRef badtab = scripts[1]->GetEntTable();
+			badtab["bad"] = true;
+		}
+
+		for( int i=0; i<2; i++ )
+			make( notifydata );
+		for( int i=0; i<2; i++ )
+		{
+			ScriptComponentInst* pinst = scripts[3+i];
+			ScriptTestSink* psink = new ScriptTestSink( pinst->GetEntity(), scripts[4]->GetEntTable() );
+			LuaRef tab = pinst->GetEntTable();
+			tab["sink"] = static_cast<ComponentInst*>(psink);
+			tab["arch"] = parch->GetName().c_str(); // AddSceneObject numbered it
+			sinks.push_back( psink );
+		}
+
+		for( auto pinst : scripts )
+			pinst->Start( psi, CMatrix4::Identity );
+
+		////////////////////////////
+		// the leader updates everyone, the others are NOPs
+		////////////////////////////
+
+		for( int iframe=0; iframe<knumframes; iframe++ )
+			for( auto pinst : scripts )
+				pinst->Update( psi );
+
+		for( int i=0; i<3; i++ )
+			inumcount[i] = scripts[i]->GetEntTable().get<int>("n");
+		for( int i=0; i<2; i++ )
+		{
+			inumnotify[i] = scripts[3+i]->GetEntTable().get<int>("n");
+			bspawnednil &= scripts[3+i]->GetEntTable().get<bool>("spawnednil");
+			eventns[i] = sinks[i]->mEventNs;
+			bafterupdate &= sinks[i]->mbAfterUpdate;
+		}
+		for( int i=1; i<=knumframes*2; i++ )
+		{
+			fxstring<64> entname;
+			entname.format( "scripttest_spawn%d", i );
+			if( psi->FindEntity(AddPooledString(entname.c_str())) )
+				inumspawned++;
+		}
+
+		for( auto pinst : scripts )
+			pinst->Stop( psi );
+		for( auto psink : sinks )
+			delete psink;
+		for( Entity* pent : entities )
+			delete pent;
+		delete entdata;
+		delete psi;
+		delete scenedata;
+	}));
+	UpdateSerialOpQ().drain();
+
+	CHECK_EQUAL( knumframes, inumcount[0] );
+	CHECK_EQUAL( 0, inumcount[1] );
+	CHECK_EQUAL( knumframes, inumcount[2] );
+	CHECK_EQUAL( knumframes, inumnotify[0] );
+	CHECK_EQUAL( knumframes, inumnotify[1] );
+	CHECK( bspawnednil );
+	CHECK( bafterupdate );
+	CHECK_EQUAL( knumframes*2, inumspawned );
+	for( int i=0; i<2; i++ )
+	{
+		CHECK_EQUAL( knumframes, int(eventns[i].size()) );
+		for( int j=0; j<int(eventns[i].size()); j++ )
+			CHECK_EQUAL( j+1, eventns[i][j] );
+	}
+}
@@ -0,0 +1,150 @@
+////////////////////////////////////////////////////////////////
+// Orkid Media Engine
+// Copyright 1996-2012, Michael T. Mayers.
+// Distributed under the Boost Software License - Version 1.0 - August 17, 2003
+// see http://www.boost.org/LICENSE_1_0.txt
+////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// DrawList
+//
+//  the sorted render queue, compiled into commands : models which share
+//   geometry, material, pass and layer (a DrawBucketKey) are gathered into
+//   one EDRAWCMD_INSTANCES command with contiguous instance arrays, placed
+//   where the first of them sorted. everything else is one
+//   EDRAWCMD_RENDERABLE command each, in sort order.
+//
+//  models are only gathered across other instanced models : a renderable
+//   which is not instanced (callbacks, transparent models, ..) starts a new
+//   span, and nothing is moved across it.
+//
+//  DrawListCompiler buckets in parallel (ConcurrentOpQ) for big queues :
+//   chunks of the sorted queue are bucketed on their own, merged in chunk
+//   order, then write their instances to their final slots.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <ork/lev2/gfx/renderqueue.h>
+#include <ork/math/cmatrix4.h>
+
+namespace ork { namespace lev2 {
+
+class GfxMaterial;
+class CModelRenderable;
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct DrawBucketKey
+{
+	DrawBucketKey()
+		: mGeometry(nullptr)
+		, mMaterial(nullptr)
+		, miMaterialPass(0)
+		, miSortGroup(0)
+		, miSpan(0)
+	{
+	}
+
+	bool operator==( const DrawBucketKey& oth ) const
+	{
+		return	(mGeometry==oth.mGeometry)
+			&&	(mMaterial==oth.mMaterial)
+			&&	(miMaterialPass==oth.miMaterialPass)
+			&&	(miSortGroup==oth.miSortGroup)
+			&&	(miSpan==oth.miSpan);
+	}
+
+	size_t Hash() const;
+
+	const void*			mGeometry;		// XgmCluster for models
+	const GfxMaterial*	mMaterial;
+	int					miMaterialPass;
+	int					miSortGroup;	// pass and layer bytes of the sort key, filled in by the compiler
+	int					miSpan;			// non instanced renderables sorted before it, filled in by the compiler
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+enum EDrawCommand
+{
+	EDRAWCMD_RENDERABLE = 0,	// mpRenderable->Render()
+	EDRAWCMD_INSTANCES,			// miNumInstances models of the same bucket
+};
+
+struct DrawCommand
+{
+	EDrawCommand		meType;
+	const IRenderable*	mpRenderable;		// EDRAWCMD_RENDERABLE
+	const Object*		mpContextObject;	// of the renderable, or the first instance
+	DrawBucketKey		mKey;				// EDRAWCMD_INSTANCES
+	int					miFirstInstance;
+	int					miNumInstances;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+class DrawList
+{
+public:
+
+	void Clear();
+
+	int GetNumCommands() const { return int(mCommands.size()); }
+	const DrawCommand& GetCommand( int idx ) const { return mCommands[idx]; }
+	int GetNumInstances() const { return int(mInstanceModels.size()); }
+
+	const CModelRenderable* const* GetInstanceModels( const DrawCommand& cmd ) const { return mInstanceModels.data()+cmd.miFirstInstance; }
+	const CMatrix4* GetInstanceMatrices( const DrawCommand& cmd ) const { return mInstanceMatrices.data()+cmd.miFirstInstance; }
+
+private:
+
+	friend class DrawListCompiler;
+
+	orkvector<DrawCommand>				mCommands;
+	orkvector<const CModelRenderable*>	mInstanceModels;
+	orkvector<CMatrix4>					mInstanceMatrices;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+class DrawListCompiler
+{
+public:
+
+	static const int kparallelsize = 4096;	// queues at least this big are bucketed on ConcurrentOpQ
+	static const int kchunksize = 2048;
+
+	DrawListCompiler();
+	~DrawListCompiler();
+
+	// pnodes[psorted[i]] is the i'th node in sort order, pkeys are the nodes sort keys
+	void Compile( const RenderQueue::Node* const* pnodes, const U32* psorted, const U64* pkeys, int inumnodes, DrawList& list );
+
+private:
+
+	struct Chunk;
+	struct GlobalBucket
+	{
+		DrawBucketKey	mKey;
+		int				miFirst;	// sorted position of the first instance
+		int				miCount;
+		int				miBase;		// first instance slot
+	};
+
+	void BucketChunk( Chunk& chunk, const RenderQueue::Node* const* pnodes, const U32* psorted, const U64* pkeys ); // spans local to the chunk
+	void FillChunk( Chunk& chunk, DrawList& list ) const;
+	int FindOrAddGlobal( const DrawBucketKey& key, int ifirst );
+
+	orkvector<Chunk*>			mChunks;
+	orkvector<GlobalBucket>		mGlobalBuckets;
+	orkvector<int>				mGlobalTable;	// open addressed, bucket index or -1
+	orkvector<int>				mGlobalFill;
+
+	DrawListCompiler( const DrawListCompiler& );
+	DrawListCompiler& operator=( const DrawListCompiler& );
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+} } // namespace ork::lev2
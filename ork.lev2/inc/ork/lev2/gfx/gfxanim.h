@@ -11,6 +11,8 @@
 #include <ork/math/box.h>
 #include <ork/file/path.h>
 
+namespace ork { struct Opq; }
+
 namespace ork { namespace lev2 {
 
 class XgmAnim;
@@ -170,6 +172,73 @@ struct DecompMtx44
 	void EndianSwap();
 };
 
+/// ///////////////////////////////////////////////////////////////////////////
+/// Compressed joint track (offline : Encode, runtime : Sample)
+///  rotations : smallest three, 15 bits per element, the index of the
+///              dropped element in the top bits of the first two
+///  positions, scales : 16 bits per element, range reduced over the track
+///  rotation, position and scale each keep only the keys needed to stay
+///  within the tolerances (a constant one keeps a single key),
+///  frames between keys are interpolated (nlerp / lerp)
+/// ///////////////////////////////////////////////////////////////////////////
+
+struct XgmAnimCompression
+{
+	float mfRotTolerance;	// radians
+	float mfPosTolerance;	// units
+	float mfScaleTolerance;
+
+	XgmAnimCompression() : mfRotTolerance(0.001f), mfPosTolerance(0.0005f), mfScaleTolerance(0.0005f) {}
+};
+
+struct XgmAnimTrack
+{
+	enum EComponent
+	{
+		ECOMP_ROT = 0,	// 3 values per key
+		ECOMP_POS,		// 3 values per key
+		ECOMP_SCALE,	// 1 value per key
+		ECOMP_COUNT,
+	};
+
+	struct Component
+	{
+		int miNumKeys;
+		int miFirstKey;		// into mKeyFrames
+		int miFirstValue;	// into mValues
+		int miFirstSeek;	// into mKeySeek
+	};
+
+	static const int kseekshift = 3;	// a seek entry every 8 frames
+
+	Component				mComponents[ECOMP_COUNT];
+	float					mPosMin[3];
+	float					mPosExtent[3];
+	float					mScaleMin;
+	float					mScaleExtent;
+	orkvector<U16>			mKeyFrames;
+	orkvector<U16>			mValues;
+	orkvector<U16>			mKeySeek;	// key at or before each 8th frame, built from mKeyFrames (not saved)
+
+	XgmAnimTrack();
+
+	void Encode( const DecompMtx44* pframes, int inumframes, const XgmAnimCompression& settings );
+	void Sample( float frame, DecompMtx44& out ) const;
+	void BuildKeySeek();
+
+	// frame is clamped to the keys, rval is the first key, ft the fraction to the next
+	int FindKey( EComponent ec, float frame, float& ft ) const;
+	// last key at or before iframe (iframe>=0), the next key is rval+1 unless rval is the last
+	int SeekKey( EComponent ec, int iframe ) const;
+	int GetNumKeys( EComponent ec ) const { return mComponents[ec].miNumKeys; }
+	// a channel without frames encodes to no keys, it samples to the identity
+	bool IsEmpty() const { return 0==mComponents[ECOMP_ROT].miNumKeys || 0==mComponents[ECOMP_POS].miNumKeys || 0==mComponents[ECOMP_SCALE].miNumKeys; }
+	size_t GetMemorySize() const;
+
+	static void EncodeRot( const CQuaternion& q, U16* pout );
+	static CQuaternion DecodeRot( const U16* pin );
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 
 class XgmDecompAnimChannel : public XgmAnimChannel
@@ -184,15 +253,26 @@ protected:
 	DecompMtx44*			mSampledFrames;
 	int						miNumFrames;
 	int						miAddIndex;
+	XgmAnimTrack*			mpTrack;		// replaces mSampledFrames once compressed
 
 public:
 
 	XgmDecompAnimChannel( const PoolString& ObjName, const PoolString & ChanName, const PoolString & Usage );
 	XgmDecompAnimChannel();
+	~XgmDecompAnimChannel();
 
 	void AddFrame( const DecompMtx44& v );
-	const DecompMtx44& GetFrame( int index ) const;
+	DecompMtx44 GetFrame( int index ) const;
 	void ReserveFrames( int iv );
+
+	void Compress( const XgmAnimCompression& settings );	/// encodes the added frames, and releases them
+	void SetTrack( XgmAnimTrack* ptrack, int inumframes );	/// takes ownership (loading)
+	bool IsCompressed() const { return mpTrack!=0; }
+	const XgmAnimTrack* GetTrack() const { return mpTrack; }
+	size_t GetMemorySize() const;
+
+	/// samples inum channels at once (a pose), compressed ones 4 at a time
+	static void SampleChannels( const XgmDecompAnimChannel* const* pchannels, int inum, float frame, DecompMtx44* pout );
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -235,6 +315,7 @@ public:
 
 	void AddChannel( const PoolString &Name, XgmAnimChannel*pchan );
 	void SetNumFrames( int ifr ) { miNumFrames=ifr; }
+	void CompressJointChannels( const XgmAnimCompression& settings );
 
 	//////////////////////////
 
@@ -383,7 +464,7 @@ struct XgmBone
 /// Blend Pose Info (one per joint)
 ///  record all weighted matrices for a given joint
 ///  combines weighted matrices for a given joint to a single matrix
-///  will eventually use pre-decomposed transforms
+///  (2 anims lerp by the second weight, more blend by normalized weights)
 /// ///////////////////////////////////////////////////////////////////////////
 
 struct PoseCallback
@@ -396,7 +477,7 @@ struct XgmBlendPoseInfo
 {
 public:
 
-	static const int kmaxblendanims = 2;
+	static const int kmaxblendanims = 4;
 
 	XgmBlendPoseInfo();
 
@@ -406,6 +487,9 @@ public:
 	void ComputeMatrix(CMatrix4 &mtx) const;
 
 	int GetNumAnims() const { return miNumAnims; }
+	const DecompMtx44& GetAnimMat( int i ) const { return AnimMat[i]; }
+	CReal GetAnimWeight( int i ) const { return AnimWeight[i]; }
+	EXFORM_COMPONENT GetAnimComponents( int i ) const { return AnimComponents[i]; }
 
 	void SetPoseCallback(PoseCallback *callback) { mPoseCallback = callback; }
 	PoseCallback *GetPoseCallback() const { return mPoseCallback; }
@@ -425,6 +509,7 @@ private:
 /// Local Pose
 ///  a pose of a skeleton in local(object) space 
 ///  may have multiple matrices per joint
+///  blends joints 4 at a time in BlendPose() (structure of arrays),
 ///  computes bounding volumes in Concatenate()
 /// ///////////////////////////////////////////////////////////////////////////
 
@@ -435,7 +520,10 @@ class XgmLocalPose
 	orkvector<XgmBlendPoseInfo>		mBlendPoseInfos;
 	CVector4						mObjSpaceBoundingSphere;
 	AABox							mObjSpaceAABoundingBox;
+	orkvector<int>					mBlendJoints;	// BlendPose scratch
+	orkvector<float>				mBlendLanes;	// BlendPose scratch
 
+	void BlendPose( void );
 	void Concatenate( void );
 
 public:
@@ -467,6 +555,26 @@ public:
 
 };
 
+/// ///////////////////////////////////////////////////////////////////////////
+/// Pose Batch
+///  builds (BuildPose) many local poses as tasks on an Opq, eg. a crowd
+///  each pose is built on one thread, poses must not be queued twice
+/// ///////////////////////////////////////////////////////////////////////////
+
+class XgmPoseBatch
+{
+public:
+
+	void Queue( XgmLocalPose* ppose );
+	void Update( Opq& the_opq );	// builds and clears everything queued
+
+	int GetNumQueued() const { return int(mPoses.size()); }
+
+private:
+
+	orkvector<XgmLocalPose*>		mPoses;
+};
+
 /// ////////////////////////////////////////////////////////////////////////////
 /// material state instance (analogous to XgmLocalPose for materials)
 /// ////////////////////////////////////////////////////////////////////////////
@@ -15,6 +15,7 @@
 #include <ork/dataflow/dataflow.h>
 #include <ork/math/gradient.h>
 #include <ork/kernel/any.h>
+#include <ork/gfx/radixsort.h>
 
 namespace ork { namespace lev2 { class RenderContextInstData; }}
 namespace ork { namespace lev2 { class GfxMaterial3DSolid; }}
@@ -109,6 +110,9 @@ private:
 	float		mfSlowNoiseTim;
 	float		mfFastNoiseTim;
 	float		mfTimeBase;
+	U32			muRandomState;	// restarted by OnStart, so a system replays the same
+
+	float RandomUnit();
 
 public:
 
@@ -764,6 +768,8 @@ class TurbulenceModule : public ParticleModule
 
 	void Compute( float dt ) final; 
 
+	U32 muRandomSeed;
+
 public:
 
 	TurbulenceModule();	
@@ -805,12 +811,62 @@ public:
 
 ///////////////////////////////////////////////////////////////////////////////
 
+///////////////////////////////////////////////////////////////////////////////
+// far to near order of a render buffers particles, for alpha blended renderers
+//  radix sorts the projected depths, an order from the last frame which is
+//  still sorted is kept as is. big buffers compute depths and sort kparallelchunks
+//  chunks on ConcurrentOpQ, then merge the sorted chunks pairwise.
+///////////////////////////////////////////////////////////////////////////////
+
+class ParticleDepthSorter
+{
+public:
+	static const int kparallelsize = 65536;	// buffers at least this big sort in parallel (unless disabled)
+	static const int kparallelchunks = 8;
+
+	ParticleDepthSorter();
+	~ParticleDepthSorter();
+
+	void Sort( const BasicParticle* pparticles, int inum, const CMatrix4& MVP );
+
+	const U32* GetOrder() const { return mpOrder; } // indices into the sorted buffer, far to near
+	int GetNumSorted() const { return miNumSorted; }
+	int GetNumCoherentSorts() const { return miNumCoherent; } // sorts which reused the last order
+
+	void SetParallel( bool bv ) { mbParallel=bv; }
+
+private:
+
+	struct DepthIndex
+	{
+		float	mfDepth;
+		U32		muIndex;
+	};
+
+	orkvector<float>		mDepths;
+	orkvector<DepthIndex>	mMergeA;
+	orkvector<DepthIndex>	mMergeB;
+	orkvector<U32>			mOrder;
+	RadixSort				mSorter;
+	orkvector<RadixSort*>	mChunkSorters;
+	const U32*				mpOrder;
+	int						miNumSorted;
+	int						miNumCoherent;
+	bool					mbParallel;
+
+	U32 GetNbHits() const;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
 class RendererModule : public ParticleModule
 {
 	RttiDeclareAbstract( RendererModule, ParticleModule );
 
 protected:
 
+	ParticleDepthSorter mDepthSorter;	// per instance, so renderers may draw concurrently
+
 	//////////////////////////////////////////////////
 	// inputs
 	//////////////////////////////////////////////////
@@ -13,6 +13,9 @@
 #include <ork/math/cvector4.h>
 #include <ork/lev2/gfx/gfxenv_enum.h>
 #include <ork/kernel/fixedlut.h>
+#include <ork/math/cvector3.h>
+
+namespace ork { struct Opq; }
 
 namespace ork { namespace lev2 { namespace particle {
 
@@ -57,13 +60,11 @@ public:
 	inline ptype* FastAlloc()
 	{
 		ptype* rval = 0;
-		int inumdead = GetNumDead();
-		if( inumdead>0 )
+		if( false==mInactiveParticles.empty() )
 		{
-			ptype *ptc = mInactiveParticles[ inumdead-1 ];
-			mInactiveParticles.erase( mInactiveParticles.begin()+inumdead-1 );
-			mActiveParticles.push_back(ptc);
-			rval = ptc;
+			rval = mInactiveParticles.back();
+			mInactiveParticles.pop_back();
+			mActiveParticles.push_back(rval);
 		}
 		return rval;	
 	}
@@ -71,11 +72,152 @@ public:
 	inline void FastFree( int iactiveindex )
 	{	ptype* ptc = mActiveParticles[ iactiveindex ];
 		mInactiveParticles.push_back(ptc);
-		int ilast_alive = GetNumAlive()-1;
-		ptype *ptclast = mActiveParticles[ ilast_alive ];
-		mActiveParticles[ iactiveindex ] = ptclast;
-		mActiveParticles.erase( mActiveParticles.begin()+ilast_alive );
+		mActiveParticles[ iactiveindex ] = mActiveParticles.back();
+		mActiveParticles.pop_back();
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct BasicParticle
+{
+	ork::CVector3	mPosition;
+	ork::CVector3	mLastPosition;
+	ork::CVector3	mVelocity;
+	float			mfRandom;
+	float			mfAge;
+	float			mfLifeSpan;
+	void*			mKey;
+    uint32_t        mColliderStates;
+
+	bool IsDead( void ) const
+	{
+		return(mfAge>=mfLifeSpan);
+	}
+
+	BasicParticle()
+		: mfAge(0.0f)
+		, mfLifeSpan(0.0f)
+		, mPosition(0.0f,0.0f,0.0f)
+		, mLastPosition(0.0f,0.0f,0.0f)
+		, mVelocity(0.0f,0.0f,0.0f)
+		, mfRandom(0.0f)
+		, mKey(0)
+        , mColliderStates(0)
+	{
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Pool<BasicParticle>
+//
+//  structure of arrays : one float stream per component (collider states
+//   are a U32 stream), each 64 byte aligned and padded to a multiple of
+//   kstreamalign particles, so modules may run whole 4 lane steps past
+//   GetNumAlive() without a scalar tail.
+//  alive particles are always [0,GetNumAlive()). FastFree() moves the last
+//   alive particle into the freed slot, indices are not stable across frees.
+//  BasicParticle is only the record renderers copy out (GetActiveParticle).
+///////////////////////////////////////////////////////////////////////////////
+
+template <> class Pool<BasicParticle>
+{
+public:
+
+	static const int kstreamalign = 16;
+
+	float*				mPosX;
+	float*				mPosY;
+	float*				mPosZ;
+	float*				mLastPosX;
+	float*				mLastPosY;
+	float*				mLastPosZ;
+	float*				mVelX;
+	float*				mVelY;
+	float*				mVelZ;
+	float*				mAge;
+	float*				mLifeSpan;
+	float*				mRandom;
+	U32*				mColliderStates;
+	orkvector<void*>	mKeys;
+
+	Pool( );
+	Pool( const Pool& oth );
+	Pool& operator=( const Pool& oth );
+	void Init( int imax );
+	void Copy( const Pool& oth );
+	void Reset();
+
+	inline int GetMax() const { return miMaxParticles; }
+	inline int GetNumAlive() const { return miNumAlive; }
+	inline int GetNumDead() const { return miMaxParticles-miNumAlive; }
+	/// GetNumAlive() rounded up to whole 4 lane steps
+	inline int GetNumAliveLanes() const { return (miNumAlive+3)&~3; }
+
+	BasicParticle GetActiveParticle(int idx) const;
+
+	inline CVector3 GetPosition(int idx) const { return CVector3(mPosX[idx],mPosY[idx],mPosZ[idx]); }
+	inline CVector3 GetLastPosition(int idx) const { return CVector3(mLastPosX[idx],mLastPosY[idx],mLastPosZ[idx]); }
+	inline CVector3 GetVelocity(int idx) const { return CVector3(mVelX[idx],mVelY[idx],mVelZ[idx]); }
+	inline void SetPosition(int idx, const CVector3& v) { mPosX[idx]=v.GetX(); mPosY[idx]=v.GetY(); mPosZ[idx]=v.GetZ(); }
+	inline void SetLastPosition(int idx, const CVector3& v) { mLastPosX[idx]=v.GetX(); mLastPosY[idx]=v.GetY(); mLastPosZ[idx]=v.GetZ(); }
+	inline void SetVelocity(int idx, const CVector3& v) { mVelX[idx]=v.GetX(); mVelY[idx]=v.GetY(); mVelZ[idx]=v.GetZ(); }
+	inline bool IsDead(int idx) const { return (mAge[idx]>=mLifeSpan[idx]); }
+
+	/// returns the index of the new particle, or -1 when the pool is full.
+	/// age and collider state are cleared and a random value assigned,
+	///  the caller sets position, velocity, lifespan and key
+	inline int FastAlloc()
+	{
+		if( miNumAlive>=miMaxParticles )
+			return -1;
+		int idx = miNumAlive++;
+		mAge[idx] = 0.0f;
+		mRandom[idx] = float(Random()>>16)/65536.0f;
+		mColliderStates[idx] = 0;
+		return idx;
+	}
+
+	/// xorshift32 stream of the pool. emitters and modules draw from the pool they
+	///  work on, so a system replays the same from its seed whichever thread updates it.
+	///  Reset() restarts the stream
+	inline U32 Random()
+	{
+		muRandomState ^= muRandomState<<13;
+		muRandomState ^= muRandomState>>17;
+		muRandomState ^= muRandomState<<5;
+		return muRandomState;
+	}
+	inline float RandomUnit() { return float(Random()>>8)*(1.0f/16777216.0f); } // [0,1)
+	void SetRandomSeed( U32 useed ); // nonzero
+
+	inline void FastFree( int idx )
+	{
+		int ilast = --miNumAlive;
+		if( idx!=ilast )
+		{
+			for( int is=0; is<knumstreams; is++ )
+			{
+				float* pstream = mpStreams+is*miStride;
+				pstream[idx] = pstream[ilast];
+			}
+			mKeys[idx] = mKeys[ilast];
+		}
 	}
+
+private:
+
+	static const int knumstreams = 13;
+
+	void BindStreams();
+
+	orkvector<float>	mStreamStorage;
+	float*				mpStreams;
+	int					miStride;
+	int					miMaxParticles;
+	int					miNumAlive;
+	U32					muRandomSeed;
+	U32					muRandomState;
 };
 
 //////////////////////////////////////////////////////////////////////////////
@@ -206,45 +348,6 @@ public: //
 
 ///////////////////////////////////////////////////////////////////////////////
 
-struct BasicParticle
-{
-	ork::CVector3	mPosition;
-	ork::CVector3	mLastPosition;
-	ork::CVector3	mVelocity;
-	ork::CVector3	mLastVelocity;
-	float			mfRandom;
-	float			mfAge;
-	float			mfLifeSpan;
-	void*			mKey;
-    uint32_t        mColliderStates;
-
-	bool IsDead( void )
-	{
-		return(mfAge>=mfLifeSpan);
-	}
-
-	BasicParticle()
-		: mfAge(0.0f)
-		, mfLifeSpan(0.0f)
-		, mPosition(0.0f,0.0f,0.0f)
-		, mLastPosition(0.0f,0.0f,0.0f)
-		, mVelocity(0.0f,0.0f,0.0f)
-		, mLastVelocity(0.0f,0.0f,0.0f)
-		, mKey(0)
-        , mColliderStates(0)
-	{
-		// todo - this prob should still be deterministic,
-		//  have the emitter assign the random val
-		
-		int irandom	=	(rand()&255)
-					|	(rand()&255)<<8;
-		mfRandom = float(irandom)/65536.0f;
-
-	}
-};
-
-///////////////////////////////////////////////////////////////////////////////
-
 struct Event
 {
 	Char4 mEventType;
@@ -402,6 +505,41 @@ protected:
 
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// updates particle systems as independent tasks on an Opq
+//  a group (systems sharing a Context, and so its event queues) updates in
+//  queue order within one task, groups run concurrently. systems only touch
+//  their own modules and pools, so results do not depend on the thread count.
+///////////////////////////////////////////////////////////////////////////////
+
+class SystemUpdateBatch
+{
+public:
+
+	void BeginGroup();
+	void Queue( ParticleSystemBase* psys, float fdt ); // into the current group (a new one if none begun)
+	void Update( Opq& the_opq );	// updates and clears everything queued
+
+	int GetNumQueued() const { return int(mItems.size()); }
+	int GetNumGroups() const { return int(mGroups.size()); }
+
+private:
+
+	struct Item
+	{
+		ParticleSystemBase*	mpSystem;
+		float				mfDeltaTime;
+	};
+	struct Group
+	{
+		int miFirst;
+		int miCount;
+	};
+
+	orkvector<Item>		mItems;
+	orkvector<Group>	mGroups;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 
 class ParticleItemBase : public ork::Object
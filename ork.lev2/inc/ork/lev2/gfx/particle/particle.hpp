@@ -73,21 +73,14 @@ void BasicEmitter<ptype>::Reap( Pool<ptype>& pool, float dt )
 	//////////////////////////
 	// kill particles
 	
-	for( int i=0; i<pool.GetNumAlive(); i++ )
+	for( int i=0; i<pool.GetNumAlive(); )
 	{
 		ptype *ptc = pool.mActiveParticles[ i ];
 
-		if( ptc->IsDead() ) // kill particle
-		{
-			pool.mInactiveParticles.push_back(ptc);
-
-			int ilast_alive = pool.GetNumAlive()-1;
-			ptype *ptclast = pool.mActiveParticles[ ilast_alive ];
-
-			pool.mActiveParticles[ i ] = ptclast;
-
-			pool.mActiveParticles.erase( pool.mActiveParticles.begin()+ilast_alive );
-		}
+		if( ptc->IsDead() ) // kill particle, the last alive one moves into i
+			pool.FastFree( i );
+		else
+			i++;
 	}
 }
 
@@ -106,14 +99,10 @@ void SpiralEmitter<ptype>::Emit( Pool<ptype>& pool, float dt )
 
 	while( mfEmitterMark>=1.0f )
 	{
-		int inumdead = pool.GetNumDead();
+		ptype *ptc = pool.FastAlloc();
 
-		if( inumdead>0 )
+		if( ptc )
 		{
-			ptype *ptc = pool.mInactiveParticles[ inumdead-1 ];
-			pool.mInactiveParticles.erase( pool.mInactiveParticles.begin()+inumdead-1 );
-			pool.mActiveParticles.push_back(ptc);
-
 			float fsx = CFloat::Sin(mfPhase);
 			float fsz = CFloat::Cos(mfPhase);
 
@@ -22,6 +22,7 @@
 #include <ork/lev2/gfx/gfxvtxbuf.h>
 #include <ork/lev2/gfx/lighting/gfx_lighting.h>
 #include <ork/lev2/gfx/lev2renderer.h>
+#include <ork/lev2/gfx/renderqueue.h>
 #include <functional>
 
 namespace ork {
@@ -35,6 +36,8 @@ namespace lev2 {
 
 class XgmCluster;
 class XgmSubMesh;
+struct DrawBucketKey;
+class CModelRenderable;
 class XgmModel;
 class XgmMesh;
 class XgmModelInst;
@@ -74,9 +77,15 @@ public:
 	/// Renderables implement this function to set the sort key used when all Renderables are sorted together.
 	/// The default is 0 for all Renderables. If no Renderable overrides this, then the RenderableQueue is not
 	/// sorted and all Renderables are drawn in the order they are queued.
-	/// Typically, a Renderable will use the IRenderer::ComposeSortKey() function as a helper when composing
-	/// its sort key.
-	virtual U32 ComposeSortKey( const Renderer *renderer ) const { return 0; }
+	/// Keys are 64 bit (see RenderSortKey), typically a Renderable will use RenderSortKey::Compose() or the
+	/// IRenderer::ComposeSortKey() function as a helper when composing its sort key.
+	/// It may be called from several threads at once.
+	virtual U64 ComposeSortKey( const Renderer *renderer ) const { return 0; }
+
+	/// Renderables which can be drawn instanced return their model and fill in its bucket (geometry, material, pass),
+	/// the DrawListCompiler gathers models of the same bucket into one instanced draw.
+	/// It may be called from several threads at once.
+	virtual const CModelRenderable* GetInstancedModel( DrawBucketKey& key ) const { return nullptr; }
 	
 	static const int kManipRenderableSortKey = 0x7fffffff;
 	static const int kLastRenderableSortKey = 0x7ffffffe;
@@ -144,7 +153,7 @@ public: //
 
 
 	void Render( const Renderer *renderer ) const final;
-	U32	ComposeSortKey( const Renderer *renderer ) const final;
+	U64	ComposeSortKey( const Renderer *renderer ) const final;
 
 private:
 
@@ -176,7 +185,7 @@ public: //
 
 
 	void Render( const Renderer *renderer ) const final;
-	U32 ComposeSortKey( const Renderer *renderer ) const final;
+	U64 ComposeSortKey( const Renderer *renderer ) const final;
 
 
 private:
@@ -215,7 +224,7 @@ public:
 	inline const lev2::XgmCluster* GetCluster( void ) const { return mCluster; }
 	inline const lev2::XgmMesh* GetMesh( void ) const { return mMesh; }
 		
-	void SetSortKey( U32 skey ) { mSortKey=skey; }
+	void SetSortKey( U64 skey ) { mSortKey=skey; }
 
 	void AddLight( Light* plight ) { mLightMask.AddLight(plight); }
 	void SetLightMask( const lev2::LightMask& lmask ) { mLightMask=lmask; }
@@ -236,14 +245,15 @@ public:
 
 private:
 
-    U32 ComposeSortKey( const Renderer *renderer ) const final { return mSortKey; }
+    U64 ComposeSortKey( const Renderer *renderer ) const final { return mSortKey; }
     void Render( const Renderer *renderer ) const final;
     bool CanGroup( const IRenderable* oth ) const final;
+    const CModelRenderable* GetInstancedModel( DrawBucketKey& key ) const final;
 
 	float mEngineParamFloats[kMaxEngineParamFloats];
 
 	const lev2::XgmModelInst*	mModelInst;
-	U32							mSortKey;
+	U64							mSortKey;
 	int							mSubMeshIndex;
 	int							mMaterialIndex;
 	int							mMaterialPassIndex;
@@ -268,7 +278,7 @@ public:
 
 	CallbackRenderable(Renderer *renderer = NULL);
 	
-	void SetSortKey( U32 skey ) { mSortKey=skey; }
+	void SetSortKey( U64 skey ) { mSortKey=skey; }
 
 	void SetUserData0( anyp pdata ) { mUserData0=pdata; }
 	const anyp& GetUserData0() const { return mUserData0; }
@@ -281,9 +291,9 @@ public:
 private:
 
     void Render( const Renderer *renderer ) const final;
-    U32 ComposeSortKey( const Renderer *renderer ) const final { return mSortKey; }   
+    U64 ComposeSortKey( const Renderer *renderer ) const final { return mSortKey; }   
 
-	U32								mSortKey;
+	U64								mSortKey;
 	int								mMaterialIndex;
 	int								mMaterialPassIndex;
 	anyp							mUserData0;	
@@ -317,7 +327,7 @@ public:
 
 private:
 
-    U32     ComposeSortKey( const Renderer *renderer ) const final { return kLastRenderableSortKey; }
+    U64     ComposeSortKey( const Renderer *renderer ) const final { return RenderSortKey::FromLegacy(kLastRenderableSortKey); }
     void    Render( const Renderer *renderer ) const final;
 
 	Frustum			mFrustum;
@@ -349,7 +359,7 @@ public: //
 private:
 
     void        Render( const Renderer *renderer ) const final;
-    U32         ComposeSortKey( const Renderer *renderer ) const final { return 0; }
+    U64         ComposeSortKey( const Renderer *renderer ) const final { return 0; }
 
 	CColor4					mColor;
 	CVector3				mPosition;
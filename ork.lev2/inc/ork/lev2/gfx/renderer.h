@@ -18,6 +18,7 @@
 #include <ork/gfx/radixsort.h>
 
 #include <ork/lev2/gfx/renderqueue.h>
+#include <ork/lev2/gfx/drawlist.h>
 
 #include "lev2renderer.h"
 
@@ -38,23 +39,36 @@ class GfxTarget;
 class Renderer // Abstract Renderer that doesnt use virtuals (function pointers embedded in object, not in vtable)
 {
 public:
-	//static const int kmaxnodes = 4096;
-	static const int kmaxrables = 4096;
-	static const int kmaxrablesmed = 1024;
-	static const int kmaxrablessm = 64;
+	static const int kparallelkeysize = 4096;	// queues at least this big compose their sort keys on ConcurrentOpQ
+	static const int kparallelkeygrain = 1024;
 
 private:
 	GfxTarget*		mpTarget;
 
-	ork::fixedvector<U32,RenderQueue::krqmaxsize>						mQueueSortKeys;
-	ork::fixedvector<const RenderQueue::Node*,RenderQueue::krqmaxsize>	mQueueSortNodes;
-
-
-	ork::fixedvector<CBoxRenderable,kmaxrablessm>			mBoxes;
-	ork::fixedvector<CModelRenderable,kmaxrables>			mModels;
-	ork::fixedvector<FrustumRenderable,kmaxrablessm>		mFrustums;
-	ork::fixedvector<SphereRenderable,kmaxrables>			mSpheres;
-	ork::fixedvector<CallbackRenderable,kmaxrablesmed>			mCallbacks;
+	orkvector<U64>								mQueueSortKeys;
+	orkvector<const RenderQueue::Node*>			mQueueSortNodes;
+	DrawListCompiler							mDrawListCompiler;
+	DrawList									mDrawList;
+
+	// renderables queued through Queue*(), one set per queue segment (thread)
+	struct SegmentRenderables
+	{
+		RenderFrameArena<CBoxRenderable>		mBoxes;
+		RenderFrameArena<CModelRenderable>		mModels;
+		RenderFrameArena<FrustumRenderable>		mFrustums;
+		RenderFrameArena<SphereRenderable>		mSpheres;
+		RenderFrameArena<CallbackRenderable>	mCallbacks;
+	};
+
+	SegmentRenderables						mSegmentRenderables[RenderQueue::kmaxsegments];
+
+	template <typename T> T& QueueFromArena( RenderFrameArena<T> SegmentRenderables::* parena )
+	{
+		RenderQueue::Segment& seg = mRenderQueue.ThreadSegment();
+		T& rend = (mSegmentRenderables[seg.GetIndex()].*parena).create();
+		seg.QueueRenderable( &rend, seg.mpPickObject );
+		return rend;
+	}
 
 public:
 
@@ -69,28 +83,40 @@ public:
 	virtual void RenderSphere( const SphereRenderable & SphereRen ) const = 0;
 	virtual void RenderCallback( const CallbackRenderable & cbren ) const = 0;
 
+	/// One instanced draw of inum models sharing a DrawBucketKey, pmatrices are their world matrices.
+	/// Renderers which can instance override this, the default goes through RenderModel/RenderModelGroup.
+	virtual void RenderModelInstances( const CModelRenderable* const* pmodels, const CMatrix4* pmatrices, int inum ) const;
+
+	/// Executes a compiled draw list (see DrawListCompiler)
+	void ExecuteDrawList( const DrawList& list );
+
 	/******************************************************************************************************************
 	 * Deferred rendering
+	 *  Queue*() may be called from several threads at once (each queues to its own segment),
+	 *  but not while DrawQueuedRenderables() runs
 	 ******************************************************************************************************************/
 
-	CBoxRenderable & QueueBox()				{ CBoxRenderable& rend=mBoxes.create(); QueueRenderable(&rend); return rend; }
-	CModelRenderable & QueueModel()			{ CModelRenderable& rend=mModels.create(); QueueRenderable(&rend); return rend; }
-	FrustumRenderable & QueueFrustum()		{ FrustumRenderable& rend=mFrustums.create(); QueueRenderable(&rend); return rend; }
-	SphereRenderable & QueueSphere()		{ SphereRenderable& rend=mSpheres.create(); QueueRenderable(&rend); return rend; }
-	CallbackRenderable & QueueCallback()	{ CallbackRenderable& rend=mCallbacks.create(); QueueRenderable(&rend); return rend; }
+	CBoxRenderable & QueueBox()				{ return QueueFromArena( &SegmentRenderables::mBoxes ); }
+	CModelRenderable & QueueModel()			{ return QueueFromArena( &SegmentRenderables::mModels ); }
+	FrustumRenderable & QueueFrustum()		{ return QueueFromArena( &SegmentRenderables::mFrustums ); }
+	SphereRenderable & QueueSphere()		{ return QueueFromArena( &SegmentRenderables::mSpheres ); }
+	CallbackRenderable & QueueCallback()	{ return QueueFromArena( &SegmentRenderables::mCallbacks ); }
 
 	void QueueRenderable( IRenderable *pRenderable );
 
 	/// Each Renderer implements this function as a helper for Renderables when composing their sort keys
-	virtual U32				ComposeSortKey( U32 texIndex, U32 depthIndex, U32 passIndex, U32 transIndex ) const { return 0; }
+	virtual U64				ComposeSortKey( U32 texIndex, U32 depthIndex, U32 passIndex, U32 transIndex ) const { return 0; }
 
 	void					DrawQueuedRenderables();
 
+	const DrawList& GetLastDrawList() const { return mDrawList; }
+
 	const Object *GetCurrentQueuedObject() const { return mpCurrentQueueObject; }
-	const Object *GetCurrentObject() const { return mpCurrentObject; }
+	const Object *GetCurrentObject() { return mRenderQueue.ThreadSegment().mpPickObject; } // the calling thread's
 
 	inline void SetPerformanceItem(CPerformanceItem* perfitem) { mPerformanceItem = perfitem; }
 
+	// per queueing thread (kept in its queue segment)
 	void PushPickID(const Object *pObject);
 	void PopPickID();
 
@@ -105,7 +131,6 @@ public:
 protected:
 	void						ResetQueue( void );
 	RadixSort					mRadixSorter;
-	const Object*				mpCurrentObject;
 	const Object*				mpCurrentQueueObject;
 	RenderQueue					mRenderQueue;
 	//const ork::CCameraData*		mpCameraData;
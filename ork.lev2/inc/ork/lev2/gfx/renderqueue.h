@@ -9,6 +9,10 @@
 #define _ORK_RENDERQUEUE_H_
 
 #include <ork/kernel/orkpool.h>
+#include <ork/kernel/atomic.h>
+#include <ork/kernel/mutex.h>
+#include <ork/orkstl.h>
+#include <thread>
 
 namespace ork { 
 namespace lev2 {
@@ -16,19 +20,99 @@ namespace lev2 {
 class Renderer;
 class IRenderable;
 
-class RenderQueue {
-public:
+///////////////////////////////////////////////////////////////////////////////
+// 64 bit sort keys, most significant first :
+//  pass(8) layer(8) material(16) depth(24) unused(8)
+// 32 bit keys from before depth was part of the key (pass/offset/material)
+//  map onto the top word, so they keep their order relative to each other.
+///////////////////////////////////////////////////////////////////////////////
 
-	static const int krqmaxsize = 8192;
+struct RenderSortKey
+{
+	static const int kpassshift = 56;
+	static const int klayershift = 48;
+	static const int kmaterialshift = 32;
+	static const int kdepthshift = 8;
+	static const U32 kmaxdepth = (1<<24)-1;
 
+	static U64 Compose( U32 pass, U32 layer, U32 material, U32 depth )
+	{
+		return	(U64(pass&0xff)<<kpassshift)
+			|	(U64(layer&0xff)<<klayershift)
+			|	(U64(material&0xffff)<<kmaterialshift)
+			|	(U64(depth&kmaxdepth)<<kdepthshift);
+	}
+	static U64 FromLegacy( U32 key ) { return U64(key)<<kmaterialshift; }
 
-	void QueueRenderable( const IRenderable *pRenderable, Renderer *pRenderer );
-	void Reset();
-	size_t Size() { return mNodes.size(); }
-	RenderQueue() 
+	// front to back over [0,frange)
+	static U32 QuantizeDepth( float fdepth, float frange )
+	{
+		float fu = fdepth/frange;
+		if( false==(fu>0.0f) ) return 0;
+		if( fu>=1.0f ) return kmaxdepth;
+		return U32(fu*float(kmaxdepth));
+	}
+	// back to front over [0,frange) (transparent passes)
+	static U32 QuantizeDepthBackToFront( float fdepth, float frange )
 	{
-		Reset();
+		return kmaxdepth-QuantizeDepth(fdepth,frange);
 	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// per frame storage : items live in fixed size chunks so their addresses
+//  stay valid while the frame grows, clear() keeps the chunks for the next
+//  frame (nothing is allocated once the high water mark is reached).
+//  like fixedvector::create, create() hands back recycled items as they are.
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename T, int kchunksize=256> class RenderFrameArena
+{
+public:
+	RenderFrameArena() : miSize(0) {}
+	~RenderFrameArena()
+	{
+		for( T* pchunk : mChunks )
+			delete[] pchunk;
+	}
+
+	T& create()
+	{
+		int ichunk = miSize/kchunksize;
+		if( ichunk==int(mChunks.size()) )
+			mChunks.push_back( new T[kchunksize] );
+		T& rval = mChunks[ichunk][miSize%kchunksize];
+		miSize++;
+		return rval;
+	}
+	T& operator[]( int idx ) { return mChunks[idx/kchunksize][idx%kchunksize]; }
+	const T& operator[]( int idx ) const { return mChunks[idx/kchunksize][idx%kchunksize]; }
+	int size() const { return miSize; }
+	void clear() { miSize=0; }
+
+private:
+	RenderFrameArena( const RenderFrameArena& );
+	RenderFrameArena& operator=( const RenderFrameArena& );
+
+	orkvector<T*>	mChunks;
+	int				miSize;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// RenderQueue
+//
+//  any number of threads may queue at once : each gets its own segment for
+//   the frame (found through a thread local cache, so only the first queue
+//   of a thread per frame locks), segments are merged in segment order when
+//   the queue is exported for drawing.
+//  exporting and Reset must not overlap queueing.
+///////////////////////////////////////////////////////////////////////////////
+
+class RenderQueue {
+public:
+
+	static const int kmaxsegments = 32;
+
 	struct Node {
 		const IRenderable *mpRenderable;
 		const Object *mpContextObject;
@@ -38,10 +122,43 @@ public:
 			, mpRenderable(renderable)
 		{}
 	};
-	void ExportRenderableNodes(ork::fixedvector<const RenderQueue::Node*,krqmaxsize>& nodes);
+
+	struct Segment {
+		Segment() : miIndex(0), mpPickObject(nullptr) {}
+
+		void QueueRenderable( const IRenderable *pRenderable, const Object *pContextObject )
+		{
+			mNodes.push_back( Node(pContextObject, pRenderable) );
+		}
+		int GetIndex() const { return miIndex; }
+
+		int					miIndex;
+		std::thread::id		mOwner;
+		const Object*		mpPickObject; // context object of what the owner queues (Renderer::PushPickID)
+		orkvector<Node>		mNodes; // capacity is kept from frame to frame
+	};
+
+	RenderQueue();
+	~RenderQueue();
+
+	Segment& ThreadSegment(); // the calling thread's segment this frame
+	void QueueRenderable( const IRenderable *pRenderable, Renderer *pRenderer );
+	void Reset();
+	size_t Size() const;
+	int NumSegments() const { return miNumSegments.load(); }
+
+	void ExportRenderableNodes(orkvector<const RenderQueue::Node*>& nodes) const;
 
 protected:
-	ork::fixedvector<Node,krqmaxsize>	mNodes;
+
+	Segment*			mSegments[kmaxsegments]; // created on first use
+	ork::atomic<int>	miNumSegments;
+	int					miEpoch; // unique per queue and frame
+	ork::mutex			mSegmentLock;
+
+private:
+	RenderQueue( const RenderQueue& );
+	RenderQueue& operator=( const RenderQueue& );
 };
 
 } }
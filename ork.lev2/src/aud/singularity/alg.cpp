@@ -61,6 +61,9 @@ void Alg::keyOn(DspKeyOnInfo& koi)
 
     for( int i=0; i<kmaxdspblocksperlayer; i++ )
     {
+        if( _block[i] ) // the voice's previous note
+            delete _block[i];
+
         const auto data = ld->_dspBlocks[i];
         if( data and data->_dspBlock.length() )
         {
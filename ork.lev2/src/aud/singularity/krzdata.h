@@ -115,6 +115,21 @@ enum struct eLoopMode
     FROMKM,
 };
 
+// sample playback interpolation (sampleOsc)
+enum struct eInterpMode
+{
+    LINEAR = 0, // 2 taps
+    HERMITE,    // 4 point, 3rd order
+    SINC,       // 8 tap blackman windowed sinc
+};
+
+// which busy voice synth::allocLayer takes over when none are free
+enum struct eStealMode
+{
+    OLDEST = 0, // longest since keyOn
+    QUIETEST,   // lowest peak over its last block
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 
 struct sample
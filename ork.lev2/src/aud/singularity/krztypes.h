@@ -52,6 +52,7 @@ inline float getSampleRate() { return 48000.0f; }
 struct outputBuffer
 {
     outputBuffer();
+    ~outputBuffer();
     void resize(int inumframes);
 
     float* _leftBuffer;
@@ -59,3 +60,53 @@ struct outputBuffer
     int _maxframes;
     int _numframes;
 };
+
+///////////////////////////////////////////////////////////////////////////////
+// doubly linked list threaded through T::_listPrev/_listNext
+//  (an item is on one list at a time), O(1) and nothing allocates
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename T> struct intrusiveList
+{
+    bool empty() const { return nullptr==_head; }
+    int size() const { return _size; }
+    T* front() const { return _head; }
+
+    void pushBack(T* item)
+    {
+        assert(item->_listPrev==nullptr and item->_listNext==nullptr and item!=_head);
+        item->_listPrev = _tail;
+        if( _tail )
+            _tail->_listNext = item;
+        else
+            _head = item;
+        _tail = item;
+        _size++;
+    }
+    void remove(T* item)
+    {
+        assert(_size>0);
+        if( item->_listPrev )
+            item->_listPrev->_listNext = item->_listNext;
+        else
+            _head = item->_listNext;
+        if( item->_listNext )
+            item->_listNext->_listPrev = item->_listPrev;
+        else
+            _tail = item->_listPrev;
+        item->_listPrev = nullptr;
+        item->_listNext = nullptr;
+        _size--;
+    }
+    T* popFront()
+    {
+        T* item = _head;
+        if( item )
+            remove(item);
+        return item;
+    }
+
+    T* _head = nullptr;
+    T* _tail = nullptr;
+    int _size = 0;
+};
@@ -2,6 +2,7 @@
 #include <assert.h>
 #include <unistd.h>
 #include <math.h>
+#include <limits>
 
 #include "krzdata.h"
 #include "synth.h"
@@ -22,7 +23,14 @@ layer::layer(synth& syn)
     , _doNoise(false)
     , _keepalive(0)
     , _AENV(nullptr)
+    , _level(0.0f)
+    , _progInst(nullptr)
 {
+    // the alg (and its dsp buffer) stays with the voice, keyOn reconfigures it,
+    //  buffers are sized for the largest block up front
+    _alg = AlgData().createAlgInst();
+    _alg->_blockBuf->resize(synth::kmaxframes);
+    _layerObuf.resize(synth::kmaxframes);
     //printf( "Layer Init<%p>\n", this );
 }
 
@@ -31,8 +39,8 @@ layer::~layer()
     for( int i=0; i<kmaxctrlblocks; i++ )
         if( _ctrlBlock[i] )
             delete _ctrlBlock[i];
-    //if( _alg )
-    //    delete _alg;
+    if( _alg )
+        delete _alg;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -334,6 +342,11 @@ void layer::compute(outputBuffer& obuf)
             }
         }
 
+        float peak = 0.0f;
+        for( int i=0; i<inumframes; i++ )
+            peak = std::max( peak, std::fabs(lyroutl[i]) );
+        _level = peak*_layerGain*_masterGain;
+
         /////////////////
         // oscope
         /////////////////
@@ -574,8 +587,7 @@ void layer::keyOn( int note, int vel, const layerData* ld )
     }
     ///////////////////////////////////////
 
-    _alg = _layerData->_algData.createAlgInst();
-    //assert(_alg);
+    _alg->_algConfig = _layerData->_algData._config;
     if(_alg)
     {
         DspKeyOnInfo koi;
@@ -592,6 +604,7 @@ void layer::keyOn( int note, int vel, const layerData* ld )
 
     _lyrPhase = 0;
     _sinrepPH = 0.0f;
+    _level = std::numeric_limits<float>::max(); // not stolen before it is heard
 
 
 }
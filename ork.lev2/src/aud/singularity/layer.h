@@ -124,6 +124,12 @@ struct layer
 
     const layerData* _layerData;
 
+    float _level; // output peak of the last block (voice stealing)
+    programInst* _progInst; // which program keyed us on, if any
+
+    layer* _listPrev = nullptr; // synth free/active voice list links
+    layer* _listNext = nullptr;
+
 private:
 
     int _keepalive;
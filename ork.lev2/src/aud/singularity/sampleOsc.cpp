@@ -4,6 +4,9 @@
 #include <unistd.h>
 #include <math.h>
 
+#include <algorithm>
+#include <ork/math/simd4.h>
+
 #include "krzdata.h"
 #include "synth.h"
 
@@ -117,6 +120,7 @@ sampleOsc::sampleOsc()
     , _baseCents(0)
     , _preDSPGAIN(1.0f)
     , _loopMode(eLoopMode::NONE)
+    , _interpMode(eInterpMode::LINEAR)
     , _loopCounter(0)
 {
 
@@ -177,39 +181,18 @@ void sampleOsc::keyOn(const DspKeyOnInfo& koi)
 	_dt = syn._dt;
 
 	_loopMode = _sample->_loopMode;
+    if( _kmregion->_loopModeOverride != eLoopMode::NOTSET )
+        _loopMode = _kmregion->_loopModeOverride;
 
     switch( _loopMode )
     {
         case eLoopMode::BIDIR:
-            _pbFunc = &sampleOsc::playLoopBid;
-            break;
-        case eLoopMode::FWD:
-            _pbFunc = &sampleOsc::playLoopFwd;
-            break;
-        case eLoopMode::NONE:
-            _pbFunc = &sampleOsc::playNoLoop;
-            break;
-        case eLoopMode::FROMKM:
-            _pbFunc = nullptr;
-            break;
-        default:
-            assert(false);
-            break;
-    }
-    switch( _kmregion->_loopModeOverride )
-    {
-        case eLoopMode::BIDIR:
-            _pbFunc = &sampleOsc::playLoopBid;
-            break;
         case eLoopMode::FWD:
-            _pbFunc = &sampleOsc::playLoopFwd;
-            break;
         case eLoopMode::NONE:
-            _pbFunc = &sampleOsc::playNoLoop;
             break;
+        case eLoopMode::FROMKM: // with no region override
         case eLoopMode::NOTSET:
-            if( _pbFunc == nullptr )
-                _pbFunc = &sampleOsc::playNoLoop;
+            _loopMode = eLoopMode::NONE;
             break;
         default:
             assert(false);
@@ -218,6 +201,8 @@ void sampleOsc::keyOn(const DspKeyOnInfo& koi)
     //printf( "LOOPMODE<%d>\n", int(_loopMode));
     //printf( "LOOPMODEOV<%d>\n", int(_kmregion->_loopModeOverride));
 
+    _interpMode = syn._sampleInterp;
+
 	_synsr = getSampleRate();
 
 	/*04-05 Pitch at Highest Playback Rate: unsigned word (affected by
@@ -229,10 +214,10 @@ void sampleOsc::keyOn(const DspKeyOnInfo& koi)
     setSrRatio(pbratio);
 
 	//printf( "osc<%p> sroot<%d> SR<%d> ratio<%f> PBR<%d> looped<%d>\n", this, _sample->_rootKey, int(_sample->_sampleRate), _curratio, int(_playbackRate), int(_isLooped) );
-	printf( "sample<%s>\n", _sample->_name.c_str() );
-    printf( "sampleBlock<%p>\n", _sample->_sampleBlock );
-    printf( "st<%d> en<%d>\n", _sample->_blk_start, _sample->_blk_end);
-    printf( "lpst<%d> lpend<%d>\n", _sample->_blk_loopstart, _sample->_blk_loopend);
+	//printf( "sample<%s>\n", _sample->_name.c_str() );
+    //printf( "sampleBlock<%p>\n", _sample->_sampleBlock );
+    //printf( "st<%d> en<%d>\n", _sample->_blk_start, _sample->_blk_end);
+    //printf( "lpst<%d> lpend<%d>\n", _sample->_blk_loopstart, _sample->_blk_loopend);
 	_active = true;
 
 	_forwarddir = true;
@@ -242,7 +227,7 @@ void sampleOsc::keyOn(const DspKeyOnInfo& koi)
 
 	_enableNatEnv = _lyr->_useNatEnv;
 
-	printf( "_enableNatEnv<%d>\n", int(_enableNatEnv) );
+	//printf( "_enableNatEnv<%d>\n", int(_enableNatEnv) );
 
     if( _enableNatEnv )
     {
@@ -257,7 +242,7 @@ void sampleOsc::keyOff()
 {
 
 	_released = true;
-	printf( "osc<%p> beginRelease\n", this );
+	//printf( "osc<%p> beginRelease\n", this );
 
     if( _enableNatEnv )
         _natAmpEnv.keyOff();
@@ -433,212 +418,404 @@ void sampleOsc::compute(int inumfr)
 		return;
     }
 
-	for( int i=0; i<inumfr; i++ )
-	{
-
-	    updateFreqRatio();
-	    setSrRatio(_curSampSRratio);
-
-	   // _spOsc.setSrRatio(currat);
-
-		//float lyrpocents = _lyr._curPitchOffsetInCents;
-
-		//float ratio = cents_to_linear_freq_ratio(_keyoncents+lyrpocents);
+    // the pitch only changes per block
+    updateFreqRatio();
+    setSrRatio(_curSampSRratio);
 
+    switch( _loopMode )
+    {
+        case eLoopMode::BIDIR:
+            playLoopBid(inumfr);
+            break;
+        case eLoopMode::FWD:
+            playLoopFwd(inumfr);
+            break;
+        default:
+            playNoLoop(inumfr);
+            break;
+    }
 
-		_playbackRate = _sample->_sampleRate*_curratio;
-
-		_pbincrem = (_dt*_playbackRate*65536.0f);
-
-		/////////////////////////////
-
-		float sampleval = _pbFunc
-                        ? (this->*_pbFunc)()
-                        : 0.0f;
-
-        //float sampleval = std::invoke(this, _pbFunc);
-
-		_OUTPUT[i] = sampleval;
+	for( int i=0; i<inumfr; i++ )
 		_NATENV[i] = _natAmpEnv.compute();
-		_lyr->_HAF_nenvseg = _natAmpEnv._curseg;
-		//printf( "_NATENV<%f> sampleval<%f>\n\n", _NATENV[i], sampleval);
-	}
+	_lyr->_HAF_nenvseg = _natAmpEnv._curseg;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// block playback
+//
+//  a block is rendered in runs : frames whose taps all fall inside the
+//   playable span go through the interpolator 4 at a time, without bounds
+//   checks. the frame at a loop point (or the sample end) goes through
+//   renderEdge, which wraps or clamps each tap, then the next run starts.
+//
+//  _pbindex and _pbincrem are 48.16 fixed point sample positions.
 ///////////////////////////////////////////////////////////////////////////////
 
-float sampleOsc::playNoLoop()
-{
-	_pbindexNext = _pbindex + _pbincrem;
-
-	///////////////
-
-	float fract = float(_pbindex&0xffff)*kinv64k;
-	float invfr = 1.0f-fract;
-
-	///////////////
-
-	int64_t iiA = (_pbindex>>16);
-	if( iiA > (_blk_end>>16) )
-		iiA = (_blk_end>>16);
-
-	int64_t iiB = iiA+1;
-	if( iiB > (_blk_end>>16) )
-		iiB = (_blk_end>>16);
-
-	///////////////
-	auto sblk = _sample->_sampleBlock;
-
-	float sampA = float(sblk[iiA] );
-	float sampB = float(sblk[iiB] );
-	float samp = (sampB*fract+sampA*invfr)*kinv32k;
-
-	///////////////
+using ork::simd::f4;
 
-	_pbindex = _pbindexNext;
+static const int ksincphases = 256;
+static const int ksinctaps = 8;
 
-	return samp;
+// first tap relative to the frame's whole sample, and the tap count
+static void interpTaps( eInterpMode mode, int& itaplo, int& inumtaps )
+{
+    switch( mode )
+    {
+        case eInterpMode::HERMITE:
+            itaplo = -1;
+            inumtaps = 4;
+            break;
+        case eInterpMode::SINC:
+            itaplo = -3;
+            inumtaps = ksinctaps;
+            break;
+        default:
+            itaplo = 0;
+            inumtaps = 2;
+            break;
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
+// blackman windowed sinc over 8 taps, a row per fractional phase
+//  (one extra so phases can be lerped), each row normalized to unity gain
 
-float sampleOsc::playLoopFwd()
+struct sincTable
 {
-	_pbindexNext = _pbindex + _pbincrem;
+    sincTable()
+    {
+        for( int ip=0; ip<=ksincphases; ip++ )
+        {
+            float fract = float(ip)/float(ksincphases);
+            float sum = 0.0f;
+            for( int k=0; k<ksinctaps; k++ )
+            {
+                double x = double(k-3)-fract;
+                double sinc = (std::fabs(x)<1.0e-9) ? 1.0 : sin(pi*x)/(pi*x);
+                double u = (x+4.0)/8.0;
+                double w = 0.42-0.5*cos(pi2*u)+0.08*cos(2.0*pi2*u);
+                _coefs[ip][k] = float(sinc*w);
+                sum += _coefs[ip][k];
+            }
+            for( int k=0; k<ksinctaps; k++ )
+                _coefs[ip][k] /= sum;
+        }
+    }
+    float _coefs[ksincphases+1][ksinctaps];
+};
 
-	bool did_loop = false;
+static const sincTable& getSincTable()
+{
+    static const sincTable the_table;
+    return the_table;
+}
 
-	if( (_pbindexNext>>16) > (_blk_loopend>>16) )
-	{
-        //printf( "reached _blk_loopend<%d>\n", int(_blk_loopend>>16));
+///////////////////////////////////////////////////////////////////////////////
+// taps of 4 frames as [tap][lane], plus their fractions (0..65535).
+//  lanes past inum repeat the last frame
 
-		int64_t over = (_pbindexNext-_blk_loopend)-(1<<16);
-		_pbindexNext = _blk_loopstart+over;
-		did_loop = true;
-		_loopCounter++;
-	}
+template <int itaplo, int inumtaps>
+static inline void gatherRun( const s16* sblk, int64_t idx, int64_t istep, int inum,
+                              float (&taps)[inumtaps][4], float (&fract)[4] )
+{
+    for( int l=0; l<4; l++ )
+    {
+        int64_t pos = idx+istep*std::min(l,inum-1);
+        const s16* s = sblk+(pos>>16)+itaplo;
+        for( int k=0; k<inumtaps; k++ )
+            taps[k][l] = float(s[k]);
+        fract[l] = float(pos&0xffff);
+    }
+}
 
-	///////////////
+// linear
+static inline f4 interp4( const float (&taps)[2][4], f4 t )
+{
+    f4 a = f4::load(taps[0]);
+    f4 b = f4::load(taps[1]);
+    return a+(b-a)*t;
+}
 
-	float fract = float(_pbindex&0xffff)*kinv64k;
-	float invfr = 1.0f-fract;
+// hermite
+static inline f4 interp4( const float (&taps)[4][4], f4 t )
+{
+    f4 ym1 = f4::load(taps[0]), y0 = f4::load(taps[1]);
+    f4 y1 = f4::load(taps[2]), y2 = f4::load(taps[3]);
+    f4 half(0.5f);
+    f4 c1 = (y1-ym1)*half;
+    f4 c2 = ym1-y0*f4(2.5f)+y1*f4(2.0f)-y2*half;
+    f4 c3 = (y2-ym1)*half+(y0-y1)*f4(1.5f);
+    return ((c3*t+c2)*t+c1)*t+y0;
+}
 
-	///////////////
+// sinc
+static inline f4 interp4( const float (&taps)[ksinctaps][4], f4 t )
+{
+    const sincTable& tbl = getSincTable();
+    float phase[4];
+    (t*f4(float(ksincphases))).store(phase);
+    float coefs[ksinctaps][4];
+    for( int l=0; l<4; l++ )
+    {
+        int ip = std::min( int(phase[l]), ksincphases-1 );
+        float fl = phase[l]-float(ip);
+        const float* ca = tbl._coefs[ip];
+        const float* cb = tbl._coefs[ip+1];
+        for( int k=0; k<ksinctaps; k++ )
+            coefs[k][l] = ca[k]+(cb[k]-ca[k])*fl;
+    }
+    f4 r(0.0f);
+    for( int k=0; k<ksinctaps; k++ )
+        r = r+f4::load(taps[k])*f4::load(coefs[k]);
+    return r;
+}
 
-	int64_t iiA = (_pbindex>>16);
+template <int itaplo, int inumtaps>
+static void interpRun( const s16* sblk, int64_t idx, int64_t istep, float* out, int inumfr )
+{
+    const f4 k64(sampleOsc::kinv64k), k32(sampleOsc::kinv32k);
+    for( int i=0; i<inumfr; i+=4 )
+    {
+        int inum = std::min(4,inumfr-i);
+        float taps[inumtaps][4];
+        float fract[4];
+        gatherRun<itaplo,inumtaps>( sblk, idx+istep*i, istep, inum, taps, fract );
+        f4 r = interp4( taps, f4::load(fract)*k64 )*k32;
+        if( inum==4 )
+            r.store(out+i);
+        else
+        {
+            float tmp[4];
+            r.store(tmp);
+            for( int l=0; l<inum; l++ )
+                out[i+l] = tmp[l];
+        }
+    }
+}
 
-	int64_t iiB = iiA+1;
-	if( iiB > (_blk_loopend>>16) )
-		iiB = (_blk_loopstart>>16);
+///////////////////////////////////////////////////////////////////////////////
+// frames from _pbindex (moving istep per frame, up to inummax) whose whole
+//  sample stays within [ilo,ihi]
 
+int sampleOsc::runLength(int64_t ilo, int64_t ihi, int64_t istep, int inummax) const
+{
+    int64_t iwhole = _pbindex>>16;
+    if( iwhole<ilo || iwhole>ihi )
+        return 0;
+    if( istep>0 )
+        return int(std::min( int64_t(inummax), (((ihi<<16)|0xffff)-_pbindex)/istep+1 ));
+    if( istep<0 )
+        return int(std::min( int64_t(inummax), (_pbindex-(ilo<<16))/(-istep)+1 ));
+    return inummax;
+}
 
-   // printf( "iia<%d> lpstart<%d> lpend<%d>\n", iiA,int(_blk_loop>>16),int(_blk_end>>16));
+///////////////////////////////////////////////////////////////////////////////
 
-	///////////////
-    // linear
-	auto sblk = _sample->_sampleBlock;
+void sampleOsc::renderRun(float* out, int inumfr, int64_t istep) const
+{
+    auto sblk = _sample->_sampleBlock;
     assert(sblk!=nullptr);
-	float sampA = float(sblk[iiA] );
-	float sampB = float(sblk[iiB] );
-	float samp = (sampB*fract+sampA*invfr)*kinv32k;
-    ///////////////
-
-    ///////////////
-    // cosine
-    //float mu2 = (1.0f-cos(fract*pi))*0.5f;
-    //float samp = (sampA*(1.0f-mu2)+sampB*mu2)*kinv32k;
-    ///////////////
-
-    ///////////////
-    // cubic
-    //int64_t iiC = iiB+1;
-    //if( iiC > (_blk_loopend>>16) )
-    //    iiC = (_blk_loopstart>>16);
-    //int64_t iiD = iiC+1;
-    //if( iiD > (_blk_loopend>>16) )
-    //    iiD = (_blk_loopstart>>16);
-    //float sampC = float(sblk[iiC] );
-    //float sampD = float(sblk[iiD] );
-    //float mu = fract;
-    //float mu2 = mu*mu;
-    //float a0 = sampD - sampC - sampA + sampB;
-    //float a1 = sampA - sampB - a0;
-    //float a2 = sampC - sampA;
-    //float a3 = sampB;
-    //float samp = (a0*mu*mu2+a1*mu2+a2*mu+a3)*kinv32k;
-	///////////////
-
-	_pbindex = _pbindexNext;
-
-	return samp;
+    switch( _interpMode )
+    {
+        case eInterpMode::HERMITE:
+            interpRun<-1,4>( sblk, _pbindex, istep, out, inumfr );
+            break;
+        case eInterpMode::SINC:
+            interpRun<-3,ksinctaps>( sblk, _pbindex, istep, out, inumfr );
+            break;
+        default:
+            interpRun<0,2>( sblk, _pbindex, istep, out, inumfr );
+            break;
+    }
 }
 
-float sampleOsc::playLoopBid()
-{
-	assert(false);
-	return 0.0f;
-	/*
-	_pbindexNext = _forwarddir
-	             ? _pbindex + _pbincrem
-	             : _pbindex - _pbincrem;
-
-
-	bool did_loop = false;
-
-	if( _forwarddir && int(_pbindexNext) > (_numFrames-1) )
-	{
-		_pbindexNext = _pbindexNext - _pbincrem;
-		printf( "LoopedBIDIR (F)->(B) : _loopPoint<%d> _numFrames<%d> _pbindexNext<%f>\n", (int)_loopPoint, _numFrames, _pbindexNext );
+///////////////////////////////////////////////////////////////////////////////
+// where a tap past the playable span reads from
 
-		did_loop = true;
+int64_t sampleOsc::edgeTap(int64_t ii) const
+{
+    int64_t st = _blk_start>>16;
+    int64_t en = _blk_end>>16;
+    int64_t ls = _blk_loopstart>>16;
+    int64_t le = _blk_loopend>>16;
 
-		_forwarddir = false;
+    switch( _loopMode )
+    {
+        case eLoopMode::FWD:
+        {
+            int64_t len = le-ls+1;
+            if( ii>le )
+                ii = ls+(ii-le-1)%len;
+            else if( ii<ls && _loopCounter>0 )
+                ii = le-(ls-1-ii)%len;
+            en = le;
+            break;
+        }
+        case eLoopMode::BIDIR:
+            if( ii>le )
+                ii = le-(ii-le);
+            else if( ii<ls && _loopCounter>0 )
+                ii = ls+(ls-ii);
+            en = le;
+            break;
+        default:
+            break;
+    }
+    return std::min( std::max(ii,st), en );
+}
 
-	}
-	else if( (!_forwarddir) && int(_pbindexNext) < _loopPoint )
-	{
-		_pbindexNext = _pbindexNext + _pbincrem;
-		printf( "LoopedBIDIR (B)->(F) : _loopPoint<%d> _numFrames<%d> _pbindexNext<%f>\n", (int)_loopPoint, _numFrames, _pbindexNext );
+///////////////////////////////////////////////////////////////////////////////
 
-		did_loop = true;
+float sampleOsc::renderEdge() const
+{
+    auto sblk = _sample->_sampleBlock;
+    int64_t iwhole = _pbindex>>16;
+    float fract[4];
+    for( int l=0; l<4; l++ )
+        fract[l] = float(_pbindex&0xffff);
+    f4 t = f4::load(fract)*f4(kinv64k);
+    float out[4];
+
+    #define EDGE_TAPS( itaplo, inumtaps ) \
+        float taps[inumtaps][4]; \
+        for( int k=0; k<inumtaps; k++ ) \
+            for( int l=0; l<4; l++ ) \
+                taps[k][l] = float(sblk[edgeTap(iwhole+itaplo+k)]); \
+        (interp4(taps,t)*f4(kinv32k)).store(out);
+
+    switch( _interpMode )
+    {
+        case eInterpMode::HERMITE:
+        {
+            EDGE_TAPS(-1,4)
+            break;
+        }
+        case eInterpMode::SINC:
+        {
+            EDGE_TAPS(-3,ksinctaps)
+            break;
+        }
+        default:
+        {
+            EDGE_TAPS(0,2)
+            break;
+        }
+    }
+    #undef EDGE_TAPS
+    return out[0];
+}
 
-		_forwarddir = true;
-	}
+///////////////////////////////////////////////////////////////////////////////
 
-	///////////////
+void sampleOsc::playNoLoop(int inumfr)
+{
+    int itaplo, inumtaps;
+    interpTaps( _interpMode, itaplo, inumtaps );
+    int64_t st = _blk_start>>16;
+    int64_t en = _blk_end>>16;
 
-	double fract = double(int64_t(_pbindex*65536.0)&0xffff)/65536.0;
-	double whole = _pbindex-fract;
+    int i = 0;
+    while( i<inumfr )
+    {
+        // past the end, every tap reads the last sample
+        if( (_pbindex>>16)+itaplo >= en )
+        {
+            float fend = float(_sample->_sampleBlock[en])*kinv32k;
+            _pbindex += _pbincrem*(inumfr-i);
+            for( ; i<inumfr; i++ )
+                _OUTPUT[i] = fend;
+            break;
+        }
 
-	int iiA = int(whole);
-	if( iiA >= (_numFrames-1) )
-	{
-		if( _isLooped )
-			iiA = _numFrames-2;
-	}
+        int n = runLength( st-itaplo, en-(itaplo+inumtaps-1), _pbincrem, inumfr-i );
+        if( n>0 )
+        {
+            renderRun( _OUTPUT+i, n, _pbincrem );
+            _pbindex += _pbincrem*n;
+            i += n;
+        }
+        else
+        {
+            _OUTPUT[i++] = renderEdge();
+            _pbindex += _pbincrem;
+        }
+    }
+}
 
-	int iiB = int(whole+1.0);
-	if( iiB >= _numFrames )
-	{
-		iiB = _loopPoint;
-		printf( "yo\n");
-	}
+///////////////////////////////////////////////////////////////////////////////
 
-	assert(iiA<_numFrames);
-	assert(iiB<_numFrames);
-	float sampA = float(_sampleData[iiA] );
-	float sampB = float(_sampleData[iiB] );
+void sampleOsc::playLoopFwd(int inumfr)
+{
+    int itaplo, inumtaps;
+    interpTaps( _interpMode, itaplo, inumtaps );
+    int64_t ls = _blk_loopstart>>16;
+    int64_t le = _blk_loopend>>16;
+    int64_t looplen = (le-ls+1)<<16;
+
+    int i = 0;
+    while( i<inumfr )
+    {
+        int64_t lo = (_loopCounter>0) ? ls : (_blk_start>>16);
+        int n = runLength( lo-itaplo, le-(itaplo+inumtaps-1), _pbincrem, inumfr-i );
+        if( n>0 )
+        {
+            renderRun( _OUTPUT+i, n, _pbincrem );
+            _pbindex += _pbincrem*n;
+            i += n;
+        }
+        else
+        {
+            _OUTPUT[i++] = renderEdge();
+            _pbindex += _pbincrem;
+        }
 
-	//if( false == _forwarddir )
-	//	std::swap(sampA,sampB);
+        while( (_pbindex>>16) > le )
+        {
+            _pbindex -= looplen;
+            _loopCounter++;
+        }
+    }
+}
 
-	float samp = (sampB*fract+sampA*(1.0-fract))/32768.0;
+///////////////////////////////////////////////////////////////////////////////
 
-	if( did_loop )
-		printf( "iiA<%d> sampA<%f> iiB<%d> sampB<%f>\n", iiA, sampA, iiB, sampB );
-	///////////////
+void sampleOsc::playLoopBid(int inumfr)
+{
+    int itaplo, inumtaps;
+    interpTaps( _interpMode, itaplo, inumtaps );
+    int64_t ls = _blk_loopstart>>16;
+    int64_t le = _blk_loopend>>16;
 
-	_pbindex = _pbindexNext;
+    int i = 0;
+    while( i<inumfr )
+    {
+        int64_t istep = _forwarddir ? _pbincrem : -_pbincrem;
+        int64_t lo = (_loopCounter>0) ? ls : (_blk_start>>16);
+        int n = runLength( lo-itaplo, le-(itaplo+inumtaps-1), istep, inumfr-i );
+        if( n>0 )
+        {
+            renderRun( _OUTPUT+i, n, istep );
+            _pbindex += istep*n;
+            i += n;
+        }
+        else
+        {
+            _OUTPUT[i++] = renderEdge();
+            _pbindex += istep;
+        }
 
-	return samp;*/
+        // bounce off the loop points
+        if( _forwarddir && (_pbindex>>16) > le )
+        {
+            _pbindex = std::max( _blk_loopend*2-_pbindex, _blk_loopstart );
+            _forwarddir = false;
+            _loopCounter++;
+        }
+        else if( (false==_forwarddir) && _pbindex < _blk_loopstart )
+        {
+            _pbindex = std::min( _blk_loopstart*2-_pbindex, _blk_loopend );
+            _forwarddir = true;
+            _loopCounter++;
+        }
+    }
 }
@@ -46,15 +46,17 @@ struct sampleOsc
     void updateFreqRatio();
     void setSrRatio(float r);
     void compute(int inumfr);
-    float playNoLoop();
-    float playLoopFwd();
-    float playLoopBid();
-    //bool playbackDone() const;
 
-    //typedef float(sampleOsc::*pbfunc_t)();
-    //pbfunc_t _pbFunc = nullptr;
+    // render inumfr frames of the sample into _OUTPUT, per loop mode
+    void playNoLoop(int inumfr);
+    void playLoopFwd(int inumfr);
+    void playLoopBid(int inumfr);
+    //bool playbackDone() const;
 
-    float(sampleOsc::*_pbFunc)() = nullptr;
+    int runLength(int64_t ilo, int64_t ihi, int64_t istep, int inummax) const;
+    void renderRun(float* out, int inumfr, int64_t istep) const;
+    float renderEdge() const;
+    int64_t edgeTap(int64_t ii) const;
 
     //
     int64_t _blk_start;
@@ -83,7 +85,8 @@ struct sampleOsc
     float _synsr;
     //bool _isLooped;
     bool _enableNatEnv;
-    eLoopMode _loopMode;
+    eLoopMode _loopMode; // with the keymap region override applied
+    eInterpMode _interpMode;
     bool _active;
     bool _forwarddir;
     int _loopCounter;
@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <unistd.h>
 #include <math.h>
+#include <algorithm>
 #include <GLFW/glfw3.h>
 //#include "drawtext.h"
 
@@ -16,6 +17,7 @@ programInst::programInst(synth& syn)
 	: _syn(syn)
 	, _progdata(nullptr)
 {
+	_layers.reserve(kmaxlayers);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -57,7 +59,7 @@ void programInst::keyOn( int note, const programData* pd )
 		if( vel<ld->_loVel || vel>ld->_hiVel )
 			continue;
 
-		printf( "KEYON L%d\n", ilayer );
+		assert(int(_layers.size())<kmaxlayers);
 
 		auto l = _syn.allocLayer();
 		l->_ldindex = ilayer-1;
@@ -67,6 +69,7 @@ void programInst::keyOn( int note, const programData* pd )
 		assert(ld!=nullptr);
 
 		l->keyOn(note,vel,ld);
+		l->_progInst = this;
 		_layers.push_back(l);
 
 	}
@@ -84,8 +87,8 @@ void programInst::keyOn( int note, const programData* pd )
 	else
 		_syn._hudLayer = nullptr;
 
-    if( _syn._hudLayer )
-        _syn._hudbuf.push(_syn._hudLayer->_HKF);
+    if( _syn._hudLayer ) // never block the audio thread on the hud
+        _syn._hudbuf.try_push(_syn._hudLayer->_HKF);
 
 
 }
@@ -95,12 +98,26 @@ void programInst::keyOn( int note, const programData* pd )
 void programInst::keyOff()
 {
 	for( auto l : _layers )
+	{
+		l->_progInst = nullptr;
 		l->keyOff();
+	}
 	_layers.clear();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
+void programInst::removeLayer( layer* l )
+{
+	auto it = std::find(_layers.begin(),_layers.end(),l);
+	assert(it!=_layers.end());
+	*it = _layers.back();
+	_layers.pop_back();
+	l->_progInst = nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 
 outputBuffer::outputBuffer()
 	: _leftBuffer(nullptr)
@@ -113,6 +130,14 @@ outputBuffer::outputBuffer()
 
 ///////////////////////////////////////////////////////////////////////////////
 
+outputBuffer::~outputBuffer()
+{
+	delete[] _leftBuffer;
+	delete[] _rightBuffer;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 void outputBuffer::resize(int inumframes)
 {
 	if( inumframes > _maxframes )
@@ -129,7 +154,7 @@ void outputBuffer::resize(int inumframes)
 
 ///////////////////////////////////////////////////////////////////////////////
 
-synth::synth(float sr)
+synth::synth(float sr, int inumworkers)
 	: _sampleRate(sr)
 	, _dt(1.0f / _sampleRate)
 	, _soloLayer(-1)
@@ -138,11 +163,21 @@ synth::synth(float sr)
 	, _hudpage(0)
 	, _ostrack(10)
 {
-	for( int i=0; i<256; i++ )
-		_freeVoices.insert(new layer(*this));
+	for( int i=0; i<kmaxvoices; i++ )
+		_freeVoices.pushBack(new layer(*this));
+
+	for( int i=0; i<kmaxprogramInsts; i++ )
+		_freeProgInst.pushBack(new programInst(*this));
+
+	_eventHeap.reserve(kmaxevents);
+	_eventSeq.store(0);
 
-	for( int i=0; i<256; i++ )
-		_freeProgInst.insert(new programInst(*this));
+	if( inumworkers < 0 )
+		inumworkers = std::max( int(std::thread::hardware_concurrency())-1, 0 );
+
+	_voiceList.reserve(kmaxvoices);
+	_voiceWorkers = new voiceWorkers(inumworkers,kmaxframes);
+	_numDeactivate.store(0);
 
 	//_SD = new SynthData(this);
 
@@ -152,76 +187,128 @@ synth::synth(float sr)
 
 synth::~synth()
 {
-	for( auto v : _freeVoices )
+	delete _voiceWorkers;
+
+	while( auto v = _freeVoices.popFront() )
 		delete v;
-	for( auto v : _activeVoices )
+	while( auto v = _activeVoices.popFront() )
 		delete v;
 
-	for( auto p : _freeProgInst )
+	while( auto p = _freeProgInst.popFront() )
 		delete p;
-	for( auto p : _activeProgInst )
+	while( auto p = _activeProgInst.popFront() )
 		delete p;
 
 	//delete _objectDB;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void synth::addEvent(float time, void_lamda_t ev)
+// any thread, including events running in tick
 
+bool synth::addEvent(float time, event_t ev)
 {
-	_eventmap.insert(std::make_pair(time,ev));
+	timedEvent te;
+	te._time = time;
+	te._seq = _eventSeq.fetch_add(1);
+	te._event = std::move(ev);
+	return _eventQ.try_push(std::move(te));
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
+static bool eventLater( const synth::timedEvent& a, const synth::timedEvent& b )
+{
+	if( a._time != b._time )
+		return a._time > b._time;
+	return int32_t(a._seq-b._seq) > 0;
+}
+
 void synth::tick(float dt)
 {
-	bool done = false;
-	while( false == done )
+	for( ;; )
 	{
-		done = true;
-		auto it = _eventmap.begin();
-		if( it != _eventmap.end() && it->first <= _timeaccum )
+		// new events onto the heap, those that do not fit wait in the queue
+		timedEvent te;
+		while( int(_eventHeap.size())<kmaxevents && _eventQ.try_pop(te) )
 		{
-			auto& event = it->second;
-			event();
-			done = false;
-			_eventmap.erase(it);
+			_eventHeap.push_back(std::move(te));
+			std::push_heap(_eventHeap.begin(),_eventHeap.end(),eventLater);
 		}
+
+		if( _eventHeap.empty() || _eventHeap.front()._time > _timeaccum )
+			break;
+
+		std::pop_heap(_eventHeap.begin(),_eventHeap.end(),eventLater);
+		te = std::move(_eventHeap.back());
+		_eventHeap.pop_back();
+		te._event();
 	}
 	_timeaccum += dt;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// audio thread (events), with no voice rendering in flight
+
 layer* synth::allocLayer()
 {
-	auto it = _freeVoices.begin();
-	assert(it != _freeVoices.end() );
-	auto l = *it;
+	// voices released earlier in this block first
+	if( _freeVoices.empty() )
+		deactivateVoices();
+
+	auto l = _freeVoices.popFront();
+	if( nullptr == l )
+		l = stealVoice();
 	//printf( "syn alloclayer<%p>\n", l );
-	_freeVoices.erase(it);
-	it = _activeVoices.find(l);
-	assert(it == _activeVoices.end() );
-	_activeVoices.insert(l);
+	_activeVoices.pushBack(l);
+	return l;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+layer* synth::stealVoice()
+{
+	auto l = _activeVoices.front();
+	assert(l!=nullptr);
+
+	if( eStealMode::QUIETEST == _stealMode )
+	{
+		for( auto v=l->_listNext; v!=nullptr; v=v->_listNext )
+			if( v->_level < l->_level )
+				l = v;
+	}
+
+	_activeVoices.remove(l);
+	if( l->_progInst )
+		l->_progInst->removeLayer(l);
+	if( l == _hudLayer )
+		_hudLayer = nullptr;
+	_numStolen++;
 	return l;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// voices release themselves from their envelopes,
+//  so this gets called from the voice workers too
+
 void synth::freeLayer(layer* l)
 {
-	_deactiveateVoiceQ.push(l);
+	int index = _numDeactivate.fetch_add(1);
+	assert(index<kmaxvoices);
+	_deactivateVoiceQ[index] = l;
 }
 
+// audio thread, with no voice rendering in flight
+
 void synth::deactivateVoices()
 {
-	bool done = (_deactiveateVoiceQ.size()==0);
+	int inumq = _numDeactivate.load();
+	_numDeactivate.store(0);
 
-	while( false == done )
+	for( int iq=0; iq<inumq; iq++ )
 	{
-		auto l = _deactiveateVoiceQ.front();
-		 _deactiveateVoiceQ.pop();
+		auto l = _deactivateVoiceQ[iq];
 
 		 if( l == _hudLayer )
 		 {
@@ -229,20 +316,13 @@ void synth::deactivateVoices()
 
 		 }
 
-		auto it = _activeVoices.find(l);
-		assert(it != _activeVoices.end() );
-		_activeVoices.erase(it);
-
-		int inumv = _activeVoices.size();
+		if( l->_progInst )
+			l->_progInst->removeLayer(l);
 
-		printf( "syn freeLayer<%p> curnumvoices<%d>\n", l, inumv );
-
-		it = _freeVoices.find(l);
-		assert(it == _freeVoices.end() );
-		_freeVoices.insert(l);
-
-		done = (_deactiveateVoiceQ.size()==0);
+		_activeVoices.remove(l);
+		_freeVoices.pushBack(l);
 
+		//printf( "syn freeLayer<%p> curnumvoices<%d>\n", l, _activeVoices.size() );
 	}
 
 }
@@ -252,14 +332,12 @@ void synth::deactivateVoices()
 programInst* synth::keyOn(int note,const programData* pdata )
 {
 	assert(pdata);
-	auto it = _freeProgInst.begin();
-	assert(it != _freeProgInst.end() );
-	auto pi = *it;
+	auto pi = _freeProgInst.popFront();
+	assert(pi!=nullptr);
 	//printf( "syn allocProgInst<%p>\n", pi );
 	pi->_progdata = pdata;
-	_freeProgInst.erase(it);
 	pi->keyOn(note,pdata);
-	_activeProgInst.insert(pi);
+	_activeProgInst.pushBack(pi);
 	_lnoteframe = 0;
 	_lnotetime = 0.0f;
 	_clearhuddata = true;
@@ -279,10 +357,8 @@ programInst* synth::keyOn(int note,const programData* pdata )
 void synth::keyOff(programInst* pinst)
 {
 	pinst->keyOff();
-	auto it = _activeProgInst.find(pinst);
-	assert(it != _activeProgInst.end() );
-	_activeProgInst.erase(it);
-	_freeProgInst.insert(pinst);
+	_activeProgInst.remove(pinst);
+	_freeProgInst.pushBack(pinst);
 	if( 0 )// _testtone )
 	{
 		_testtoneampps = slopeDBPerSample(-18,_sampleRate);
@@ -334,12 +410,11 @@ void synth::compute(int inumframes,const void* inputBuffer)
 	//for( auto pi : _activeProgInst )
 	//	pi->compute();
 
-	int inumv = 0;
-	for( auto l : _activeVoices )
-	{
-		l->compute(_obuf);
-		inumv++;
-	}
+	_voiceList.clear();
+	for( auto l=_activeVoices.front(); l!=nullptr; l=l->_listNext )
+		_voiceList.push_back(l);
+
+	_voiceWorkers->render(_voiceList.data(),int(_voiceList.size()),_obuf);
 
 	if( 0 )//_testtone )
 	{
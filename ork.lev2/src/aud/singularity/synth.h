@@ -4,25 +4,33 @@
 #include "krztypes.h"
 #include "krzdata.h"
 #include "layer.h"
+#include "voiceworkers.h"
 #include <ork/kernel/concurrent_queue.h>
+#include <ork/kernel/fixedlambda.h>
 #include <ork/kernel/svariant.h>
 
 ///////////////////////////////////////////////////////////////////////////////
 
 struct programInst
 {
+	static const int kmaxlayers = 32;
+
 	programInst(synth& syn);
 	~programInst();
 
 	void keyOn( int note, const programData* pd );
 	void keyOff();
+	void removeLayer( layer* l ); // a voice freed or stolen from under us
 
 	//void compute();
 
 	const programData* _progdata;
 	synth& _syn;
 
-	std::vector<layer*> _layers;
+	std::vector<layer*> _layers; // reserved to kmaxlayers
+
+	programInst* _listPrev = nullptr; // synth free/active list links
+	programInst* _listNext = nullptr;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -35,9 +43,34 @@ struct hudsample
 	float _value;
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// nothing on the audio thread allocates once the synth is built :
+//  voices and program instances move between fixed intrusive lists,
+//  with a busy voice stolen (_stealMode) when none are free,
+//  and timed events (captures up to keventsize bytes) are queued from
+//  any thread and ordered in a preallocated heap by tick().
+///////////////////////////////////////////////////////////////////////////////
+
 struct synth
 {
-	synth(float sr);
+	static const int kmaxvoices = 256;
+	static const int kmaxprogramInsts = 256;
+	static const int kmaxframes = 1024; // frames per block the voice workers preallocate for
+	static const int kmaxevents = 1024; // pending timed events
+	static const int keventsize = 64;
+
+	typedef ork::FixedLambda<void(),keventsize> event_t;
+	typedef intrusiveList<layer> voiceList;
+
+	struct timedEvent
+	{
+		float _time = 0.0f;
+		uint32_t _seq = 0; // equal times run in the order they were added
+		event_t _event;
+	};
+
+	// inumworkers : voice rendering threads besides the audio callback, -1 for one less than the cores
+	synth(float sr, int inumworkers=-1);
 	~synth();
 
 	typedef std::vector<hudsample> hudsamples_t;
@@ -48,6 +81,7 @@ struct synth
 	void keyOff(programInst* p);
 
 	layer* allocLayer();
+	layer* stealVoice();
 	void freeLayer(layer* l);
 	void deactivateVoices();
 
@@ -58,7 +92,7 @@ struct synth
 
 	void resetFenables();
 
-    void addEvent(float time, void_lamda_t ev);
+    bool addEvent(float time, event_t ev); // false (and dropped) if the queue is full
     void tick(float dt);
     float _timeaccum;
 
@@ -67,14 +101,21 @@ struct synth
 	float _sampleRate;
 	float _dt;
 
-	std::set<layer*> _freeVoices;
-	std::set<layer*> _activeVoices;
-	std::queue<layer*> _deactiveateVoiceQ;
-	std::set<programInst*> _freeProgInst;
-	std::set<programInst*> _activeProgInst;
+	voiceList _freeVoices;
+	voiceList _activeVoices; // in keyOn order
+	eStealMode _stealMode = eStealMode::OLDEST;
+	int _numStolen = 0;
+	std::vector<layer*> _voiceList; // _activeVoices for the current block
+	voiceWorkers* _voiceWorkers;
+	layer* _deactivateVoiceQ[kmaxvoices]; // released voices, filled from any voice worker
+	ork::atomic<int> _numDeactivate;
+	intrusiveList<programInst> _freeProgInst;
+	intrusiveList<programInst> _activeProgInst;
 	std::map<std::string,hudsamples_t> _hudsample_map;
 
-    std::multimap<float,void_lamda_t> _eventmap;
+	ork::MpMcBoundedQueue<timedEvent> _eventQ; // addEvent, drained by tick
+	std::vector<timedEvent> _eventHeap; // reserved to kmaxevents
+	ork::atomic<uint32_t> _eventSeq;
 
 	int _soloLayer = -1;
 	bool _fblockEnable[5] = { true, true, true, true, true };
@@ -93,6 +134,7 @@ struct synth
 	bool _doPressure = false;
 	bool _doInput = false;
 	float _masterGain = 1.0f/2.0f;
+	eInterpMode _sampleInterp = eInterpMode::LINEAR;
 
 	layer* _hudLayer = nullptr;
 	bool _clearhuddata = true;
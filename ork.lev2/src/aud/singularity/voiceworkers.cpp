@@ -0,0 +1,179 @@
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include "voiceworkers.h"
+#include "layer.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+voiceWorkers::voiceWorkers( int inumworkers, int imaxframes )
+    : _numWorkers( std::min( std::max(inumworkers,0), int(kmaxworkers) ) )
+    , _voices(nullptr)
+    , _numFrames(0)
+{
+    _numVoices.store(0);
+    _cursor.store(0);
+    _generation.store(0);
+    _numDone.store(0);
+    _quit.store(false);
+
+    for( int i=0; i<=_numWorkers; i++ )
+    {
+        _accum[i].resize(imaxframes);
+        _accumGen[i].store(0);
+    }
+
+    for( int i=0; i<_numWorkers; i++ )
+    {
+        _threads[i] = new ork::Thread( "synvoices" );
+        _threads[i]->start( [this,i]()
+        {
+            workerLoop(i);
+        });
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+voiceWorkers::~voiceWorkers()
+{
+    _quit.store(true);
+    _wake.NotifyAll();
+    for( int i=0; i<_numWorkers; i++ )
+    {
+        _threads[i]->join();
+        delete _threads[i];
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void voiceWorkers::workerLoop( int iworker )
+{
+    // the same class as the audio callback if we are allowed,
+    //  otherwise the workers just stay at normal priority
+    sched_param param;
+    memset( &param, 0, sizeof(param) );
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO)-1;
+    pthread_setschedparam( pthread_self(), SCHED_FIFO, &param );
+
+    uint32_t seen = 0;
+
+    while( false == _quit.load(MemAcquire) )
+    {
+        uint32_t gen = _generation.load(MemAcquire);
+
+        for( int i=0; gen==seen && i<kidlespins; i++ )
+        {
+            ork::cpu_relax();
+            gen = _generation.load(MemAcquire);
+        }
+
+        if( gen==seen )
+        {
+            uint32_t key = _wake.PrepareWait();
+            if( _generation.load(MemAcquire)!=seen || _quit.load(MemAcquire) )
+                _wake.CancelWait();
+            else
+                _wake.Wait(key);
+            continue;
+        }
+
+        seen = gen;
+        renderClaimed( iworker, gen );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// claims voices of block gen until there are none left
+
+int voiceWorkers::renderClaimed( int islot, uint32_t gen )
+{
+    outputBuffer& accum = _accum[islot];
+    int inumrendered = 0;
+
+    uint64_t cur = _cursor.load(MemAcquire);
+    while( uint32_t(cur>>32)==gen && int(uint32_t(cur))<_numVoices.load(MemRelaxed) )
+    {
+        if( false == _cursor.compare_exchange_weak( cur, cur+1, std::memory_order_acq_rel, MemAcquire ) )
+            continue;
+
+        if( _accumGen[islot].load(MemRelaxed)!=gen )
+        {
+            accum.resize(_numFrames);
+            for( int i=0; i<_numFrames; i++ )
+            {
+                accum._leftBuffer[i] = 0.0f;
+                accum._rightBuffer[i] = 0.0f;
+            }
+            _accumGen[islot].store(gen,MemRelaxed);
+        }
+
+        _voices[uint32_t(cur)]->compute(accum);
+        inumrendered++;
+
+        _numDone.fetch_add(1,MemRelease);
+        cur = _cursor.load(MemAcquire);
+    }
+    return inumrendered;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void voiceWorkers::render( layer* const* voices, int inumvoices, outputBuffer& obuf )
+{
+    int inumframes = obuf._numframes;
+
+    if( 0==_numWorkers || inumvoices<2 )
+    {
+        for( int i=0; i<inumvoices; i++ )
+            voices[i]->compute(obuf);
+        return;
+    }
+
+    ///////////////////////////////////
+    // publish the block, then help render it
+    ///////////////////////////////////
+
+    uint32_t gen = _generation.load(MemRelaxed)+1;
+    _voices = voices;
+    _numVoices.store(inumvoices,MemRelaxed);
+    _numFrames = inumframes;
+    _numDone.store(0,MemRelaxed);
+    _cursor.store(uint64_t(gen)<<32,MemRelease);
+    _generation.store(gen,MemRelease);
+    _wake.NotifyAll();
+
+    renderClaimed( _numWorkers, gen );
+
+    // at most one voice per worker is still in flight, yield
+    //  once that takes long (a preempted worker)
+    for( int ispin=0; _numDone.load(MemAcquire)<inumvoices; ispin++ )
+    {
+        if( ispin<kidlespins )
+            ork::cpu_relax();
+        else
+            std::this_thread::yield();
+    }
+
+    ///////////////////////////////////
+    // mix the slots that took part
+    ///////////////////////////////////
+
+    float* outl = obuf._leftBuffer;
+    float* outr = obuf._rightBuffer;
+    for( int is=0; is<=_numWorkers; is++ )
+    {
+        if( _accumGen[is].load(MemRelaxed)!=gen )
+            continue;
+        const float* accl = _accum[is]._leftBuffer;
+        const float* accr = _accum[is]._rightBuffer;
+        for( int i=0; i<inumframes; i++ )
+        {
+            outl[i] += accl[i];
+            outr[i] += accr[i];
+        }
+    }
+}
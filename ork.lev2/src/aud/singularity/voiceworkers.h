@@ -0,0 +1,59 @@
+#pragma once
+
+#include <ork/kernel/atomic.h>
+#include <ork/kernel/eventcount.h>
+#include <ork/kernel/thread.h>
+#include "krztypes.h"
+
+struct layer;
+
+///////////////////////////////////////////////////////////////////////////////
+// voice rendering on worker threads
+//
+//  the audio callback publishes the block's voice list and claims voices
+//   alongside the workers, one at a time, through a single atomic cursor
+//   tagged with the block generation (so a late worker can never claim
+//   into the next block). each thread accumulates into its own buffer,
+//   the callback adds those up once every voice is done.
+//
+//  nothing in render() locks or allocates : workers spin briefly between
+//   blocks, then park on an EventCount, so waking them costs the callback
+//   a futex wake at most.
+//
+//  the mix order depends on which thread got which voice, so the output
+//   can differ from a serial render by float rounding.
+///////////////////////////////////////////////////////////////////////////////
+
+struct voiceWorkers
+{
+    static const int kmaxworkers = 15;
+    static const int kidlespins = 4096;
+
+    voiceWorkers( int inumworkers, int imaxframes );
+    ~voiceWorkers();
+
+    // adds every voice's output into obuf
+    void render( layer* const* voices, int inumvoices, outputBuffer& obuf );
+
+    int numWorkers() const { return _numWorkers; }
+
+private:
+
+    void workerLoop( int iworker );
+    int renderClaimed( int islot, uint32_t gen );
+
+    int _numWorkers;
+    ork::Thread* _threads[kmaxworkers];
+    outputBuffer _accum[kmaxworkers+1]; // the callback's own slot last
+    ork::atomic<uint32_t> _accumGen[kmaxworkers+1]; // block a slot last accumulated in
+
+    layer* const* _voices;
+    ork::atomic<int> _numVoices;
+    int _numFrames;
+
+    ork::atomic<uint64_t> _cursor; // generation<<32 | next voice
+    ork::atomic<uint32_t> _generation;
+    ork::atomic<int> _numDone;
+    ork::atomic<bool> _quit;
+    ork::EventCount _wake;
+};
@@ -14,6 +14,7 @@
 #include <ork/file/chunkfile.h>
 #include <ork/file/chunkfile.hpp>
 #include <ork/application/application.h>
+#include <ork/math/simd4.h>
 
 INSTANTIATE_TRANSPARENT_RTTI( ork::lev2::XgmAnimChannel,"XgmAnimChannel");
 INSTANTIATE_TRANSPARENT_RTTI( ork::lev2::XgmFloatAnimChannel,"XgmFloatAnimChannel");
@@ -346,6 +347,7 @@ void XgmBlendPoseInfo::ComputeMatrix( CMatrix4 & outmatrix ) const
 			const DecompMtx44 &a = AnimMat[0];
 			const DecompMtx44 &b = AnimMat[1];
 			DecompMtx44 c;
+			c.mScale = 1.0f; // components neither anim has stay identity
 
 			const EXFORM_COMPONENT& acomp = AnimComponents[0];
 			const EXFORM_COMPONENT& bcomp = AnimComponents[0];
@@ -387,13 +389,37 @@ void XgmBlendPoseInfo::ComputeMatrix( CMatrix4 & outmatrix ) const
 		}
 		break;
 
-		default:
-			// gotta figure out a N-way quaternion blend first
-			// on the DS, Lerping each matrix column (NormalX, NormalY, NormalZ) gives
-			// decent results. Try it.
+		default: // N-way : normalized weights, quaternions summed in the first ones hemisphere
 		{
-			OrkAssert(false);
-			outmatrix = CMatrix4::Identity;
+			float fwsum = 0.0f;
+			for( int i=0; i<miNumAnims; i++ )
+				fwsum += AnimWeight[i];
+			OrkAssert(fwsum > 0.0f);
+			float finvwsum = 1.0f / fwsum;
+
+			const CQuaternion& q0 = AnimMat[0].mRot;
+			float fq[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			float ft[3] = { 0.0f, 0.0f, 0.0f };
+			float fs = 0.0f;
+			for( int i=0; i<miNumAnims; i++ )
+			{
+				const DecompMtx44& m = AnimMat[i];
+				float fw = AnimWeight[i] * finvwsum;
+				float fdot = q0.GetX()*m.mRot.GetX() + q0.GetY()*m.mRot.GetY() + q0.GetZ()*m.mRot.GetZ() + q0.GetW()*m.mRot.GetW();
+				float fwq = (fdot < 0.0f) ? -fw : fw;
+				fq[0] += m.mRot.GetX()*fwq; fq[1] += m.mRot.GetY()*fwq; fq[2] += m.mRot.GetZ()*fwq; fq[3] += m.mRot.GetW()*fwq;
+				ft[0] += m.mTrans.GetX()*fw; ft[1] += m.mTrans.GetY()*fw; ft[2] += m.mTrans.GetZ()*fw;
+				fs += m.mScale*fw;
+			}
+			DecompMtx44 c;
+			c.mRot = CQuaternion( fq[0], fq[1], fq[2], fq[3] );
+			c.mTrans = CVector3( ft[0], ft[1], ft[2] );
+			c.mScale = fs;
+
+			if(mPoseCallback)
+				mPoseCallback->PostBlendPreConcat(c);
+
+			outmatrix.ComposeMatrix(c.mTrans, c.mRot, c.mScale);
 		}
 		break;
 	}
@@ -564,6 +590,9 @@ void XgmLocalPose::ApplyAnimInst( const XgmAnimInst& AnimInst )
 		float frame = AnimInst.GetCurrentFrame();
 		float numframes = AnimInst.GetNumFrames();
 		int iframe = int(frame);
+		const ork::lev2::XgmDecompAnimChannel* BoundChannels[XgmAnimInst::kmaxbones];
+		int BoundSkelIndices[XgmAnimInst::kmaxbones];
+		int inumbound = 0;
 		for( int iaidx=0; iaidx<XgmAnimInst::kmaxbones; iaidx++ )
 		{
 			const XgmAnimInst::Binding& binding = AnimInst.GetAnimBinding(iaidx);
@@ -572,19 +601,26 @@ void XgmLocalPose::ApplyAnimInst( const XgmAnimInst& AnimInst )
 			if( iskelindex != 0xffff )
 			{
 				int ichanindex = binding.mChanIndex;
-				const ork::lev2::XgmDecompAnimChannel* __restrict MtxChannelData = Channels.GetItemAtIndex(ichanindex).second;
-				const DecompMtx44& AnimMtx = MtxChannelData->GetFrame(iframe);
-				EXFORM_COMPONENT components = AnimInst.RefMask().GetComponents(iskelindex);
-				RefBlendPoseInfo(iskelindex).AddPose(AnimMtx, fweight, components);
-
-				//printf( "apply frame<%d> on iskelidx<%d>\n", iframe, iskelindex );
-
+				BoundChannels[inumbound] = Channels.GetItemAtIndex(ichanindex).second;
+				BoundSkelIndices[inumbound] = iskelindex;
+				inumbound++;
 			}
 			else
 			{
 				break;
 			}
 		}
+		////////////////////////////////////////////////////
+		// decode the whole pose at once, then blend it
+		////////////////////////////////////////////////////
+		DecompMtx44 AnimMtxs[XgmAnimInst::kmaxbones];
+		XgmDecompAnimChannel::SampleChannels( BoundChannels, inumbound, float(iframe), AnimMtxs );
+		for( int ib=0; ib<inumbound; ib++ )
+		{
+			int iskelindex = BoundSkelIndices[ib];
+			EXFORM_COMPONENT components = AnimInst.RefMask().GetComponents(iskelindex);
+			RefBlendPoseInfo(iskelindex).AddPose(AnimMtxs[ib], fweight, components);
+		}
 		/*
 		//////////////////////////////////////////////////////////////////////////////////////////
 		// root anim on a rigid model (ala destructables in sushi)
@@ -637,45 +673,41 @@ void XgmLocalPose::BindPose( void )
 void XgmLocalPose::BuildPose( void )
 {
 #ifdef ENABLE_ANIM
-	int inumjoints = NumJoints();
-
-	static int gctr = 0;
-	for( int i=0; i<inumjoints; i++ )
-	{
-		int inumanms = mBlendPoseInfos[i].GetNumAnims();
-
-		//printf( "j<%d> inumanms<%d>\n", i, inumanms );
-		if( inumanms )
-		{
-			 mBlendPoseInfos[i].ComputeMatrix(mLocalMatrices[i]);
-
-			 if(0)//( i == ((gctr/1000)%inumjoints) )
-			 {
-			 	ork::FixedString<64> fxs;
-			 	fxs.format( "buildpose i<%d>", i );
-			 	mLocalMatrices[i].dump((char*)fxs.c_str());
-			 }
-			 // TODO: Callback for after previous/current have been blended in local space
-		}
-	}
-	gctr++;
-
+	BlendPose(); // see gfxanim_pose.cpp
+	// TODO: Callback for after previous/current have been blended in local space
 	Concatenate();
 #endif
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Concat43 on rows (a row times the parents 3x3, plus its translation row),
+//  the w column is set as Concat43 leaves it (0,0,0,1)
+static inline void Concat43Rows( const CMatrix4& LocMatrix, const CMatrix4& ParentMatrix, CMatrix4& out )
+{
+	using namespace simd;
+	const float* __restrict pa = LocMatrix.GetArray();
+	const float* __restrict pb = ParentMatrix.GetArray();
+	const m4 wlane = vlanes(8);
+	f4 b0 = f4::load(pb+0), b1 = f4::load(pb+4), b2 = f4::load(pb+8), b3 = f4::load(pb+12);
+	f4 r0 = f4(pa[0])*b0+f4(pa[1])*b1+f4(pa[2])*b2;
+	f4 r1 = f4(pa[4])*b0+f4(pa[5])*b1+f4(pa[6])*b2;
+	f4 r2 = f4(pa[8])*b0+f4(pa[9])*b1+f4(pa[10])*b2;
+	f4 r3 = f4(pa[12])*b0+f4(pa[13])*b1+f4(pa[14])*b2+b3;
+	float* __restrict pout = out.GetArray();
+	vselect( wlane, f4(0.0f), r0 ).store(pout+0);
+	vselect( wlane, f4(0.0f), r1 ).store(pout+4);
+	vselect( wlane, f4(0.0f), r2 ).store(pout+8);
+	vselect( wlane, f4(1.0f), r3 ).store(pout+12);
+}
+
 void XgmLocalPose::Concatenate( void )
 {
+	using namespace simd;
 	CMatrix4* __restrict pmats = & RefLocalMatrix(0);
 
-	float fminx = CFloat::TypeMax();
-	float fminy = CFloat::TypeMax();
-	float fminz = CFloat::TypeMax();
-	float fmaxx = -CFloat::TypeMax();
-	float fmaxy = -CFloat::TypeMax();
-	float fmaxz = -CFloat::TypeMax();
+	f4 vboundmin( CFloat::TypeMax() );
+	f4 vboundmax( -CFloat::TypeMax() );
 
 	if( mSkeleton.miRootNode >= 0 )
 	{
@@ -688,27 +720,25 @@ void XgmLocalPose::Concatenate( void )
 			const XgmBone & Bone = mSkeleton.GetFlattenedBone( ib );
 			int iparent = Bone.miParent;
 			int ichild = Bone.miChild;
-			const CMatrix4 & ParentMatrix = pmats[ iparent ];
-			const CMatrix4 & LocMatrix = pmats[ ichild ];
 
-			pmats[ ichild ] = LocMatrix.Concat43(ParentMatrix);
+			// flattened order : the parent is always final before its children
+			Concat43Rows( pmats[ ichild ], pmats[ iparent ], pmats[ ichild ] );
 
 			if(RefBlendPoseInfo(ichild).GetPoseCallback())
 				RefBlendPoseInfo(ichild).GetPoseCallback()->PostBlendPostConcat(pmats[ ichild ]);
 
-			CVector3 vtrans = pmats[ ichild ].GetTranslation();
-
-			fminx = CFloat::Min( fminx, vtrans.GetX() );
-			fminy = CFloat::Min( fminy, vtrans.GetY() );
-			fminz = CFloat::Min( fminz, vtrans.GetZ() );
-
-			fmaxx = CFloat::Max( fmaxx, vtrans.GetX() );
-			fmaxy = CFloat::Max( fmaxy, vtrans.GetY() );
-			fmaxz = CFloat::Max( fmaxz, vtrans.GetZ() );
-
+			f4 vtrans = f4::load( pmats[ ichild ].GetArray()+12 );
+			vboundmin = vmin( vboundmin, vtrans );
+			vboundmax = vmax( vboundmax, vtrans );
 		}
 	}
 
+	float fmins[4], fmaxs[4];
+	vboundmin.store( fmins );
+	vboundmax.store( fmaxs );
+	float fminx = fmins[0], fminy = fmins[1], fminz = fmins[2];
+	float fmaxx = fmaxs[0], fmaxy = fmaxs[1], fmaxz = fmaxs[2];
+
 	float fmidx = (fminx+fmaxx)*0.5f;
 	float fmidy = (fminy+fmaxy)*0.5f;
 	float fmidz = (fminz+fmaxz)*0.5f;
@@ -948,6 +978,14 @@ void XgmAnim::AddChannel( const PoolString &Name, XgmAnimChannel*pchan )
 
 ///////////////////////////////////////////////////////////////////////////////
 
+void XgmAnim::CompressJointChannels( const XgmAnimCompression& settings )
+{
+	for( JointChannelsMap::const_iterator it=mJointAnimationChannels.begin(); it!=mJointAnimationChannels.end(); it++ )
+		it->second->Compress( settings );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 const XgmAnimInst::Binding XgmAnimInst::gBadBinding;
 
 XgmAnimInst::XgmAnimInst()
@@ -1085,17 +1123,29 @@ void XgmMatrixAnimChannel::ReserveFrames(int icount)
 XgmDecompAnimChannel::XgmDecompAnimChannel( )
 	: XgmAnimChannel( EXGMAC_DCMTX )
 	, mSampledFrames( 0 )
+	, miNumFrames( 0 )
 	, miAddIndex( 0 )
+	, mpTrack( 0 )
 {
 }
 
 XgmDecompAnimChannel::XgmDecompAnimChannel( const PoolString& ObjName, const PoolString & ChanName, const PoolString & Usage )
 	: XgmAnimChannel( ObjName, ChanName, Usage, EXGMAC_DCMTX )
 	, mSampledFrames( 0 )
+	, miNumFrames( 0 )
 	, miAddIndex( 0 )
+	, mpTrack( 0 )
 {
 }
 
+XgmDecompAnimChannel::~XgmDecompAnimChannel()
+{
+	delete mpTrack;
+#if ! defined(WII)
+	delete[] mSampledFrames;
+#endif
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 void XgmDecompAnimChannel::AddFrame( const DecompMtx44& v )
@@ -1107,14 +1157,52 @@ void XgmDecompAnimChannel::AddFrame( const DecompMtx44& v )
 
 ///////////////////////////////////////////////////////////////////////////////
 
-const DecompMtx44& XgmDecompAnimChannel::GetFrame( int index ) const
+DecompMtx44 XgmDecompAnimChannel::GetFrame( int index ) const
 {
 	OrkAssert( index >= 0 && index < miAddIndex );
+	if( mpTrack )
+	{
+		DecompMtx44 rval;
+		mpTrack->Sample( float(index), rval );
+		return rval;
+	}
 	return mSampledFrames[index];
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
+void XgmDecompAnimChannel::Compress( const XgmAnimCompression& settings )
+{
+	OrkAssert( miAddIndex==miNumFrames );
+	XgmAnimTrack* ptrack = new XgmAnimTrack; // no frames : a track without keys
+	if( miAddIndex>0 )
+		ptrack->Encode( mSampledFrames, miAddIndex, settings );
+	SetTrack( ptrack, miAddIndex );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void XgmDecompAnimChannel::SetTrack( XgmAnimTrack* ptrack, int inumframes )
+{
+	delete mpTrack;
+#if ! defined(WII)
+	delete[] mSampledFrames;
+#endif
+	mSampledFrames = 0;
+	mpTrack = ptrack;
+	miNumFrames = inumframes;
+	miAddIndex = inumframes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t XgmDecompAnimChannel::GetMemorySize() const
+{
+	return mpTrack ? mpTrack->GetMemorySize() : sizeof(DecompMtx44)*size_t(miNumFrames);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 int XgmDecompAnimChannel::GetNumFrames() const
 {
 	return miNumFrames;
@@ -1318,6 +1406,7 @@ struct AnimLoadAllocator
 		if( 0 == strcmp( pchkname, "header" ) ) pmem = new char[ilen];
 		else if( 0 == strcmp( pchkname, "animdata" ) ) pmem = new char[ilen];
 #endif
+		if( 0 == strcmp( pchkname, "animtracks" ) ) pmem = new char[ilen];
 		return pmem;
 	}
 	//////////////////////////////
@@ -1325,7 +1414,7 @@ struct AnimLoadAllocator
 	//////////////////////////////
 	void done( const char* pchkname, void* pdata )
 	{
-		if( 0 == strcmp( pchkname, "header" ) )
+		if( 0 == strcmp( pchkname, "header" ) || 0 == strcmp( pchkname, "animtracks" ) )
 		{
 			delete[] (char *) pdata;
 		}			// audio banks keep this resident
@@ -1338,6 +1427,37 @@ struct AnimLoadAllocator
 	}
 };
 ///////////////////////////////////////////////////////////////////////////////
+// compressed joint channels (see XgmAnim::Save)
+//  numkeys[3], posmin[3], posextent[3], scalemin, scaleextent,
+//  keyframes, values, padded to 4 bytes
+///////////////////////////////////////////////////////////////////////////////
+static XgmAnimTrack* LoadAnimTrack( chunkfile::InputStream* TrackStream, int idataoffset )
+{
+	chunkfile::InputStream trk( TrackStream->GetDataAt(idataoffset), TrackStream->GetLength()-idataoffset );
+	XgmAnimTrack* ptrack = new XgmAnimTrack;
+	static const int kvalsperkey[XgmAnimTrack::ECOMP_COUNT] = { 3, 3, 1 };
+	int inumkeys = 0, inumvals = 0;
+	for( int ic=0; ic<XgmAnimTrack::ECOMP_COUNT; ic++ )
+	{
+		XgmAnimTrack::Component& comp = ptrack->mComponents[ic];
+		trk.GetItem( comp.miNumKeys );
+		comp.miFirstKey = inumkeys;
+		comp.miFirstValue = inumvals;
+		inumkeys += comp.miNumKeys;
+		inumvals += comp.miNumKeys*kvalsperkey[ic];
+	}
+	for( int ia=0; ia<3; ia++ ) trk.GetItem( ptrack->mPosMin[ia] );
+	for( int ia=0; ia<3; ia++ ) trk.GetItem( ptrack->mPosExtent[ia] );
+	trk.GetItem( ptrack->mScaleMin );
+	trk.GetItem( ptrack->mScaleExtent );
+	ptrack->mKeyFrames.resize( inumkeys );
+	ptrack->mValues.resize( inumvals );
+	for( int ik=0; ik<inumkeys; ik++ ) trk.GetItem( ptrack->mKeyFrames[ik] );
+	for( int iv=0; iv<inumvals; iv++ ) trk.GetItem( ptrack->mValues[iv] );
+	ptrack->BuildKeySeek();
+	return ptrack;
+}
+///////////////////////////////////////////////////////////////////////////////
 bool XgmAnim::UnLoadUnManaged( XgmAnim* anm )
 {
 #if defined(ORKCONFIG_ASSET_UNLOAD)
@@ -1369,6 +1489,7 @@ bool XgmAnim::LoadUnManaged( XgmAnim* anm, const AssetPath& fname )
 	if( chunkreader.IsOk() )
 	{	chunkfile::InputStream* HeaderStream = chunkreader.GetStream("header");
 		chunkfile::InputStream* AnimDataStream = chunkreader.GetStream("animdata");
+		chunkfile::InputStream* TrackStream = chunkreader.GetStream("animtracks"); // compressed joint channels
 		////////////////////////////////////////////////////////
 		int inumchannels = 0, inumframes = 0;
 		int inumjointchannels=0;
@@ -1391,13 +1512,20 @@ bool XgmAnim::LoadUnManaged( XgmAnim* anm, const AssetPath& fname )
 			const char* pobjname = chunkreader.GetString(iobjname);
 			const char* pchnname = chunkreader.GetString(ichnname);
 			const char* pusgname = chunkreader.GetString(iusgname);
-			void* pdata = AnimDataStream->GetDataAt( idataoffset );
 			ork::object::ObjectClass* pclass = rtti::autocast( rtti::Class::FindClass(pchannelclass) );
 			XgmAnimChannel* Channel = rtti::autocast( pclass->CreateObject() );
 			Channel->SetChannelName( AddPooledString(pchnname) );
 			Channel->SetObjectName( AddPooledString(pobjname) );
 			Channel->SetChannelUsage( AddPooledString(pusgname) );
-			chansettter::set( anm, Channel, pdata );
+			if( TrackStream )
+			{	XgmDecompAnimChannel* DecChannel = rtti::autocast( Channel );
+				OrkAssert( DecChannel );
+				DecChannel->SetTrack( LoadAnimTrack( TrackStream, idataoffset ), inumframes );
+			}
+			else
+			{	void* pdata = AnimDataStream->GetDataAt( idataoffset );
+				chansettter::set( anm, Channel, pdata );
+			}
 			anm->AddChannel( Channel->GetChannelName(), Channel );
 		}
 		OrkHeapCheck();
@@ -0,0 +1,225 @@
+////////////////////////////////////////////////////////////////
+// Orkid Media Engine
+// Copyright 1996-2012, Michael T. Mayers.
+// Distributed under the Boost Software License - Version 1.0 - August 17, 2003
+// see http://www.boost.org/LICENSE_1_0.txt
+////////////////////////////////////////////////////////////////
+
+#include <ork/pch.h>
+#include <ork/lev2/gfx/gfxanim.h>
+#include <ork/math/simd4.h>
+#include <ork/kernel/opq.h>
+#include <ork/kernel/taskgraph.h>
+
+namespace ork { namespace lev2 {
+
+///////////////////////////////////////////////////////////////////////////////
+// pose blending, structure of arrays
+//
+//  joints that blend whole transforms (XFORM_COMPONENT_ALL, no callback)
+//  are gathered into lanes : per blend slot, quaternion, translation,
+//  scale and weight arrays. 4 joints per step, the weighted sum (quaternions
+//  flipped into slot 0's hemisphere) is composed straight to a matrix, the
+//  same as XgmBlendPoseInfo::ComputeMatrix would. other joints go through
+//  ComputeMatrix as before.
+///////////////////////////////////////////////////////////////////////////////
+
+enum EBlendLane
+{
+	EBL_QX = 0, EBL_QY, EBL_QZ, EBL_QW,
+	EBL_TX, EBL_TY, EBL_TZ,
+	EBL_SCALE,
+	EBL_WEIGHT,
+	EBL_COUNT,
+};
+
+static bool IsWholeBlend( const XgmBlendPoseInfo& info )
+{
+	if( info.GetPoseCallback() )
+		return false;
+	for( int ia=0; ia<info.GetNumAnims(); ia++ )
+		if( info.GetAnimComponents(ia) != XFORM_COMPONENT_ALL )
+			return false;
+	return true;
+}
+
+// the weights ComputeMatrix blends with
+static void BlendWeights( const XgmBlendPoseInfo& info, float* pweights )
+{
+	int inumanims = info.GetNumAnims();
+	switch( inumanims )
+	{
+		case 1:
+			pweights[0] = 1.0f;
+			break;
+		case 2:
+		{
+			OrkAssert( std::fabs(info.GetAnimWeight(0)+info.GetAnimWeight(1)-1.0f) < 0.01f );
+			float flerp = std::min( std::max( info.GetAnimWeight(1), 0.0f ), 1.0f );
+			pweights[0] = 1.0f-flerp;
+			pweights[1] = flerp;
+			break;
+		}
+		default:
+		{
+			float fwsum = 0.0f;
+			for( int ia=0; ia<inumanims; ia++ )
+				fwsum += info.GetAnimWeight(ia);
+			OrkAssert( fwsum>0.0f );
+			for( int ia=0; ia<inumanims; ia++ )
+				pweights[ia] = info.GetAnimWeight(ia)/fwsum;
+			break;
+		}
+	}
+}
+
+void XgmLocalPose::BlendPose( void )
+{
+	using namespace simd;
+
+	int inumjoints = NumJoints();
+
+	///////////////////////////////////
+	// split joints : lanes or ComputeMatrix
+	///////////////////////////////////
+
+	mBlendJoints.clear();
+	int imaxanims = 0;
+	for( int ij=0; ij<inumjoints; ij++ )
+	{
+		const XgmBlendPoseInfo& info = mBlendPoseInfos[ij];
+		int inumanims = info.GetNumAnims();
+		if( 0 == inumanims )
+			continue;
+		if( IsWholeBlend(info) )
+		{
+			mBlendJoints.push_back( ij );
+			imaxanims = std::max( imaxanims, inumanims );
+		}
+		else
+			info.ComputeMatrix( mLocalMatrices[ij] );
+	}
+
+	int inumlanes = int(mBlendJoints.size());
+	if( 0 == inumlanes )
+		return;
+
+	///////////////////////////////////
+	// gather, unused slots and padding lanes get weight 0 and the
+	//  slot 0 (or identity) transform so they stay finite
+	///////////////////////////////////
+
+	int istride = (inumlanes+3)&~3;
+	mBlendLanes.resize( size_t(imaxanims*EBL_COUNT*istride) );
+	float* __restrict planes = mBlendLanes.data();
+	#define BLEND_LANE( islot, ifield ) (planes+((islot)*EBL_COUNT+(ifield))*istride)
+
+	DecompMtx44 ident;
+	ident.mScale = 1.0f;
+	for( int il=0; il<istride; il++ )
+	{
+		const XgmBlendPoseInfo* pinfo = (il<inumlanes) ? & mBlendPoseInfos[mBlendJoints[il]] : 0;
+		int inumanims = pinfo ? pinfo->GetNumAnims() : 0;
+		float fweights[XgmBlendPoseInfo::kmaxblendanims];
+		if( pinfo )
+			BlendWeights( *pinfo, fweights );
+		for( int is=0; is<imaxanims; is++ )
+		{
+			const DecompMtx44& m = (is<inumanims) ? pinfo->GetAnimMat(is) : (pinfo ? pinfo->GetAnimMat(0) : ident);
+			BLEND_LANE(is,EBL_QX)[il] = m.mRot.GetX();
+			BLEND_LANE(is,EBL_QY)[il] = m.mRot.GetY();
+			BLEND_LANE(is,EBL_QZ)[il] = m.mRot.GetZ();
+			BLEND_LANE(is,EBL_QW)[il] = m.mRot.GetW();
+			BLEND_LANE(is,EBL_TX)[il] = m.mTrans.GetX();
+			BLEND_LANE(is,EBL_TY)[il] = m.mTrans.GetY();
+			BLEND_LANE(is,EBL_TZ)[il] = m.mTrans.GetZ();
+			BLEND_LANE(is,EBL_SCALE)[il] = m.mScale;
+			BLEND_LANE(is,EBL_WEIGHT)[il] = (is<inumanims) ? fweights[is] : ((0==is) ? 1.0f : 0.0f);
+		}
+	}
+
+	///////////////////////////////////
+	// blend and compose, 4 joints per step
+	///////////////////////////////////
+
+	const f4 zero(0.0f), one(1.0f), two(2.0f), eps(float(EPSILON));
+	for( int il=0; il<istride; il+=4 )
+	{
+		f4 w0 = f4::load(BLEND_LANE(0,EBL_WEIGHT)+il);
+		f4 ax = f4::load(BLEND_LANE(0,EBL_QX)+il), ay = f4::load(BLEND_LANE(0,EBL_QY)+il);
+		f4 az = f4::load(BLEND_LANE(0,EBL_QZ)+il), aw = f4::load(BLEND_LANE(0,EBL_QW)+il);
+		f4 qx = ax*w0, qy = ay*w0, qz = az*w0, qw = aw*w0;
+		f4 tx = f4::load(BLEND_LANE(0,EBL_TX)+il)*w0;
+		f4 ty = f4::load(BLEND_LANE(0,EBL_TY)+il)*w0;
+		f4 tz = f4::load(BLEND_LANE(0,EBL_TZ)+il)*w0;
+		f4 sc = f4::load(BLEND_LANE(0,EBL_SCALE)+il)*w0;
+		for( int is=1; is<imaxanims; is++ )
+		{
+			f4 w = f4::load(BLEND_LANE(is,EBL_WEIGHT)+il);
+			f4 bx = f4::load(BLEND_LANE(is,EBL_QX)+il), by = f4::load(BLEND_LANE(is,EBL_QY)+il);
+			f4 bz = f4::load(BLEND_LANE(is,EBL_QZ)+il), bw = f4::load(BLEND_LANE(is,EBL_QW)+il);
+			f4 dot = ax*bx+ay*by+az*bz+aw*bw;
+			f4 wq = vselect( vlt(dot,zero), zero-w, w );
+			qx = qx+bx*wq; qy = qy+by*wq; qz = qz+bz*wq; qw = qw+bw*wq;
+			tx = tx+f4::load(BLEND_LANE(is,EBL_TX)+il)*w;
+			ty = ty+f4::load(BLEND_LANE(is,EBL_TY)+il)*w;
+			tz = tz+f4::load(BLEND_LANE(is,EBL_TZ)+il)*w;
+			sc = sc+f4::load(BLEND_LANE(is,EBL_SCALE)+il)*w;
+		}
+
+		// CQuaternion::ToMatrix (normalizing by 2/|q|^2), times scale
+		f4 l = qx*qx+qy*qy+qz*qz+qw*qw;
+		f4 s = vselect( vlt(l,eps), one, two/l );
+		f4 xs = qx*s, ys = qy*s, zs = qz*s;
+		f4 wx = qw*xs, wy = qw*ys, wz = qw*zs;
+		f4 xx = qx*xs, xy = qx*ys, xz = qx*zs;
+		f4 yy = qy*ys, yz = qy*zs, zz = qz*zs;
+
+		float rows[12][4]; // [element][lane], 3x3 then translation
+		((one-(yy+zz))*sc).store(rows[0]);
+		((xy-wz)*sc).store(rows[1]);
+		((xz+wy)*sc).store(rows[2]);
+		((xy+wz)*sc).store(rows[3]);
+		((one-(xx+zz))*sc).store(rows[4]);
+		((yz-wx)*sc).store(rows[5]);
+		((xz-wy)*sc).store(rows[6]);
+		((yz+wx)*sc).store(rows[7]);
+		((one-(xx+yy))*sc).store(rows[8]);
+		tx.store(rows[9]);
+		ty.store(rows[10]);
+		tz.store(rows[11]);
+
+		int inum = std::min( 4, inumlanes-il );
+		for( int i=0; i<inum; i++ )
+		{
+			float* __restrict pout = mLocalMatrices[mBlendJoints[il+i]].GetArray();
+			pout[0] = rows[0][i];	pout[1] = rows[1][i];	pout[2] = rows[2][i];	pout[3] = 0.0f;
+			pout[4] = rows[3][i];	pout[5] = rows[4][i];	pout[6] = rows[5][i];	pout[7] = 0.0f;
+			pout[8] = rows[6][i];	pout[9] = rows[7][i];	pout[10] = rows[8][i];	pout[11] = 0.0f;
+			pout[12] = rows[9][i];	pout[13] = rows[10][i];	pout[14] = rows[11][i];	pout[15] = 1.0f;
+		}
+	}
+	#undef BLEND_LANE
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void XgmPoseBatch::Queue( XgmLocalPose* ppose )
+{
+	mPoses.push_back( ppose );
+}
+
+void XgmPoseBatch::Update( Opq& the_opq )
+{
+	XgmLocalPose* const* pposes = mPoses.data();
+	parallel_for( the_opq, 0, int(mPoses.size()), 4, [pposes]( int ib, int ie )
+	{
+		for( int i=ib; i<ie; i++ )
+			pposes[i]->BuildPose();
+	});
+	mPoses.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+} }
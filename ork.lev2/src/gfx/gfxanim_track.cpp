@@ -0,0 +1,533 @@
+////////////////////////////////////////////////////////////////
+// Orkid Media Engine
+// Copyright 1996-2012, Michael T. Mayers.
+// Distributed under the Boost Software License - Version 1.0 - August 17, 2003
+// see http://www.boost.org/LICENSE_1_0.txt
+////////////////////////////////////////////////////////////////
+
+#include <ork/pch.h>
+#include <ork/lev2/gfx/gfxanim.h>
+#include <ork/math/simd4.h>
+#include <algorithm>
+#include <cmath>
+
+namespace ork { namespace lev2 {
+
+///////////////////////////////////////////////////////////////////////////////
+// quantization
+///////////////////////////////////////////////////////////////////////////////
+
+static const float kfsqrt2 = 1.41421356f;
+static const float kfinvsqrt2 = 0.70710678f;
+static const float kfrotrange = 32767.0f;	// 15 bit smallest three elements
+static const float kfvalrange = 65535.0f;	// 16 bit positions / scales
+
+static U16 QuantizeUnit( float fu, float frange )
+{
+	fu = std::min( std::max( fu, 0.0f ), 1.0f );
+	return U16( fu*frange+0.5f );
+}
+
+void XgmAnimTrack::EncodeRot( const CQuaternion& q, U16* pout )
+{
+	float fq[4] = { q.GetX(), q.GetY(), q.GetZ(), q.GetW() };
+	int ilargest = 0;
+	for( int i=1; i<4; i++ )
+		if( std::fabs(fq[i]) > std::fabs(fq[ilargest]) )
+			ilargest = i;
+	// q and -q are the same rotation, keep the dropped element positive
+	float fsign = (fq[ilargest]<0.0f) ? -1.0f : 1.0f;
+	int j = 0;
+	for( int i=0; i<4; i++ )
+		if( i!=ilargest )
+			pout[j++] = QuantizeUnit( (fq[i]*fsign*kfsqrt2+1.0f)*0.5f, kfrotrange );
+	pout[0] |= U16((ilargest&1)<<15);
+	pout[1] |= U16((ilargest>>1)<<15);
+}
+
+CQuaternion XgmAnimTrack::DecodeRot( const U16* pin )
+{
+	int ilargest = (pin[0]>>15)|((pin[1]>>15)<<1);
+	float fe[3];
+	for( int j=0; j<3; j++ )
+		fe[j] = (float(pin[j]&0x7fff)*(2.0f/kfrotrange)-1.0f)*kfinvsqrt2;
+	float fq[4];
+	int j = 0;
+	for( int i=0; i<4; i++ )
+		fq[i] = (i==ilargest) ? std::sqrt( std::max( 0.0f, 1.0f-fe[0]*fe[0]-fe[1]*fe[1]-fe[2]*fe[2] ) ) : fe[j++];
+	return CQuaternion( fq[0], fq[1], fq[2], fq[3] );
+}
+
+static CQuaternion NLerp( const CQuaternion& a, const CQuaternion& b, float ft )
+{
+	float fdot = a.GetX()*b.GetX()+a.GetY()*b.GetY()+a.GetZ()*b.GetZ()+a.GetW()*b.GetW();
+	float fb = (fdot<0.0f) ? -ft : ft;
+	float fa = 1.0f-ft;
+	CQuaternion r( a.GetX()*fa+b.GetX()*fb, a.GetY()*fa+b.GetY()*fb, a.GetZ()*fa+b.GetZ()*fb, a.GetW()*fa+b.GetW()*fb );
+	r.Normalize();
+	return r;
+}
+
+// angle between two rotations, from the chord |a-b| = 2sin(angle/4),
+//  acos of the dot product has no precision left for small angles
+static float RotAngle( const CQuaternion& a, const CQuaternion& b )
+{
+	float fdot = a.GetX()*b.GetX()+a.GetY()*b.GetY()+a.GetZ()*b.GetZ()+a.GetW()*b.GetW();
+	float fs = (fdot<0.0f) ? -1.0f : 1.0f;
+	float dx = a.GetX()-b.GetX()*fs, dy = a.GetY()-b.GetY()*fs;
+	float dz = a.GetZ()-b.GetZ()*fs, dw = a.GetW()-b.GetW()*fs;
+	float fchord = std::sqrt( dx*dx+dy*dy+dz*dz+dw*dw );
+	return 4.0f*std::asin( std::min( fchord*0.5f, 1.0f ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// greedy key reduction : from each key, reach as far as the interpolation of
+//  the two (quantized) keys stays within tolerance on every frame between
+//  ferr(ia,ib,i) is the error at frame i relative to the tolerance (ok <= 1)
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename ErrFn> static void ReduceKeys( int inumframes, ErrFn ferr, orkvector<int>& keys )
+{
+	keys.clear();
+	keys.push_back( 0 );
+	bool bconstant = true;
+	for( int i=1; i<inumframes && bconstant; i++ )
+		bconstant = (ferr(0,0,i)<=1.0f);
+	if( bconstant )
+		return;
+	int ia = 0;
+	while( ia<inumframes-1 )
+	{
+		int ib = ia+1;
+		for( int ic=ib+1; ic<inumframes; ic++ )
+		{
+			bool bok = true;
+			for( int i=ia+1; i<ic && bok; i++ )
+				bok = (ferr(ia,ic,i)<=1.0f);
+			if( false==bok )
+				break;
+			ib = ic;
+		}
+		keys.push_back( ib );
+		ia = ib;
+	}
+}
+
+static float KeyFraction( int ia, int ib, int i )
+{
+	return (ib>ia) ? float(i-ia)/float(ib-ia) : 0.0f;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+XgmAnimTrack::XgmAnimTrack()
+	: mScaleMin(0.0f)
+	, mScaleExtent(0.0f)
+{
+	for( int i=0; i<3; i++ )
+	{
+		mPosMin[i] = 0.0f;
+		mPosExtent[i] = 0.0f;
+	}
+	for( int ic=0; ic<ECOMP_COUNT; ic++ )
+	{
+		mComponents[ic].miNumKeys = 0;
+		mComponents[ic].miFirstKey = 0;
+		mComponents[ic].miFirstValue = 0;
+		mComponents[ic].miFirstSeek = 0;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void XgmAnimTrack::Encode( const DecompMtx44* pframes, int inumframes, const XgmAnimCompression& settings )
+{
+	OrkAssert( inumframes>0 && inumframes<=65536 );
+
+	///////////////////////////////////
+	// ranges
+	///////////////////////////////////
+
+	float fposmax[3];
+	for( int ia=0; ia<3; ia++ )
+		mPosMin[ia] = fposmax[ia] = pframes[0].mTrans.GetArray()[ia];
+	mScaleMin = pframes[0].mScale;
+	float fscalemax = mScaleMin;
+	for( int i=1; i<inumframes; i++ )
+	{
+		for( int ia=0; ia<3; ia++ )
+		{
+			float fv = pframes[i].mTrans.GetArray()[ia];
+			mPosMin[ia] = std::min( mPosMin[ia], fv );
+			fposmax[ia] = std::max( fposmax[ia], fv );
+		}
+		mScaleMin = std::min( mScaleMin, pframes[i].mScale );
+		fscalemax = std::max( fscalemax, pframes[i].mScale );
+	}
+	for( int ia=0; ia<3; ia++ )
+		mPosExtent[ia] = fposmax[ia]-mPosMin[ia];
+	mScaleExtent = fscalemax-mScaleMin;
+
+	///////////////////////////////////
+	// quantize every frame, reduction measures the error of
+	//  what the runtime will decode
+	///////////////////////////////////
+
+	orkvector<U16> rotq(inumframes*3), posq(inumframes*3), scaleq(inumframes);
+	orkvector<CQuaternion> rotd(inumframes), rotorig(inumframes);
+	orkvector<CVector3> posd(inumframes);
+	orkvector<float> scaled(inumframes);
+
+	for( int i=0; i<inumframes; i++ )
+	{
+		rotorig[i] = pframes[i].mRot;
+		rotorig[i].Normalize();
+		EncodeRot( rotorig[i], & rotq[i*3] );
+		rotd[i] = DecodeRot( & rotq[i*3] );
+		for( int ia=0; ia<3; ia++ )
+		{
+			float fu = (mPosExtent[ia]>0.0f) ? (pframes[i].mTrans.GetArray()[ia]-mPosMin[ia])/mPosExtent[ia] : 0.0f;
+			posq[i*3+ia] = QuantizeUnit( fu, kfvalrange );
+		}
+		posd[i] = CVector3( mPosMin[0]+mPosExtent[0]*float(posq[i*3+0])/kfvalrange,
+							mPosMin[1]+mPosExtent[1]*float(posq[i*3+1])/kfvalrange,
+							mPosMin[2]+mPosExtent[2]*float(posq[i*3+2])/kfvalrange );
+		float fu = (mScaleExtent>0.0f) ? (pframes[i].mScale-mScaleMin)/mScaleExtent : 0.0f;
+		scaleq[i] = QuantizeUnit( fu, kfvalrange );
+		scaled[i] = mScaleMin+mScaleExtent*float(scaleq[i])/kfvalrange;
+	}
+
+	///////////////////////////////////
+	// reduce
+	///////////////////////////////////
+
+	const float kfmintol = 1.0e-6f;
+	float finvrottol = 1.0f/std::max( settings.mfRotTolerance, kfmintol );
+	float finvpostol = 1.0f/std::max( settings.mfPosTolerance, kfmintol );
+	float finvscaletol = 1.0f/std::max( settings.mfScaleTolerance, kfmintol );
+
+	orkvector<int> keys[ECOMP_COUNT];
+
+	ReduceKeys( inumframes, [&]( int ia, int ib, int i ) -> float
+	{
+		CQuaternion q = NLerp( rotd[ia], rotd[ib], KeyFraction(ia,ib,i) );
+		return RotAngle( q, rotorig[i] )*finvrottol;
+	}, keys[ECOMP_ROT] );
+
+	ReduceKeys( inumframes, [&]( int ia, int ib, int i ) -> float
+	{
+		CVector3 p = posd[ia]+(posd[ib]-posd[ia])*KeyFraction(ia,ib,i);
+		return (p-pframes[i].mTrans).Mag()*finvpostol;
+	}, keys[ECOMP_POS] );
+
+	ReduceKeys( inumframes, [&]( int ia, int ib, int i ) -> float
+	{
+		float fs = scaled[ia]+(scaled[ib]-scaled[ia])*KeyFraction(ia,ib,i);
+		return std::fabs(fs-pframes[i].mScale)*finvscaletol;
+	}, keys[ECOMP_SCALE] );
+
+	///////////////////////////////////
+	// store
+	///////////////////////////////////
+
+	mKeyFrames.clear();
+	mValues.clear();
+	static const int kvalsperkey[ECOMP_COUNT] = { 3, 3, 1 };
+	const U16* psrcvals[ECOMP_COUNT] = { rotq.data(), posq.data(), scaleq.data() };
+	for( int ic=0; ic<ECOMP_COUNT; ic++ )
+	{
+		Component& comp = mComponents[ic];
+		comp.miNumKeys = int(keys[ic].size());
+		comp.miFirstKey = int(mKeyFrames.size());
+		comp.miFirstValue = int(mValues.size());
+		int inumvals = kvalsperkey[ic];
+		for( size_t ik=0; ik<keys[ic].size(); ik++ )
+		{
+			int iframe = keys[ic][ik];
+			mKeyFrames.push_back( U16(iframe) );
+			for( int iv=0; iv<inumvals; iv++ )
+				mValues.push_back( psrcvals[ic][iframe*inumvals+iv] );
+		}
+	}
+	BuildKeySeek();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// a binary search over the keys mispredicts on every step, the seek table
+//  gets FindKey to within a few (forward, predictable) steps of the key
+
+void XgmAnimTrack::BuildKeySeek()
+{
+	mKeySeek.clear();
+	for( int ic=0; ic<ECOMP_COUNT; ic++ )
+	{
+		Component& comp = mComponents[ic];
+		comp.miFirstSeek = int(mKeySeek.size());
+		if( comp.miNumKeys<2 )
+			continue;
+		const U16* pkeys = & mKeyFrames[comp.miFirstKey];
+		int inumseek = (int(pkeys[comp.miNumKeys-1])>>kseekshift)+1;
+		int ik = 0;
+		for( int is=0; is<inumseek; is++ )
+		{
+			int iframe = is<<kseekshift;
+			while( ik+1<comp.miNumKeys && int(pkeys[ik+1])<=iframe )
+				ik++;
+			mKeySeek.push_back( U16(ik) );
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int XgmAnimTrack::SeekKey( EComponent ec, int iframe ) const
+{
+	const Component& comp = mComponents[ec];
+	if( comp.miNumKeys<2 )
+		return 0;
+	const U16* pkeys = & mKeyFrames[comp.miFirstKey];
+	int ilast = comp.miNumKeys-1;
+	if( iframe>=int(pkeys[ilast]) )
+		return ilast;
+	int ik = mKeySeek[comp.miFirstSeek+(iframe>>kseekshift)];
+	while( int(pkeys[ik+1])<=iframe )
+		ik++;
+	return ik;
+}
+
+int XgmAnimTrack::FindKey( EComponent ec, float frame, float& ft ) const
+{
+	const Component& comp = mComponents[ec];
+	ft = 0.0f;
+	if( comp.miNumKeys<2 )
+		return 0;
+	const U16* pkeys = & mKeyFrames[comp.miFirstKey];
+	if( frame<=float(pkeys[0]) )
+		return 0;
+	// keys are on whole frames, so the key at or before frame is the one at or before int(frame)
+	int ik = SeekKey( ec, int(frame) );
+	if( ik<comp.miNumKeys-1 )
+		ft = (frame-float(pkeys[ik]))/float(pkeys[ik+1]-pkeys[ik]);
+	return ik;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void XgmAnimTrack::Sample( float frame, DecompMtx44& out ) const
+{
+	if( IsEmpty() )
+	{
+		out.mRot = CQuaternion();
+		out.mTrans = CVector3( 0.0f, 0.0f, 0.0f );
+		out.mScale = 1.0f;
+		return;
+	}
+
+	float ft = 0.0f;
+	int ik = FindKey( ECOMP_ROT, frame, ft );
+	const U16* prot = & mValues[mComponents[ECOMP_ROT].miFirstValue+ik*3];
+	out.mRot = (ft>0.0f) ? NLerp( DecodeRot(prot), DecodeRot(prot+3), ft ) : DecodeRot(prot);
+
+	ik = FindKey( ECOMP_POS, frame, ft );
+	const U16* ppos = & mValues[mComponents[ECOMP_POS].miFirstValue+ik*3];
+	float fpos[3];
+	for( int ia=0; ia<3; ia++ )
+	{
+		float fq = float(ppos[ia]);
+		if( ft>0.0f )
+			fq += (float(ppos[3+ia])-fq)*ft;
+		fpos[ia] = mPosMin[ia]+mPosExtent[ia]*fq*(1.0f/kfvalrange);
+	}
+	out.mTrans = CVector3( fpos[0], fpos[1], fpos[2] );
+
+	ik = FindKey( ECOMP_SCALE, frame, ft );
+	const U16* pscale = & mValues[mComponents[ECOMP_SCALE].miFirstValue+ik];
+	float fq = float(pscale[0]);
+	if( ft>0.0f )
+		fq += (float(pscale[1])-fq)*ft;
+	out.mScale = mScaleMin+mScaleExtent*fq*(1.0f/kfvalrange);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t XgmAnimTrack::GetMemorySize() const
+{
+	return sizeof(XgmAnimTrack)+(mKeyFrames.size()+mValues.size()+mKeySeek.size())*sizeof(U16);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// pose sampling, 4 compressed tracks per step :
+//  key seek and gathers are scalar, key fractions, dequantization,
+//  smallest three reconstruction and interpolation are 4 lane
+///////////////////////////////////////////////////////////////////////////////
+
+// the keys around iframe, ikb==ika past the last key (the fraction is then 0)
+static void GatherKeys( const XgmAnimTrack& trk, XgmAnimTrack::EComponent ec, int iframe, int& ika, int& ikb, float* pka, float* pkb )
+{
+	const XgmAnimTrack::Component& comp = trk.mComponents[ec];
+	ika = trk.SeekKey( ec, iframe );
+	ikb = (ika<comp.miNumKeys-1) ? ika+1 : ika;
+	*pka = float( trk.mKeyFrames[comp.miFirstKey+ika] );
+	*pkb = float( trk.mKeyFrames[comp.miFirstKey+ikb] );
+}
+
+static void SampleTracks4( const XgmAnimTrack* const* ptracks, float frame, DecompMtx44** pouts, int inumlanes )
+{
+	using namespace simd;
+
+	float keya[XgmAnimTrack::ECOMP_COUNT][4], keyb[XgmAnimTrack::ECOMP_COUNT][4];	// [component][lane]
+	float rotq[2][3][4];	// [key][element][lane], raw 15 bit values
+	float rotidx[2][4];		// dropped element per key/lane
+	float posq[2][3][4];
+	float posmin[3][4], posext[3][4];
+	float scaleq[2][4];
+	float scalemin[4], scaleext[4];
+
+	int iframe = (frame>0.0f) ? int(frame) : 0;
+	for( int il=0; il<4; il++ )
+	{
+		const XgmAnimTrack& trk = *ptracks[(il<inumlanes) ? il : 0];
+		int ika, ikb;
+
+		GatherKeys( trk, XgmAnimTrack::ECOMP_ROT, iframe, ika, ikb, & keya[XgmAnimTrack::ECOMP_ROT][il], & keyb[XgmAnimTrack::ECOMP_ROT][il] );
+		const U16* prot = & trk.mValues[trk.mComponents[XgmAnimTrack::ECOMP_ROT].miFirstValue];
+		const U16* prota = prot+ika*3;
+		const U16* protb = prot+ikb*3;
+		for( int ie=0; ie<3; ie++ )
+		{
+			rotq[0][ie][il] = float(prota[ie]&0x7fff);
+			rotq[1][ie][il] = float(protb[ie]&0x7fff);
+		}
+		rotidx[0][il] = float( (prota[0]>>15)|((prota[1]>>15)<<1) );
+		rotidx[1][il] = float( (protb[0]>>15)|((protb[1]>>15)<<1) );
+
+		GatherKeys( trk, XgmAnimTrack::ECOMP_POS, iframe, ika, ikb, & keya[XgmAnimTrack::ECOMP_POS][il], & keyb[XgmAnimTrack::ECOMP_POS][il] );
+		const U16* ppos = & trk.mValues[trk.mComponents[XgmAnimTrack::ECOMP_POS].miFirstValue];
+		for( int ia=0; ia<3; ia++ )
+		{
+			posq[0][ia][il] = float(ppos[ika*3+ia]);
+			posq[1][ia][il] = float(ppos[ikb*3+ia]);
+			posmin[ia][il] = trk.mPosMin[ia];
+			posext[ia][il] = trk.mPosExtent[ia];
+		}
+
+		GatherKeys( trk, XgmAnimTrack::ECOMP_SCALE, iframe, ika, ikb, & keya[XgmAnimTrack::ECOMP_SCALE][il], & keyb[XgmAnimTrack::ECOMP_SCALE][il] );
+		const U16* pscale = & trk.mValues[trk.mComponents[XgmAnimTrack::ECOMP_SCALE].miFirstValue];
+		scaleq[0][il] = float(pscale[ika]);
+		scaleq[1][il] = float(pscale[ikb]);
+		scalemin[il] = trk.mScaleMin;
+		scaleext[il] = trk.mScaleExtent;
+	}
+
+	///////////////////////////////////
+	// key fractions, 0 on a single key and clamped to the keys
+	///////////////////////////////////
+
+	const f4 vframe(frame), one(1.0f), zero(0.0f);
+	f4 fracs[XgmAnimTrack::ECOMP_COUNT];
+	for( int ic=0; ic<XgmAnimTrack::ECOMP_COUNT; ic++ )
+	{
+		f4 ka = f4::load(keya[ic]), kb = f4::load(keyb[ic]);
+		f4 ft = vmin( vmax( (vframe-ka)/vmax( kb-ka, one ), zero ), one );
+		fracs[ic] = vselect( vlt(ka,kb), ft, zero );
+	}
+
+	///////////////////////////////////
+	// rotations : elements, the dropped one, then into xyzw order
+	//  (per lane masks from the dropped index, no branches)
+	///////////////////////////////////
+
+	f4 rotxyzw[2][4];	// [key][xyzw]
+	const f4 elemscale(2.0f*kfinvsqrt2/kfrotrange), elembias(-kfinvsqrt2);
+	const f4 half(0.5f), onehalf(1.5f), twohalf(2.5f);
+	for( int ik=0; ik<2; ik++ )
+	{
+		f4 e0 = f4::load(rotq[ik][0])*elemscale+elembias;
+		f4 e1 = f4::load(rotq[ik][1])*elemscale+elembias;
+		f4 e2 = f4::load(rotq[ik][2])*elemscale+elembias;
+		f4 ed = vsqrt( vmax( one-e0*e0-e1*e1-e2*e2, zero ) );
+		f4 idrop = f4::load(rotidx[ik]);
+		m4 le0 = vlt(idrop,half), le1 = vlt(idrop,onehalf), le2 = vlt(idrop,twohalf);
+		rotxyzw[ik][0] = vselect( le0, ed, e0 );
+		rotxyzw[ik][1] = vselect( vandnot(le0,le1), ed, vselect( le0, e0, e1 ) );
+		rotxyzw[ik][2] = vselect( vandnot(le1,le2), ed, vselect( le1, e1, e2 ) );
+		rotxyzw[ik][3] = vselect( le2, e2, ed );
+	}
+
+	f4 ax = rotxyzw[0][0], ay = rotxyzw[0][1], az = rotxyzw[0][2], aw = rotxyzw[0][3];
+	f4 bx = rotxyzw[1][0], by = rotxyzw[1][1], bz = rotxyzw[1][2], bw = rotxyzw[1][3];
+	f4 vt = fracs[XgmAnimTrack::ECOMP_ROT];
+	f4 dot = ax*bx+ay*by+az*bz+aw*bw;
+	f4 tb = vselect( vlt(dot,zero), zero-vt, vt );
+	f4 ta = one-vt;
+	f4 rx = ax*ta+bx*tb, ry = ay*ta+by*tb, rz = az*ta+bz*tb, rw = aw*ta+bw*tb;
+	f4 invmag = vrcp( vsqrt(rx*rx+ry*ry+rz*rz+rw*rw) );
+	float outrot[4][4];
+	(rx*invmag).store(outrot[0]);
+	(ry*invmag).store(outrot[1]);
+	(rz*invmag).store(outrot[2]);
+	(rw*invmag).store(outrot[3]);
+
+	///////////////////////////////////
+	// positions, scales
+	///////////////////////////////////
+
+	const f4 valscale(1.0f/kfvalrange);
+	float outpos[3][4];
+	f4 pt = fracs[XgmAnimTrack::ECOMP_POS];
+	for( int ia=0; ia<3; ia++ )
+	{
+		f4 qa = f4::load(posq[0][ia]);
+		f4 q = qa+(f4::load(posq[1][ia])-qa)*pt;
+		(f4::load(posmin[ia])+f4::load(posext[ia])*q*valscale).store(outpos[ia]);
+	}
+	float outscale[4];
+	f4 sa = f4::load(scaleq[0]);
+	f4 sq = sa+(f4::load(scaleq[1])-sa)*fracs[XgmAnimTrack::ECOMP_SCALE];
+	(f4::load(scalemin)+f4::load(scaleext)*sq*valscale).store(outscale);
+
+	for( int il=0; il<inumlanes; il++ )
+	{
+		DecompMtx44& out = *pouts[il];
+		out.mRot = CQuaternion( outrot[0][il], outrot[1][il], outrot[2][il], outrot[3][il] );
+		out.mTrans = CVector3( outpos[0][il], outpos[1][il], outpos[2][il] );
+		out.mScale = outscale[il];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void XgmDecompAnimChannel::SampleChannels( const XgmDecompAnimChannel* const* pchannels, int inum, float frame, DecompMtx44* pout )
+{
+	const XgmAnimTrack* ptracks[4];
+	DecompMtx44* pouts[4];
+	int inumlanes = 0;
+	for( int ich=0; ich<inum; ich++ )
+	{
+		const XgmDecompAnimChannel* pchan = pchannels[ich];
+		if( pchan->mpTrack && pchan->mpTrack->IsEmpty() )
+		{
+			pchan->mpTrack->Sample( frame, pout[ich] ); // the 4 lane sampler needs keys
+		}
+		else if( pchan->mpTrack )
+		{
+			ptracks[inumlanes] = pchan->mpTrack;
+			pouts[inumlanes] = pout+ich;
+			if( ++inumlanes == 4 )
+			{
+				SampleTracks4( ptracks, frame, pouts, 4 );
+				inumlanes = 0;
+			}
+		}
+		else
+		{
+			pout[ich] = pchan->GetFrame( int(frame) );
+		}
+	}
+	if( inumlanes )
+		SampleTracks4( ptracks, frame, pouts, inumlanes );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+} }
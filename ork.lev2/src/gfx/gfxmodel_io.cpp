@@ -153,7 +153,8 @@ bool XgmModel::LoadUnManaged( XgmModel * mdl, const AssetPath& Filename )
 
 	/////////////////////////////////////////////////////////////
 	OrkHeapCheck();
-	chunkfile::Reader<ModelLoadAllocator> chunkreader( fnameext, "xgm" );
+	// modeldata only lives through the load, so read it straight from the mapping
+	chunkfile::Reader<ModelLoadAllocator> chunkreader( fnameext, "xgm", chunkfile::EREADMODE_MAPPED );
 	OrkHeapCheck();
 	/////////////////////////////////////////////////////////////
 	if( chunkreader.IsOk() )
@@ -20,6 +20,9 @@
 #include <ork/kernel/orklut.hpp>
 #include <ork/lev2/gfx/particle/modular_particles.h>
 #include <ork/lev2/lev2_asset.h>
+#include <ork/math/simd4.h>
+#include <ork/kernel/opq.h>
+#include <ork/kernel/taskgraph.h>
 #include <signal.h>
 
 INSTANTIATE_TRANSPARENT_RTTI(ork::lev2::particle::Global, "psys::Global");
@@ -57,6 +60,27 @@ END_ENUM_SERIALIZER()
 ///////////////////////////////////////////////////////////////////////////////
 namespace ork { namespace lev2 { namespace particle {
 ///////////////////////////////////////////////////////////////////////////////
+// per particle module loops run over fixed ranges of lanes,
+//  spread across ConcurrentOpQ for big pools. the ranges do not depend
+//  on the thread count, so anything seeded per range stays deterministic
+///////////////////////////////////////////////////////////////////////////////
+static const int klanechunk = 16384;
+static const int kparallellanes = 65536;
+static void ForEachLaneRange( const Pool<BasicParticle>& pool, TaskGraph::range_lambda_t&& l )
+{	int inumlanes = pool.GetNumAliveLanes();
+	int inumchunks = (inumlanes+klanechunk-1)/klanechunk;
+	auto do_chunks = [&]( int icb, int ice )
+	{	for( int ic=icb; ic<ice; ic++ )
+		{	int ib = ic*klanechunk;
+			l( ib, std::min(ib+klanechunk,inumlanes) );
+		}
+	};
+	if( inumlanes>=kparallellanes )
+		parallel_for( ConcurrentOpQ(), 0, inumchunks, 1, do_chunks );
+	else
+		do_chunks( 0, inumchunks );
+}
+///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 void Global::Describe()
@@ -88,11 +112,20 @@ Global::Global()
 	, mfSlowNoiseBas(0.0f)
 	, mfFastNoiseBas(0.0f)
 	, mfTimeBase(0.0f)
+	, muRandomState(0x9e3779b9)
 {
 }
 void Global::OnStart()
 {
 	mfTimeBase = ork::CSystem::GetRef().GetLoResTime()*mPlugInpTimeScale.GetValue();
+	muRandomState = 0x9e3779b9;
+}
+float Global::RandomUnit()
+{
+	muRandomState ^= muRandomState<<13;
+	muRandomState ^= muRandomState>>17;
+	muRandomState ^= muRandomState<<5;
+	return float(muRandomState>>8)*(1.0f/16777216.0f);
 }
 ///////////////////////////////////////////////////////////////////////////////
 void Global::Compute( float fdt )
@@ -100,13 +133,13 @@ void Global::Compute( float fdt )
 	mOutDataTime = ftime;
 	mOutDataTimeDiv10 = ftime*0.1f;
 	mOutDataTimeDiv100 = ftime*0.01f;
-	mOutDataRandom = float(std::rand()%32767)/32768.0f;
+	mOutDataRandom = RandomUnit();
 	mOutDataRelTime = (ftime-mfTimeBase);
 	/////////////////////////////////////////
 
-	mOutDataRandomNormal.SetX( float(std::rand()%32767)/32768.0f );
-	mOutDataRandomNormal.SetY( float(std::rand()%32767)/32768.0f );
-	mOutDataRandomNormal.SetZ( float(std::rand()%32767)/32768.0f );
+	mOutDataRandomNormal.SetX( RandomUnit() );
+	mOutDataRandomNormal.SetY( RandomUnit() );
+	mOutDataRandomNormal.SetZ( RandomUnit() );
 
 	mOutDataRandomNormal.Normalize();
 
@@ -115,8 +148,8 @@ void Global::Compute( float fdt )
 	/////////////////////////////////////////
 	if( mfNoiseTim>=mfNoisePrv )
 	{	mfNoiseBas = mOutDataNoise;
-		mfNoiseTim = float(std::rand()%32767)/32768.0f;
-		mfNoiseNew = float(std::rand()%32767)/32768.0f;
+		mfNoiseTim = RandomUnit();
+		mfNoiseNew = RandomUnit();
 		mfNoiseRat = (mfNoiseNew-mfNoiseBas)/mfNoiseTim;
 		mfNoiseTim = 0.0f;
 
@@ -621,48 +654,59 @@ void ParticlePool::Compute( float fdt )
 {	if( mPoolOutput.GetMax() != miPoolSize )
 	{	mPoolOutput.Init(miPoolSize);
 	}
-	int inumalive = mPoolOutput.GetNumAlive();
-	for( int i=0; i<inumalive; i++ )
-	{	BasicParticle *ptc = mPoolOutput.mActiveParticles[ i ];
-		/////////////////////////////////
-		float fage = ptc->mfAge;
-		float unit_age = (fage/ptc->mfLifeSpan);
+	Pool<BasicParticle>& pool = mPoolOutput;
+	int inumalive = pool.GetNumAlive();
+	if( inumalive>0 )
+	{	/////////////////////////////////
+		int ilast = inumalive-1;
+		float unit_age = (pool.mAge[ilast]/pool.mLifeSpan[ilast]);
 		mOutDataUnitAge = ork::clamp(unit_age,0.001f,0.999f);
-		
-		//printf( "ptcl<%d> age<%f> ls<%f> IsDead<%d> unitage<%f>\n", i, fage, ptc->mfLifeSpan, int(ptc->IsDead()), mOutDataUnitAge );
-		/////////////////////////////////
-        int ia1 = int(ptc->mfAge/mfPathInterval);
-        int ia2 = int((ptc->mfAge+fdt)/mfPathInterval);
-		if( (mPathIntervalEventQueue!=0)&&(ia2>ia1) )
-		{
-			Event PathEv;
-			PathEv.mEventType = Char4("PATH");
-			PathEv.mPosition = ptc->mPosition;
-			PathEv.mLastPosition = ptc->mLastPosition;
-			PathEv.mVelocity = ptc->mVelocity;
-			mPathIntervalEventQueue->QueueEvent(PathEv);
-		} 
-		/////////////////////////////////
-		if( mPathStochasticEventQueue!=0 )
-		{
-			int irand = rand()%1000;
-			float frand = float(irand)*0.001f;
-			float fprob = mPlugInpPathProbability.GetValue();
-			if( frand<fprob )
-			{
-				Event PathEv;
+	}
+	/////////////////////////////////
+	// path events (before integration, they carry this frames state)
+	/////////////////////////////////
+	if( mPathIntervalEventQueue!=0 || mPathStochasticEventQueue!=0 )
+	{	float fprob = mPlugInpPathProbability.GetValue();
+		for( int i=0; i<inumalive; i++ )
+		{	int ia1 = int(pool.mAge[i]/mfPathInterval);
+			int ia2 = int((pool.mAge[i]+fdt)/mfPathInterval);
+			bool binterval = (mPathIntervalEventQueue!=0)&&(ia2>ia1);
+			bool bstochastic = false;
+			if( mPathStochasticEventQueue!=0 )
+			{	bstochastic = (pool.RandomUnit()<fprob);
+			}
+			if( binterval || bstochastic )
+			{	Event PathEv;
 				PathEv.mEventType = Char4("PATH");
-				PathEv.mPosition = ptc->mPosition;
-				PathEv.mLastPosition = ptc->mLastPosition;
-				PathEv.mVelocity = ptc->mVelocity;
-				mPathStochasticEventQueue->QueueEvent(PathEv);
+				PathEv.mPosition = pool.GetPosition(i);
+				PathEv.mLastPosition = pool.GetLastPosition(i);
+				PathEv.mVelocity = pool.GetVelocity(i);
+				if( binterval )
+					mPathIntervalEventQueue->QueueEvent(PathEv);
+				if( bstochastic )
+					mPathStochasticEventQueue->QueueEvent(PathEv);
 			}
-		} 
-		/////////////////////////////////
-		ptc->mfAge+=fdt;
-		ptc->mLastPosition = ptc->mPosition;
-		ptc->mPosition += ptc->mVelocity*fdt;
+		}
 	}
+	/////////////////////////////////
+	// integrate
+	/////////////////////////////////
+	using namespace simd;
+	f4 dt(fdt);
+	ForEachLaneRange( pool, [&]( int ib, int ie )
+	{	for( int i=ib; i<ie; i+=4 )
+		{	(f4::loada(pool.mAge+i)+dt).storea(pool.mAge+i);
+			f4 px = f4::loada(pool.mPosX+i);
+			f4 py = f4::loada(pool.mPosY+i);
+			f4 pz = f4::loada(pool.mPosZ+i);
+			px.storea(pool.mLastPosX+i);
+			py.storea(pool.mLastPosY+i);
+			pz.storea(pool.mLastPosZ+i);
+			(px+f4::loada(pool.mVelX+i)*dt).storea(pool.mPosX+i);
+			(py+f4::loada(pool.mVelY+i)*dt).storea(pool.mPosY+i);
+			(pz+f4::loada(pool.mVelZ+i)*dt).storea(pool.mPosZ+i);
+		}
+	});
 }
 void ParticlePool::Reset()
 {
@@ -1178,11 +1222,14 @@ WindModule::WindModule()
 void WindModule::Compute( float dt )
 {	const psys_ptclbuf& pb = mPlugInpInput.GetValue();
 	if( pb.mPool )
-	{	ork::CVector4 accel( 0.0f , mPlugInpForce.GetValue(), 0.0f );
-		for( int i=0; i<pb.mPool->GetNumAlive(); i++ )
-		{	BasicParticle *particle = pb.mPool->GetActiveParticle(i);
-			particle->mVelocity += accel*dt;
-		}
+	{	using namespace simd;
+		Pool<BasicParticle>& pool = *pb.mPool;
+		f4 accel( mPlugInpForce.GetValue()*dt );
+		ForEachLaneRange( pool, [&]( int ib, int ie )
+		{	for( int i=ib; i<ie; i+=4 )
+			{	(f4::loada(pool.mVelY+i)+accel).storea(pool.mVelY+i);
+			}
+		});
 	}
 	mOutDataOutput.mPool = pb.mPool;
 }
@@ -1241,20 +1288,27 @@ void GravityModule::Compute( float dt )
 		float finvmass = (fothmass==0.0f) ? 0.0f : (1.0f/fothmass);
 		float numer = (fmass*fothmass*fG);
 		float mindist = mPlugInpMinDistance.GetValue();
-		for( int i=0; i<pb.mPool->GetNumAlive(); i++ )
-		{	BasicParticle *particle = pb.mPool->GetActiveParticle(i);
-			const CVector3& OldPos = particle->mPosition;
-			CVector3 Dir = (mvCenter-OldPos);
-			float Mag = Dir.Mag();
-			if(Mag<mindist)
-			 Mag=mindist;
-			Dir = Dir*(1.0f/Mag);
-			float denom = Mag*Mag;
-			CVector3 forceVec = Dir*(numer/denom);
-			CVector3 accel = forceVec*finvmass;
-			//printf( "numer<%f> denim<%f> accel<%f %f %f>\n", numer, denom, accel.GetX(), accel.GetY(), accel.GetZ() );
-			particle->mVelocity += accel*dt;
-		}
+		//////////////////////////////////////////////////////////
+		// vel += Dir/Mag * (numer/Mag^2) * invmass * dt
+		//////////////////////////////////////////////////////////
+		using namespace simd;
+		Pool<BasicParticle>& pool = *pb.mPool;
+		f4 cx(mvCenter.GetX()), cy(mvCenter.GetY()), cz(mvCenter.GetZ());
+		f4 vmindist(mindist);
+		f4 scale(numer*finvmass*dt);
+		ForEachLaneRange( pool, [&]( int ib, int ie )
+		{	for( int i=ib; i<ie; i+=4 )
+			{	f4 dx = cx-f4::loada(pool.mPosX+i);
+				f4 dy = cy-f4::loada(pool.mPosY+i);
+				f4 dz = cz-f4::loada(pool.mPosZ+i);
+				f4 mag = vmax( vsqrt(dx*dx+dy*dy+dz*dz), vmindist );
+				f4 invmag = vrcp(mag);
+				f4 s = scale*invmag*invmag*invmag;
+				(f4::loada(pool.mVelX+i)+dx*s).storea(pool.mVelX+i);
+				(f4::loada(pool.mVelY+i)+dy*s).storea(pool.mVelY+i);
+				(f4::loada(pool.mVelZ+i)+dz*s).storea(pool.mVelZ+i);
+			}
+		});
 	}
 	mOutDataOutput.mPool = pb.mPool;
 }
@@ -1334,28 +1388,36 @@ void PlanarColliderModule::Compute( float dt )
 		CollisionPlane.CalcFromNormalAndOrigin( PlaneN, PlaneO );
 		float retention = 1.0f-mPlugInpAbsorbtion.GetValue();
 		//////////////////////////////////////////////////////////
-		
-		for( int i=0; i<pb.mPool->GetNumAlive(); i++ )
-		{	auto particle = pb.mPool->GetActiveParticle(i);
-            const fvec3& cur_pos = particle->mPosition;
-            const fvec3& cur_vel = particle->mVelocity;
-
-            auto nxt_pos = cur_pos+cur_vel*dt;
-
-			float pntdist = CollisionPlane.GetPointDistance( nxt_pos );
-
-            bool cur_inside = particle->mColliderStates&1;
-            bool nxt_inside = pntdist<0;
-
-            if( (false==cur_inside) && nxt_inside )
-            {
-                particle->mVelocity = cur_vel.Reflect(PlaneN)*retention;
-            }
-            if(nxt_inside)
-                particle->mColliderStates |= 1;
-            else
-                particle->mColliderStates &= ~1;
-		}
+		// entering the back side this step reflects the velocity
+		//  (v - N*2*(N.v)) * retention
+		//////////////////////////////////////////////////////////
+		using namespace simd;
+		Pool<BasicParticle>& pool = *pb.mPool;
+		f4 nx(PlaneN.GetX()), ny(PlaneN.GetY()), nz(PlaneN.GetZ());
+		f4 pd(CollisionPlane.GetD());
+		f4 vdt(dt), vret(retention), zero(0.0f), two(2.0f);
+		i4 one(1);
+		ForEachLaneRange( pool, [&]( int ib, int ie )
+		{	for( int i=ib; i<ie; i+=4 )
+			{	f4 vx = f4::loada(pool.mVelX+i);
+				f4 vy = f4::loada(pool.mVelY+i);
+				f4 vz = f4::loada(pool.mVelZ+i);
+				f4 qx = f4::loada(pool.mPosX+i)+vx*vdt;
+				f4 qy = f4::loada(pool.mPosY+i)+vy*vdt;
+				f4 qz = f4::loada(pool.mPosZ+i)+vz*vdt;
+				f4 pntdist = nx*qx+ny*qy+nz*qz+pd;
+				i4 states = i4::loada(pool.mColliderStates+i);
+				m4 cur_outside = viszero(states&one);
+				m4 nxt_inside = vlt(pntdist,zero);
+				m4 hit = vand(cur_outside,nxt_inside);
+				f4 ndv2 = (nx*vx+ny*vy+nz*vz)*two;
+				vselect(hit,(vx-nx*ndv2)*vret,vx).storea(pool.mVelX+i);
+				vselect(hit,(vy-ny*ndv2)*vret,vy).storea(pool.mVelY+i);
+				vselect(hit,(vz-nz*ndv2)*vret,vz).storea(pool.mVelZ+i);
+				states = ((states|one)^one) | (vasbits(nxt_inside)&one);
+				states.storea(pool.mColliderStates+i);
+			}
+		});
 	}
 	mOutDataOutput.mPool = pb.mPool;
 }
@@ -1442,37 +1504,45 @@ void SphericalColliderModule::Compute( float dt )
 		the_sphere.mRadius = mPlugInpRadius.GetValue();
 		float retention = 1.0f-mPlugInpAbsorbtion.GetValue();
 		//////////////////////////////////////////////////////////
-		
-		auto m1 = 1000.0f;
-		auto m2 = 1.0f;
-
-        float sphereradsquared = the_sphere.mRadius*the_sphere.mRadius;
-        auto& sphereCenter = the_sphere.mCenter;
-
-		for( int i=0; i<pb.mPool->GetNumAlive(); i++ )
-		{	
-			auto particle = pb.mPool->GetActiveParticle(i);
-			const fvec3& cur_pos = particle->mPosition;
-			const fvec3& cur_vel = particle->mVelocity;
-			auto cur_dir = cur_vel.Normal();
-
-			auto nxt_pos = cur_pos+cur_vel*dt;
-			float ndcsquared = (nxt_pos-the_sphere.mCenter).MagSquared();
-
-            bool cur_inside = particle->mColliderStates&1;
-			bool nxt_inside = ndcsquared<=sphereradsquared;
-
-			if( (false==cur_inside) && nxt_inside )
-			{
-				auto N = (cur_pos-sphereCenter).Normal();
-				particle->mVelocity = cur_vel.Reflect(N)*retention;
+		// entering the sphere this step reflects the velocity about
+		//  the normal at the current position, (v - N*2*(N.v)) * retention
+		//////////////////////////////////////////////////////////
+		using namespace simd;
+		Pool<BasicParticle>& pool = *pb.mPool;
+		const fvec3& sphereCenter = the_sphere.mCenter;
+		f4 cx(sphereCenter.GetX()), cy(sphereCenter.GetY()), cz(sphereCenter.GetZ());
+		f4 radsquared(the_sphere.mRadius*the_sphere.mRadius);
+		f4 vdt(dt), vret(retention), two(2.0f), one_f(1.0f), eps(CFloat::Epsilon());
+		i4 one(1);
+		ForEachLaneRange( pool, [&]( int ib, int ie )
+		{	for( int i=ib; i<ie; i+=4 )
+			{	f4 vx = f4::loada(pool.mVelX+i);
+				f4 vy = f4::loada(pool.mVelY+i);
+				f4 vz = f4::loada(pool.mVelZ+i);
+				f4 ox = f4::loada(pool.mPosX+i)-cx;
+				f4 oy = f4::loada(pool.mPosY+i)-cy;
+				f4 oz = f4::loada(pool.mPosZ+i)-cz;
+				f4 qx = ox+vx*vdt;
+				f4 qy = oy+vy*vdt;
+				f4 qz = oz+vz*vdt;
+				i4 states = i4::loada(pool.mColliderStates+i);
+				m4 cur_outside = viszero(states&one);
+				m4 nxt_inside = vle(qx*qx+qy*qy+qz*qz,radsquared);
+				m4 hit = vand(cur_outside,nxt_inside);
+				if( vmask(hit) )
+				{	// N = (cur_pos-center).Normal(), left as is when too short
+					f4 mag = vsqrt(ox*ox+oy*oy+oz*oz);
+					f4 invmag = vselect(vlt(eps,mag),vrcp(mag),one_f);
+					f4 nx = ox*invmag, ny = oy*invmag, nz = oz*invmag;
+					f4 ndv2 = (nx*vx+ny*vy+nz*vz)*two;
+					vselect(hit,(vx-nx*ndv2)*vret,vx).storea(pool.mVelX+i);
+					vselect(hit,(vy-ny*ndv2)*vret,vy).storea(pool.mVelY+i);
+					vselect(hit,(vz-nz*ndv2)*vret,vz).storea(pool.mVelZ+i);
+				}
+				states = ((states|one)^one) | (vasbits(nxt_inside)&one);
+				states.storea(pool.mColliderStates+i);
 			}
-            if(nxt_inside)
-                particle->mColliderStates |= 1;
-            else
-                particle->mColliderStates &= ~1;
-
-		}
+		});
 	}
 	mOutDataOutput.mPool = pb.mPool;
 }
@@ -1498,11 +1568,16 @@ DecayModule::DecayModule()
 void DecayModule::Compute( float dt )
 {	const psys_ptclbuf& pb = mPlugInpInput.GetValue();
 	if( pb.mPool )
-	{	float decay = ork::powf(mPlugInpDecay.GetValue(), dt);
-		for( int i=0; i<pb.mPool->GetNumAlive(); i++ )
-		{	BasicParticle *particle = pb.mPool->GetActiveParticle(i);
-			particle->mVelocity *= decay;
-		}
+	{	using namespace simd;
+		Pool<BasicParticle>& pool = *pb.mPool;
+		f4 decay( ork::powf(mPlugInpDecay.GetValue(), dt) );
+		ForEachLaneRange( pool, [&]( int ib, int ie )
+		{	for( int i=ib; i<ie; i+=4 )
+			{	(f4::loada(pool.mVelX+i)*decay).storea(pool.mVelX+i);
+				(f4::loada(pool.mVelY+i)*decay).storea(pool.mVelY+i);
+				(f4::loada(pool.mVelZ+i)*decay).storea(pool.mVelZ+i);
+			}
+		});
 	}
 	mOutDataOutput.mPool = pb.mPool;
 }
@@ -1538,23 +1613,37 @@ TurbulenceModule::TurbulenceModule()
 	, mfAmountX(0.0f)
 	, mfAmountY(0.0f)
 	, mfAmountZ(0.0f)
+	, muRandomSeed(0x6d2b79f5)
 {}
 ///////////////////////////////////////////////////////////////////////////////
 void TurbulenceModule::Compute( float dt )
 {	const psys_ptclbuf& pb = mPlugInpInput.GetValue();
 	if( pb.mPool )
-	{	for( int i=0; i<pb.mPool->GetNumAlive(); i++ )
-		{	BasicParticle *particle = pb.mPool->GetActiveParticle(i);
-			float furx = ((std::rand()%256)/256.0f)-0.5f;
-			float fury = ((std::rand()%256)/256.0f)-0.5f;
-			float furz = ((std::rand()%256)/256.0f)-0.5f;
-			/////////////////////////////////////////
-			F32 randX = mPlugInpAmountX.GetValue()*furx;
-			F32 randY = mPlugInpAmountY.GetValue()*fury;
-			F32 randZ = mPlugInpAmountZ.GetValue()*furz;
-			ork::CVector4 accel( randX , randY, randZ );
-			particle->mVelocity += accel*dt;
-		}
+	{	using namespace simd;
+		Pool<BasicParticle>& pool = *pb.mPool;
+		/////////////////////////////////////////
+		// per lane xorshift, seeded from the module each frame
+		//  and from the lane range, so chunking keeps it deterministic
+		//  vel += amount*(rand-0.5)*dt
+		/////////////////////////////////////////
+		muRandomSeed = muRandomSeed*1664525u+1013904223u;
+		U32 useed = muRandomSeed;
+		f4 half(0.5f);
+		f4 ax( mPlugInpAmountX.GetValue()*dt );
+		f4 ay( mPlugInpAmountY.GetValue()*dt );
+		f4 az( mPlugInpAmountZ.GetValue()*dt );
+		ForEachLaneRange( pool, [&]( int ib, int ie )
+		{	U32 us = useed^(U32(ib)*0x9e3779b9u);
+			i4 rng( us|1, (us^0x9e3779b9)|1, (us^0x7f4a7c15)|1, (us^0x94d049bb)|1 );
+			for( int i=ib; i<ie; i+=4 )
+			{	rng = vxorshift(rng);
+				(f4::loada(pool.mVelX+i)+ax*(vunitfloat(rng)-half)).storea(pool.mVelX+i);
+				rng = vxorshift(rng);
+				(f4::loada(pool.mVelY+i)+ay*(vunitfloat(rng)-half)).storea(pool.mVelY+i);
+				rng = vxorshift(rng);
+				(f4::loada(pool.mVelZ+i)+az*(vunitfloat(rng)-half)).storea(pool.mVelZ+i);
+			}
+		});
 	}
 	mOutDataOutput.mPool = pb.mPool;
 }
@@ -1598,23 +1687,34 @@ VortexModule::VortexModule()
 void VortexModule::Compute( float dt )
 {	const psys_ptclbuf& pb = mPlugInpInput.GetValue();
 	if( pb.mPool )
-	{	for( int i=0; i<pb.mPool->GetNumAlive(); i++ )
-		{	BasicParticle *particle = pb.mPool->GetActiveParticle(i);
-			/////////////////////////////////////////
-			F32 falloff = mPlugInpFalloff.GetValue();
-			F32 vortexstrength = mPlugInpVortexStrength.GetValue();
-			F32 outwardstrength = mPlugInpOutwardStrength.GetValue();
-
-			CVector3 Pos2D = particle->mPosition;
-			Pos2D.SetY(0.0f);
-			CVector3 N = particle->mPosition.Normal();
-			CVector3 Dir = N.Cross(CVector3::UnitY());
-			float fstr = 1.0f/(1.0f+falloff/Pos2D.Mag());
-			CVector3 Force = Dir*(vortexstrength*fstr);
-			         Force += N*(outwardstrength*fstr);
-
-			particle->mVelocity += Force*dt;
-		}
+	{	F32 falloff = mPlugInpFalloff.GetValue();
+		F32 vortexstrength = mPlugInpVortexStrength.GetValue();
+		F32 outwardstrength = mPlugInpOutwardStrength.GetValue();
+		/////////////////////////////////////////
+		// N = Pos.Normal(), Dir = N x Y = (-Nz,0,Nx)
+		// fstr = 1/(1+falloff/|Pos.xz|)
+		// vel += (Dir*vortexstrength + N*outwardstrength)*fstr*dt
+		/////////////////////////////////////////
+		using namespace simd;
+		Pool<BasicParticle>& pool = *pb.mPool;
+		f4 vfalloff(falloff), one(1.0f), eps(CFloat::Epsilon());
+		f4 vs(vortexstrength*dt), os(outwardstrength*dt);
+		ForEachLaneRange( pool, [&]( int ib, int ie )
+		{	for( int i=ib; i<ie; i+=4 )
+			{	f4 px = f4::loada(pool.mPosX+i);
+				f4 py = f4::loada(pool.mPosY+i);
+				f4 pz = f4::loada(pool.mPosZ+i);
+				f4 mag2d = vsqrt(px*px+pz*pz);
+				f4 mag = vsqrt(px*px+py*py+pz*pz);
+				f4 invmag = vselect(vlt(eps,mag),vrcp(mag),one);
+				f4 nx = px*invmag, ny = py*invmag, nz = pz*invmag;
+				f4 fstr = vrcp(one+vfalloff/mag2d);
+				f4 fvs = vs*fstr, fos = os*fstr;
+				(f4::loada(pool.mVelX+i)+nx*fos-nz*fvs).storea(pool.mVelX+i);
+				(f4::loada(pool.mVelY+i)+ny*fos).storea(pool.mVelY+i);
+				(f4::loada(pool.mVelZ+i)+nz*fos+nx*fvs).storea(pool.mVelZ+i);
+			}
+		});
 	}
 	mOutDataOutput.mPool = pb.mPool;
 }
@@ -17,6 +17,9 @@
 #include <ork/reflect/enum_serializer.h>
 #include <ork/kernel/orklut.hpp>
 #include <ork/kernel/fixedlut.hpp>
+#include <ork/math/simd4.h>
+#include <ork/kernel/opq.h>
+#include <ork/kernel/taskgraph.h>
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -25,17 +28,129 @@ using namespace ork::lev2::particle;
 template class ork::reflect::DirectObjectMapPropertyType< orkmap<float,ork::CVector4> >;
 template class ork::reflect::DirectObjectPropertyType< ork::lev2::EBlending >;
 template class ork::reflect::DirectObjectPropertyType< ork::lev2::EPrimitiveType>;
-namespace ork { namespace lev2 { namespace particle {
-template class Pool< BasicParticle >;
-template class BasicEmitter<BasicParticle>;
-template class SpiralEmitter<BasicParticle>;
-template class FixedSystem<BasicParticle>;
-}}}
 template class ork::fixedlut<ork::Char4,ork::lev2::particle::EventQueue*,8>;
 template class ork::fixedvector<ork::lev2::particle::Event,ork::lev2::particle::EventQueue::kmaxevents>;
 
 //template class orklut<ork::Char4,ork::lev2::particle::EventQueue>;
 
+namespace ork { namespace lev2 { namespace particle {
+
+///////////////////////////////////////////////////////////////////////////////
+
+Pool<BasicParticle>::Pool()
+	: mpStreams(0)
+	, miStride(0)
+	, miMaxParticles(0)
+	, miNumAlive(0)
+	, muRandomSeed(0x2545f491)
+	, muRandomState(0x2545f491)
+{
+	BindStreams();
+}
+
+Pool<BasicParticle>::Pool( const Pool& oth )
+	: mpStreams(0)
+	, miStride(0)
+	, miMaxParticles(0)
+	, miNumAlive(0)
+	, muRandomSeed(0x2545f491)
+	, muRandomState(0x2545f491)
+{
+	Copy(oth);
+}
+
+Pool<BasicParticle>& Pool<BasicParticle>::operator=( const Pool& oth )
+{
+	if( this != & oth )
+		Copy(oth);
+	return *this;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Pool<BasicParticle>::BindStreams()
+{
+	// 64 byte align the first stream, the stride keeps the rest aligned
+	mpStreams = 0;
+	if( false==mStreamStorage.empty() )
+	{
+		size_t uaddr = size_t(mStreamStorage.data());
+		size_t ualigned = (uaddr+63)&~size_t(63);
+		mpStreams = mStreamStorage.data()+(ualigned-uaddr)/sizeof(float);
+	}
+	float** ppstreams[] = { & mPosX, & mPosY, & mPosZ,
+							& mLastPosX, & mLastPosY, & mLastPosZ,
+							& mVelX, & mVelY, & mVelZ,
+							& mAge, & mLifeSpan, & mRandom };
+	for( int is=0; is<knumstreams-1; is++ )
+		*ppstreams[is] = mpStreams ? mpStreams+is*miStride : 0;
+	mColliderStates = mpStreams ? reinterpret_cast<U32*>(mpStreams+(knumstreams-1)*miStride) : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Pool<BasicParticle>::Init( int imax )
+{
+	miMaxParticles = imax;
+	miNumAlive = 0;
+	miStride = (imax+kstreamalign-1)&~(kstreamalign-1);
+	mStreamStorage.clear();
+	mStreamStorage.resize( miStride*knumstreams + 64/sizeof(float), 0.0f );
+	mKeys.clear();
+	mKeys.resize( miStride, 0 );
+	BindStreams();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Pool<BasicParticle>::Copy( const Pool& oth )
+{
+	miMaxParticles = oth.miMaxParticles;
+	miNumAlive = oth.miNumAlive;
+	miStride = oth.miStride;
+	muRandomSeed = oth.muRandomSeed;
+	muRandomState = oth.muRandomState;
+	mStreamStorage.resize( oth.mStreamStorage.size() );
+	mKeys = oth.mKeys;
+	BindStreams();
+	if( mpStreams )
+		memcpy( mpStreams, oth.mpStreams, miStride*knumstreams*sizeof(float) );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Pool<BasicParticle>::Reset()
+{
+	miNumAlive = 0;
+	muRandomState = muRandomSeed;
+}
+
+void Pool<BasicParticle>::SetRandomSeed( U32 useed )
+{
+	OrkAssert( useed!=0 );
+	muRandomSeed = useed;
+	muRandomState = useed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+BasicParticle Pool<BasicParticle>::GetActiveParticle( int idx ) const
+{
+	BasicParticle ptc;
+	ptc.mPosition = GetPosition(idx);
+	ptc.mLastPosition = GetLastPosition(idx);
+	ptc.mVelocity = GetVelocity(idx);
+	ptc.mfRandom = mRandom[idx];
+	ptc.mfAge = mAge[idx];
+	ptc.mfLifeSpan = mLifeSpan[idx];
+	ptc.mKey = mKeys[idx];
+	ptc.mColliderStates = mColliderStates[idx];
+	return ptc;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+}}}
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -181,10 +296,9 @@ void DirectedEmitter::EmitCB( EmitterCtx& ctx )
 	{	float fi = float(ic)/float(icount);
 		ComputePosDir( fi, pos, dir );
 		pos += ctx.mPosition;
-		BasicParticle* __restrict ptc = the_pool.FastAlloc();
-		if( ptc )
-		{	ptc->mfAge = 0.0f;
-			ptc->mfLifeSpan = ctx.mfLifespan;
+		int iptc = the_pool.FastAlloc();
+		if( iptc>=0 )
+		{	the_pool.mLifeSpan[iptc] = ctx.mfLifespan;
 			switch( meDirection )
 			{	case EMITDIR_CROSS_X:
 					dir = dir.Cross(CVector3::Red());
@@ -205,15 +319,16 @@ void DirectedEmitter::EmitCB( EmitterCtx& ctx )
 			if( vbin.MagSquared() < .1f ) vbin = dir.Cross(CVector3::Red());
 			vbin.Normalize();
 			vtan = vbin.Cross(dir);
-			float fu = ((std::rand()%256)/256.0f)-0.5f;
-			float fv = ((std::rand()%256)/256.0f)-0.5f;
+			float fu = the_pool.RandomUnit()-0.5f;
+			float fv = the_pool.RandomUnit()-0.5f;
 			disp = (vbin*fu) + (vtan*fv);
 			yo.Lerp( dir,disp, ctx.mDispersion );
 			dir = yo.Normal();
-			ptc->mPosition = pos;
-			ptc->mVelocity = dir*ctx.mfEmissionVelocity + ctx.mOffsetVelocity;
-			ptc->mLastPosition = pos - (ptc->mVelocity*ctx.mfDeltaTime);
-			ptc->mKey = (void*) ctx.mKey;
+			CVector3 vel = dir*ctx.mfEmissionVelocity + ctx.mOffsetVelocity;
+			the_pool.SetPosition( iptc, pos );
+			the_pool.SetVelocity( iptc, vel );
+			the_pool.SetLastPosition( iptc, pos - (vel*ctx.mfDeltaTime) );
+			the_pool.mKeys[iptc] = (void*) ctx.mKey;
 		}
 	}
 	ctx.mfEmitterMark-=float(icount);
@@ -238,8 +353,7 @@ void DirectedEmitter::EmitSQ( EmitterCtx& ctx )
 		Event ev = ctx.mSpawnQueue->DequeueEvent();
 		//////////////////////////////////////////////////
 		// prababalistic spawning
-		int iran = rand()%100;
-		float fran = float(iran)*0.01f;
+		float fran = the_pool.RandomUnit();
 		//////////////////////////////////////////////////
 		if(fran<ctx.mfSpawnProbability)
 		{
@@ -252,10 +366,9 @@ void DirectedEmitter::EmitSQ( EmitterCtx& ctx )
 			//////////////////////////////////////////////
 			for( float ii=0.0f; ii<ctx.mfSpawnMultiplier; ii+=1.0f )
 			{
-				BasicParticle* __restrict ptc = the_pool.FastAlloc();
-				if( ptc )
-				{	ptc->mfAge = 0.0f;
-					ptc->mfLifeSpan = ctx.mfLifespan;
+				int iptc = the_pool.FastAlloc();
+				if( iptc>=0 )
+				{	the_pool.mLifeSpan[iptc] = ctx.mfLifespan;
 					//////////////////////////////////////////////
 					// calc dispersion
 					//////////////////////////////////////////////
@@ -263,17 +376,18 @@ void DirectedEmitter::EmitSQ( EmitterCtx& ctx )
 					if( vbin.MagSquared() < .1f ) vbin = dir.Cross(CVector3::Red());
 					vbin.Normalize();
 					vtan = vbin.Cross(dir);
-					float fu = ((std::rand()%256)/256.0f)-0.5f;
-					float fv = ((std::rand()%256)/256.0f)-0.5f;
+					float fu = the_pool.RandomUnit()-0.5f;
+					float fv = the_pool.RandomUnit()-0.5f;
 					disp = (vbin*fu) + (vtan*fv);
 					yo.Lerp( dir,disp, ctx.mDispersion );
 					dir = yo.Normal();
 					//////////////////////////////////////////////
-					ptc->mPosition = pos;
-					ptc->mVelocity = dir*EmitterSpeed; 
+					CVector3 vel = dir*EmitterSpeed; 
 					//ctx.mfEmissionVelocity + ctx.mOffsetVelocity;
-					ptc->mLastPosition = pos - (ptc->mVelocity*ctx.mfDeltaTime);
-					ptc->mKey = (void*) ctx.mKey;
+					the_pool.SetPosition( iptc, pos );
+					the_pool.SetVelocity( iptc, vel );
+					the_pool.SetLastPosition( iptc, pos - (vel*ctx.mfDeltaTime) );
+					the_pool.mKeys[iptc] = (void*) ctx.mKey;
 				}
 			}
 		}
@@ -297,54 +411,42 @@ void DirectedEmitter::Reap( EmitterCtx& ctx )
 {	if( ctx.mPool )
 	{	//////////////////////////
 		// kill particles
+		//  4 lanes are age tested at a time, only steps
+		//  with a dead particle are looked at one by one
 		//////////////////////////
 		
+		Pool<BasicParticle>& the_pool = *ctx.mPool;
+
 		Event DeathEv;
 		DeathEv.mEventType = Char4("KILL");
 
-		int inumalive = ctx.mPool->GetNumAlive();
-		//static const int kkillbufsize = 32<<10;
-		//static BasicParticle* gpKillBuf = new int[kkillbufsize];
-
-		//printf( "REAP numalive<%d>\n", inumalive );
-		int inumkilled = 0;
-		for( int i=0; i<inumalive; i++ )
-		{	BasicParticle* ptc = ctx.mPool->mActiveParticles[ i ];
-			bool bkeymatch = (ptc->mKey == ctx.mKey);
-			if( ptc->IsDead() && bkeymatch ) // kill particle
-			{	
-                if( ctx.mDeathQueue )
-                {
-                    DeathEv.mPosition = ptc->mPosition;
-                    DeathEv.mLastPosition = ptc->mLastPosition;
-                    DeathEv.mVelocity = ptc->mVelocity;
-                    ctx.mDeathQueue->QueueEvent(DeathEv);
-                    /*printf( "sending particle<%p> kill event DQ<%p> pos<%f %f %f>\n", 
-                    		ptc,
-                    		ctx.mDeathQueue,
-                    		DeathEv.mPosition.GetX(),
-                    		DeathEv.mPosition.GetY(),
-                    		DeathEv.mPosition.GetZ()
-                    		);*/
-                }
-                ctx.mPool->mInactiveParticles.push_back(ptc);
-                int ilast_alive = ctx.mPool->GetNumAlive()-1;
-                BasicParticle* ptclast = ctx.mPool->mActiveParticles[ ilast_alive ];
-                ctx.mPool->mActiveParticles[ i ] = ptclast;
-                ctx.mPool->mActiveParticles.erase( ctx.mPool->mActiveParticles.begin()+ilast_alive );
-                inumalive--;
-                //ctx.mPool->FastFree(ikill);
+		for( int ib=0; ib<the_pool.GetNumAlive(); ib+=4 )
+		{	simd::f4 age = simd::f4::loada( the_pool.mAge+ib );
+			simd::f4 lifespan = simd::f4::loada( the_pool.mLifeSpan+ib );
+			if( 0 == simd::vmask( simd::vle(lifespan,age) ) )
+				continue;
+
+			// FastFree moves the last alive particle into i, so i is looked at again
+			int iend = std::min(ib+4,the_pool.GetNumAlive());
+			for( int i=ib; i<iend; )
+			{	bool bkeymatch = (the_pool.mKeys[i] == ctx.mKey);
+				if( the_pool.IsDead(i) && bkeymatch ) // kill particle
+				{	
+					if( ctx.mDeathQueue )
+					{
+						DeathEv.mPosition = the_pool.GetPosition(i);
+						DeathEv.mLastPosition = the_pool.GetLastPosition(i);
+						DeathEv.mVelocity = the_pool.GetVelocity(i);
+						ctx.mDeathQueue->QueueEvent(DeathEv);
+					}
+					the_pool.FastFree(i);
+					iend = std::min(ib+4,the_pool.GetNumAlive());
+				}
+				else
+					i++;
 			}
 		}				
 	}
-	else if( 0 ) //ctx.mPool )
-	{	for( int i=0; i<ctx.mPool->GetNumAlive(); i++ )
-		{	BasicParticle* __restrict ptc = ctx.mPool->mActiveParticles[ i ];
-			if( ptc->IsDead() && ptc->mKey == ctx.mKey ) // kill particle
-			{	ctx.mPool->FastFree(i);
-			}
-		}
-	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -473,6 +575,46 @@ void ParticleSystemBase::Update(float fdt)
 	mElapsed += fdt;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+void SystemUpdateBatch::BeginGroup()
+{
+	Group grp;
+	grp.miFirst = int(mItems.size());
+	grp.miCount = 0;
+	mGroups.push_back( grp );
+}
+
+void SystemUpdateBatch::Queue( ParticleSystemBase* psys, float fdt )
+{
+	if( mGroups.empty() )
+		BeginGroup();
+	Item item;
+	item.mpSystem = psys;
+	item.mfDeltaTime = fdt;
+	mItems.push_back( item );
+	mGroups.back().miCount++;
+}
+
+void SystemUpdateBatch::Update( Opq& the_opq )
+{
+	const Item* pitems = mItems.data();
+	const Group* pgroups = mGroups.data();
+
+	parallel_for( the_opq, 0, int(mGroups.size()), 1, [pitems,pgroups]( int ib, int ie )
+	{
+		for( int ig=ib; ig<ie; ig++ )
+		{
+			const Item* pitem = pitems+pgroups[ig].miFirst;
+			for( int i=0; i<pgroups[ig].miCount; i++, pitem++ )
+				pitem->mpSystem->Update( pitem->mfDeltaTime );
+		}
+	});
+
+	mItems.clear();
+	mGroups.clear();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -20,8 +20,10 @@
 #include <ork/kernel/orklut.hpp>
 #include <ork/lev2/gfx/particle/modular_particles.h>
 #include <ork/lev2/lev2_asset.h>
-#include <ork/kernel/fixedlut.hpp>
 #include <ork/kernel/string/string.h>
+#include <ork/kernel/opq.h>
+#include <ork/kernel/taskgraph.h>
+#include <algorithm>
 //#include <pkg/ent/PerfController.h>
 
 INSTANTIATE_TRANSPARENT_RTTI(ork::lev2::particle::RendererModule, "psys::RendererModule");
@@ -47,6 +49,138 @@ RendererModule::RendererModule()
 {	
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+ParticleDepthSorter::ParticleDepthSorter()
+	: mpOrder(0)
+	, miNumSorted(0)
+	, miNumCoherent(0)
+	, mbParallel(true)
+{
+}
+
+ParticleDepthSorter::~ParticleDepthSorter()
+{
+	for( RadixSort* psorter : mChunkSorters )
+		delete psorter;
+}
+
+U32 ParticleDepthSorter::GetNbHits() const
+{
+	U32 uhits = mSorter.GetNbHits();
+	for( const RadixSort* psorter : mChunkSorters )
+		uhits += psorter->GetNbHits();
+	return uhits;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void ParticleDepthSorter::Sort( const BasicParticle* pparticles, int inum, const CMatrix4& MVP )
+{
+	miNumSorted = inum;
+	mpOrder = 0;
+	if( 0==inum )
+		return;
+
+	bool bparallel = mbParallel && (inum>=kparallelsize);
+	U32 uhits0 = GetNbHits();
+
+	///////////////////////////////////
+	// negated projected depths, so ascending order is far to near
+	///////////////////////////////////
+
+	mDepths.resize(inum);
+	float* pdepths = mDepths.data();
+
+	auto compute_depths = [pparticles,pdepths,&MVP]( int ibeg, int iend )
+	{
+		for( int i=ibeg; i<iend; i++ )
+		{
+			CVector4 proj = pparticles[i].mPosition.Transform(MVP);
+			proj.PerspectiveDivide();
+			pdepths[i] = -proj.GetZ();
+		}
+	};
+
+	if( false==bparallel )
+	{
+		compute_depths( 0, inum );
+		mSorter.Sort( pdepths, U32(inum) );
+		mpOrder = mSorter.GetIndices();
+		miNumCoherent += int(GetNbHits()!=uhits0);
+		return;
+	}
+
+	int ichunksize = (inum+kparallelchunks-1)/kparallelchunks;
+
+	parallel_for( ConcurrentOpQ(), 0, inum, ichunksize, compute_depths );
+
+	///////////////////////////////////
+	// radix sort the chunks, each keeping its own last order
+	//  (chunk sizes only depend on inum, so that survives)
+	///////////////////////////////////
+
+	while( int(mChunkSorters.size())<kparallelchunks )
+		mChunkSorters.push_back( new RadixSort );
+
+	mMergeA.resize(inum);
+	mMergeB.resize(inum);
+	mOrder.resize(inum);
+	DepthIndex* psrc = mMergeA.data();
+	DepthIndex* pdst = mMergeB.data();
+
+	parallel_for( ConcurrentOpQ(), 0, kparallelchunks, 1, [this,pdepths,psrc,inum,ichunksize]( int ib, int ie )
+	{
+		for( int ic=ib; ic<ie; ic++ )
+		{
+			int ibase = ic*ichunksize;
+			int icount = std::min(inum-ibase,ichunksize);
+			if( icount<=0 )
+				continue;
+			const U32* pchunk = mChunkSorters[ic]->Sort( pdepths+ibase, U32(icount) ).GetIndices();
+			for( int i=0; i<icount; i++ )
+			{
+				U32 uindex = pchunk[i]+U32(ibase);
+				psrc[ibase+i].mfDepth = pdepths[uindex];
+				psrc[ibase+i].muIndex = uindex;
+			}
+		}
+	});
+
+	///////////////////////////////////
+	// merge neighbouring runs until one is left
+	//  depths travel with the indices so the merges read memory in order
+	///////////////////////////////////
+
+	for( int iwidth=ichunksize; iwidth<inum; iwidth*=2 )
+	{
+		int inumpairs = (inum+2*iwidth-1)/(2*iwidth);
+		parallel_for( ConcurrentOpQ(), 0, inumpairs, 1, [psrc,pdst,iwidth,inum]( int ib, int ie )
+		{
+			auto by_depth = []( const DepthIndex& a, const DepthIndex& b ) { return a.mfDepth<b.mfDepth; };
+			for( int ip=ib; ip<ie; ip++ )
+			{
+				int ilo = ip*2*iwidth;
+				int imid = std::min(ilo+iwidth,inum);
+				int ihi = std::min(ilo+2*iwidth,inum);
+				std::merge( psrc+ilo, psrc+imid, psrc+imid, psrc+ihi, pdst+ilo, by_depth );
+			}
+		});
+		std::swap( psrc, pdst );
+	}
+
+	U32* porder = mOrder.data();
+	parallel_for( ConcurrentOpQ(), 0, inum, ichunksize, [psrc,porder]( int ib, int ie )
+	{
+		for( int i=ib; i<ie; i++ )
+			porder[i] = psrc[i].muIndex;
+	});
+
+	mpOrder = porder;
+	int inumusedchunks = (inum+ichunksize-1)/ichunksize;
+	miNumCoherent += int(GetNbHits()-uhits0==U32(inumusedchunks));
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -285,8 +419,7 @@ void ParticlePoolRenderBuffer::Update( const Pool<BasicParticle>& the_pool )
 	
 	for( int i=0; i<icnt; i++ )
 	{
-		const ork::lev2::particle::BasicParticle* ptcl = the_pool.GetActiveParticle(i);
-		mpParticles[i] = *ptcl;
+		mpParticles[i] = the_pool.GetActiveParticle(i);
 	}
 }
 
@@ -466,18 +599,10 @@ void SpriteRenderer::Render(const CMatrix4& mtx, ork::lev2::RenderContextInstDat
 			if( meBlendMode>=ork::lev2::EBLENDING_ADDITIVE && meBlendMode<=EBLENDING_ALPHA_SUBTRACTIVE ) bsort=false;
 
 			if( bsort )
-			{	static ork::fixedlut<float,const ork::lev2::particle::BasicParticle*,20000> SortedParticles(EKEYPOLICY_MULTILUT);
-				SortedParticles.clear();
+			{	mDepthSorter.Sort( buffer.mpParticles, icnt, MVP );
+				const U32* porder = mDepthSorter.GetOrder();
 				for( int i=0; i<icnt; i++ )
-				{	const ork::lev2::particle::BasicParticle* ptcl = buffer.mpParticles+i;
-					{	CVector4 proj = ptcl->mPosition.Transform(MVP);
-						proj.PerspectiveDivide();
-						float fv = proj.GetZ();
-						SortedParticles.AddSorted( fv, ptcl );
-					}
-				}
-				for( int i=(icnt-1); i>=0; i-- )
-				{	const ork::lev2::particle::BasicParticle* __restrict ptcl = SortedParticles.GetItemAtIndex(i).second;
+				{	const ork::lev2::particle::BasicParticle* __restrict ptcl = buffer.mpParticles+porder[i];
 					//////////////////////////////////////////////////////
 					float fage = ptcl->mfAge;
 					float funitage = (fage/ptcl->mfLifeSpan);
@@ -690,19 +815,11 @@ void StreakRenderer::Render(const CMatrix4& mtx, ork::lev2::RenderContextInstDat
 
 			if( mbSort )
 			{
-				static ork::fixedlut<float,const ork::lev2::particle::BasicParticle*,20000> SortedParticles(EKEYPOLICY_MULTILUT);
-				SortedParticles.clear();
 				const CMatrix4& MVP = targ->MTXI()->RefMVPMatrix();
+				mDepthSorter.Sort( buffer.mpParticles, icnt, MVP );
+				const U32* porder = mDepthSorter.GetOrder();
 				for( int i=0; i<icnt; i++ )
-				{	const ork::lev2::particle::BasicParticle* ptcl = buffer.mpParticles+i;
-					{	CVector4 proj = ptcl->mPosition.Transform(MVP);
-						proj.PerspectiveDivide();
-						float fv = proj.GetZ();
-						SortedParticles.AddSorted( fv, ptcl );
-					}
-				}
-				for( int i=(icnt-1); i>=0; i-- )
-				{	const ork::lev2::particle::BasicParticle* __restrict ptcl = SortedParticles.GetItemAtIndex(i).second;
+				{	const ork::lev2::particle::BasicParticle* __restrict ptcl = ptclbase+porder[i];
 					////////////////////////////////////////////////
 					// varying properties
 					////////////////////////////////////////////////
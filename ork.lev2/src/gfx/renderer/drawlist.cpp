@@ -0,0 +1,328 @@
+////////////////////////////////////////////////////////////////
+// Orkid Media Engine
+// Copyright 1996-2012, Michael T. Mayers.
+// Distributed under the Boost Software License - Version 1.0 - August 17, 2003
+// see http://www.boost.org/LICENSE_1_0.txt
+////////////////////////////////////////////////////////////////
+
+#include <ork/pch.h>
+#include <ork/lev2/gfx/drawlist.h>
+#include <ork/lev2/gfx/renderable.h>
+#include <ork/kernel/opq.h>
+#include <ork/kernel/taskgraph.h>
+
+namespace ork { namespace lev2 {
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t DrawBucketKey::Hash() const
+{
+	size_t h = size_t(mGeometry)*0x9e3779b97f4a7c15ULL;
+	h ^= (size_t(mMaterial)>>4) + 0x9e3779b9 + (h<<6) + (h>>2);
+	h ^= size_t(miMaterialPass*131 + miSortGroup) + 0x9e3779b9 + (h<<6) + (h>>2);
+	h ^= size_t(miSpan) + 0x9e3779b9 + (h<<6) + (h>>2);
+	return h ^ (h>>29);
+}
+
+static int DrawListTableSize( int inumitems )
+{
+	int isize = 16;
+	while( isize < inumitems*2 )
+		isize <<= 1;
+	return isize;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void DrawList::Clear()
+{
+	mCommands.clear();
+	mInstanceModels.clear();
+	mInstanceMatrices.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// one chunk of the sorted queue
+///////////////////////////////////////////////////////////////////////////////
+
+struct DrawListCompiler::Chunk
+{
+	struct Bucket
+	{
+		DrawBucketKey	mKey;
+		int				miFirst;	// sorted position
+		int				miCount;
+		int				miGlobal;
+		int				miOffset;	// next instance slot of this chunk
+	};
+
+	int							miBegin;
+	int							miEnd;
+	orkvector<Bucket>			mBuckets;		// in order of first position
+	orkvector<int>				mTable;			// open addressed, bucket index or -1
+	orkvector<int>				mPosBucket;		// per position, bucket index or -1
+	orkvector<const CModelRenderable*> mPosModel;
+	orkvector<int>				mSingles;		// positions drawn as EDRAWCMD_RENDERABLE
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+DrawListCompiler::DrawListCompiler()
+{
+}
+
+DrawListCompiler::~DrawListCompiler()
+{
+	for( Chunk* pchunk : mChunks )
+		delete pchunk;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void DrawListCompiler::BucketChunk( Chunk& chunk, const RenderQueue::Node* const* pnodes, const U32* psorted, const U64* pkeys )
+{
+	int inum = chunk.miEnd-chunk.miBegin;
+	int itablesize = DrawListTableSize(inum);
+	int imask = itablesize-1;
+
+	chunk.mBuckets.clear();
+	chunk.mSingles.clear();
+	chunk.mTable.assign(itablesize,-1);
+	chunk.mPosBucket.resize(inum);
+	chunk.mPosModel.resize(inum);
+
+	for( int i=0; i<inum; i++ )
+	{
+		int ipos = chunk.miBegin+i;
+		U32 uindex = psorted[ipos];
+		const RenderQueue::Node* pnode = pnodes[uindex];
+
+		DrawBucketKey key;
+		const CModelRenderable* pmodel = pnode->mpRenderable->GetInstancedModel(key);
+		chunk.mPosModel[i] = pmodel;
+
+		if( nullptr==pmodel )
+		{
+			chunk.mPosBucket[i] = -1;
+			chunk.mSingles.push_back(ipos);
+			continue;
+		}
+
+		key.miSortGroup = int(pkeys[uindex]>>RenderSortKey::klayershift);
+		key.miSpan = int(chunk.mSingles.size());
+
+		int islot = int(key.Hash()) & imask;
+		int ibucket = chunk.mTable[islot];
+		while( ibucket>=0 && false==(chunk.mBuckets[ibucket].mKey==key) )
+		{
+			islot = (islot+1)&imask;
+			ibucket = chunk.mTable[islot];
+		}
+		if( ibucket<0 )
+		{
+			ibucket = int(chunk.mBuckets.size());
+			Chunk::Bucket bucket;
+			bucket.mKey = key;
+			bucket.miFirst = ipos;
+			bucket.miCount = 0;
+			bucket.miGlobal = -1;
+			bucket.miOffset = 0;
+			chunk.mBuckets.push_back(bucket);
+			chunk.mTable[islot] = ibucket;
+		}
+		chunk.mBuckets[ibucket].miCount++;
+		chunk.mPosBucket[i] = ibucket;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int DrawListCompiler::FindOrAddGlobal( const DrawBucketKey& key, int ifirst )
+{
+	int imask = int(mGlobalTable.size())-1;
+	int islot = int(key.Hash()) & imask;
+	int ibucket = mGlobalTable[islot];
+	while( ibucket>=0 && false==(mGlobalBuckets[ibucket].mKey==key) )
+	{
+		islot = (islot+1)&imask;
+		ibucket = mGlobalTable[islot];
+	}
+	if( ibucket<0 )
+	{
+		ibucket = int(mGlobalBuckets.size());
+		GlobalBucket bucket;
+		bucket.mKey = key;
+		bucket.miFirst = ifirst;
+		bucket.miCount = 0;
+		bucket.miBase = 0;
+		mGlobalBuckets.push_back(bucket);
+		mGlobalTable[islot] = ibucket;
+	}
+	return ibucket;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void DrawListCompiler::FillChunk( Chunk& chunk, DrawList& list ) const
+{
+	int inum = chunk.miEnd-chunk.miBegin;
+	const CModelRenderable** ppmodels = list.mInstanceModels.data();
+	CMatrix4* pmatrices = list.mInstanceMatrices.data();
+
+	for( int i=0; i<inum; i++ )
+	{
+		int ibucket = chunk.mPosBucket[i];
+		if( ibucket<0 )
+			continue;
+		int islot = chunk.mBuckets[ibucket].miOffset++;
+		const CModelRenderable* pmodel = chunk.mPosModel[i];
+		ppmodels[islot] = pmodel;
+		pmatrices[islot] = pmodel->GetMatrix();
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void DrawListCompiler::Compile( const RenderQueue::Node* const* pnodes, const U32* psorted, const U64* pkeys, int inumnodes, DrawList& list )
+{
+	list.Clear();
+	if( inumnodes<=0 )
+		return;
+
+	bool bparallel = (inumnodes>=kparallelsize);
+	int inumchunks = bparallel ? (inumnodes+kchunksize-1)/kchunksize : 1;
+
+	while( int(mChunks.size())<inumchunks )
+		mChunks.push_back( new Chunk );
+
+	for( int ic=0; ic<inumchunks; ic++ )
+	{
+		mChunks[ic]->miBegin = bparallel ? ic*kchunksize : 0;
+		mChunks[ic]->miEnd = bparallel ? std::min(inumnodes,(ic+1)*kchunksize) : inumnodes;
+	}
+
+	///////////////////////////////////
+	// bucket each chunk
+	///////////////////////////////////
+
+	if( bparallel )
+	{
+		parallel_for( ConcurrentOpQ(), 0, inumchunks, 1, [this,pnodes,psorted,pkeys]( int ib, int ie )
+		{
+			for( int ic=ib; ic<ie; ic++ )
+				BucketChunk( *mChunks[ic], pnodes, psorted, pkeys );
+		});
+	}
+	else
+		BucketChunk( *mChunks[0], pnodes, psorted, pkeys );
+
+	///////////////////////////////////
+	// merge buckets in chunk order, so global buckets
+	//  are created in order of their first position
+	///////////////////////////////////
+
+	int inumlocal = 0;
+	for( int ic=0; ic<inumchunks; ic++ )
+		inumlocal += int(mChunks[ic]->mBuckets.size());
+
+	mGlobalBuckets.clear();
+	mGlobalTable.assign( DrawListTableSize(inumlocal), -1 );
+
+	int ispanbase = 0;
+	for( int ic=0; ic<inumchunks; ic++ )
+	{
+		for( Chunk::Bucket& bucket : mChunks[ic]->mBuckets )
+		{
+			DrawBucketKey key = bucket.mKey;
+			key.miSpan += ispanbase;
+			bucket.miGlobal = FindOrAddGlobal( key, bucket.miFirst );
+			mGlobalBuckets[bucket.miGlobal].miCount += bucket.miCount;
+		}
+		ispanbase += int(mChunks[ic]->mSingles.size());
+	}
+
+	///////////////////////////////////
+	// commands : buckets and single renderables merged by position
+	///////////////////////////////////
+
+	int inuminstances = 0;
+	for( GlobalBucket& gbucket : mGlobalBuckets )
+	{
+		gbucket.miBase = inuminstances;
+		inuminstances += gbucket.miCount;
+	}
+
+	list.mInstanceModels.resize(inuminstances);
+	list.mInstanceMatrices.resize(inuminstances);
+
+	size_t ibucket = 0;
+	for( int ic=0; ic<=inumchunks; ic++ )
+	{
+		bool blast = (ic==inumchunks);
+		const orkvector<int>* psingles = blast ? nullptr : & mChunks[ic]->mSingles;
+		size_t inumsingles = blast ? 0 : psingles->size();
+		size_t isingle = 0;
+
+		while( isingle<inumsingles || (blast && ibucket<mGlobalBuckets.size()) )
+		{
+			int isinglepos = (isingle<inumsingles) ? (*psingles)[isingle] : inumnodes;
+			bool bbucket = (ibucket<mGlobalBuckets.size()) && (mGlobalBuckets[ibucket].miFirst<isinglepos);
+
+			DrawCommand cmd;
+			if( bbucket )
+			{
+				const GlobalBucket& gbucket = mGlobalBuckets[ibucket++];
+				cmd.meType = EDRAWCMD_INSTANCES;
+				cmd.mpRenderable = nullptr;
+				cmd.mpContextObject = pnodes[psorted[gbucket.miFirst]]->mpContextObject;
+				cmd.mKey = gbucket.mKey;
+				cmd.miFirstInstance = gbucket.miBase;
+				cmd.miNumInstances = gbucket.miCount;
+			}
+			else
+			{
+				const RenderQueue::Node* pnode = pnodes[psorted[isinglepos]];
+				isingle++;
+				cmd.meType = EDRAWCMD_RENDERABLE;
+				cmd.mpRenderable = pnode->mpRenderable;
+				cmd.mpContextObject = pnode->mpContextObject;
+				cmd.miFirstInstance = 0;
+				cmd.miNumInstances = 0;
+			}
+			list.mCommands.push_back(cmd);
+		}
+	}
+
+	///////////////////////////////////
+	// instance slots, chunks fill in chunk order
+	//  so instances stay in sort order
+	///////////////////////////////////
+
+	mGlobalFill.resize(mGlobalBuckets.size());
+	for( size_t ig=0; ig<mGlobalBuckets.size(); ig++ )
+		mGlobalFill[ig] = mGlobalBuckets[ig].miBase;
+
+	for( int ic=0; ic<inumchunks; ic++ )
+	{
+		for( Chunk::Bucket& bucket : mChunks[ic]->mBuckets )
+		{
+			bucket.miOffset = mGlobalFill[bucket.miGlobal];
+			mGlobalFill[bucket.miGlobal] += bucket.miCount;
+		}
+	}
+
+	if( bparallel )
+	{
+		parallel_for( ConcurrentOpQ(), 0, inumchunks, 1, [this,&list]( int ib, int ie )
+		{
+			for( int ic=ib; ic<ie; ic++ )
+				FillChunk( *mChunks[ic], list );
+		});
+	}
+	else
+		FillChunk( *mChunks[0], list );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+} } // namespace ork::lev2
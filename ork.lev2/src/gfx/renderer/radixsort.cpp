@@ -60,7 +60,7 @@ RadixSort::RadixSort() : mIndices(NULL), mIndices2(NULL), mCurrentSize(0), mPrev
 {
 #ifndef RADIX_LOCAL_RAM
 	// Allocate input-independent ram
-	mHistogram		= new U32[256*4];
+	mHistogram		= new U32[256*8]; // 8 passes for 64 bit keys
 	mOffset			= new U32[256];
 #endif
 	// Initialize indices
@@ -110,10 +110,19 @@ bool RadixSort::Resize(U32 nb)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void RadixSort::CHECK_RESIZE( U32 n )
+void RadixSort::CHECK_RESIZE( U32 n, bool keeporder )
 {
+	// Keep the previous sorted order when asked and the size did not change, the histograms then start
+	// reading the input in that order and bail out early if it is still sorted
+	bool samesize = (n==mPreviousSize);
+	mPreviousSize = n;
+	if( keeporder && samesize )
+		return;
+
 	if( n > mCurrentSize )
 	{
+		delete[] mIndices2;
+		delete[] mIndices;
 		mIndices		= new U32[n];
 		OrkAssertI( mIndices != 0, "radix mem prob" );
 		mIndices2		= new U32[n];
@@ -289,7 +298,7 @@ RadixSort& RadixSort::Sort(const float* input2, U32 nb)
 	U32* input = (U32*)input2;
 
 	// Resize lists if needed
-	CHECK_RESIZE(nb);
+	CHECK_RESIZE(nb,true);
 
 #ifdef RADIX_LOCAL_RAM
 	// Allocate histograms & offsets on the stack
@@ -305,7 +314,11 @@ RadixSort& RadixSort::Sort(const float* input2, U32 nb)
 	// is dreadful, this is surprisingly not such a performance hit - well, I suppose that's a big one on first
 	// generation Pentiums....We can't make comparison on integer representations because, as Chris said, it just
 	// wouldn't work with mixed positive/negative values....
-	{ CREATE_HISTOGRAMS<float>(input2,nb); }
+	bool AlreadySorted = CREATE_HISTOGRAMS<float>(input2,nb);
+	if( AlreadySorted )
+	{
+		return *this;
+	}
 
 	// Compute #negative values involved if needed
 	U32 NbNegativeValues = 0;
@@ -395,6 +408,81 @@ RadixSort& RadixSort::Sort(const float* input2, U32 nb)
 	return *this;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ *	Main sort routine.
+ *	This one is for unsigned 64 bit values. Bytes are read by shifting, so it does not depend on the byte order.
+ *	Passes on bytes which are the same for all values are skipped, render queue keys usually leave several
+ *	bytes (unused layers, depth in sorted passes) constant.
+ *	\param		input			[in] a list of unsigned 64 bit values to sort
+ *	\param		nb				[in] number of values to sort
+ *	\return		Self-Reference
+ */
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+RadixSort& RadixSort::Sort(const U64* input, U32 nb)
+{
+	// Checkings
+	if(!input || !nb)	return *this;
+
+	// Stats
+	mTotalCalls++;
+
+	// Resize lists if needed
+	CHECK_RESIZE(nb);
+
+#ifdef RADIX_LOCAL_RAM
+	// Allocate histograms & offsets on the stack
+	U32 mHistogram[256*8];
+	U32 mOffset[256];
+#endif
+
+	// Create histograms for all 8 passes in one run, with the same early out on already sorted input
+	RadixZeroMem(mHistogram, 256*8*sizeof(U32));
+
+	bool AlreadySorted = true;
+	U64 PrevVal = input[0];
+	for(U32 i=0;i<nb;i++)
+	{
+		U64 Val = input[i];
+		if(Val<PrevVal)	AlreadySorted = false;
+		PrevVal = Val;
+		for(U32 k=0;k<8;k++)	mHistogram[(k<<8)+U32((Val>>(k<<3))&0xff)]++;
+	}
+	if(AlreadySorted)
+	{
+		mNbHits++;
+		return *this;
+	}
+
+	// Radix sort, k is the pass number (0=LSB, 7=MSB)
+	for(U32 k=0;k<8;k++)
+	{
+		U32* CurCount = &mHistogram[k<<8];
+
+		// If all values have the same byte, sorting is useless
+		U32 Shift = k<<3;
+		if(CurCount[U32((input[0]>>Shift)&0xff)]==nb)	continue;
+
+		// Create offsets
+		mOffset[0] = 0;
+		for(U32 i=1;i<256;i++)		mOffset[i] = mOffset[i-1] + CurCount[i-1];
+
+		// Perform Radix Sort
+		U32* Indices		= mIndices;
+		U32* IndicesEnd	= &mIndices[nb];
+		while(Indices!=IndicesEnd)
+		{
+			U32 id = *Indices++;
+			mIndices2[mOffset[U32((input[id]>>Shift)&0xff)]++] = id;
+		}
+
+		// Swap pointers for next pass. Valid indices - the most recent ones - are in mIndices after the swap.
+		U32* Tmp	= mIndices;	mIndices = mIndices2; mIndices2 = Tmp;
+	}
+
+	return *this;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**
  *	Resets the inner indices. After the call, mIndices is reset.
@@ -415,7 +503,7 @@ U32 RadixSort::GetUsedRam() const
 {
 	U32 UsedRam = sizeof(RadixSort);
 #ifndef RADIX_LOCAL_RAM
-	UsedRam += 256*4*sizeof(U32);			// Histograms
+	UsedRam += 256*8*sizeof(U32);			// Histograms
 	UsedRam += 256*sizeof(U32);				// Offsets
 #endif
 	UsedRam += 2*mCurrentSize*sizeof(U32);	// 2 lists of indices
@@ -53,9 +53,9 @@ void CBoxRenderable::Render(const Renderer *renderer) const
 	renderer->RenderBox( *this );
 }
 
-U32 CBoxRenderable::ComposeSortKey( const Renderer *renderer ) const
+U64 CBoxRenderable::ComposeSortKey( const Renderer *renderer ) const
 {
-	return 0x1ffffffe;
+	return RenderSortKey::FromLegacy(0x1ffffffe);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -140,4 +140,20 @@ bool CModelRenderable::CanGroup( const IRenderable* oth ) const
 
 ///////////////////////////////////////////////////////////////////////////////
 
+const CModelRenderable* CModelRenderable::GetInstancedModel( DrawBucketKey& key ) const
+{
+	if( nullptr==mSubMesh || nullptr==mCluster )
+		return nullptr;
+	const GfxMaterial* pmtl = mSubMesh->GetMaterial();
+	// transparent models blend back to front, one at a time
+	if( pmtl && pmtl->GetRenderQueueSortingData().mbTransparency )
+		return nullptr;
+	key.mGeometry = mCluster;
+	key.mMaterial = pmtl;
+	key.miMaterialPass = mMaterialPassIndex;
+	return this;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 } } // namespace ork
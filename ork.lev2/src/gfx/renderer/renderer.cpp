@@ -12,28 +12,18 @@
 #include <ork/lev2/gfx/gfxenv.h>
 
 #include <ork/kernel/timer.h>
-#include <ork/kernel/Array.hpp>
+#include <ork/kernel/opq.h>
+#include <ork/kernel/taskgraph.h>
 
 ///////////////////////////////////////////////////////////////////////////////
 
-template class ork::fixedvector<U32,ork::lev2::RenderQueue::krqmaxsize>;
-template class ork::fixedvector<const ork::lev2::RenderQueue::Node*,ork::lev2::RenderQueue::krqmaxsize>;
-
-template class ork::fixedvector<ork::lev2::CBoxRenderable,ork::lev2::Renderer::kmaxrablessm>;
-template class ork::fixedvector<ork::lev2::CModelRenderable,ork::lev2::Renderer::kmaxrables>;
-template class ork::fixedvector<ork::lev2::FrustumRenderable,ork::lev2::Renderer::kmaxrablessm>;
-template class ork::fixedvector<ork::lev2::SphereRenderable,ork::lev2::Renderer::kmaxrablessm>;
-//template class ork::fixedvector<ork::lev2::CGlyphsRenderable,ork::lev2::Renderer::kmaxrables>;
-template class ork::fixedvector<ork::lev2::CallbackRenderable,ork::lev2::Renderer::kmaxrables>;
-
 namespace ork { namespace lev2 {
 static const int kRenderbufferSize = 1024 << 10;
 
 ///////////////////////////////////////////////////////////////////////////////
 
 Renderer::Renderer(GfxTarget* pTARG)
-	: mpCurrentObject(0)
-	, mpCurrentQueueObject(0)
+	: mpCurrentQueueObject(0)
 	, mPerformanceItem(0)
 	, mpTarget( pTARG )
 	, mRenderQueue()
@@ -45,7 +35,8 @@ Renderer::Renderer(GfxTarget* pTARG)
 
 void Renderer::QueueRenderable( IRenderable* pRenderable )
 {
-	mRenderQueue.QueueRenderable(pRenderable, this);
+	RenderQueue::Segment& seg = mRenderQueue.ThreadSegment();
+	seg.QueueRenderable(pRenderable, seg.mpPickObject);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -56,96 +47,50 @@ void Renderer::DrawQueuedRenderables()
 	if(mPerformanceItem)
 		mPerformanceItem->Enter();
 
-	size_t renderQueueSize  = mRenderQueue.Size();
+	mRenderQueue.ExportRenderableNodes(mQueueSortNodes);
+
+	size_t renderQueueSize  = mQueueSortNodes.size();
 
 	if(renderQueueSize == 0)
 	{
+		ResetQueue();
+		if(mPerformanceItem)
+			mPerformanceItem->Exit();
 		return;
 	}
 
-	mQueueSortKeys.clear();
-
-	mRenderQueue.ExportRenderableNodes(mQueueSortNodes);
+	///////////////////////////////////
+	// compose keys, in parallel for big queues
+	//  (ComposeSortKey only reads its renderable)
+	///////////////////////////////////
 
 	mQueueSortKeys.resize(renderQueueSize);
-	for( size_t i = 0; i < renderQueueSize; i++ )
+
+	U64* pkeys = mQueueSortKeys.data();
+	const RenderQueue::Node* const* pnodes = mQueueSortNodes.data();
+
+	auto compose_keys = [this,pkeys,pnodes]( int ibeg, int iend )
 	{
-		mQueueSortKeys[i] = mQueueSortNodes[i]->mpRenderable->ComposeSortKey( this );
-	}
+		for( int i=ibeg; i<iend; i++ )
+			pkeys[i] = pnodes[i]->mpRenderable->ComposeSortKey( this );
+	};
+
+	if( renderQueueSize >= size_t(kparallelkeysize) )
+		parallel_for( ConcurrentOpQ(), 0, int(renderQueueSize), kparallelkeygrain, compose_keys );
+	else
+		compose_keys( 0, int(renderQueueSize) );
 
 	//orkprintf( "rqsize<%d>\n", renderQueueSize );
 
-	U32& first = (*mQueueSortKeys.begin());
-
-	mRadixSorter.Sort(&first, U32(renderQueueSize));
-
-	U32* sortedRenderQueueIndices = mRadixSorter.GetIndices();
-
-	int irun = 0;
-	int imdlcount = 0;
-
-	float fruntot = 0.0f;
-
-	static const ork::lev2::CModelRenderable*	spGroupedModels[RenderQueue::krqmaxsize];
-	for( size_t i = 0; i < renderQueueSize; i++ )
-	{	
-		OrkAssert(sortedRenderQueueIndices[i] < U32(renderQueueSize));
-		const RenderQueue::Node *pnode = mQueueSortNodes[ sortedRenderQueueIndices[i] ];
-		OrkAssert(pnode);
-		int igroupsize = 0;
-		bool bren = true;
-		bool islast = (i+1 == renderQueueSize);
-			
-		//if( pnode )
-		//{
-			//u32 ukey = pnode->mpRenderable->ComposeSortKey( this );
-			//printf( "ukek<0x%x>\n", ukey );
-		//}
-		if( i < renderQueueSize )
-		{	int sortedindex = sortedRenderQueueIndices[i+1];
-			const RenderQueue::Node *pnext = islast ? 0 : mQueueSortNodes[ sortedindex ];
-			const ork::lev2::CModelRenderable* pmdl = rtti::autocast(pnode->mpRenderable);
-
-
-			if( pmdl )
-			{
-				imdlcount++;
-			}
-			if( pnext && pnode->mpRenderable->CanGroup( pnext->mpRenderable ) )
-			{	spGroupedModels[irun] = pmdl;
-				bren = false;
-				irun++;
-				fruntot += 1.0f;
-			}
-			else
-			{	if( irun>0 )
-				{	const ork::lev2::CModelRenderable* pmdl = rtti::autocast(pnode->mpRenderable);
-					spGroupedModels[irun] = pmdl;
-					igroupsize = (irun+1);
-				}
-				irun = 0;
-			}
-		}
-		//orkprintf( "rq <%d:%p> irun<%d> igroupsize<%d>\n", i, pnode->mpRenderable, irun, igroupsize );
-		//orkprintf( "//////////////////////////\n" );
-		if( bren )
-		{	if( igroupsize ) // render renderables as a group to amortize state setup costs
-			{	
-				//orkprintf( "rq<%d> Rendering Group size<%d>\n", i, igroupsize );
-				//OrkAssert( mpTarget->FBI()->IsPickState() == false );
-				
-				this->RenderModelGroup( spGroupedModels, igroupsize );
-			}
-			else
-			{
-				//orkprintf( "rq<%d> Rendering node <%p>\n", i, pnode->mpRenderable );
-				mpCurrentQueueObject = pnode->mpContextObject;
-				pnode->mpRenderable->Render( this );
-			}
-		}
-		//orkprintf( "//////////////////////////\n" );
-	}
-	float favgrun = fruntot/float(imdlcount);
+	mRadixSorter.Sort(pkeys, U32(renderQueueSize));
+
+	///////////////////////////////////
+	// bucket into instanced draws and execute
+	///////////////////////////////////
+
+	mDrawListCompiler.Compile( pnodes, mRadixSorter.GetIndices(), pkeys, int(renderQueueSize), mDrawList );
+
+	ExecuteDrawList( mDrawList );
 
 	ResetQueue();
 
@@ -155,17 +100,53 @@ void Renderer::DrawQueuedRenderables()
 
 ///////////////////////////////////////////////////////////////////////////////
 
+void Renderer::ExecuteDrawList( const DrawList& list )
+{
+	int inumcmds = list.GetNumCommands();
+	for( int i=0; i<inumcmds; i++ )
+	{
+		const DrawCommand& cmd = list.GetCommand(i);
+		mpCurrentQueueObject = cmd.mpContextObject;
+		switch( cmd.meType )
+		{
+			case EDRAWCMD_RENDERABLE:
+				cmd.mpRenderable->Render( this );
+				break;
+			case EDRAWCMD_INSTANCES:
+				RenderModelInstances( list.GetInstanceModels(cmd), list.GetInstanceMatrices(cmd), cmd.miNumInstances );
+				break;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Renderer::RenderModelInstances( const CModelRenderable* const* pmodels, const CMatrix4* pmatrices, int inum ) const
+{
+	if( 1==inum )
+		RenderModel( *pmodels[0] );
+	else
+		RenderModelGroup( const_cast<const CModelRenderable**>(pmodels), inum );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 void Renderer::ResetQueue( void )
 {
-	mpCurrentObject = 0;
 	mpCurrentQueueObject = 0;
-	mRenderQueue.Reset();
 
-	mBoxes.clear();
-	mModels.clear();
-	mFrustums.clear();
-	mSpheres.clear();
-	mCallbacks.clear();
+	int inumsegs = mRenderQueue.NumSegments();
+	for( int i=0; i<inumsegs; i++ )
+	{
+		SegmentRenderables& segrables = mSegmentRenderables[i];
+		segrables.mBoxes.clear();
+		segrables.mModels.clear();
+		segrables.mFrustums.clear();
+		segrables.mSpheres.clear();
+		segrables.mCallbacks.clear();
+	}
+
+	mRenderQueue.Reset();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -175,13 +156,12 @@ void Renderer::ResetQueue( void )
 
 void Renderer::PushPickID(const Object *pObject)
 {
-	mpCurrentObject = pObject;
-
+	mRenderQueue.ThreadSegment().mpPickObject = pObject;
 }
 
 void Renderer::PopPickID()
 {
-	mpCurrentObject = 0;
+	mRenderQueue.ThreadSegment().mpPickObject = nullptr;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
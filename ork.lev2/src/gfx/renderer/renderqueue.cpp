@@ -10,30 +10,112 @@
 
 #include<ork/lev2/gfx/renderqueue.h>
 #include<ork/lev2/gfx/renderer.h>
-#include <ork/kernel/Array.hpp>
 
 ///////////////////////////////////////////////////////////////////////////////
 
-template class ork::fixedvector<ork::lev2::RenderQueue::Node,ork::lev2::RenderQueue::krqmaxsize>;
-
 namespace ork { namespace lev2 {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+static ork::atomic<int> gRenderQueueEpoch(0);
+
+struct RenderQueueThreadCache
+{
+	int						miEpoch;
+	RenderQueue::Segment*	mpSegment;
+};
+
+static thread_local RenderQueueThreadCache gRenderQueueTls = { -1, nullptr };
+
+///////////////////////////////////////////////////////////////////////////////
+
+RenderQueue::RenderQueue()
+	: miNumSegments(0)
+	, miEpoch(gRenderQueueEpoch.fetch_add(1))
+	, mSegmentLock("RenderQueue")
+{
+	for( int i=0; i<kmaxsegments; i++ )
+		mSegments[i] = nullptr;
+}
+
+RenderQueue::~RenderQueue()
+{
+	for( int i=0; i<kmaxsegments; i++ )
+		delete mSegments[i];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+RenderQueue::Segment& RenderQueue::ThreadSegment()
+{
+	if( gRenderQueueTls.miEpoch==miEpoch )
+		return *gRenderQueueTls.mpSegment;
+
+	// first queue of this thread to this queue this frame
+	//  (or it queued to another queue since)
+
+	std::thread::id tid = std::this_thread::get_id();
+	Segment* pseg = nullptr;
+
+	mSegmentLock.Lock();
+	{
+		int inumsegs = miNumSegments.load();
+		for( int i=0; i<inumsegs && nullptr==pseg; i++ )
+			if( mSegments[i]->mOwner==tid )
+				pseg = mSegments[i];
+
+		if( nullptr==pseg )
+		{
+			OrkAssert( inumsegs<kmaxsegments );
+			if( nullptr==mSegments[inumsegs] )
+			{
+				mSegments[inumsegs] = new Segment;
+				mSegments[inumsegs]->miIndex = inumsegs;
+			}
+			pseg = mSegments[inumsegs];
+			pseg->mOwner = tid;
+			miNumSegments.store(inumsegs+1);
+		}
+	}
+	mSegmentLock.UnLock();
+
+	gRenderQueueTls.miEpoch = miEpoch;
+	gRenderQueueTls.mpSegment = pseg;
+	return *pseg;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 void RenderQueue::QueueRenderable(const IRenderable *pRenderable, Renderer *pRenderer)
 {
-	new (&mNodes.create()) Node(pRenderer->GetCurrentObject(), pRenderable);
+	Segment& seg = ThreadSegment();
+	seg.QueueRenderable(pRenderable, seg.mpPickObject);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t RenderQueue::Size() const
+{
+	size_t isize = 0;
+	int inumsegs = miNumSegments.load();
+	for( int i=0; i<inumsegs; i++ )
+		isize += mSegments[i]->mNodes.size();
+	return isize;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-void RenderQueue::ExportRenderableNodes(ork::fixedvector<const RenderQueue::Node*,krqmaxsize>& nodes)
+void RenderQueue::ExportRenderableNodes(orkvector<const RenderQueue::Node*>& nodes) const
 {
 	nodes.resize(Size());
-	int idx = 0;
-	for(ork::fixedvector<Node,krqmaxsize>::const_iterator it=mNodes.begin(); it!=mNodes.end(); it++ )
+	size_t idx = 0;
+	int inumsegs = miNumSegments.load();
+	for( int i=0; i<inumsegs; i++ )
 	{
-		nodes[idx++] = &(*it);
+		for( const Node& node : mSegments[i]->mNodes )
+		{
+			nodes[idx++] = &node;
+		}
 	}
 }
 
@@ -41,7 +123,15 @@ void RenderQueue::ExportRenderableNodes(ork::fixedvector<const RenderQueue::Node
 
 void RenderQueue::Reset()
 {
-	mNodes.clear();
+	int inumsegs = miNumSegments.load();
+	for( int i=0; i<inumsegs; i++ )
+	{
+		mSegments[i]->mNodes.clear();
+		mSegments[i]->mOwner = std::thread::id();
+		mSegments[i]->mpPickObject = nullptr;
+	}
+	miNumSegments.store(0);
+	miEpoch = gRenderQueueEpoch.fetch_add(1);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
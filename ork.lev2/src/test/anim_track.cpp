@@ -0,0 +1,269 @@
+#include <ork/pch.h>
+
+#include <unittest++/UnitTest++.h>
+#include <stdio.h>
+#include <cmath>
+
+#include <ork/lev2/gfx/gfxanim.h>
+#include <ork/kernel/timer.h>
+
+using namespace ork;
+using namespace ork::lev2;
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// ijoint selects the motion : 0 constant, 1 smooth, 2 noisy
+static DecompMtx44 JointFrame( int ijoint, int iframe )
+{
+	DecompMtx44 rval;
+	float ft = float(iframe)/30.0f;
+	float fangle = 0.0f;
+	CVector3 pos( 0.0f, 1.0f, float(ijoint) );
+	switch( ijoint%3 )
+	{
+		case 0:
+			fangle = 0.3f;
+			break;
+		case 1:
+			fangle = std::sin(ft)*0.75f;
+			pos = pos+CVector3( ft*0.5f, 0.0f, 0.0f );
+			break;
+		case 2:
+		{
+			U32 useed = U32(iframe*2654435761u)^U32(ijoint);
+			useed ^= useed>>13; useed *= 0x5bd1e995u; useed ^= useed>>15;
+			fangle = float(useed&0xffff)/65536.0f*6.0f-3.0f;
+			pos = pos+CVector3( float((useed>>16)&0xff)/256.0f, 0.0f, 0.0f );
+			break;
+		}
+	}
+	float fs = std::sin(fangle*0.5f), fc = std::cos(fangle*0.5f);
+	CVector3 axis( 0.48f, 0.6f, 0.64f ); // unit
+	rval.mRot = CQuaternion( axis.GetX()*fs, axis.GetY()*fs, axis.GetZ()*fs, fc );
+	rval.mTrans = pos;
+	rval.mScale = 1.0f;
+	return rval;
+}
+
+static XgmDecompAnimChannel* CreateChannel( int ijoint, int inumframes )
+{
+	XgmDecompAnimChannel* pchan = new XgmDecompAnimChannel;
+	pchan->ReserveFrames( inumframes );
+	for( int i=0; i<inumframes; i++ )
+		pchan->AddFrame( JointFrame(ijoint,i) );
+	return pchan;
+}
+
+// angle between rotations, from the chord (acos is too coarse near 1)
+static float RotError( const CQuaternion& a, const CQuaternion& b )
+{
+	float fdot = a.GetX()*b.GetX()+a.GetY()*b.GetY()+a.GetZ()*b.GetZ()+a.GetW()*b.GetW();
+	float fs = (fdot<0.0f) ? -1.0f : 1.0f;
+	float dx = a.GetX()-b.GetX()*fs, dy = a.GetY()-b.GetY()*fs;
+	float dz = a.GetZ()-b.GetZ()*fs, dw = a.GetW()-b.GetW()*fs;
+	return 4.0f*std::asin( std::min( std::sqrt(dx*dx+dy*dy+dz*dz+dw*dw)*0.5f, 1.0f ) );
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(AnimTrackRotCodec)
+{
+	float fmaxerr = 0.0f;
+	for( int i=0; i<1000; i++ )
+	{
+		CQuaternion q = JointFrame( 2, i ).mRot;
+		if( i&1 )
+			q = CQuaternion( -q.GetX(), -q.GetY(), -q.GetZ(), -q.GetW() );
+		U16 packed[3];
+		XgmAnimTrack::EncodeRot( q, packed );
+		fmaxerr = std::max( fmaxerr, RotError( q, XgmAnimTrack::DecodeRot(packed) ) );
+	}
+	CHECK( fmaxerr < 0.0002f );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(AnimTrackCompress)
+{
+	const int knumframes = 120;
+	XgmAnimCompression settings;
+
+	for( int ijoint=0; ijoint<3; ijoint++ )
+	{
+		XgmDecompAnimChannel* pchan = CreateChannel( ijoint, knumframes );
+		size_t irawsize = pchan->GetMemorySize();
+		pchan->Compress( settings );
+		CHECK( pchan->IsCompressed() );
+		CHECK_EQUAL( knumframes, static_cast<XgmAnimChannel*>(pchan)->GetNumFrames() );
+
+		const XgmAnimTrack& trk = *pchan->GetTrack();
+		switch( ijoint )
+		{
+			case 0: // constant everything
+				CHECK_EQUAL( 1, trk.GetNumKeys(XgmAnimTrack::ECOMP_ROT) );
+				CHECK_EQUAL( 1, trk.GetNumKeys(XgmAnimTrack::ECOMP_POS) );
+				CHECK_EQUAL( 1, trk.GetNumKeys(XgmAnimTrack::ECOMP_SCALE) );
+				break;
+			case 1: // smooth rotation, linear position
+				CHECK( trk.GetNumKeys(XgmAnimTrack::ECOMP_ROT) < knumframes/2 );
+				CHECK_EQUAL( 2, trk.GetNumKeys(XgmAnimTrack::ECOMP_POS) );
+				CHECK_EQUAL( 1, trk.GetNumKeys(XgmAnimTrack::ECOMP_SCALE) );
+				break;
+			case 2: // noise keeps (nearly) every key
+				CHECK( trk.GetNumKeys(XgmAnimTrack::ECOMP_ROT) > knumframes*3/4 );
+				break;
+		}
+		CHECK( pchan->GetMemorySize() < irawsize );
+
+		float frotmax = 0.0f, fposmax = 0.0f;
+		for( int i=0; i<knumframes; i++ )
+		{
+			DecompMtx44 orig = JointFrame( ijoint, i );
+			DecompMtx44 dec = pchan->GetFrame( i );
+			frotmax = std::max( frotmax, RotError( orig.mRot, dec.mRot ) );
+			fposmax = std::max( fposmax, (orig.mTrans-dec.mTrans).Mag() );
+			CHECK_CLOSE( orig.mScale, dec.mScale, settings.mfScaleTolerance );
+		}
+		// quantization of the keys themselves adds a little
+		CHECK( frotmax <= settings.mfRotTolerance*1.05f+0.0002f );
+		CHECK( fposmax <= settings.mfPosTolerance*1.05f );
+
+		delete pchan;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// a channel without frames still compresses (the exporter saves all joint
+//  channels compressed or none)
+
+TEST(AnimTrackCompressEmpty)
+{
+	XgmDecompAnimChannel* pchan = CreateChannel( 0, 0 );
+	pchan->Compress( XgmAnimCompression() );
+	CHECK( pchan->IsCompressed() );
+	CHECK_EQUAL( 0, static_cast<XgmAnimChannel*>(pchan)->GetNumFrames() );
+	for( int ic=0; ic<XgmAnimTrack::ECOMP_COUNT; ic++ )
+		CHECK_EQUAL( 0, pchan->GetTrack()->GetNumKeys(XgmAnimTrack::EComponent(ic)) );
+	CHECK( pchan->GetTrack()->IsEmpty() );
+
+	// and samples to the identity, alone and among other channels
+	DecompMtx44 out;
+	out.mScale = 0.0f;
+	pchan->GetTrack()->Sample( 3.5f, out );
+	CHECK( RotError( CQuaternion(), out.mRot ) < 0.0001f );
+	CHECK( out.mTrans.Mag() < 0.0001f );
+	CHECK_EQUAL( 1.0f, out.mScale );
+
+	const int knumframes = 10;
+	XgmDecompAnimChannel* pfull = CreateChannel( 1, knumframes );
+	pfull->Compress( XgmAnimCompression() );
+	const XgmDecompAnimChannel* channels[3] = { pfull, pchan, pfull };
+	DecompMtx44 pose[3];
+	pose[1].mScale = 0.0f;
+	XgmDecompAnimChannel::SampleChannels( channels, 3, 3.5f, pose );
+	DecompMtx44 ref;
+	pfull->GetTrack()->Sample( 3.5f, ref );
+	CHECK( RotError( CQuaternion(), pose[1].mRot ) < 0.0001f );
+	CHECK_EQUAL( 1.0f, pose[1].mScale );
+	CHECK( (ref.mTrans-pose[0].mTrans).Mag() < 0.0001f && (ref.mTrans-pose[2].mTrans).Mag() < 0.0001f );
+
+	delete pfull;
+	delete pchan;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// the 4 lane pose sampler against per channel sampling, mixing
+//  compressed and raw channels, at and between frames
+
+TEST(AnimTrackSamplePose)
+{
+	const int knumframes = 90;
+	const int knumchannels = 11;
+	XgmAnimCompression settings;
+
+	orkvector<XgmDecompAnimChannel*> channels;
+	for( int ic=0; ic<knumchannels; ic++ )
+	{
+		channels.push_back( CreateChannel( ic, knumframes ) );
+		if( ic!=5 )
+			channels.back()->Compress( settings );
+	}
+
+	DecompMtx44 pose[knumchannels];
+	bool bsame = true;
+	for( float frame=0.0f; frame<float(knumframes-1); frame+=0.75f )
+	{
+		XgmDecompAnimChannel::SampleChannels( channels.data(), knumchannels, frame, pose );
+		for( int ic=0; ic<knumchannels; ic++ )
+		{
+			DecompMtx44 ref;
+			if( channels[ic]->IsCompressed() )
+				channels[ic]->GetTrack()->Sample( frame, ref );
+			else
+				ref = channels[ic]->GetFrame( int(frame) );
+			bsame &= RotError( ref.mRot, pose[ic].mRot ) < 0.0001f;
+			bsame &= (ref.mTrans-pose[ic].mTrans).Mag() < 0.0001f;
+			bsame &= std::fabs( ref.mScale-pose[ic].mScale ) < 0.0001f;
+		}
+	}
+	CHECK( bsame );
+
+	for( int ic=0; ic<knumchannels; ic++ )
+		delete channels[ic];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// memory and pose sampling cost for a 64 joint character
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(AnimTrackBench)
+{
+	const int knumframes = 300;
+	const int knumchannels = 64;
+	const int knumposes = 20000;
+
+	orkvector<XgmDecompAnimChannel*> raw, comp;
+	size_t irawsize = 0, icompsize = 0;
+	for( int ic=0; ic<knumchannels; ic++ )
+	{
+		// mostly smooth joints, as in character anims
+		int imotion = (ic%8)==7 ? 2 : (ic%4)==0 ? 0 : 1;
+		raw.push_back( CreateChannel( imotion, knumframes ) );
+		comp.push_back( CreateChannel( imotion, knumframes ) );
+		comp.back()->Compress( XgmAnimCompression() );
+		irawsize += raw.back()->GetMemorySize();
+		icompsize += comp.back()->GetMemorySize();
+	}
+
+	// quarter frame steps, as playback at a rate other than the authored one
+	const int knumsteps = (knumframes-1)*4;
+	DecompMtx44 pose[knumchannels];
+	float ft0 = get_sync_time();
+	for( int ip=0; ip<knumposes; ip++ )
+		XgmDecompAnimChannel::SampleChannels( raw.data(), knumchannels, float(ip%knumsteps)*0.25f, pose );
+	float ft1 = get_sync_time();
+	for( int ip=0; ip<knumposes; ip++ )
+		XgmDecompAnimChannel::SampleChannels( comp.data(), knumchannels, float(ip%knumsteps)*0.25f, pose );
+	float ft2 = get_sync_time();
+	for( int ip=0; ip<knumposes; ip++ )
+		for( int ic=0; ic<knumchannels; ic++ )
+			comp[ic]->GetTrack()->Sample( float(ip%knumsteps)*0.25f, pose[ic] );
+	float ft3 = get_sync_time();
+
+	printf( "AnimTrackBench %d joints %d frames : raw<%d bytes> compressed<%d bytes> (x%f)\n",
+			knumchannels, knumframes, int(irawsize), int(icompsize), float(irawsize)/float(icompsize) );
+	printf( "AnimTrackBench pose sample : raw<%f us> compressed 4 lane<%f us> compressed scalar<%f us>\n",
+			(ft1-ft0)*1.0e6f/float(knumposes), (ft2-ft1)*1.0e6f/float(knumposes), (ft3-ft2)*1.0e6f/float(knumposes) );
+
+	CHECK( icompsize*4 < irawsize );
+
+	for( int ic=0; ic<knumchannels; ic++ )
+	{
+		delete raw[ic];
+		delete comp[ic];
+	}
+}
@@ -0,0 +1,312 @@
+#include <ork/pch.h>
+
+#include <unittest++/UnitTest++.h>
+#include <stdio.h>
+#include <limits>
+
+#include <ork/lev2/gfx/renderer.h>
+#include <ork/lev2/gfx/renderable.h>
+#include <ork/lev2/gfx/gfxmodel.h>
+#include <ork/lev2/gfx/gfxmaterial.h>
+#include <ork/kernel/timer.h>
+
+using namespace ork;
+using namespace ork::lev2;
+
+///////////////////////////////////////////////////////////////////////////////
+// counts what the draw list asks of the backend, and records the queue
+//  position (model z, callback depth) of everything it draws, in draw order
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+class DrawListTestMaterial : public GfxMaterial
+{
+public:
+	DrawListTestMaterial( bool btransparent=false ) { mSortingData.mbTransparency = btransparent; }
+
+	void Update( void ) final {}
+	void Init( GfxTarget *pTarg ) final {}
+	bool BeginPass( GfxTarget* pTARG, int iPass=0 ) final { return true; }
+	void EndPass( GfxTarget* pTARG ) final {}
+	int  BeginBlock( GfxTarget* pTARG, const RenderContextInstData &MatCtx = RenderContextInstData::Default ) final { return 1; }
+	void EndBlock( GfxTarget* pTARG ) final {}
+};
+
+class DrawListTestRenderer : public Renderer
+{
+public:
+	DrawListTestRenderer() : Renderer(nullptr) { Clear(); }
+
+	void Clear()
+	{
+		miNumModels = 0;
+		miNumCallbacks = 0;
+		miNumInstanceDraws = 0;
+		miNumInstances = 0;
+		mbInstancesOrdered = true;
+		mDrawn.clear();
+		mCallbacksDrawn.clear();
+	}
+
+	void RenderBox( const CBoxRenderable & CubeRen ) const final {}
+	void RenderModel( const CModelRenderable & ModelRen, RenderGroupState rgs=ERGST_NONE ) const final
+	{
+		miNumModels++;
+		mDrawn.push_back( int(ModelRen.GetMatrix().GetTranslation().GetZ()) );
+	}
+	void RenderModelGroup( const CModelRenderable** Renderables, int inumr ) const final {}
+	void RenderFrustum( const FrustumRenderable & Frusren ) const final {}
+	void RenderSphere( const SphereRenderable & SphereRen ) const final {}
+	void RenderCallback( const CallbackRenderable & cbren ) const final
+	{
+		miNumCallbacks++;
+		mCallbacksDrawn.push_back( int(mDrawn.size()) );
+		const IRenderable& rable = cbren;
+		mDrawn.push_back( int((rable.ComposeSortKey(this)>>RenderSortKey::kdepthshift)&RenderSortKey::kmaxdepth) );
+	}
+
+	void RenderModelInstances( const CModelRenderable* const* pmodels, const CMatrix4* pmatrices, int inum ) const final
+	{
+		miNumInstanceDraws++;
+		miNumInstances += inum;
+		for( int i=0; i<inum; i++ )
+		{
+			mbInstancesOrdered &= (pmodels[i]->GetCluster()==pmodels[0]->GetCluster());
+			mbInstancesOrdered &= (pmatrices[i].GetTranslation()==pmodels[i]->GetMatrix().GetTranslation());
+			if( i>0 )
+				mbInstancesOrdered &= (pmatrices[i-1].GetTranslation().GetZ() <= pmatrices[i].GetTranslation().GetZ());
+			mDrawn.push_back( int(pmatrices[i].GetTranslation().GetZ()) );
+		}
+	}
+
+	// everything queued before a callback is drawn before it, everything after it after it
+	bool CallbacksKeepOrder() const
+	{
+		int inum = int(mDrawn.size());
+		orkvector<int> minafter(inum+1,std::numeric_limits<int>::max());
+		for( int i=inum-1; i>=0; i-- )
+			minafter[i] = std::min(minafter[i+1],mDrawn[i]);
+
+		bool border = true;
+		int imaxbefore = -1;
+		size_t icb = 0;
+		for( int i=0; i<inum; i++ )
+		{
+			if( icb<mCallbacksDrawn.size() && mCallbacksDrawn[icb]==i )
+			{
+				border &= (imaxbefore<mDrawn[i]) && (mDrawn[i]<minafter[i+1]);
+				icb++;
+			}
+			imaxbefore = std::max(imaxbefore,mDrawn[i]);
+		}
+		return border;
+	}
+
+	mutable int miNumModels;
+	mutable int miNumCallbacks;
+	mutable int miNumInstanceDraws;
+	mutable int miNumInstances;
+	mutable bool mbInstancesOrdered;
+	mutable orkvector<int> mDrawn;
+	mutable orkvector<int> mCallbacksDrawn;	// indices into mDrawn
+};
+
+// nmeshes x nmtls buckets, instanced models are spread over the sorted queue
+//  with a callback every 8th renderable
+static void DrawListQueue( DrawListTestRenderer& renderer, XgmSubMesh* psubmeshes, XgmCluster* pclusters, int inummeshes, int inumrables )
+{
+	for( int i=0; i<inumrables; i++ )
+	{
+		if( 7==(i&7) )
+		{
+			CallbackRenderable& cb = renderer.QueueCallback();
+			cb.SetSortKey( RenderSortKey::Compose(1,0,0,i) );
+			continue;
+		}
+		int imesh = i%inummeshes;
+		CModelRenderable& mdl = renderer.QueueModel();
+		mdl.SetSubMesh( & psubmeshes[imesh] );
+		mdl.SetCluster( & pclusters[imesh] );
+		CMatrix4 mtx;
+		mtx.SetTranslation( CVector3( 0.0f, 0.0f, float(i) ) );
+		mdl.SetMatrix( mtx );
+		mdl.SetSortKey( RenderSortKey::Compose(1,0,0,i) );
+	}
+}
+
+// what DrawListQueue should compile to : one bucket per mesh between callbacks
+static int DrawListNumBuckets( int inummeshes, int inumrables )
+{
+	int inumbuckets = 0;
+	orkvector<bool> used(inummeshes,false);
+	for( int i=0; i<inumrables; i++ )
+	{
+		if( 7==(i&7) )
+		{
+			used.assign(inummeshes,false);
+			continue;
+		}
+		if( false==used[i%inummeshes] )
+			inumbuckets++;
+		used[i%inummeshes] = true;
+	}
+	return inumbuckets;
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(DrawListBuckets)
+{
+	const int knummeshes = 4;
+	XgmSubMesh submeshes[knummeshes];
+	XgmCluster clusters[knummeshes];
+	DrawListTestMaterial materials[2];
+	for( int i=0; i<knummeshes; i++ )
+		submeshes[i].mpMaterial = & materials[i&1];
+
+	DrawListTestRenderer renderer;
+
+	// small (serial) and big (parallel) queues compile the same way,
+	//  the callbacks split the buckets (and chunks do not)
+	const int ksizes[] = { 64, 3*DrawListCompiler::kparallelsize+17 };
+	for( int inumrables : ksizes )
+	{
+		int inumcallbacks = (inumrables+1)/8;
+		int inummodels = inumrables-inumcallbacks;
+		int inumbuckets = DrawListNumBuckets( knummeshes, inumrables );
+
+		renderer.Clear();
+		DrawListQueue( renderer, submeshes, clusters, knummeshes, inumrables );
+		renderer.DrawQueuedRenderables();
+
+		const DrawList& list = renderer.GetLastDrawList();
+		CHECK_EQUAL( inumbuckets+inumcallbacks, list.GetNumCommands() );
+		CHECK_EQUAL( inummodels, list.GetNumInstances() );
+		CHECK_EQUAL( inumbuckets, renderer.miNumInstanceDraws );
+		CHECK_EQUAL( inummodels, renderer.miNumInstances );
+		CHECK_EQUAL( inumcallbacks, renderer.miNumCallbacks );
+		CHECK_EQUAL( 0, renderer.miNumModels );
+		CHECK( renderer.mbInstancesOrdered );
+		CHECK( renderer.CallbacksKeepOrder() );
+		CHECK_EQUAL( inumrables, int(renderer.mDrawn.size()) );
+
+		// buckets are placed where their first instance sorted
+		bool bplaced = true;
+		for( int i=0; i<knummeshes; i++ )
+			bplaced &= (list.GetCommand(i).meType==EDRAWCMD_INSTANCES) && (list.GetCommand(i).mKey.mGeometry==&clusters[i]);
+		bplaced &= (list.GetCommand(knummeshes).meType==EDRAWCMD_RENDERABLE);
+		CHECK( bplaced );
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(DrawListPassesSplitBuckets)
+{
+	XgmSubMesh submesh;
+	XgmCluster cluster;
+	DrawListTestRenderer renderer;
+
+	// the same mesh in two passes, and in two material passes, makes 4 buckets
+	for( int i=0; i<40; i++ )
+	{
+		CModelRenderable& mdl = renderer.QueueModel();
+		mdl.SetSubMesh( & submesh );
+		mdl.SetCluster( & cluster );
+		mdl.SetMaterialPassIndex( i&1 );
+		mdl.SetSortKey( RenderSortKey::Compose(i<20?1:2,0,0,i) );
+	}
+	// models without geometry are drawn one at a time
+	renderer.QueueModel().SetSortKey( RenderSortKey::Compose(3,0,0,0) );
+
+	renderer.DrawQueuedRenderables();
+
+	CHECK_EQUAL( 5, renderer.GetLastDrawList().GetNumCommands() );
+	CHECK_EQUAL( 4, renderer.miNumInstanceDraws );
+	CHECK_EQUAL( 40, renderer.miNumInstances );
+	CHECK_EQUAL( 1, renderer.miNumModels );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// layers are drawn in layer order, transparent models one at a time in sort
+//  order, whatever their geometry and material
+
+TEST(DrawListKeepsOrder)
+{
+	XgmSubMesh submeshes[2];
+	XgmCluster clusters[2];
+	DrawListTestMaterial opaque;
+	DrawListTestMaterial transparent(true);
+	submeshes[0].mpMaterial = & opaque;
+	submeshes[1].mpMaterial = & transparent;
+	DrawListTestRenderer renderer;
+
+	const int knum = 20;
+	for( int i=0; i<knum; i++ )
+	{
+		CMatrix4 mtx;
+		mtx.SetTranslation( CVector3( 0.0f, 0.0f, float(i) ) );
+
+		// the same mesh in layers 1 (even) and 0 (odd)
+		CModelRenderable& mdl = renderer.QueueModel();
+		mdl.SetSubMesh( & submeshes[0] );
+		mdl.SetCluster( & clusters[0] );
+		mdl.SetMatrix( mtx );
+		mdl.SetSortKey( RenderSortKey::Compose(1,(i&1)?0:1,0,i) );
+
+		// two transparent meshes, back to front
+		mtx.SetTranslation( CVector3( 0.0f, 0.0f, float(knum+i) ) );
+		CModelRenderable& tmdl = renderer.QueueModel();
+		tmdl.SetSubMesh( & submeshes[1] );
+		tmdl.SetCluster( & clusters[i&1] );
+		tmdl.SetMatrix( mtx );
+		tmdl.SetSortKey( RenderSortKey::Compose(2,0,0,knum-i) );
+	}
+
+	renderer.DrawQueuedRenderables();
+
+	CHECK_EQUAL( 2, renderer.miNumInstanceDraws );
+	CHECK_EQUAL( knum, renderer.miNumModels );
+
+	orkvector<int> expected;
+	for( int i=1; i<knum; i+=2 )
+		expected.push_back(i);
+	for( int i=0; i<knum; i+=2 )
+		expected.push_back(i);
+	for( int i=knum-1; i>=0; i-- )
+		expected.push_back(knum+i);
+	CHECK( expected==renderer.mDrawn );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(DrawListCompileBench)
+{
+	const int knummeshes = 63;
+	const int knumrables = 100000;
+	XgmSubMesh submeshes[knummeshes];
+	XgmCluster clusters[knummeshes];
+	DrawListTestMaterial materials[8];
+	for( int i=0; i<knummeshes; i++ )
+		submeshes[i].mpMaterial = & materials[i&7];
+
+	DrawListTestRenderer renderer;
+	float ftot = 0.0f;
+	const int knumframes = 8;
+	for( int iframe=0; iframe<knumframes; iframe++ )
+	{
+		renderer.Clear();
+		DrawListQueue( renderer, submeshes, clusters, knummeshes, knumrables );
+		float ft0 = get_sync_time();
+		renderer.DrawQueuedRenderables();
+		ftot += get_sync_time()-ft0;
+	}
+
+	printf( "DrawListCompileBench %d renderables : %d commands, %f ms/frame\n",
+			knumrables, renderer.GetLastDrawList().GetNumCommands(), ftot*1000.0f/float(knumframes) );
+
+	CHECK_EQUAL( DrawListNumBuckets(knummeshes,knumrables)+knumrables/8, renderer.GetLastDrawList().GetNumCommands() );
+}
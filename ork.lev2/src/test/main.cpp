@@ -11,6 +11,7 @@
 #include <ork/rtti/downcast.h>
 #include <ork/reflect/RegisterProperty.h>
 #include <ork/lev2/gfx/gfxenv.h>
+#include <unittest++/UnitTest++.h>
 
 namespace ork { namespace lev2 { void Init(const std::string& gfxlayer); }}
 
@@ -32,6 +33,5 @@ int main(int argc, char** argv)
     ork::lev2::Init("dummy");
 
 	ork::rtti::Class::InitializeClasses();
-	printf("yo\n" );
-	return 0;
+	return UnitTest::RunAllTests();
 }
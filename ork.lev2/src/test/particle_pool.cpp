@@ -0,0 +1,161 @@
+#include <ork/pch.h>
+
+#include <unittest++/UnitTest++.h>
+#include <stdio.h>
+
+#include <ork/lev2/gfx/particle/particle.h>
+#include <ork/kernel/timer.h>
+
+using namespace ork;
+using namespace ork::lev2::particle;
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// emits from the origin along +Y
+class TestEmitter : public DirectedEmitter
+{
+public:
+	TestEmitter() { meDirection=EMITDIR_CONSTANT; mDispersionAngle=0.0f; }
+	void ComputePosDir( float fi, CVector3& pos, CVector3& dir ) final
+	{
+		pos = CVector3(fi,0.0f,0.0f);
+		dir = CVector3(0.0f,1.0f,0.0f);
+	}
+};
+
+static void AgeParticles( Pool<BasicParticle>& pool, float fdt )
+{
+	for( int i=0; i<pool.GetNumAlive(); i++ )
+		pool.mAge[i] += fdt;
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(ParticlePoolSoA)
+{
+	Pool<BasicParticle> pool;
+	pool.Init(1000);
+
+	CHECK_EQUAL( 1000, pool.GetMax() );
+	CHECK_EQUAL( 0, pool.GetNumAlive() );
+	CHECK_EQUAL( 0, int(size_t(pool.mPosX)&63) );
+	CHECK_EQUAL( 0, int(size_t(pool.mColliderStates)&63) );
+
+	for( int i=0; i<1000; i++ )
+	{
+		int iptc = pool.FastAlloc();
+		pool.SetPosition( iptc, CVector3(float(i),0.0f,0.0f) );
+		pool.mLifeSpan[iptc] = 1.0f;
+	}
+	CHECK_EQUAL( -1, pool.FastAlloc() );
+	CHECK_EQUAL( 1000, pool.GetNumAlive() );
+
+	// freeing moves the last alive particle into the slot
+	pool.FastFree( 10 );
+	CHECK_EQUAL( 999, pool.GetNumAlive() );
+	CHECK_EQUAL( 1000, pool.GetNumAliveLanes() );
+	CHECK_EQUAL( 999.0f, pool.mPosX[10] );
+	CHECK_EQUAL( 999.0f, pool.GetActiveParticle(10).mPosition.GetX() );
+
+	Pool<BasicParticle> copy( pool );
+	CHECK_EQUAL( 999, copy.GetNumAlive() );
+	CHECK( copy.mPosX != pool.mPosX );
+	CHECK_EQUAL( 0, int(size_t(copy.mPosX)&63) );
+	CHECK_EQUAL( 999.0f, copy.mPosX[10] );
+
+	pool.Reset();
+	CHECK_EQUAL( 0, pool.GetNumAlive() );
+	CHECK_EQUAL( 1000, pool.GetNumDead() );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(ParticlePoolEmitReap)
+{
+	Pool<BasicParticle> pool;
+	pool.Init(256);
+	EventQueue deaths;
+	TestEmitter emitter;
+	int ikeya = 0, ikeyb = 0;
+
+	EmitterCtx ctx;
+	ctx.mPool = & pool;
+	ctx.mDeathQueue = & deaths;
+	ctx.mfDeltaTime = 1.0f;
+	ctx.mfEmissionRate = 100.0f;
+	ctx.mfEmissionVelocity = 2.0f;
+	ctx.mfLifespan = 1.5f;
+	ctx.mKey = & ikeya;
+	emitter.Emit( ctx );
+	CHECK_EQUAL( 100, pool.GetNumAlive() );
+	CHECK_EQUAL( 2.0f, pool.mVelY[0] );
+	CHECK_EQUAL( -2.0f, pool.mLastPosY[0] );
+
+	// a second emitter sharing the pool, with a longer lifespan
+	ctx.mKey = & ikeyb;
+	ctx.mfLifespan = 3.0f;
+	emitter.Emit( ctx );
+	CHECK_EQUAL( 200, pool.GetNumAlive() );
+
+	AgeParticles( pool, 2.0f );
+
+	// only the first emitters dead particles are reaped
+	ctx.mKey = & ikeya;
+	emitter.Reap( ctx );
+	CHECK_EQUAL( 100, pool.GetNumAlive() );
+	CHECK_EQUAL( 100, deaths.GetNumEvents() );
+	bool ballb = true;
+	for( int i=0; i<pool.GetNumAlive(); i++ )
+		ballb &= (pool.mKeys[i]==& ikeyb) && (false==pool.IsDead(i));
+	CHECK( ballb );
+
+	AgeParticles( pool, 2.0f );
+	ctx.mKey = & ikeyb;
+	emitter.Reap( ctx );
+	CHECK_EQUAL( 0, pool.GetNumAlive() );
+	CHECK_EQUAL( 200, deaths.GetNumEvents() );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// 1M particles : emit, age and reap a steady state pool
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(ParticlePoolBench)
+{
+	const int knumparticles = 1<<20;
+	const int knumframes = 16;
+	const float kdt = 1.0f/60.0f;
+
+	Pool<BasicParticle> pool;
+	pool.Init(knumparticles);
+	TestEmitter emitter;
+	int ikey = 0;
+
+	EmitterCtx ctx;
+	ctx.mPool = & pool;
+	ctx.mfDeltaTime = kdt;
+	ctx.mfEmissionRate = float(knumparticles)/(kdt*float(knumframes));
+	ctx.mfEmissionVelocity = 1.0f;
+	ctx.mfLifespan = 0.75f*kdt*float(knumframes);
+	ctx.mKey = & ikey;
+
+	float ft0 = get_sync_time();
+	int imaxalive = 0;
+	for( int iframe=0; iframe<knumframes; iframe++ )
+	{
+		emitter.Emit( ctx );
+		AgeParticles( pool, kdt );
+		emitter.Reap( ctx );
+		imaxalive = std::max(imaxalive,pool.GetNumAlive());
+	}
+	float ft1 = get_sync_time();
+
+	printf( "ParticlePoolBench %d frames, max alive<%d> : %f ms/frame\n",
+			knumframes, imaxalive, (ft1-ft0)*1000.0f/float(knumframes) );
+
+	CHECK( imaxalive > knumparticles/2 );
+}
@@ -0,0 +1,155 @@
+#include <ork/pch.h>
+
+#include <unittest++/UnitTest++.h>
+#include <stdio.h>
+
+#include <ork/lev2/gfx/particle/modular_particles.h>
+#include <ork/kernel/fixedlut.hpp>
+#include <ork/kernel/timer.h>
+
+using namespace ork;
+using namespace ork::lev2::particle;
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// particles on a line along z, shuffled, with an identity MVP their depth is z
+static void ScatterParticles( orkvector<BasicParticle>& particles, int inum )
+{
+	particles.resize(inum);
+	U32 useed = 0x1234567;
+	for( int i=0; i<inum; i++ )
+	{
+		useed = useed*1664525u+1013904223u;
+		float fz = float(useed>>8)/float(1<<24)*2.0f-1.0f;
+		particles[i].mPosition = CVector3( float(i&7), 0.0f, fz );
+	}
+}
+
+static bool IsFarToNear( const orkvector<BasicParticle>& particles, const ParticleDepthSorter& sorter )
+{
+	const U32* porder = sorter.GetOrder();
+	for( int i=1; i<sorter.GetNumSorted(); i++ )
+		if( particles[porder[i]].mPosition.GetZ() > particles[porder[i-1]].mPosition.GetZ() )
+			return false;
+	return true;
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(ParticleDepthSortOrder)
+{
+	orkvector<BasicParticle> particles;
+	ScatterParticles( particles, 50000 ); // more than the old 20k fixedlut held
+
+	ParticleDepthSorter sorter;
+	sorter.SetParallel( false );
+	sorter.Sort( particles.data(), int(particles.size()), CMatrix4::Identity );
+	CHECK_EQUAL( 50000, sorter.GetNumSorted() );
+	CHECK( IsFarToNear( particles, sorter ) );
+	CHECK_EQUAL( 0, sorter.GetNumCoherentSorts() );
+
+	// unchanged depths reuse the last order
+	sorter.Sort( particles.data(), int(particles.size()), CMatrix4::Identity );
+	CHECK_EQUAL( 1, sorter.GetNumCoherentSorts() );
+	CHECK( IsFarToNear( particles, sorter ) );
+
+	// one particle moving to the back invalidates it
+	particles[10].mPosition.SetZ( 2.0f );
+	sorter.Sort( particles.data(), int(particles.size()), CMatrix4::Identity );
+	CHECK_EQUAL( 1, sorter.GetNumCoherentSorts() );
+	CHECK_EQUAL( 10, int(sorter.GetOrder()[0]) );
+	CHECK( IsFarToNear( particles, sorter ) );
+
+	sorter.Sort( particles.data(), 0, CMatrix4::Identity );
+	CHECK_EQUAL( 0, sorter.GetNumSorted() );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(ParticleDepthSortParallel)
+{
+	const int knum = ParticleDepthSorter::kparallelsize*3+123;
+	orkvector<BasicParticle> particles;
+	ScatterParticles( particles, knum );
+
+	ParticleDepthSorter serial, parallel;
+	serial.SetParallel( false );
+	serial.Sort( particles.data(), knum, CMatrix4::Identity );
+	parallel.Sort( particles.data(), knum, CMatrix4::Identity );
+	CHECK( IsFarToNear( particles, parallel ) );
+
+	// equal depths may come out in either order
+	bool bsame = true;
+	for( int i=0; i<knum; i++ )
+		bsame &= (particles[serial.GetOrder()[i]].mPosition.GetZ()==particles[parallel.GetOrder()[i]].mPosition.GetZ());
+	CHECK( bsame );
+
+	parallel.Sort( particles.data(), knum, CMatrix4::Identity );
+	CHECK_EQUAL( 1, parallel.GetNumCoherentSorts() );
+	CHECK( IsFarToNear( particles, parallel ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// sort cost per frame, radix (serial/parallel, moving and still particles)
+//  against the fixedlut insertion sort it replaced, at the size that held
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(ParticleDepthSortBench)
+{
+	const int knumframes = 8;
+	orkvector<BasicParticle> particles;
+
+	{
+		const int knumlut = 16384;
+		ScatterParticles( particles, knumlut );
+		static ork::fixedlut<float,const BasicParticle*,knumlut> lut(EKEYPOLICY_MULTILUT);
+		ParticleDepthSorter sorter;
+		sorter.SetParallel( false );
+
+		float ft0 = get_sync_time();
+		lut.clear();
+		for( int i=0; i<knumlut; i++ )
+			lut.AddSorted( particles[i].mPosition.GetZ(), & particles[i] );
+		float ft1 = get_sync_time();
+		for( int iframe=0; iframe<knumframes; iframe++ )
+		{
+			particles[iframe].mPosition.SetZ( -2.0f );
+			sorter.Sort( particles.data(), knumlut, CMatrix4::Identity );
+		}
+		float ft2 = get_sync_time();
+		printf( "ParticleDepthSortBench <%d> fixedlut<%f ms> radix<%f ms>\n",
+				knumlut, (ft1-ft0)*1000.0f, (ft2-ft1)*1000.0f/float(knumframes) );
+		CHECK( IsFarToNear( particles, sorter ) );
+	}
+
+	const int knum = 1<<20;
+	ScatterParticles( particles, knum );
+
+	for( int ipass=0; ipass<2; ipass++ )
+	{
+		bool bparallel = (ipass==1);
+		ParticleDepthSorter sorter;
+		sorter.SetParallel( bparallel );
+
+		float ft0 = get_sync_time();
+		for( int iframe=0; iframe<knumframes; iframe++ )
+		{
+			particles[ipass*knumframes+iframe].mPosition.SetZ( -2.0f );
+			sorter.Sort( particles.data(), knum, CMatrix4::Identity );
+		}
+		float ft1 = get_sync_time();
+		for( int iframe=0; iframe<knumframes; iframe++ )
+			sorter.Sort( particles.data(), knum, CMatrix4::Identity );
+		float ft2 = get_sync_time();
+
+		printf( "ParticleDepthSortBench <%d> parallel<%d> moving<%f ms/frame> still<%f ms/frame>\n",
+				knum, int(bparallel), (ft1-ft0)*1000.0f/float(knumframes), (ft2-ft1)*1000.0f/float(knumframes) );
+
+		CHECK( IsFarToNear( particles, sorter ) );
+		CHECK_EQUAL( knumframes, sorter.GetNumCoherentSorts() );
+	}
+}
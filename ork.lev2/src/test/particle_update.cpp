@@ -0,0 +1,220 @@
+#include <ork/pch.h>
+
+#include <unittest++/UnitTest++.h>
+#include <stdio.h>
+
+#include <ork/lev2/gfx/particle/particle.h>
+#include <ork/kernel/opq.h>
+#include <ork/kernel/timer.h>
+
+using namespace ork;
+using namespace ork::lev2::particle;
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+class TestItem : public ParticleItemBase
+{
+};
+
+// emits along +Y with some dispersion (so it draws from the pools stream),
+//  integrates, ages and reaps its own pool
+class TestEmitter : public DirectedEmitter
+{
+public:
+	TestEmitter() { meDirection=EMITDIR_CONSTANT; mDispersionAngle=30.0f; }
+	void ComputePosDir( float fi, CVector3& pos, CVector3& dir ) final
+	{
+		pos = CVector3(fi,0.0f,0.0f);
+		dir = CVector3(0.0f,1.0f,0.0f);
+	}
+};
+
+class TestSystem : public ParticleSystemBase
+{
+public:
+	TestSystem( const TestItem& item, int imax, U32 useed )
+		: ParticleSystemBase(item)
+		, miKey(0)
+	{
+		mPool.Init(imax);
+		mPool.SetRandomSeed(useed);
+		mCtx.mPool = & mPool;
+		mCtx.mDeathQueue = & mDeaths;
+		mCtx.mfEmissionRate = float(imax);
+		mCtx.mfEmissionVelocity = 1.0f;
+		mCtx.mfLifespan = 0.75f;
+		mCtx.mKey = & miKey;
+	}
+
+	// order dependent, so any change in how the pool evolved shows
+	U32 Checksum() const
+	{
+		U32 usum = U32(mPool.GetNumAlive());
+		for( int i=0; i<mPool.GetNumAlive(); i++ )
+		{
+			union { float f; U32 u; } c;
+			c.f = mPool.mPosX[i]+mPool.mVelZ[i];
+			usum = usum*31u+c.u;
+		}
+		return usum;
+	}
+
+private:
+
+	Pool<BasicParticle>	mPool;
+	TestEmitter			mEmitter;
+	EventQueue			mDeaths;
+	EmitterCtx			mCtx;
+	int					miKey;
+
+	void DoUpdate( float fdt ) final
+	{
+		mCtx.mfDeltaTime = fdt;
+		mEmitter.Emit( mCtx );
+		for( int i=0; i<mPool.GetNumAlive(); i++ )
+		{
+			mPool.mAge[i] += fdt;
+			mPool.mPosX[i] += mPool.mVelX[i]*fdt;
+			mPool.mPosY[i] += mPool.mVelY[i]*fdt;
+			mPool.mPosZ[i] += mPool.mVelZ[i]*fdt;
+		}
+		mEmitter.Reap( mCtx );
+		mDeaths.Clear();
+	}
+	void SetEmitterEnable( bool bv ) final {}
+};
+
+static void CreateSystems( const TestItem& item, orkvector<TestSystem*>& systems, int inum, int imax )
+{
+	for( int i=0; i<inum; i++ )
+		systems.push_back( new TestSystem( item, imax, 0x1234567u+U32(i)*0x9e3779b9u ) );
+}
+
+static void DeleteSystems( orkvector<TestSystem*>& systems )
+{
+	for( size_t i=0; i<systems.size(); i++ )
+		delete systems[i];
+	systems.clear();
+}
+
+// groups of igroupsize systems, as a controllable with several systems would queue them
+static void QueueSystems( SystemUpdateBatch& batch, const orkvector<TestSystem*>& systems, int igroupsize, float fdt )
+{
+	for( size_t i=0; i<systems.size(); i++ )
+	{
+		if( 0==(i%igroupsize) )
+			batch.BeginGroup();
+		batch.Queue( systems[i], fdt );
+	}
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(ParticleUpdateBatchGroups)
+{
+	TestItem item;
+	orkvector<TestSystem*> systems;
+	CreateSystems( item, systems, 10, 64 );
+
+	SystemUpdateBatch batch;
+	batch.Queue( systems[0], 0.1f ); // no group begun yet
+	CHECK_EQUAL( 1, batch.GetNumGroups() );
+	QueueSystems( batch, systems, 3, 0.1f );
+	CHECK_EQUAL( 11, batch.GetNumQueued() );
+	CHECK_EQUAL( 5, batch.GetNumGroups() );
+
+	Opq the_opq(2,"psysq");
+	batch.Update( the_opq );
+	CHECK_EQUAL( 0, batch.GetNumQueued() );
+	CHECK_EQUAL( 0, batch.GetNumGroups() );
+	CHECK_CLOSE( 0.2f, systems[0]->GetElapsed(), 0.0001f );
+	CHECK_CLOSE( 0.1f, systems[9]->GetElapsed(), 0.0001f );
+
+	DeleteSystems( systems );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// the same seeds give the same particles, whatever the thread count
+
+TEST(ParticleUpdateBatchDeterministic)
+{
+	const int knumsystems = 64;
+	const int knumframes = 8;
+	const float kdt = 1.0f/30.0f;
+	TestItem item;
+
+	orkvector<TestSystem*> serial;
+	CreateSystems( item, serial, knumsystems, 256 );
+	for( int iframe=0; iframe<knumframes; iframe++ )
+		for( size_t i=0; i<serial.size(); i++ )
+			serial[i]->Update( kdt );
+
+	for( int inumthreads=1; inumthreads<=8; inumthreads*=2 )
+	{
+		Opq the_opq(inumthreads,"psysq",EOPQMODE_WORKSTEALING);
+		orkvector<TestSystem*> batched;
+		CreateSystems( item, batched, knumsystems, 256 );
+		SystemUpdateBatch batch;
+		for( int iframe=0; iframe<knumframes; iframe++ )
+		{
+			QueueSystems( batch, batched, 2, kdt );
+			batch.Update( the_opq );
+		}
+
+		bool bsame = true;
+		for( int i=0; i<knumsystems; i++ )
+			bsame &= (serial[i]->Checksum()==batched[i]->Checksum());
+		CHECK( bsame );
+
+		DeleteSystems( batched );
+	}
+
+	DeleteSystems( serial );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// hundreds of emitters, as in a level : frame time against thread count
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(ParticleUpdateBatchBench)
+{
+	const int knumsystems = 512;
+	const int knumframes = 16;
+	const float kdt = 1.0f/60.0f;
+	TestItem item;
+
+	float fserial = 0.0f;
+	for( int inumthreads=0; inumthreads<=8; inumthreads=inumthreads ? inumthreads*2 : 1 )
+	{
+		orkvector<TestSystem*> systems;
+		CreateSystems( item, systems, knumsystems, 4096 );
+		SystemUpdateBatch batch;
+		Opq* popq = inumthreads ? new Opq(inumthreads,"psysq",EOPQMODE_WORKSTEALING) : nullptr;
+
+		float ft0 = get_sync_time();
+		for( int iframe=0; iframe<knumframes; iframe++ )
+		{
+			if( popq )
+			{
+				QueueSystems( batch, systems, 1, kdt );
+				batch.Update( *popq );
+			}
+			else for( size_t i=0; i<systems.size(); i++ )
+				systems[i]->Update( kdt );
+		}
+		float ft1 = get_sync_time();
+		float fms = (ft1-ft0)*1000.0f/float(knumframes);
+		if( 0==inumthreads )
+			fserial = fms;
+
+		printf( "ParticleUpdateBatchBench %d systems, threads<%d> : %f ms/frame (x%f)\n",
+				knumsystems, inumthreads, fms, fserial/fms );
+
+		delete popq;
+		DeleteSystems( systems );
+	}
+}
@@ -0,0 +1,224 @@
+#include <ork/pch.h>
+
+#include <unittest++/UnitTest++.h>
+#include <stdio.h>
+#include <cmath>
+
+#include <ork/lev2/gfx/gfxanim.h>
+#include <ork/kernel/opq.h>
+#include <ork/kernel/timer.h>
+#include <ork/application/application.h>
+
+using namespace ork;
+using namespace ork::lev2;
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// a spine with 3 branches (arms, head), flattened parent first
+static void CreateSkeleton( XgmSkeleton& skel, int inumjoints )
+{
+	skel.SetNumJoints( inumjoints );
+	for( int ij=0; ij<inumjoints; ij++ )
+	{
+		int iparent = (ij==0) ? -1 : (ij<4) ? ij-1 : ((ij-4)%3==0) ? 3 : ij-3;
+		char name[32];
+		snprintf( name, sizeof(name), "joint%d", ij );
+		skel.AddJoint( ij, iparent, AddPooledString(name) );
+		skel.RefJointMatrix(ij).SetTranslation( 0.0f, 0.25f, 0.0f );
+		if( iparent>=0 )
+		{
+			XgmBone bone;
+			bone.miParent = iparent;
+			bone.miChild = ij;
+			skel.AddFlatBone( bone );
+		}
+	}
+	skel.miRootNode = 0;
+	skel.mTopNodesMatrix.SetTranslation( 1.0f, 2.0f, 3.0f );
+}
+
+static DecompMtx44 JointXf( int ij, int ianim, float ft )
+{
+	float fangle = std::sin( ft+float(ij)*0.37f+float(ianim) )*0.8f;
+	float fs = std::sin(fangle*0.5f), fc = std::cos(fangle*0.5f);
+	DecompMtx44 rval;
+	rval.mRot = (ianim&1) ? CQuaternion( 0.0f, fs, 0.0f, fc ) : CQuaternion( fs*0.6f, 0.0f, fs*0.8f, fc );
+	if( ij%5==0 ) // the other hemisphere, the same rotation
+		rval.mRot = CQuaternion( -rval.mRot.GetX(), -rval.mRot.GetY(), -rval.mRot.GetZ(), -rval.mRot.GetW() );
+	rval.mTrans = CVector3( 0.0f, 0.25f+0.01f*float(ianim), std::sin(ft)*0.05f );
+	rval.mScale = 1.0f+0.1f*float(ianim);
+	return rval;
+}
+
+// inumanims weighted anims per joint, some joints masked to part of the transform
+static void ApplyPose( XgmLocalPose& pose, int inumanims, float ft, bool bmasked )
+{
+	pose.BindPose();
+	for( int ij=0; ij<pose.NumJoints(); ij++ )
+	{
+		EXFORM_COMPONENT comps = (bmasked && (ij%7)==3) ? XFORM_COMPONENT_TRANSORIENT : XFORM_COMPONENT_ALL;
+		for( int ia=0; ia<inumanims; ia++ )
+		{
+			float fw = (inumanims==2) ? ((ia==0) ? 0.7f : 0.3f) : 1.0f/float(inumanims)+0.1f*float(ia);
+			pose.RefBlendPoseInfo(ij).AddPose( JointXf(ij,ia,ft), fw, comps );
+		}
+	}
+}
+
+// BuildPose the way it was : ComputeMatrix per joint, Concat43 per bone
+static void ReferencePose( const XgmSkeleton& skel, const XgmLocalPose& pose, orkvector<CMatrix4>& mats )
+{
+	mats.resize( pose.NumJoints() );
+	for( int ij=0; ij<pose.NumJoints(); ij++ )
+	{
+		mats[ij] = skel.RefJointMatrix(ij);
+		if( pose.RefBlendPoseInfo(ij).GetNumAnims() )
+			pose.RefBlendPoseInfo(ij).ComputeMatrix( mats[ij] );
+	}
+	mats[skel.miRootNode] = mats[skel.miRootNode].Concat43( skel.mTopNodesMatrix );
+	for( int ib=0; ib<skel.GetNumBones(); ib++ )
+	{
+		const XgmBone& bone = skel.GetFlattenedBone(ib);
+		mats[bone.miChild] = mats[bone.miChild].Concat43( mats[bone.miParent] );
+	}
+}
+
+static float MaxDiff( const XgmLocalPose& pose, const orkvector<CMatrix4>& mats )
+{
+	float fmax = 0.0f;
+	for( int ij=0; ij<pose.NumJoints(); ij++ )
+	{
+		const float* pa = pose.RefLocalMatrix(ij).GetArray();
+		const float* pb = mats[ij].GetArray();
+		for( int i=0; i<16; i++ )
+			fmax = std::max( fmax, std::fabs(pa[i]-pb[i]) );
+	}
+	return fmax;
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// the lane blend and row concatenation against ComputeMatrix / Concat43
+
+TEST(PoseBlendMatchesReference)
+{
+	XgmSkeleton skel;
+	CreateSkeleton( skel, 37 );
+	XgmLocalPose pose( skel );
+	orkvector<CMatrix4> ref;
+
+	for( int inumanims=1; inumanims<=3; inumanims++ )
+	{
+		for( int imasked=0; imasked<2; imasked++ )
+		{
+			ApplyPose( pose, inumanims, 0.5f*float(inumanims), 0!=imasked );
+			ReferencePose( skel, pose, ref );
+			pose.BuildPose();
+			CHECK( MaxDiff( pose, ref ) < 1.0e-5f );
+		}
+	}
+
+	// bounds are over the concatenated joints (not the root)
+	CVector3 vmin( 1.0e9f, 1.0e9f, 1.0e9f ), vmax( -1.0e9f, -1.0e9f, -1.0e9f );
+	for( int ij=1; ij<pose.NumJoints(); ij++ )
+	{
+		CVector3 v = ref[ij].GetTranslation();
+		vmin = CVector3( std::min(vmin.GetX(),v.GetX()), std::min(vmin.GetY(),v.GetY()), std::min(vmin.GetZ(),v.GetZ()) );
+		vmax = CVector3( std::max(vmax.GetX(),v.GetX()), std::max(vmax.GetY(),v.GetY()), std::max(vmax.GetZ(),v.GetZ()) );
+	}
+	const AABox& box = pose.RefObjSpaceAABoundingBox();
+	CHECK( (box.Min()-vmin).Mag() < 1.0e-4f );
+	CHECK( (box.Max()-vmax).Mag() < 1.0e-4f );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(PoseBatchMatchesSerial)
+{
+	const int knumposes = 40;
+	XgmSkeleton skel;
+	CreateSkeleton( skel, 25 );
+
+	orkvector<XgmLocalPose*> poses;
+	for( int ip=0; ip<knumposes; ip++ )
+	{
+		poses.push_back( new XgmLocalPose( skel ) );
+		ApplyPose( *poses.back(), 1+(ip%2), float(ip)*0.1f, false );
+	}
+
+	Opq the_opq(4,"posebatch",EOPQMODE_WORKSTEALING);
+	XgmPoseBatch batch;
+	for( int ip=0; ip<knumposes; ip++ )
+		batch.Queue( poses[ip] );
+	CHECK_EQUAL( knumposes, batch.GetNumQueued() );
+	batch.Update( the_opq );
+	CHECK_EQUAL( 0, batch.GetNumQueued() );
+
+	orkvector<CMatrix4> ref;
+	float fmax = 0.0f;
+	for( int ip=0; ip<knumposes; ip++ )
+	{
+		ReferencePose( skel, *poses[ip], ref );
+		fmax = std::max( fmax, MaxDiff( *poses[ip], ref ) );
+		delete poses[ip];
+	}
+	CHECK( fmax < 1.0e-5f );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// a crowd : 500 characters, 64 joints, 2 anims blending
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(PoseBlendBench)
+{
+	const int knumposes = 500;
+	const int knumframes = 8;
+	XgmSkeleton skel;
+	CreateSkeleton( skel, 64 );
+
+	orkvector<XgmLocalPose*> poses;
+	for( int ip=0; ip<knumposes; ip++ )
+	{
+		poses.push_back( new XgmLocalPose( skel ) );
+		ApplyPose( *poses.back(), 2, float(ip)*0.01f, false );
+	}
+
+	orkvector<CMatrix4> ref;
+	float ft0 = get_sync_time();
+	for( int ifr=0; ifr<knumframes; ifr++ )
+		for( int ip=0; ip<knumposes; ip++ )
+			ReferencePose( skel, *poses[ip], ref );
+	float ft1 = get_sync_time();
+	for( int ifr=0; ifr<knumframes; ifr++ )
+		for( int ip=0; ip<knumposes; ip++ )
+			poses[ip]->BuildPose();
+	float ft2 = get_sync_time();
+	float fref = (ft1-ft0)*1000.0f/float(knumframes);
+	float fsoa = (ft2-ft1)*1000.0f/float(knumframes);
+	printf( "PoseBlendBench %d poses : per joint<%f ms/frame> lanes<%f ms/frame> (x%f)\n",
+			knumposes, fref, fsoa, fref/fsoa );
+
+	// blend infos stay until BindPose, so the batch rebuilds the same poses
+	for( int inumthreads=1; inumthreads<=8; inumthreads*=2 )
+	{
+		Opq the_opq(inumthreads,"posebatch",EOPQMODE_WORKSTEALING);
+		XgmPoseBatch batch;
+		float ft3 = get_sync_time();
+		for( int ifr=0; ifr<knumframes; ifr++ )
+		{
+			for( int ip=0; ip<knumposes; ip++ )
+				batch.Queue( poses[ip] );
+			batch.Update( the_opq );
+		}
+		float ft4 = get_sync_time();
+		float fms = (ft4-ft3)*1000.0f/float(knumframes);
+		printf( "PoseBlendBench %d poses, batch threads<%d> : %f ms/frame (x%f)\n",
+				knumposes, inumthreads, fms, fref/fms );
+	}
+
+	for( int ip=0; ip<knumposes; ip++ )
+		delete poses[ip];
+}
@@ -0,0 +1,163 @@
+#include <ork/pch.h>
+
+#include <unittest++/UnitTest++.h>
+#include <thread>
+
+#include <ork/lev2/gfx/renderqueue.h>
+#include <ork/gfx/radixsort.h>
+
+using namespace ork;
+using namespace ork::lev2;
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// the queue never looks inside the renderables it is handed
+const IRenderable* FakeRenderable( int ithread, int i ) { return reinterpret_cast<const IRenderable*>(size_t((ithread<<20)+i+1)*16); }
+
+U64 NextKey( U64& useed )
+{
+	useed = useed*6364136223846793005ull+1442695040888963407ull;
+	return useed;
+}
+
+bool IsSorted( const U64* pkeys, const U32* porder, int inum )
+{
+	for( int i=1; i<inum; i++ )
+		if( pkeys[porder[i]] < pkeys[porder[i-1]] )
+			return false;
+	return true;
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// pass > layer > material > depth, legacy keys keep their order on top
+
+TEST(RenderSortKeyPacking)
+{
+	U64 ukey = RenderSortKey::Compose( 0x12, 0x34, 0x5678, 0x9abcde );
+	CHECK( ukey==0x123456789abcde00ull );
+	CHECK( RenderSortKey::Compose( 0x112, 0x134, 0x15678, 0xff9abcde )==ukey ); // fields are masked
+
+	CHECK( RenderSortKey::Compose(1,0,0,0) > RenderSortKey::Compose(0,0xff,0xffff,RenderSortKey::kmaxdepth) );
+	CHECK( RenderSortKey::Compose(0,1,0,0) > RenderSortKey::Compose(0,0,0xffff,RenderSortKey::kmaxdepth) );
+	CHECK( RenderSortKey::Compose(0,0,1,0) > RenderSortKey::Compose(0,0,0,RenderSortKey::kmaxdepth) );
+
+	CHECK( RenderSortKey::FromLegacy(0x10020003) < RenderSortKey::FromLegacy(0x10030001) );
+	CHECK( RenderSortKey::FromLegacy(0x12345678)==RenderSortKey::Compose(0x12,0x34,0x5678,0) );
+
+	const float krange = 100.0f;
+	CHECK_EQUAL( 0u, RenderSortKey::QuantizeDepth( -5.0f, krange ) );
+	CHECK_EQUAL( RenderSortKey::kmaxdepth, RenderSortKey::QuantizeDepth( 500.0f, krange ) );
+	CHECK( RenderSortKey::QuantizeDepth( 10.0f, krange ) < RenderSortKey::QuantizeDepth( 10.1f, krange ) );
+
+	// transparent passes sort the far ones first
+	CHECK( RenderSortKey::QuantizeDepthBackToFront( 10.0f, krange ) > RenderSortKey::QuantizeDepthBackToFront( 10.1f, krange ) );
+	CHECK_EQUAL( RenderSortKey::kmaxdepth, RenderSortKey::QuantizeDepthBackToFront( -5.0f, krange ) );
+	CHECK_EQUAL( 0u, RenderSortKey::QuantizeDepthBackToFront( 500.0f, krange ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// full range keys (top bit set is not negative), stable on equal keys,
+//  already sorted input keeps the identity order
+
+TEST(RadixSortU64)
+{
+	const int knum = 20000;
+	orkvector<U64> keys(knum);
+	U64 useed = 0x1234567;
+	for( int i=0; i<knum; i++ )
+		keys[i] = NextKey(useed);
+	keys[7] = 0xffffffffffffffffull;
+	keys[8] = 0;
+
+	RadixSort sorter;
+	sorter.Sort( keys.data(), knum );
+	const U32* porder = sorter.GetIndices();
+	CHECK( IsSorted( keys.data(), porder, knum ) );
+	CHECK_EQUAL( 8, int(porder[0]) );
+	CHECK_EQUAL( 7, int(porder[knum-1]) );
+
+	// render queue like keys, few distinct values and constant bytes
+	for( int i=0; i<knum; i++ )
+		keys[i] = RenderSortKey::Compose( 3, 0, U32(NextKey(useed)>>60), 0 );
+	sorter.Sort( keys.data(), knum );
+	porder = sorter.GetIndices();
+	bool bstable = true;
+	for( int i=1; i<knum; i++ )
+		bstable &= (keys[porder[i]]!=keys[porder[i-1]]) || (porder[i]>porder[i-1]);
+	CHECK( IsSorted( keys.data(), porder, knum ) );
+	CHECK( bstable );
+
+	U32 uhits = sorter.GetNbHits();
+	for( int i=0; i<knum; i++ )
+		keys[i] = U64(i)<<8;
+	sorter.Sort( keys.data(), knum );
+	porder = sorter.GetIndices();
+	bool bidentity = true;
+	for( int i=0; i<knum; i++ )
+		bidentity &= (int(porder[i])==i);
+	CHECK_EQUAL( uhits+1, sorter.GetNbHits() );
+	CHECK( bidentity );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// one segment per queueing thread, merged in segment order on export,
+//  Reset hands the segments to whoever queues first next frame.
+//  each thread's pick object stays with its own nodes
+
+TEST(RenderQueueSegments)
+{
+	const int knumthreads = 6;
+	const int kperthread = 3000;
+
+	RenderQueue queue;
+
+	for( int iframe=0; iframe<2; iframe++ )
+	{
+		queue.Reset();
+
+		std::vector<std::thread> threads;
+		for( int it=0; it<knumthreads; it++ )
+			threads.push_back( std::thread( [&queue,it]()
+			{
+				queue.ThreadSegment().mpPickObject = reinterpret_cast<const Object*>(FakeRenderable(it,0));
+				for( int i=0; i<kperthread; i++ )
+					queue.QueueRenderable( FakeRenderable(it,i), nullptr );
+			}));
+		for( auto& t : threads )
+			t.join();
+
+		CHECK_EQUAL( knumthreads, queue.NumSegments() );
+		CHECK_EQUAL( size_t(knumthreads*kperthread), queue.Size() );
+
+		orkvector<const RenderQueue::Node*> nodes;
+		queue.ExportRenderableNodes( nodes );
+		CHECK_EQUAL( size_t(knumthreads*kperthread), nodes.size() );
+
+		// each thread's nodes are contiguous and in queue order
+		bool border = true;
+		for( size_t n=0; n<nodes.size(); n+=kperthread )
+		{
+			size_t uthread = (reinterpret_cast<size_t>(nodes[n]->mpRenderable)/16-1)>>20;
+			const Object* ppick = reinterpret_cast<const Object*>(FakeRenderable(int(uthread),0));
+			for( int i=0; i<kperthread; i++ )
+			{
+				border &= (nodes[n+i]->mpRenderable==FakeRenderable(int(uthread),i));
+				border &= (nodes[n+i]->mpContextObject==ppick);
+			}
+		}
+		CHECK( border );
+	}
+
+	// the same thread queueing twice a frame stays in its segment
+	queue.Reset();
+	CHECK( nullptr==queue.ThreadSegment().mpPickObject );
+	queue.ThreadSegment().QueueRenderable( FakeRenderable(0,0), nullptr );
+	queue.ThreadSegment().QueueRenderable( FakeRenderable(0,1), nullptr );
+	CHECK_EQUAL( 1, queue.NumSegments() );
+	CHECK_EQUAL( size_t(2), queue.Size() );
+	CHECK_EQUAL( 0, queue.ThreadSegment().GetIndex() );
+}
@@ -0,0 +1,251 @@
+#include <ork/pch.h>
+
+#include <unittest++/UnitTest++.h>
+#include <stdio.h>
+#include <cmath>
+
+#include <ork/kernel/timer.h>
+#include "../aud/singularity/synth.h"
+
+using namespace ork;
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const float kcycle = 37.3f; // samples per sine cycle
+const float kamp = 16000.0f;
+
+struct TestSample
+{
+	TestSample( int inumframes, int iloopstart, eLoopMode mode, float fcycle=kcycle )
+	{
+		_data.resize(inumframes);
+		for( int i=0; i<inumframes; i++ )
+			_data[i] = s16( kamp*sinf(float(pi2)*float(i)/fcycle) );
+		_sample._sampleBlock = _data.data();
+		_sample._blk_start = 0;
+		_sample._blk_loopstart = iloopstart;
+		_sample._blk_loopend = inumframes-1;
+		_sample._blk_end = inumframes-1;
+		_sample._loopMode = mode;
+		_sample._sampleRate = 48000.0f;
+	}
+	std::vector<s16> _data;
+	sample _sample;
+};
+
+// what keyOn sets up for playback
+static void StartOsc( sampleOsc& osc, const sample& s, eInterpMode interp, float fratio )
+{
+	osc._sample = &s;
+	osc._blk_start = int64_t(s._blk_start)<<16;
+	osc._blk_alt = int64_t(s._blk_alt)<<16;
+	osc._blk_loopstart = int64_t(s._blk_loopstart)<<16;
+	osc._blk_loopend = int64_t(s._blk_loopend)<<16;
+	osc._blk_end = int64_t(s._blk_end)<<16;
+	osc._pbindex = osc._blk_start;
+	osc._pbincrem = int64_t(fratio*65536.0f);
+	osc._loopMode = s._loopMode;
+	osc._interpMode = interp;
+	osc._loopCounter = 0;
+	osc._forwarddir = true;
+	osc._active = true;
+}
+
+static void Play( sampleOsc& osc, int inumfr )
+{
+	switch( osc._loopMode )
+	{
+		case eLoopMode::FWD: osc.playLoopFwd(inumfr); break;
+		case eLoopMode::BIDIR: osc.playLoopBid(inumfr); break;
+		default: osc.playNoLoop(inumfr); break;
+	}
+}
+
+// the per sample playback sampleOsc had (linear only)
+struct RefOsc
+{
+	RefOsc( const sample& s, float fratio )
+		: _s(s)
+		, _pbindex( int64_t(s._blk_start)<<16 )
+		, _pbincrem( int64_t(fratio*65536.0f) )
+	{
+	}
+	float play()
+	{
+		int64_t end = _s._blk_end, ls = _s._blk_loopstart, le = _s._blk_loopend;
+		int64_t next = _pbindex+_pbincrem;
+		if( _s._loopMode==eLoopMode::FWD && (next>>16)>le )
+			next = (ls<<16)+(next-(le<<16))-(1<<16);
+		float fract = float(_pbindex&0xffff)*sampleOsc::kinv64k;
+		int64_t iiA = _pbindex>>16;
+		int64_t iiB = iiA+1;
+		if( _s._loopMode==eLoopMode::FWD )
+		{
+			if( iiB>le ) iiB = ls;
+		}
+		else
+		{
+			iiA = std::min(iiA,end);
+			iiB = std::min(iiB,end);
+		}
+		float a = float(_s._sampleBlock[iiA]);
+		float b = float(_s._sampleBlock[iiB]);
+		_pbindex = next;
+		return (b*fract+a*(1.0f-fract))*sampleOsc::kinv32k;
+	}
+	const sample& _s;
+	int64_t _pbindex;
+	int64_t _pbincrem;
+};
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// linear block playback against the per sample loop, through the loop
+//  point (fwd) and past the end (no loop), at odd block sizes
+
+TEST(SampleOscLinearMatchesPerSample)
+{
+	const eLoopMode modes[2] = { eLoopMode::NONE, eLoopMode::FWD };
+	for( int im=0; im<2; im++ )
+	{
+		for( float fratio : { 0.37f, 1.0f, 1.9f, 3.3f } )
+		{
+			TestSample ts( 300, 211, modes[im] );
+			sampleOsc osc;
+			StartOsc( osc, ts._sample, eInterpMode::LINEAR, fratio );
+			RefOsc ref( ts._sample, fratio );
+
+			float fmax = 0.0f;
+			for( int iblk=0; iblk<40; iblk++ )
+			{
+				int inumfr = 13+(iblk*7)%50;
+				Play( osc, inumfr );
+				for( int i=0; i<inumfr; i++ )
+					fmax = std::max( fmax, std::fabs(osc._OUTPUT[i]-ref.play()) );
+			}
+			CHECK( fmax < 1.0e-5f );
+			CHECK( osc._pbindex == ref._pbindex );
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// each interpolator against the sine the sample was made from, a high one
+//  (5 samples per cycle) where the short interpolators fall behind
+
+TEST(SampleOscInterpAccuracy)
+{
+	const float kshortcycle = 5.1f;
+	TestSample ts( 4096, 0, eLoopMode::NONE, kshortcycle );
+	const eInterpMode interps[3] = { eInterpMode::LINEAR, eInterpMode::HERMITE, eInterpMode::SINC };
+	float ferr[3];
+	for( int ii=0; ii<3; ii++ )
+	{
+		sampleOsc osc;
+		StartOsc( osc, ts._sample, interps[ii], 0.6180339f );
+		ferr[ii] = 0.0f;
+		for( int iblk=0; iblk<16; iblk++ )
+		{
+			int64_t pos = osc._pbindex;
+			osc.playNoLoop(128);
+			for( int i=0; i<128; i++, pos+=osc._pbincrem )
+			{
+				if( (pos>>16)<4 ) // edge taps clamp to the start
+					continue;
+				float fexpect = (kamp/32768.0f)*sinf(float(pi2)*float(double(pos)/65536.0)/kshortcycle);
+				ferr[ii] = std::max( ferr[ii], std::fabs(osc._OUTPUT[i]-fexpect) );
+			}
+		}
+	}
+	printf( "SampleOscInterpAccuracy max error : linear<%g> hermite<%g> sinc<%g>\n", ferr[0], ferr[1], ferr[2] );
+	CHECK( ferr[1] < ferr[0] );
+	CHECK( ferr[2] < ferr[1] );
+	CHECK( ferr[2] < 0.01f );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// bidirectional loops stay inside the loop and have no jumps at the turns
+
+TEST(SampleOscBidir)
+{
+	TestSample ts( 400, 150, eLoopMode::BIDIR );
+	for( int ii=0; ii<3; ii++ )
+	{
+		sampleOsc osc;
+		StartOsc( osc, ts._sample, eInterpMode(ii), 1.3f );
+		float fprev = 0.0f, fmaxstep = 0.0f;
+		for( int iblk=0; iblk<50; iblk++ )
+		{
+			osc.playLoopBid(64);
+			for( int i=0; i<64; i++ )
+			{
+				fmaxstep = std::max( fmaxstep, std::fabs(osc._OUTPUT[i]-fprev) );
+				fprev = osc._OUTPUT[i];
+			}
+			CHECK( (osc._pbindex>>16) >= 0 );
+			CHECK( (osc._pbindex>>16) <= ts._sample._blk_loopend );
+		}
+		CHECK( osc._loopCounter > 10 );
+		// a sine step at this rate is at most 2*pi*1.3/kcycle of the amplitude,
+		//  give the sinc some ringing where the turn kinks the waveform
+		CHECK( fmaxstep < (kamp/32768.0f)*float(pi2)*1.3f/kcycle*1.25f );
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// a voice worth of sample playback : the per sample loop (with its per sample
+//  pitch update) against the block renderer per interpolator
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(SampleOscBench)
+{
+	const int knumblocks = 20000;
+	const int knumframes = 256;
+	TestSample ts( 48000, 1000, eLoopMode::FWD );
+
+	sampleOsc refosc;
+	StartOsc( refosc, ts._sample, eInterpMode::LINEAR, 1.0f );
+	refosc._dt = 1.0f/48000.0f;
+	refosc._sampleRoot = 60;
+	refosc._curcents = 6700;
+	RefOsc ref( ts._sample, 1.0f );
+
+	float ft0 = get_sync_time();
+	float fsum = 0.0f;
+	for( int iblk=0; iblk<knumblocks; iblk++ )
+		for( int i=0; i<knumframes; i++ )
+		{
+			refosc.updateFreqRatio();
+			refosc.setSrRatio(refosc._curSampSRratio);
+			ref._pbincrem = refosc._pbincrem;
+			fsum += ref.play();
+		}
+	float ft1 = get_sync_time();
+	float fref = (ft1-ft0)*1.0e6f/float(knumblocks);
+
+	const char* names[3] = { "linear", "hermite", "sinc" };
+	for( int ii=0; ii<3; ii++ )
+	{
+		sampleOsc osc;
+		StartOsc( osc, ts._sample, eInterpMode(ii), 1.0f );
+		osc._dt = 1.0f/48000.0f;
+		osc._sampleRoot = 60;
+		osc._curcents = 6700;
+		float ft2 = get_sync_time();
+		for( int iblk=0; iblk<knumblocks; iblk++ )
+		{
+			osc.updateFreqRatio();
+			osc.setSrRatio(osc._curSampSRratio);
+			osc.playLoopFwd(knumframes);
+			fsum += osc._OUTPUT[0];
+		}
+		float ft3 = get_sync_time();
+		float fus = (ft3-ft2)*1.0e6f/float(knumblocks);
+		printf( "SampleOscBench %d frames : per sample<%f us> block %s<%f us> (x%f)\n",
+				knumframes, fref, names[ii], fus, fref/fus );
+	}
+	CHECK( fsum==fsum );
+}
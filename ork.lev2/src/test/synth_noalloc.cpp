@@ -0,0 +1,131 @@
+#include <ork/pch.h>
+
+#include <unittest++/UnitTest++.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+
+#include <ork/kernel/atomic.h>
+#include "../aud/singularity/synth.h"
+
+using namespace ork;
+
+///////////////////////////////////////////////////////////////////////////////
+// counting allocator (whole test binary, only counts while enabled)
+///////////////////////////////////////////////////////////////////////////////
+
+static ork::atomic<int> gnumallocs(0);
+static ork::atomic<bool> gcountallocs(false);
+
+void* operator new(size_t size)
+{
+	if( gcountallocs.load(MemRelaxed) )
+		gnumallocs++;
+	void* ptr = malloc(size ? size : 1);
+	if( nullptr == ptr )
+		throw std::bad_alloc();
+	return ptr;
+}
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct NoteStream
+{
+	static const int knumlayers = 3; // 128 held notes is more than kmaxvoices
+
+	NoteStream( synth& syn )
+		: _syn(syn)
+	{
+		for( int i=0; i<knumlayers; i++ )
+			_pd._layerDatas.push_back(&_ld[i]);
+		for( int i=0; i<128; i++ )
+			_playing[i] = nullptr;
+	}
+	~NoteStream()
+	{
+		_pd._layerDatas.clear();
+	}
+
+	// a block's worth of note ons and offs, spread over the block
+	void schedule( int iblock, float fblocktime )
+	{
+		for( int i=0; i<8; i++ )
+		{
+			int note = (iblock*37+i*11)%128;
+			float t = _syn._timeaccum + fblocktime*float(i)/8.0f;
+			if( 3==(i&3) ) // mostly note ons, so the voices run out
+			{
+				_syn.addEvent( t, [this,note]()
+				{
+					if( _playing[note] )
+						_syn.keyOff(_playing[note]);
+					_playing[note] = nullptr;
+				});
+			}
+			else
+			{
+				_syn.addEvent( t, [this,note]()
+				{
+					if( _playing[note] )
+						_syn.keyOff(_playing[note]);
+					_playing[note] = _syn.keyOn(note,&_pd);
+				});
+			}
+		}
+	}
+
+	synth& _syn;
+	layerData _ld[knumlayers];
+	programData _pd;
+	programInst* _playing[128];
+};
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// a dense note stream (voices stolen every block) through the threaded
+//  renderer, for both steal modes, must not touch the heap
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(SynthComputeNoAlloc)
+{
+	const int knumblocks = 400;
+	const int knumframes = 64;
+
+	for( int imode=0; imode<2; imode++ )
+	{
+		synth syn( 48000.0f, 2 );
+		syn._genmode = 1;
+		syn._stealMode = eStealMode(imode);
+		NoteStream stream(syn);
+		float fblocktime = float(knumframes)*syn._dt;
+
+		for( int ib=0; ib<4; ib++ ) // warm up
+		{
+			stream.schedule( ib, fblocktime );
+			syn.compute( knumframes, nullptr );
+		}
+
+		gnumallocs = 0;
+		gcountallocs = true;
+		for( int ib=0; ib<knumblocks; ib++ )
+		{
+			stream.schedule( ib, fblocktime );
+			syn.compute( knumframes, nullptr );
+		}
+		gcountallocs = false;
+
+		printf( "SynthComputeNoAlloc mode<%d> blocks<%d> stolen<%d> active<%d> allocs<%d>\n",
+				imode, knumblocks, syn._numStolen, syn._activeVoices.size(), int(gnumallocs) );
+
+		CHECK_EQUAL( 0, int(gnumallocs) );
+		CHECK( syn._numStolen > 0 );
+		CHECK_EQUAL( synth::kmaxvoices, syn._activeVoices.size()+syn._freeVoices.size() );
+	}
+}
@@ -0,0 +1,172 @@
+#include <ork/pch.h>
+
+#include <unittest++/UnitTest++.h>
+#include <stdio.h>
+#include <cmath>
+
+#include <ork/kernel/timer.h>
+#include "../aud/singularity/synth.h"
+
+using namespace ork;
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// layers with no dsp blocks, sine forced so each voice makes a distinct tone
+static void StartVoices( synth& syn, layerData& ld, int inumvoices )
+{
+	syn._genmode = 1;
+	for( int i=0; i<inumvoices; i++ )
+	{
+		auto l = syn.allocLayer();
+		l->_ldindex = 0;
+		l->keyOn( 24+(i%80), 96, &ld );
+	}
+}
+
+static void RenderBlocks( synth& syn, int inumblocks, int inumframes, std::vector<float>& out )
+{
+	out.clear();
+	for( int ib=0; ib<inumblocks; ib++ )
+	{
+		syn.compute( inumframes, nullptr );
+		out.insert( out.end(), syn._obuf._leftBuffer, syn._obuf._leftBuffer+inumframes );
+		out.insert( out.end(), syn._obuf._rightBuffer, syn._obuf._rightBuffer+inumframes );
+	}
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// threaded voices against the callback rendering them all
+
+TEST(SynthVoicesMatchSerial)
+{
+	const int knumvoices = 48;
+	layerData ld;
+
+	synth serial( 48000.0f, 0 );
+	StartVoices( serial, ld, knumvoices );
+	std::vector<float> ref;
+	RenderBlocks( serial, 16, 256, ref );
+
+	for( int inumworkers=1; inumworkers<=4; inumworkers++ )
+	{
+		synth threaded( 48000.0f, inumworkers );
+		CHECK_EQUAL( inumworkers, threaded._voiceWorkers->numWorkers() );
+		StartVoices( threaded, ld, knumvoices );
+		std::vector<float> out;
+		RenderBlocks( threaded, 16, 256, out );
+
+		// the same samples up to the order voices are summed
+		float fmax = 0.0f;
+		for( size_t i=0; i<ref.size(); i++ )
+			fmax = std::max( fmax, std::fabs(ref[i]-out[i]) );
+		CHECK( fmax < 1.0e-4f );
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// voices releasing themselves while others render (keyOff from the event queue)
+
+TEST(SynthVoicesRelease)
+{
+	const int knumvoices = 64;
+	layerData ld;
+	synth syn( 48000.0f, 3 );
+	StartVoices( syn, ld, knumvoices );
+	std::vector<float> out;
+	RenderBlocks( syn, 2, 128, out );
+	CHECK_EQUAL( knumvoices, int(syn._activeVoices.size()) );
+
+	std::vector<layer*> voices;
+	for( auto l=syn._activeVoices.front(); l!=nullptr; l=l->_listNext )
+		voices.push_back(l);
+	for( int i=0; i<knumvoices; i+=2 )
+	{
+		auto l = voices[i];
+		syn.addEvent( 0.0f, [l](){ l->keyOff(); } );
+	}
+	RenderBlocks( syn, 2, 128, out );
+	CHECK_EQUAL( knumvoices/2, int(syn._activeVoices.size()) );
+	CHECK_EQUAL( synth::kmaxvoices-knumvoices/2, int(syn._freeVoices.size()) );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// past full polyphony keyOn takes over a busy voice : the oldest one,
+//  or the one that was quietest over the last block
+
+TEST(SynthVoiceSteal)
+{
+	layerData ld;
+	std::vector<float> out;
+
+	synth oldest( 48000.0f, 0 );
+	StartVoices( oldest, ld, synth::kmaxvoices );
+	layer* first = oldest._activeVoices.front();
+	layer* second = first->_listNext;
+	RenderBlocks( oldest, 1, 64, out );
+	CHECK( oldest._freeVoices.empty() );
+	CHECK( first == oldest.allocLayer() );
+	CHECK( second == oldest.allocLayer() );
+	CHECK( second == oldest._activeVoices._tail ); // stolen voices are the newest
+	CHECK_EQUAL( 2, oldest._numStolen );
+	CHECK_EQUAL( synth::kmaxvoices, oldest._activeVoices.size() );
+
+	synth quietest( 48000.0f, 0 );
+	quietest._stealMode = eStealMode::QUIETEST;
+	StartVoices( quietest, ld, synth::kmaxvoices );
+	layer* quiet = nullptr;
+	int i = 0;
+	for( auto l=quietest._activeVoices.front(); l!=nullptr; l=l->_listNext, i++ )
+	{
+		l->_layerGain = (i==100) ? 0.1f : 1.0f;
+		if( i==100 )
+			quiet = l;
+	}
+	RenderBlocks( quietest, 1, 64, out );
+	CHECK( quiet == quietest.allocLayer() );
+	CHECK_EQUAL( 1, quietest._numStolen );
+
+	// a voice released this block is reused before anything is stolen
+	layer* released = quietest._activeVoices.front();
+	layer* realloced = nullptr;
+	quietest.addEvent( 0.0f, [&quietest,released,&realloced]()
+	{
+		released->keyOff();
+		realloced = quietest.allocLayer();
+	});
+	RenderBlocks( quietest, 1, 64, out );
+	CHECK( released == realloced );
+	CHECK_EQUAL( 1, quietest._numStolen );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// full polyphony : callback time against worker count
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(SynthVoicesBench)
+{
+	const int knumblocks = 64;
+	const int knumframes = 256;
+	layerData ld;
+	std::vector<float> out;
+
+	float fserial = 0.0f;
+	for( int inumworkers=0; inumworkers<=7; inumworkers=inumworkers ? inumworkers*2+1 : 1 )
+	{
+		synth syn( 48000.0f, inumworkers );
+		StartVoices( syn, ld, synth::kmaxvoices );
+
+		float ft0 = get_sync_time();
+		RenderBlocks( syn, knumblocks, knumframes, out );
+		float ft1 = get_sync_time();
+		float fus = (ft1-ft0)*1.0e6f/float(knumblocks);
+		if( 0==inumworkers )
+			fserial = fus;
+
+		printf( "SynthVoicesBench %d voices, workers<%d> : %f us/block (x%f) budget<%f us>\n",
+				synth::kmaxvoices, inumworkers, fus, fserial/fus, float(knumframes)*1.0e6f/48000.0f );
+	}
+}
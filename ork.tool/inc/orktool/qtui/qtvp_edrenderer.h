@@ -34,7 +34,7 @@ private:
 	void RenderCallback( const lev2::CallbackRenderable & cbren ) const override;
 
 
-	U32 ComposeSortKey( U32 texIndex, U32 depthIndex, U32 passIndex, U32 transIndex ) const override;
+	U64 ComposeSortKey( U32 texIndex, U32 depthIndex, U32 passIndex, U32 transIndex ) const override;
 
 
 	lev2::Texture*			mTopSkyEnvMap;
@@ -566,7 +566,7 @@ void CManipManager::Queue(ork::lev2::Renderer* prend)
 
 		CallbackRenderable& rable = prend->QueueCallback();
 		rable.SetUserData0( ap );
-		rable.SetSortKey(0x7fffffff);
+		rable.SetSortKey(RenderSortKey::FromLegacy(IRenderable::kManipRenderableSortKey));
 		rable.SetRenderCallback( ManipRenderCallback );
 	}
 	
@@ -29,10 +29,12 @@ bool DAEXGAFilter::ConvertAsset( const tokenlist& toklist )
 	ork::tool::FilterOptMap options;
 	options.SetDefault( "-in" ,"yo" );
 	options.SetDefault( "-out" ,"yo" );
+	options.SetDefault( "-compress" ,"true" );
 	options.SetOptions( toklist );
 
 	const std::string inf = options.GetOption( "-in" )->GetValue();
 	const std::string outf = options.GetOption( "-out" )->GetValue();
+	bool bCOMPRESS = options.GetOption( "-compress" )->GetValue()=="true";
 
 	ColladaExportPolicy policy;
 	policy.mUnits = UNITS_METER;
@@ -168,6 +170,15 @@ bool DAEXGAFilter::ConvertAsset( const tokenlist& toklist )
 			StaticPose.AddSorted( ChannelPooledName, decmtx );
 		}
 
+		////////////////////////
+		// joint channels to key reduced, quantized tracks
+		////////////////////////
+
+		if( bCOMPRESS )
+		{
+			colanim->mXgmAnim.CompressJointChannels( ork::lev2::XgmAnimCompression() );
+		}
+
 		////////////////////////
 
 		brval = ork::lev2::XgmAnim::Save( file::Path(outf.c_str()), & colanim->mXgmAnim );
@@ -211,6 +222,14 @@ bool XgmAnim::Save( const AssetPath& Filename, const XgmAnim *anm )
 
 	const XgmAnim::JointChannelsMap & JointChannels = anm->RefJointChannels();
 
+	///////////////////////////////////
+	// compressed joint channels go in the "animtracks" stream
+	//  (its presence tells the loader), all of them or none
+	///////////////////////////////////
+
+	bool bcompressed = (JointChannels.size()!=0) && JointChannels.begin()->second->IsCompressed();
+	chunkfile::OutputStream* TrackStream = bcompressed ? chunkwriter.AddStream("animtracks") : 0;
+
 	HeaderStream->AddItem( int(JointChannels.size()) );
 	for( XgmAnim::JointChannelsMap::const_iterator it=JointChannels.begin(); it!=JointChannels.end(); it++ )
 	{
@@ -219,11 +238,25 @@ bool XgmAnim::Save( const AssetPath& Filename, const XgmAnim *anm )
 		const XgmDecompAnimChannel* MtxChannel = rtti::autocast( it->second );
 		const PoolString& ObjectName = MtxChannel->GetObjectName();
 
-		int idataoffset = AnimDataStream->GetSize();
-
-		if( MtxChannel )
+		int idataoffset = bcompressed ? TrackStream->GetSize() : AnimDataStream->GetSize();
+
+		if( bcompressed )
+		{	OrkAssert( MtxChannel->IsCompressed() );
+			const XgmAnimTrack& trk = *MtxChannel->GetTrack();
+			for( int ic=0; ic<XgmAnimTrack::ECOMP_COUNT; ic++ )
+				TrackStream->AddItem( trk.mComponents[ic].miNumKeys );
+			for( int ia=0; ia<3; ia++ ) TrackStream->AddItem( trk.mPosMin[ia] );
+			for( int ia=0; ia<3; ia++ ) TrackStream->AddItem( trk.mPosExtent[ia] );
+			TrackStream->AddItem( trk.mScaleMin );
+			TrackStream->AddItem( trk.mScaleExtent );
+			for( size_t ik=0; ik<trk.mKeyFrames.size(); ik++ ) TrackStream->AddItem( trk.mKeyFrames[ik] );
+			for( size_t iv=0; iv<trk.mValues.size(); iv++ ) TrackStream->AddItem( trk.mValues[iv] );
+			if( (trk.mKeyFrames.size()+trk.mValues.size())&1 )
+				TrackStream->AddItem( (unsigned short) 0 );
+		}
+		else if( MtxChannel )
 		{	for( int ifr=0; ifr<inumframes; ifr++ )
-			{	const DecompMtx44 & Matrix = MtxChannel->GetFrame(ifr);
+			{	const DecompMtx44 Matrix = MtxChannel->GetFrame(ifr);
 				AnimDataStream->AddItem( Matrix );
 			}
 		}
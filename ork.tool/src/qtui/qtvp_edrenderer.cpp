@@ -44,7 +44,7 @@ void Renderer::Init( )
 
 ///////////////////////////////////////////////////////////////////////////////
 
-U32 Renderer::ComposeSortKey( U32 texIndex, U32 depthIndex, U32 passIndex, U32 transIndex ) const
+U64 Renderer::ComposeSortKey( U32 texIndex, U32 depthIndex, U32 passIndex, U32 transIndex ) const
 {
 	return 0;
 }